@@ -0,0 +1,550 @@
+/*
+* arena.cpp
+*
+* NodeArena implementations
+*
+* DO NOT compile this file, it is included at the bottom of arena.h
+*/
+
+#include <new>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/*
+* Constructs an empty arena, no memory is allocated until first use
+* @param hugePages true to back slabs with transparent huge pages
+*/
+template<class N>
+NodeArena<N>::NodeArena(bool hugePages)
+
+	:hugePages(hugePages) {}
+
+/*
+* Releases every slab unless another arena shares them,
+* nodes still alive are NOT destroyed
+*/
+template<class N>
+NodeArena<N>::~NodeArena() {
+
+}
+
+/*
+* Move constructor, takes every slab of other in O(1), nodes keep
+* their addresses and other is left empty
+* @param other The arena to move from
+*/
+template<class N>
+NodeArena<N>::NodeArena(NodeArena<N>&& other) noexcept
+
+	:pool(std::move(other.pool)), hugePages(other.hugePages) {}
+
+/*
+* Move assignment, swaps slabs with other in O(1), so what this
+* held is released with other
+* @param other The arena to move from
+* @return this by reference
+*/
+template<class N>
+NodeArena<N>& NodeArena<N>::operator=(NodeArena<N>&& other) noexcept {
+
+	this->pool.swap(other.pool);
+
+	std::swap(this->hugePages, other.hugePages);
+
+	return *this;
+}
+
+/*
+* Constructs a node in a free slot
+* @param args The arguments for the node's constructor
+* @return pointer to the new node
+*/
+template<class N>
+template<class... Args>
+N* NodeArena<N>::create(Args&&... args) {
+
+	Slot* slot = this->takeSlot();
+
+	try {
+
+		return ::new (static_cast<void*>(slot->storage)) N(std::forward<Args>(args)...);
+
+	} catch (...) {
+
+		this->recycle(reinterpret_cast<N*>(slot));
+
+		throw;
+	}
+}
+
+/*
+* Destroys a node created by this arena and recycles its slot
+* @param node The node to destroy
+*/
+template<class N>
+void NodeArena<N>::destroy(N* node) {
+
+	if (node != nullptr) {
+
+		node->~N();
+
+		this->recycle(node);
+	}
+}
+
+/*
+* Recycles the slot of a node whose destructor already ran
+* @param node The node whose slot is recycled
+*/
+template<class N>
+void NodeArena<N>::recycle(N* node) {
+
+	Slot* slot = reinterpret_cast<Slot*>(node);
+
+	std::unique_lock<std::mutex> lock = NodeArena<N>::guard(*this->pool);
+
+	slot->next = this->pool->freeList;
+	this->pool->freeList = slot;
+}
+
+/*
+* Makes sure the next n nodes can be created without allocating
+* @param n The number of nodes to make room for
+*/
+template<class N>
+void NodeArena<N>::reserve(std::size_t n) {
+
+	Pool& pool = this->acquire();
+
+	std::unique_lock<std::mutex> lock = NodeArena<N>::guard(pool);
+
+	std::size_t available = static_cast<std::size_t>(pool.bumpEnd - pool.bump);
+
+	if (n > available) {
+
+		this->grow(n);
+	}
+}
+
+/*
+* Takes uninitialized storage for n nodes in a row. The nodes are
+* constructed with createAt, possibly from several threads, and can
+* later be destroyed or recycled one by one like any other node.
+* @param n The number of nodes
+* @return the first slot of the run
+*/
+template<class N>
+N* NodeArena<N>::takeRun(std::size_t n) {
+
+	Pool& pool = this->acquire();
+
+	std::unique_lock<std::mutex> lock = NodeArena<N>::guard(pool);
+
+	if (n > static_cast<std::size_t>(pool.bumpEnd - pool.bump)) {
+
+		this->grow(n);
+	}
+
+	Slot* run = pool.bump;
+
+	pool.bump += n;
+
+	return reinterpret_cast<N*>(run);
+}
+
+/*
+* Constructs node i of a run taken with takeRun
+* @param run The first slot of the run
+* @param i The index of the node in the run
+* @param args The arguments for the node's constructor
+* @return pointer to the new node
+*/
+template<class N>
+template<class... Args>
+N* NodeArena<N>::createAt(N* run, std::size_t i, Args&&... args) {
+
+	return ::new (static_cast<void*>(run + i)) N(std::forward<Args>(args)...);
+}
+
+/*
+* Forgets every node at once, the destructors are NOT run.
+* The most recent slab is kept for reuse and all others are released.
+* When another arena shares the slabs this arena only lets go of
+* them, the slots come back when the last sharing arena is gone.
+*/
+template<class N>
+void NodeArena<N>::reset() {
+
+	if (this->pool == nullptr) {
+
+		return;
+	}
+
+	if (this->pool.use_count() > 1) {
+
+		this->pool.reset();
+
+		return;
+	}
+
+	Pool& pool = *this->pool;
+
+	// the other arenas are gone, and taking the lock sees the last of
+	// what they did on other threads
+	std::unique_lock<std::mutex> lock = NodeArena<N>::guard(pool);
+
+	pool.locking = false;
+
+	if (!pool.slabs.empty()) {
+
+		Slab last = pool.slabs.back();
+
+		pool.slabs.pop_back();
+
+		for (const Slab& slab : pool.slabs) {
+
+			NodeArena<N>::releaseSlab(slab);
+		}
+
+		pool.slabs.clear();
+		pool.slabs.push_back(last);
+
+		pool.bump = last.slots;
+		pool.bumpEnd = last.slots + last.count;
+	}
+
+	pool.freeList = nullptr;
+}
+
+/*
+* Makes the nodes of other and this arena come from the same slabs,
+* so nodes of either may be destroyed through either arena. An arena
+* without slabs just shares the other's, otherwise the slabs of the
+* one that shares them with nobody else are handed over, in O(slabs)
+* plus O(free slots). Both arenas must not be in use on other threads
+* during absorb, afterwards they can be.
+* @param other The arena whose nodes this arena takes in
+* @return true if the arenas share their slabs, false if both already
+*         share them with other arenas and nothing changed
+*/
+template<class N>
+bool NodeArena<N>::absorb(NodeArena<N>& other) {
+
+	if (other.pool == nullptr || other.pool == this->pool) {
+
+		return true;
+	}
+
+	if (this->pool == nullptr) {
+
+		this->pool = other.pool;
+
+	} else if (other.pool.use_count() == 1) {
+
+		NodeArena<N>::merge(*this->pool, *other.pool);
+
+		other.pool = this->pool;
+
+	} else if (this->pool.use_count() == 1) {
+
+		NodeArena<N>::merge(*other.pool, *this->pool);
+
+		this->pool = other.pool;
+
+	} else {
+
+		return false;
+	}
+
+	// a pool already shared may be read by other threads, which never
+	// write the flag
+	if (!this->pool->locking) {
+
+		this->pool->locking = true;
+	}
+
+	return true;
+}
+
+/*
+* Turns huge page backing on or off for slabs allocated from now on
+* @param enable true to use huge pages
+*/
+template<class N>
+void NodeArena<N>::setHugePages(bool enable) {
+
+	this->hugePages = enable;
+}
+
+/*
+* Gets the number of bytes currently held in slabs,
+* including those of arenas sharing them
+* @return bytes held by the arena
+*/
+template<class N>
+std::size_t NodeArena<N>::bytesReserved() const {
+
+	std::size_t bytes(0);
+
+	if (this->pool == nullptr) {
+
+		return bytes;
+	}
+
+	std::unique_lock<std::mutex> lock = NodeArena<N>::guard(*this->pool);
+
+	for (const Slab& slab : this->pool->slabs) {
+
+		bytes += slab.bytes;
+	}
+
+	return bytes;
+}
+
+/*
+* Checks if another arena shares the slabs, then reset only lets go
+* of them and nodes must be destroyed one by one to reuse their slots
+* @return true if the slabs are shared
+*/
+template<class N>
+bool NodeArena<N>::shared() const {
+
+	return this->pool.use_count() > 1;
+}
+
+/*
+* Gets a slot from the free list or the current slab
+* @return an uninitialized slot
+*/
+template<class N>
+typename NodeArena<N>::Slot* NodeArena<N>::takeSlot() {
+
+	Pool& pool = this->acquire();
+
+	std::unique_lock<std::mutex> lock = NodeArena<N>::guard(pool);
+
+	Slot* slot = pool.freeList;
+
+	if (slot != nullptr) {
+
+		pool.freeList = slot->next;
+
+	} else {
+
+		if (pool.bump == pool.bumpEnd) {
+
+			this->grow(1);
+		}
+
+		slot = pool.bump++;
+	}
+
+	return slot;
+}
+
+/*
+* Static helper function, locks a pool that has been shared since
+* arenas on other threads may be using it
+* @param pool The pool
+* @return the lock, holding nothing if the pool was never shared
+*/
+template<class N>
+std::unique_lock<std::mutex> NodeArena<N>::guard(Pool& pool) {
+
+	if (pool.locking) {
+
+		return std::unique_lock<std::mutex>(pool.lock);
+	}
+
+	return std::unique_lock<std::mutex>();
+}
+
+/*
+* Gets the pool, creating it on first use
+* @return the pool of this arena
+*/
+template<class N>
+typename NodeArena<N>::Pool& NodeArena<N>::acquire() {
+
+	if (this->pool == nullptr) {
+
+		this->pool = std::make_shared<Pool>();
+	}
+
+	return *this->pool;
+}
+
+/*
+* Allocates a slab with room for at least n slots and makes it current,
+* with the pool guarded. Slots left in the previous slab are abandoned
+* until the next reset.
+* @param n The minimum number of slots
+*/
+template<class N>
+void NodeArena<N>::grow(std::size_t n) {
+
+	Pool& pool = this->acquire();
+
+	std::size_t count = pool.slabs.empty() ? MIN_SLAB_NODES
+	                                       : pool.slabs.back().count * 2;
+
+	if (count > MAX_SLAB_NODES) {
+
+		count = MAX_SLAB_NODES;
+	}
+	if (count < n) {
+
+		count = n;
+	}
+
+	Slab slab{nullptr, count, count * sizeof(Slot), false};
+
+#ifdef __linux__
+	if (this->hugePages) {
+
+		slab.bytes = (slab.bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+
+		void* mem = mmap(nullptr, slab.bytes, PROT_READ | PROT_WRITE,
+		                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (mem != MAP_FAILED) {
+
+			madvise(mem, slab.bytes, MADV_HUGEPAGE);
+
+			slab.slots = static_cast<Slot*>(mem);
+			slab.count = slab.bytes / sizeof(Slot);
+			slab.mapped = true;
+
+		} else {
+
+			slab.bytes = count * sizeof(Slot);
+		}
+	}
+#endif
+
+	if (slab.slots == nullptr) {
+
+		if constexpr (alignof(Slot) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+
+			slab.slots = static_cast<Slot*>(::operator new(slab.bytes, std::align_val_t(alignof(Slot))));
+
+		} else {
+
+			slab.slots = static_cast<Slot*>(::operator new(slab.bytes));
+		}
+	}
+
+	try {
+
+		pool.slabs.push_back(slab);
+
+	} catch (...) {
+
+		NodeArena<N>::releaseSlab(slab);
+
+		throw;
+	}
+
+	pool.bump = slab.slots;
+	pool.bumpEnd = slab.slots + slab.count;
+}
+
+/*
+* Static helper function for absorb, moves every slab and free slot
+* of from into to, leaving from empty. The slots left in the slab
+* from was carving are abandoned until the pool is released.
+* @param to The pool taking the slabs
+* @param from The pool giving them up
+*/
+template<class N>
+void NodeArena<N>::merge(Pool& to, Pool& from) {
+
+	// to may be shared with arenas in use on other threads, and from
+	// may have been shared with arenas that were used on other threads
+	std::unique_lock<std::mutex> fromLock = NodeArena<N>::guard(from),
+	                             toLock = NodeArena<N>::guard(to);
+
+	if (to.slabs.empty()) {
+
+		std::swap(to.slabs, from.slabs);
+		std::swap(to.bump, from.bump);
+		std::swap(to.bumpEnd, from.bumpEnd);
+
+	} else {
+
+		// the slab to is carving stays last
+		to.slabs.insert(to.slabs.end() - 1, from.slabs.begin(), from.slabs.end());
+
+		from.slabs.clear();
+	}
+
+	if (from.freeList != nullptr) {
+
+		Slot* tail = from.freeList;
+
+		while (tail->next != nullptr) {
+
+			tail = tail->next;
+		}
+
+		tail->next = to.freeList;
+		to.freeList = from.freeList;
+	}
+
+	from.freeList = nullptr;
+	from.bump = nullptr;
+	from.bumpEnd = nullptr;
+}
+
+/*
+* Returns a slab's memory to the system
+* @param slab The slab to release
+*/
+template<class N>
+void NodeArena<N>::releaseSlab(const Slab& slab) {
+
+#ifdef __linux__
+	if (slab.mapped) {
+
+		munmap(slab.slots, slab.bytes);
+
+		return;
+	}
+#endif
+
+	if constexpr (alignof(Slot) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+
+		::operator delete(slab.slots, std::align_val_t(alignof(Slot)));
+
+	} else {
+
+		::operator delete(slab.slots);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////// POOL POOL POOL POOL POOL POOL ///////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+* Constructs an empty pool
+*/
+template<class N>
+NodeArena<N>::Pool::Pool()
+
+	:freeList(nullptr), bump(nullptr), bumpEnd(nullptr), locking(false) {}
+
+/*
+* Releases every slab
+*/
+template<class N>
+NodeArena<N>::Pool::~Pool() {
+
+	for (const Slab& slab : this->slabs) {
+
+		NodeArena<N>::releaseSlab(slab);
+	}
+}
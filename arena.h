@@ -0,0 +1,277 @@
+/*
+* arena.h
+*
+* NodeArena specs
+*
+* A NodeArena hands out fixed size slots for tree nodes from large slabs
+* instead of calling new/delete for every node. Freed slots go on a free
+* list and are reused first, and all slabs are released at once by reset(),
+* so clearing a tree is a bulk operation and nodes of one tree sit close
+* together in memory. The slabs live in a pool that several arenas can
+* share, so a tree split in two keeps its nodes where they are and two
+* trees being joined can link each other's nodes. Once a pool has been
+* shared, taking and recycling its slots is done under its mutex, so the
+* arenas sharing it can be used from different threads; a pool that was
+* never shared is not locked. Operations include:
+*
+*	- constructing a node in a slot
+*	- destroying a node and recycling its slot
+*	- recycling a slot without running the destructor
+*	- reserving room for a number of nodes
+*	- taking a run of contiguous slots to fill from several threads
+*	- optionally backing slabs with transparent huge pages
+*	- keeping slots aligned for nodes aligned to cache lines
+*	- resetting (forgetting every node at once)
+*	- moving every slab to another arena in O(1)
+*	- sharing the slabs of another arena, or absorbing them
+*/
+
+#ifndef NODEARENA_H
+#define NODEARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+template<class N>
+class NodeArena {
+
+public:
+
+	/*
+	* Constructs an empty arena, no memory is allocated until first use
+	* @param hugePages true to back slabs with transparent huge pages
+	*/
+	explicit NodeArena(bool hugePages = false);
+
+	/*
+	* Releases every slab unless another arena shares them,
+	* nodes still alive are NOT destroyed
+	*/
+	~NodeArena();
+
+	/*
+	* Move constructor, takes every slab of other in O(1), nodes keep
+	* their addresses and other is left empty
+	* @param other The arena to move from
+	*/
+	NodeArena(NodeArena<N>&& other) noexcept;
+
+	/*
+	* Move assignment, swaps slabs with other in O(1), so what this
+	* held is released with other
+	* @param other The arena to move from
+	* @return this by reference
+	*/
+	NodeArena<N>& operator=(NodeArena<N>&& other) noexcept;
+
+	/*
+	* Constructs a node in a free slot
+	* @param args The arguments for the node's constructor
+	* @return pointer to the new node
+	*/
+	template<class... Args>
+	N* create(Args&&... args);
+
+	/*
+	* Destroys a node created by this arena and recycles its slot
+	* @param node The node to destroy
+	*/
+	void destroy(N* node);
+
+	/*
+	* Recycles the slot of a node whose destructor already ran
+	* @param node The node whose slot is recycled
+	*/
+	void recycle(N* node);
+
+	/*
+	* Makes sure the next n nodes can be created without allocating
+	* @param n The number of nodes to make room for
+	*/
+	void reserve(std::size_t n);
+
+	/*
+	* Takes uninitialized storage for n nodes in a row. The nodes are
+	* constructed with createAt, possibly from several threads, and can
+	* later be destroyed or recycled one by one like any other node.
+	* @param n The number of nodes
+	* @return the first slot of the run
+	*/
+	N* takeRun(std::size_t n);
+
+	/*
+	* Constructs node i of a run taken with takeRun
+	* @param run The first slot of the run
+	* @param i The index of the node in the run
+	* @param args The arguments for the node's constructor
+	* @return pointer to the new node
+	*/
+	template<class... Args>
+	static N* createAt(N* run, std::size_t i, Args&&... args);
+
+	/*
+	* Forgets every node at once, the destructors are NOT run.
+	* The most recent slab is kept for reuse and all others are released.
+	* When another arena shares the slabs this arena only lets go of
+	* them, the slots come back when the last sharing arena is gone.
+	*/
+	void reset();
+
+	/*
+	* Makes the nodes of other and this arena come from the same slabs,
+	* so nodes of either may be destroyed through either arena. An arena
+	* without slabs just shares the other's, otherwise the slabs of the
+	* one that shares them with nobody else are handed over, in O(slabs)
+	* plus O(free slots). Both arenas must not be in use on other threads
+	* during absorb, afterwards they can be.
+	* @param other The arena whose nodes this arena takes in
+	* @return true if the arenas share their slabs, false if both already
+	*         share them with other arenas and nothing changed
+	*/
+	bool absorb(NodeArena<N>& other);
+
+	/*
+	* Turns huge page backing on or off for slabs allocated from now on
+	* @param enable true to use huge pages
+	*/
+	void setHugePages(bool enable);
+
+	/*
+	* Gets the number of bytes currently held in slabs,
+	* including those of arenas sharing them
+	* @return bytes held by the arena
+	*/
+	std::size_t bytesReserved() const;
+
+	/*
+	* Checks if another arena shares the slabs, then reset only lets go
+	* of them and nodes must be destroyed one by one to reuse their slots
+	* @return true if the slabs are shared
+	*/
+	bool shared() const;
+
+private:
+
+	/*
+	* A slot holds either a node or a link in the free list
+	*/
+	union Slot {
+
+		Slot* next;
+
+		alignas(N) unsigned char storage[sizeof(N)];
+	};
+
+	static_assert(sizeof(Slot) == sizeof(N), "a run of slots must be an array of N");
+
+	/*
+	* A slab of contiguous slots
+	*/
+	struct Slab {
+
+		Slot* slots;
+
+		std::size_t count;
+
+		std::size_t bytes;
+
+		bool mapped;
+	};
+
+	// Slots in the first slab, later slabs double up to MAX_SLAB_NODES
+	static const std::size_t MIN_SLAB_NODES = 64;
+
+	// Largest slab allocated by growth alone
+	static const std::size_t MAX_SLAB_NODES = 1 << 16;
+
+	// Size of a transparent huge page
+	static const std::size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+	/*
+	* The slabs and free slots, possibly shared by several arenas
+	*/
+	struct Pool {
+
+		// All slabs, the last one is the one being carved
+		std::vector<Slab> slabs;
+
+		// Recycled slots
+		Slot* freeList;
+
+		// Next never used slot in the last slab
+		Slot* bump;
+
+		// One past the last slot in the last slab
+		Slot* bumpEnd;
+
+		// Guards the slabs and free slots once the pool is shared
+		std::mutex lock;
+
+		// Whether the pool has been shared, set while no other thread
+		// can use it and cleared only when no other arena holds it
+		bool locking;
+
+		/*
+		* Constructs an empty pool
+		*/
+		Pool();
+
+		/*
+		* Releases every slab
+		*/
+		~Pool();
+	};
+
+	// The slabs of this arena, nullptr until first use
+	std::shared_ptr<Pool> pool;
+
+	// Whether new slabs use huge pages
+	bool hugePages;
+
+	/*
+	* Gets the pool, creating it on first use
+	* @return the pool of this arena
+	*/
+	Pool& acquire();
+
+	/*
+	* Gets a slot from the free list or the current slab
+	* @return an uninitialized slot
+	*/
+	Slot* takeSlot();
+
+	/*
+	* Static helper function, locks a pool that has been shared since
+	* arenas on other threads may be using it
+	* @param pool The pool
+	* @return the lock, holding nothing if the pool was never shared
+	*/
+	static std::unique_lock<std::mutex> guard(Pool& pool);
+
+	/*
+	* Static helper function for absorb, moves every slab and free slot
+	* of from into to, leaving from empty. The slots left in the slab
+	* from was carving are abandoned until the pool is released.
+	* @param to The pool taking the slabs
+	* @param from The pool giving them up
+	*/
+	static void merge(Pool& to, Pool& from);
+
+	/*
+	* Allocates a slab with room for at least n slots and makes it
+	* current, with the pool guarded
+	* @param n The minimum number of slots
+	*/
+	void grow(std::size_t n);
+
+	/*
+	* Returns a slab's memory to the system
+	* @param slab The slab to release
+	*/
+	static void releaseSlab(const Slab& slab);
+};
+
+#include "arena.cpp"
+#endif // NODEARENA_H
@@ -16,11 +16,66 @@
 *	- inorderTraverse
 *	- rebalance
 *	- clear
-*	- readTree
+*	- readTree (arrays, iterator ranges, moved vectors, unsorted input)
 *	- operator overloads == and !=
+*	- reserve and useHugePages (NodeArena), and arenas absorbing
+*	  each other's slabs
+*	- size, select and rank
+*	- iterators
+*	- lowerBound, upperBound, floor, ceiling, range, countRange and
+*	  eraseRange against std::set
+*	- custom, stateful, transparent and three-way comparators
+*	- moving trees, add(T&&), emplace, and extract and insert moving
+*	  items between trees without copying them
+*	- useThreads
+*	- copying, comparing and destroying degenerate trees
+*	- freeze: FrozenTree lookups, bounds and iterators
+*	- containsBatch and findBatch on pointer trees and FrozenTree
+*	  against contains, for batches shorter and longer than the
+*	  searches kept in flight
+*	- AVLTree add, remove, copying, rebalance, split, join and
+*	  eraseRange keeping balance, the two halves of a split changed on
+*	  two threads, a sliding window of splits reusing
+*	  the slots of the trees it drops, and unionWith, intersect and difference against std::set
+*	  on one and several threads, unionWith of a much smaller tree by
+*	  adding, and unionWith leaving the tree as it was when copying an
+*	  item throws
+*	- RedBlackTree add, remove, copying, readTree, rebalance, split,
+*	  join, eraseRange and the set operations keeping the red-black rules
+*	- BTree add, remove, copying, readTree and iterators keeping
+*	  every node between half full and full
+*	- SimdSearch kernels at every instruction set the processor has,
+*	  against scalar searches
+*	- CompactAVLTree add, remove, copying, readTree and iterators keeping
+*	  the balance bits right, with and without parent links, and select,
+*	  rank and summary keeping subtree sizes and augmentations right
+*	- EpochReclaimer holding back retired objects while a Guard is open
+*	- ConcurrentAVLTree add, remove and routing nodes on one thread, and
+*	  writers on several threads with readers that never miss an item,
+*	  ending as a strict AVL tree
+*	- PersistentAVLTree add, remove, readTree and iterators keeping
+*	  snapshots unchanged and sharing the nodes they did not touch,
+*	  with a reader thread on a snapshot while the tree changes
 */
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdlib>
+#include <list>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 #include "avltree.h"
+#include "btree.h"
+#include "compacttree.h"
+#include "concurrenttree.h"
+#include "persistenttree.h"
+#include "rbtree.h"
 
 /*
 * Unit test for all constructors and destructor
@@ -271,6 +326,10 @@ void inorderTraverse() {
 	assert(tree.add(190) && tree.contains(190));
 
 	tree.inorderTraverse(intVisit);
+
+	// items are visited in place, doubling keeps their order
+	assert(tree.contains(380) && tree.contains(40) && !tree.contains(190));
+	assert(tree.select(0) == 40 && tree.select(6) == 380);
 }
 
 /*
@@ -308,6 +367,59 @@ void readTree() {
 						&& tree.getHeight() == 4);
 }
 
+/*
+* Unit test for readTree from iterator ranges and moved vectors
+*/
+void readTreeRanges() {
+
+	std::list<int> sortedList {1, 3, 5, 7, 9, 11, 13};
+
+	BinarySearchTree<int> tree;
+	assert(tree.readTree(sortedList.begin(), sortedList.end()));
+	assert(tree.getHeight() == 3 && tree.size() == 7 && tree.select(3) == 7);
+	assert(std::equal(tree.begin(), tree.end(), sortedList.begin()));
+
+	assert(!tree.readTree(sortedList.end(), sortedList.end()) && tree.size() == 7);
+
+	std::vector<int> unsorted {8, 3, 8, 1, 3, 9, 1, 4};
+	assert(tree.readTree(unsorted.begin(), unsorted.end(), false));
+	assert(std::vector<int>(tree.begin(), tree.end()) == std::vector<int>({1, 3, 4, 8, 9}));
+	assert(unsorted.size() == 8);
+
+	std::vector<std::string> words;
+
+	for (int i(0); i < 100; ++i) {
+
+		words.push_back("word number " + std::to_string(1000 + i));
+	}
+
+	BinarySearchTree<std::string> moved;
+	assert(moved.readTree(std::move(words)));
+	assert(moved.size() == 100 && moved.getHeight() == 7);
+	assert(moved.contains("word number 1042") && moved.select(99) == "word number 1099");
+
+	std::vector<std::string> shuffled {"kiwi", "fig", "apple", "fig", "pear"};
+	assert(moved.readTree(std::move(shuffled), false));
+	assert(moved.size() == 4 && moved.select(0) == "apple" && moved.select(3) == "pear");
+
+	AVLTree<int> avl;
+	std::vector<int> keys;
+
+	for (int i(0); i < 1000; ++i) {
+
+		keys.push_back(i);
+	}
+
+	assert(avl.readTree(keys.begin(), keys.end()) && avl.getHeight() == 10);
+
+	for (int i(1000); i < 2000; ++i) {
+
+		assert(avl.add(i));
+	}
+
+	assert(avl.getHeight() == 11 && avl.size() == 2000);
+}
+
 /*
 * Unit test for rebalance
 */
@@ -330,6 +442,36 @@ void rebalance() {
 
 	assert(tree != temp && tree.getNumberOfNodes() == temp.getNumberOfNodes()
 					    && tree.getHeight() == 5);
+
+	// a degenerate tree, checked through parent pointers and subtree sizes
+	BinarySearchTree<int> vine;
+
+	for (int i(0); i < 2000; ++i) {
+
+		vine.add(i);
+	}
+
+	assert(vine.getHeight() == 2000);
+
+	vine.rebalance();
+
+	assert(vine.getHeight() == 11 && vine.size() == 2000);
+
+	int expected(0);
+
+	for (int num : vine) {
+
+		assert(num == expected && vine.select(num) == num);
+
+		++expected;
+	}
+
+	assert(expected == 2000 && *vine.rbegin() == 1999 && *--vine.end() == 1999);
+
+	BinarySearchTree<int> single(1), empty;
+	single.rebalance();
+	empty.rebalance();
+	assert(single.getHeight() == 1 && empty.isEmpty());
 }
 
 /*
@@ -435,82 +577,3316 @@ void mystery() {
 }
 
 /*
-* Runs all BST unit tests in order
+* Unit test for NodeArena slot reuse and bulk reset, and for
+* the tree's reserve and useHugePages
 */
-void BSTTests() {
-	
-	constructor();
-	empty();
-	contains();
-	add();
-	getHeight();
-	getNumberOfNodes();
-	clear();
-	equalityOperators();
-	inorderTraverse();
-	readTree();
-	rebalance();
-	remove();
-	getCuddies();
-	mystery();
+void arena() {
+
+	NodeArena<Node<std::string>> strings;
+
+	Node<std::string>* first  = strings.create("first");
+	Node<std::string>* second = strings.create("second");
+	assert(first != second && first->getItem() == "first");
+
+	strings.destroy(first);
+
+	Node<std::string>* third = strings.create("third");
+	assert(third == first && third->getItem() == "third");
+
+	strings.destroy(second);
+	strings.destroy(third);
+
+	NodeArena<Node<int>> ints;
+	ints.reserve(1000);
+
+	std::size_t bytes = ints.bytesReserved();
+
+	for (int i(0); i < 1000; ++i) {
+
+		assert(ints.create(i)->getItem() == i);
+	}
+
+	assert(ints.bytesReserved() == bytes);
+
+	ints.reset();
+	ints.create(1);
+	assert(ints.bytesReserved() == bytes);
+
+	// after absorbing, a node of either arena can be destroyed through the other
+	NodeArena<Node<int>> more;
+	Node<int>* kept = more.create(7);
+	more.destroy(more.create(8));
+
+	std::size_t both = ints.bytesReserved() + more.bytesReserved();
+	assert(ints.absorb(more) && ints.bytesReserved() == both && more.bytesReserved() == both);
+
+	ints.destroy(kept);
+	assert(more.create(9) == kept);
+
+	// two arenas that both share their slabs with others cannot merge
+	NodeArena<Node<int>> sharing, otherSharing;
+	sharing.absorb(ints);
+	otherSharing.create(1);
+
+	NodeArena<Node<int>> alsoSharing;
+	alsoSharing.absorb(otherSharing);
+	assert(!ints.absorb(otherSharing) && sharing.bytesReserved() == both);
+
+	// letting go of shared slabs leaves them to the others
+	ints.reset();
+	assert(ints.bytesReserved() == 0 && more.bytesReserved() == both && more.create(10)->getItem() == 10);
+
+	BinarySearchTree<int> tree;
+	tree.useHugePages(true);
+	tree.reserve(5000);
+
+	for (int i(0); i < 5000; ++i) {
+
+		assert(tree.add((i * 7919) % 5000));
+	}
+
+	assert(tree.getNumberOfNodes() == 5000 && tree.contains(4999));
+
+	tree.clear();
+	assert(tree.isEmpty() && !tree.contains(4999));
+
+	assert(tree.add(3) && tree.contains(3) && tree.getNumberOfNodes() == 1);
 }
 
 /*
-* Unit test for contains
+* Checks size, select and rank of a tree holding the even numbers 0..2(n-1)
+* @param tree The tree to check
+* @param n The number of items expected
 */
-void AVLcontains() {
-	
-	BinarySearchTree<int>* avl = new AVLTree<int>(4);
+void assertOrderStatistics(const BinarySearchTree<int>& tree, int n) {
 
-	assert(avl->contains(4));
+	assert(tree.size() == static_cast<std::size_t>(n) && tree.getNumberOfNodes() == n);
+
+	for (int k(0); k < n; ++k) {
+
+		assert(tree.select(k) == 2 * k);
+		assert(tree.rank(2 * k) == static_cast<std::size_t>(k));
+		assert(tree.rank(2 * k + 1) == static_cast<std::size_t>(k + 1));
+	}
+
+	bool thrown(false);
+
+	try {
+
+		tree.select(n);
+
+	} catch (const std::out_of_range&) {
+
+		thrown = true;
+	}
+
+	assert(thrown);
 }
 
 /*
-* Unit test for add
+* Unit test for size, select and rank through adds, removes and copies
 */
-void AVLadd() {
-	
-	BinarySearchTree<int>* avl = new AVLTree<int>(100);
+void orderStatistics() {
 
-	assert(avl->add(150) && avl->contains(150));
-	avl->displaySideways();
-	std::cout << "\n\n";
+	BinarySearchTree<int> tree;
+	assertOrderStatistics(tree, 0);
 
-	assert(avl->add(200) && avl->contains(200));
-	avl->displaySideways();
-	std::cout << "\n\n";
+	for (int i(0); i < 100; ++i) {
 
-	assert(avl->getHeight() == 2);
+		tree.add((i * 37) % 100 * 2);
+	}
 
-	assert(avl->add(50) && avl->contains(50));
-	avl->displaySideways();
-	std::cout << "\n\n";
+	assertOrderStatistics(tree, 100);
 
-	assert(avl->add(10) && avl->contains(10));
-	avl->displaySideways();
-	std::cout << "\n\n";
+	for (int i(99); i >= 50; --i) {
 
-	assert(avl->getHeight() == 3);
+		assert(tree.remove(2 * i));
+	}
+
+	assertOrderStatistics(tree, 50);
+
+	BinarySearchTree<int> copy(tree);
+	assertOrderStatistics(copy, 50);
+
+	tree.rebalance();
+	assertOrderStatistics(tree, 50);
+
+	AVLTree<int> avl;
+
+	for (int i(0); i < 200; ++i) {
+
+		avl.add(2 * i);
+	}
+
+	assertOrderStatistics(avl, 200);
 }
 
 /*
-* Runs all AVL unit tests in order
+* Unit test for iterators, range-for and <algorithm> on BST and AVL
 */
-void AVLTests() {
+void iterators() {
 
-	AVLcontains();
-	AVLadd();
-	
+	BinarySearchTree<int> empty;
+	assert(empty.begin() == empty.end() && empty.rbegin() == empty.rend());
+
+	BinarySearchTree<int> tree;
+	AVLTree<int> avl;
+
+	int arr[9] {50, 20, 80, 10, 30, 70, 90, 25, 85};
+
+	for (int num : arr) {
+
+		tree.add(num);
+		avl.add(num);
+	}
+
+	std::vector<int> sorted(arr, arr + 9);
+	std::sort(sorted.begin(), sorted.end());
+
+	std::vector<int> forward;
+
+	for (const int& num : tree) {
+
+		forward.push_back(num);
+	}
+
+	assert(forward == sorted);
+	assert(std::vector<int>(avl.begin(), avl.end()) == sorted);
+	assert(std::vector<int>(tree.rbegin(), tree.rend()) ==
+	       std::vector<int>(sorted.rbegin(), sorted.rend()));
+
+	assert(std::find(tree.begin(), tree.end(), 30) != tree.end());
+	assert(std::find(tree.begin(), tree.end(), 31) == tree.end());
+	assert(std::distance(avl.begin(), avl.end()) == 9);
+
+	BinarySearchTree<int>::Iterator it = tree.end();
+	assert(*--it == 90 && *--it == 85 && *it-- == 85 && *it == 80);
+	assert(*++it == 85 && *it++ == 85 && *it == 90 && ++it == tree.end());
+
+	int sum(0);
+	int bonus(1);
+
+	std::for_each(avl.begin(), avl.end(), [&sum, bonus](int num) { sum += num + bonus; });
+	assert(sum == 50 + 20 + 80 + 10 + 30 + 70 + 90 + 25 + 85 + 9);
 }
 
 /*
-* Begins unit testing
+* Checks that a tree holds exactly the items of a std::set, in order
+* @param tree The tree to check
+* @param expected The items expected
+* @return true if the same
 */
-int main() {
-	
-	//BSTTests();
+bool sameItems(const BinarySearchTree<int>& tree, const std::set<int>& expected) {
 
-	AVLTests();
+	return tree.size() == expected.size() && std::equal(tree.begin(), tree.end(), expected.begin());
+}
+
+/*
+* Unit test for the bounds and ranges against std::set, erasing
+* random ranges until the tree is empty
+*/
+void ranges() {
+
+	BinarySearchTree<int> tree;
+	std::set<int> expected;
+
+	assert(tree.lowerBound(1) == tree.end() && tree.floor(1) == tree.end());
+	assert(tree.range(0, 10).empty() && tree.countRange(0, 10) == 0 && tree.eraseRange(0, 10) == 0);
+
+	std::mt19937 rng(5);
+
+	for (int i(0); i < 500; ++i) {
+
+		int num(static_cast<int>(rng() % 1000));
+
+		tree.add(num);
+		expected.insert(num);
+	}
+
+	for (int key(-1); key <= 1000; ++key) {
+
+		std::set<int>::iterator lower(expected.lower_bound(key)),
+								upper(expected.upper_bound(key));
+
+		assert(tree.lowerBound(key) == tree.ceiling(key));
+		assert(lower == expected.end() ? tree.lowerBound(key) == tree.end() : *tree.lowerBound(key) == *lower);
+		assert(upper == expected.end() ? tree.upperBound(key) == tree.end() : *tree.upperBound(key) == *upper);
+		assert(upper == expected.begin() ? tree.floor(key) == tree.end() : *tree.floor(key) == *std::prev(upper));
+	}
+
+	assert(*tree.floor(1000) == *expected.rbegin() && tree.range(5, 5).empty() && tree.countRange(9, 3) == 0);
+
+	for (int round(0); round < 200; ++round) {
+
+		int low(static_cast<int>(rng() % 1000)),
+			high(low + static_cast<int>(rng() % 100));
+
+		std::vector<int> items;
+
+		for (int num : tree.range(low, high)) {
+
+			items.push_back(num);
+		}
+
+		std::set<int>::iterator first(expected.lower_bound(low)),
+								last(expected.lower_bound(high));
+
+		assert(items == std::vector<int>(first, last));
+		assert(tree.countRange(low, high) == items.size());
+
+		if (round % 4 == 0) {
+
+			assert(tree.eraseRange(low, high) == items.size());
+
+			expected.erase(first, last);
+
+			assert(sameItems(tree, expected) && tree.countRange(low, high) == 0);
+			assert(tree.getNumberOfNodes() == static_cast<int>(expected.size()));
+		}
+	}
+
+	assert(tree.eraseRange(-1, 1001) == expected.size() && tree.isEmpty());
+	assert(tree.add(7) && tree.size() == 1 && tree.countRange(0, 10) == 1);
+}
+
+/*
+* Comparator that counts its calls
+*/
+struct CountingLess {
+
+	static int calls;
+
+	bool operator()(int a, int b) const {
+
+		++calls;
+
+		return a < b;
+	}
+};
+
+int CountingLess::calls = 0;
+
+/*
+* Comparator with state, orders ints by their distance from a center
+* and ties by value
+*/
+struct CloseTo {
+
+	int center;
+
+	bool operator()(int a, int b) const {
+
+		int da(std::abs(a - this->center)),
+			db(std::abs(b - this->center));
+
+		return da < db || (da == db && a < b);
+	}
+};
+
+/*
+* Unit test for custom, stateful, transparent and three-way comparators
+*/
+void comparators() {
+
+	BinarySearchTree<int, std::greater<int>> descending;
+
+	for (int num : {5, 1, 9, 3, 7}) {
+
+		assert(descending.add(num));
+	}
+
+	assert(!descending.add(9) && descending.contains(3) && !descending.contains(4));
+	assert(std::vector<int>(descending.begin(), descending.end()) ==
+	       std::vector<int>({9, 7, 5, 3, 1}));
+	assert(descending.rank(6) == 2 && descending.select(0) == 9);
+
+	// one comparison per level plus one to confirm the match
+	BinarySearchTree<int, CountingLess> counted;
+
+	for (int num : {4, 2, 6, 1, 3, 5, 7}) {
+
+		counted.add(num);
+	}
+
+	CountingLess::calls = 0;
+	assert(counted.contains(4) && CountingLess::calls == counted.getHeight() + 1);
+
+	// the comparator goes along with copies and moves
+	BinarySearchTree<int, CloseTo> nearTen(CloseTo{10}), nearZero(CloseTo{0});
+	AVLTree<int, CloseTo> avlNear(CloseTo{10});
+	RedBlackTree<int, CloseTo> rb(CloseTo{10});
+
+	for (int num : {7, 12, 10, 3, 15, 9}) {
+
+		nearTen.add(num);
+		nearZero.add(num);
+		avlNear.add(num);
+		rb.add(num);
+	}
+
+	std::vector<int> byTen({10, 9, 12, 7, 15, 3});
+
+	assert(std::vector<int>(nearTen.begin(), nearTen.end()) == byTen);
+	assert(std::vector<int>(nearZero.begin(), nearZero.end()) == std::vector<int>({3, 7, 9, 10, 12, 15}));
+	assert(std::vector<int>(avlNear.begin(), avlNear.end()) == byTen && std::vector<int>(rb.begin(), rb.end()) == byTen);
+
+	nearZero = nearTen;
+	assert(nearZero.add(11) && nearZero.select(2) == 11 && nearZero.contains(15));
+
+	BinarySearchTree<int, CloseTo> moved(CloseTo{0});
+	moved = std::move(nearTen);
+	assert(moved.add(8) && moved.select(2) == 8 && moved.rank(12) == 3);
+
+	AVLTree<int, CloseTo> avlCopy(avlNear);
+	assert(avlCopy.add(11) && avlCopy.select(2) == 11);
+
+	BinarySearchTree<std::string, std::less<>> words;
+	words.add("pear");
+	words.add("apple");
+	words.add("fig");
+
+	const char* fig = "fig";
+	assert(words.contains(fig) && words.contains("apple") && !words.contains("kiwi"));
+
+#if __cplusplus >= 201703L
+	assert(words.contains(std::string_view("pear")));
+#endif
+
+#if defined(__cpp_impl_three_way_comparison) && __has_include(<compare>)
+	BinarySearchTree<std::string, ThreeWayCompare> threeWay;
+	threeWay.add("m");
+	threeWay.add("c");
+	threeWay.add("x");
+
+	assert(!threeWay.add("c") && threeWay.contains("x") && !threeWay.contains("y"));
+	assert(threeWay.contains(std::string_view("m")) && threeWay.rank("d") == 1);
+
+	AVLTree<int, std::compare_three_way> avl;
+
+	for (int i(0); i < 100; ++i) {
+
+		avl.add(i);
+	}
+
+	assert(avl.getHeight() == 7 && avl.contains(50) && !avl.contains(100));
+#endif
+}
+
+/*
+* Unit test for building, sorting and rebalancing on several threads,
+* sized past the point where work is handed to other threads
+*/
+void parallel() {
+
+	const int n(100000);
+
+	std::vector<int> keys;
+
+	for (int i(0); i < n; ++i) {
+
+		keys.push_back(2 * i);
+	}
+
+	BinarySearchTree<int> serial, threaded;
+	threaded.useThreads(4);
+
+	assert(serial.readTree(keys.begin(), keys.end()));
+	assert(threaded.readTree(keys.begin(), keys.end()));
+	assert(threaded == serial && threaded.getHeight() == 17);
+	assertOrderStatistics(threaded, n);
+
+	std::vector<int> shuffled;
+
+	for (int i(0); i < 2 * n; ++i) {
+
+		shuffled.push_back(i);
+	}
+
+	std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(3));
+
+	threaded.clear();
+
+	for (int num : shuffled) {
+
+		threaded.add(num);
+	}
+
+	threaded.rebalance();
+	assert(threaded.getHeight() == 18 && threaded.size() == 2 * n);
+	assert(threaded.select(n) == n && threaded.rank(n + 7) == static_cast<std::size_t>(n + 7));
+
+	int expected(0);
+
+	for (int num : threaded) {
+
+		assert(num == expected);
+
+		++expected;
+	}
+
+	assert(expected == 2 * n);
+
+	shuffled = keys;
+	shuffled.insert(shuffled.end(), keys.begin(), keys.begin() + 100);
+	std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(3));
+
+	assert(threaded.readTree(std::move(shuffled), false));
+	assert(threaded == serial);
+
+	AVLTree<int> avl;
+	avl.useThreads(0);
+
+	assert(avl.readTree(keys.begin(), keys.end()) && avl.getHeight() == 17);
+	assert(avl.remove(0) && avl.add(1) && avl.getHeight() == 17 && avl.size() == n);
+}
+
+/*
+* A tree that can be turned into a vine (every node a right child)
+* in O(n), the worst case for anything that recurses to the height
+*/
+class VineTree : public BinarySearchTree<int> {
+
+public:
+
+	void toVine() {
+
+		for (Node<int>* curr = this->getRoot(); curr != nullptr; ) {
+
+			curr = (curr->getLeft() != nullptr) ? this->rotateRight(curr) : curr->getRight();
+		}
+	}
+};
+
+/*
+* Unit test for the traversals on a tree far deeper than the call stack allows
+*/
+void degenerate() {
+
+	const int n(1000000);
+
+	std::vector<int> keys;
+
+	for (int i(0); i < n; ++i) {
+
+		keys.push_back(i);
+	}
+
+	VineTree* vine = new VineTree();
+	assert(vine->readTree(keys.begin(), keys.end()));
+	vine->toVine();
+	assert(vine->getHeight() == n && vine->getHeight(n - 10) == 10);
+
+	BinarySearchTree<int> copy(*vine);
+	assert(copy == *vine && copy.getHeight() == n && copy.select(n / 2) == n / 2);
+
+	assert(copy.remove(n - 1) && copy != *vine && copy.add(n - 1) && copy == *vine);
+
+	long sum(0);
+
+	for (int num : copy) {
+
+		sum += num;
+	}
+
+	assert(sum == static_cast<long>(n) * (n - 1) / 2);
+
+	delete vine;
+
+	BinarySearchTree<std::string> words;
+
+	for (int i(0); i < 20000; ++i) {
+
+		words.add(std::to_string(100000 + i));
+	}
+
+	BinarySearchTree<std::string> wordsCopy(words);
+	assert(words == wordsCopy && words.getHeight() == 20000);
+	words.clear();
+	assert(words.isEmpty() && wordsCopy.contains("119999"));
+
+	BinarySearchTree<int> small, smallCopy;
+	assert(small == smallCopy && small.getHeight() == 0);
+
+	small.add(2);
+	smallCopy.add(1);
+	assert(small != smallCopy);
+	smallCopy = small;
+	assert(small == smallCopy && smallCopy.getHeight() == 1);
+}
+
+/*
+* Unit test for freeze, every size up to a few full levels
+* against std::lower_bound and std::upper_bound
+*/
+void frozen() {
+
+	BinarySearchTree<int> tree;
+
+	FrozenTree<int> empty = tree.freeze();
+	assert(empty.isEmpty() && empty.getHeight() == 0 && !empty.contains(0));
+	assert(empty.begin() == empty.end() && empty.lowerBound(0) == empty.end());
+
+	for (int n(1); n <= 70; ++n) {
+
+		std::vector<int> keys;
+
+		for (int i(0); i < n; ++i) {
+
+			keys.push_back(3 * i);
+		}
+
+		tree.readTree(keys.begin(), keys.end());
+
+		FrozenTree<int> frozen = tree.freeze();
+		assert(frozen.size() == static_cast<std::size_t>(n) && frozen.getHeight() == tree.getHeight());
+		assert(std::equal(frozen.begin(), frozen.end(), keys.begin(), keys.end()));
+		assert(std::equal(frozen.rbegin(), frozen.rend(), keys.rbegin(), keys.rend()));
+
+		for (int k(-1); k <= 3 * n; ++k) {
+
+			std::vector<int>::iterator lower = std::lower_bound(keys.begin(), keys.end(), k);
+			std::vector<int>::iterator upper = std::upper_bound(keys.begin(), keys.end(), k);
+
+			assert(frozen.contains(k) == (k >= 0 && k % 3 == 0 && k < 3 * n));
+			assert((frozen.lowerBound(k) == frozen.end()) == (lower == keys.end()));
+			assert((frozen.upperBound(k) == frozen.end()) == (upper == keys.end()));
+			assert(lower == keys.end() || *frozen.lowerBound(k) == *lower);
+			assert(upper == keys.end() || *frozen.upperBound(k) == *upper);
+		}
+	}
+
+	// the snapshot does not change with the tree
+	FrozenTree<int> before = tree.freeze();
+	tree.add(1);
+	assert(!before.contains(1) && tree.contains(1) && tree.freeze().contains(1));
+
+	FrozenTree<int>::iterator it = before.end();
+	assert(*--it == 207 && *it-- == 207 && *it == 204 && *++it == 207 && ++it == before.end());
+
+	AVLTree<std::string, std::less<>> words;
+
+	for (int i(0); i < 1000; ++i) {
+
+		words.add("word " + std::to_string(i));
+	}
+
+	FrozenTree<std::string, std::less<>> frozenWords = words.freeze();
+	assert(frozenWords.contains("word 999") && !frozenWords.contains("word 1000"));
+	assert(*frozenWords.lowerBound("word 5") == "word 5" && *frozenWords.upperBound("word 5") == "word 50");
+	assert(std::equal(frozenWords.begin(), frozenWords.end(), words.begin(), words.end()));
+}
+
+/*
+* Checks containsBatch and findBatch of a tree against contains,
+* for every batch length up to count
+* @param tree The tree, a pointer tree or a FrozenTree
+* @param keys The keys to look for
+*/
+template<class Tree>
+void assertBatches(const Tree& tree, const std::vector<int>& keys) {
+
+	for (std::size_t count : {std::size_t(0), std::size_t(1), std::size_t(15), std::size_t(17), keys.size()}) {
+
+		bool found[1000];
+		typename Tree::Iterator at[1000];
+
+		tree.containsBatch(keys.data(), count, found);
+		tree.findBatch(keys.data(), count, at);
+
+		for (std::size_t i(0); i < count; ++i) {
+
+			assert(found[i] == tree.contains(keys[i]));
+			assert(found[i] ? *at[i] == keys[i] : at[i] == tree.end());
+		}
+	}
+}
+
+/*
+* Unit test for containsBatch and findBatch
+*/
+void batches() {
+
+	std::vector<int> keys;
+	std::mt19937 rng(19);
+
+	for (int i(0); i < 1000; ++i) {
+
+		keys.push_back(static_cast<int>(rng() % 1200));
+	}
+
+	BinarySearchTree<int> empty;
+	assertBatches(empty, keys);
+
+	BinarySearchTree<int> tree;
+	AVLTree<int> avl;
+
+	for (int i(0); i < 500; ++i) {
+
+		int num(static_cast<int>(rng() % 1000));
+
+		tree.add(num);
+		avl.add(num);
+	}
+
+	assertBatches(tree, keys);
+	assertBatches(avl, keys);
+	assertBatches(avl.freeze(), keys);
+
+	// a chain, every search ends at a different depth
+	BinarySearchTree<int> chain;
+
+	for (int i(0); i < 100; ++i) {
+
+		chain.add(2 * i);
+	}
+
+	assertBatches(chain, keys);
+
+	AVLTree<std::string> words;
+
+	for (int i(0); i < 100; ++i) {
+
+		words.add("word " + std::to_string(i));
+	}
+
+	std::string wanted[3] {"word 7", "word 70", "word 700"};
+	AVLTree<std::string>::Iterator at[3];
+
+	words.findBatch(wanted, 3, at);
+	assert(*at[0] == "word 7" && *at[1] == "word 70" && at[2] == words.end());
+}
+
+/*
+* An item that counts how many times it is copied
+*/
+struct Counted {
+
+	explicit Counted(int key) :key(key) {}
+
+	Counted(const Counted& other) :key(other.key) { ++Counted::copies; }
+
+	Counted(Counted&& other) noexcept :key(other.key) {}
+
+	Counted& operator=(const Counted& other) { this->key = other.key; ++Counted::copies; return *this; }
+
+	Counted& operator=(Counted&& other) noexcept { this->key = other.key; return *this; }
+
+	bool operator<(const Counted& other) const { return this->key < other.key; }
+
+	friend std::ostream& operator<<(std::ostream& out, const Counted& item) { return out << item.key; }
+
+	int key;
+
+	static int copies;
+};
+
+int Counted::copies = 0;
+
+/*
+* An item whose copies throw once copiesLeft runs out
+*/
+struct Fragile {
+
+	explicit Fragile(int key) :key(key) {}
+
+	Fragile(const Fragile& other) :key(other.key) {
+
+		if (--Fragile::copiesLeft < 0) {
+
+			throw std::runtime_error("copy failed");
+		}
+	}
+
+	Fragile& operator=(const Fragile& other) { this->key = other.key; return *this; }
+
+	bool operator<(const Fragile& other) const { return this->key < other.key; }
+
+	friend std::ostream& operator<<(std::ostream& out, const Fragile& item) { return out << item.key; }
+
+	int key;
+
+	static int copiesLeft;
+};
+
+int Fragile::copiesLeft = 0;
+
+/*
+* Unit test for moving trees, adding moved and emplaced items, and
+* moving items between trees with extract and insert
+*/
+void moves() {
+
+	const std::string prefix("a string long enough to live on the heap ");
+
+	BinarySearchTree<std::string> words;
+
+	for (int i(0); i < 1000; ++i) {
+
+		assert(words.add(prefix + std::to_string(i)));
+	}
+
+	// a duplicate is not moved from
+	std::string duplicate(prefix + "5");
+	assert(!words.add(std::move(duplicate)) && duplicate == prefix + "5");
+	assert(words.emplace(3, 'x') && words.contains("xxx") && !words.emplace("xxx") && words.size() == 1001);
+
+	// moving keeps the nodes where they are
+	const std::string* first = &*words.begin();
+
+	BinarySearchTree<std::string> moved(std::move(words));
+	assert(words.isEmpty() && words.size() == 0 && moved.size() == 1001 && &*moved.begin() == first);
+	assert(words.add("reused") && words.size() == 1 && words.contains("reused"));
+
+	BinarySearchTree<std::string> assigned;
+	assigned.add("old");
+	assigned = std::move(moved);
+	assert(moved.isEmpty() && !assigned.contains("old") && assigned.size() == 1001 && &*assigned.begin() == first);
+
+	// the item's own buffer moves with it, into a tree of another kind
+	AVLTree<std::string> other;
+
+	BinarySearchTree<std::string>::NodeHandle handle = assigned.extract(prefix + "500");
+	assert(handle && !handle.empty() && handle.value() == prefix + "500" && !assigned.contains(prefix + "500"));
+
+	const char* buffer = handle.value().data();
+
+	assert(other.insert(std::move(handle)) && handle.empty() && !handle);
+	assert(other.contains(prefix + "500") && other.begin()->data() == buffer && assigned.size() == 1000);
+
+	assert(assigned.extract("missing").empty() && !other.insert(assigned.extract("missing")));
+
+	// a duplicate stays in the handle
+	other.add("xxx");
+	handle = assigned.extract("xxx");
+	assert(!other.insert(std::move(handle)) && handle && handle.value() == "xxx" && !assigned.contains("xxx"));
+	assert(assigned.insert(std::move(handle)) && assigned.contains("xxx"));
+
+	// extracting through a reference to the tree's own item
+	std::string smallest = *assigned.begin();
+	handle = assigned.extract(*assigned.begin());
+	assert(handle.value() == smallest && !assigned.contains(smallest) && assigned.size() == 999);
+
+	// no item is copied by any of it
+	Counted::copies = 0;
+
+	BinarySearchTree<Counted> counted;
+
+	for (int i(0); i < 100; ++i) {
+
+		assert(counted.emplace(i) && counted.add(Counted(100 + i)));
+	}
+
+	BinarySearchTree<Counted> stage(std::move(counted));
+	counted = std::move(stage);
+
+	RedBlackTree<Counted> redBlack;
+
+	for (int i(0); i < 200; i += 3) {
+
+		assert(redBlack.insert(counted.extract(Counted(i))));
+	}
+
+	assert(Counted::copies == 0 && counted.size() + redBlack.size() == 200 && redBlack.contains(Counted(99)));
+
+	// growing a vector of trees moves them instead of copying every node
+	std::vector<BinarySearchTree<int>> trees;
+
+	trees.emplace_back();
+	trees.back().add(1);
+
+	const int* one = &*trees[0].begin();
+
+	for (int i(0); i < 100; ++i) {
+
+		trees.emplace_back();
+	}
+
+	assert(&*trees[0].begin() == one && trees[0].size() == 1);
+}
+
+/*
+* Runs all BST unit tests in order
+*/
+void BSTTests() {
+	
+	constructor();
+	empty();
+	contains();
+	add();
+	getHeight();
+	getNumberOfNodes();
+	clear();
+	equalityOperators();
+	inorderTraverse();
+	readTree();
+	readTreeRanges();
+	rebalance();
+	remove();
+	getCuddies();
+	mystery();
+	arena();
+	orderStatistics();
+	iterators();
+	ranges();
+	comparators();
+	parallel();
+	degenerate();
+	frozen();
+	batches();
+	moves();
+}
+
+/*
+* Unit test for contains
+*/
+void AVLcontains() {
+	
+	BinarySearchTree<int>* avl = new AVLTree<int>(4);
+
+	assert(avl->contains(4));
+
+	delete avl;
+}
+
+/*
+* Unit test for add
+*/
+void AVLadd() {
+	
+	BinarySearchTree<int>* avl = new AVLTree<int>(100);
+
+	assert(avl->add(150) && avl->contains(150));
+	avl->displaySideways();
+	std::cout << "\n\n";
+
+	assert(avl->add(200) && avl->contains(200));
+	avl->displaySideways();
+	std::cout << "\n\n";
+
+	assert(avl->getHeight() == 2);
+
+	assert(avl->add(50) && avl->contains(50));
+	avl->displaySideways();
+	std::cout << "\n\n";
+
+	assert(avl->add(10) && avl->contains(10));
+	avl->displaySideways();
+	std::cout << "\n\n";
+
+	assert(avl->getHeight() == 3);
+
+	delete avl;
+}
+
+/*
+* Unit test for add with sorted input, every insert retraces and rotates
+*/
+void AVLsorted() {
+
+	AVLTree<int> avl;
+
+	for (int i(1); i <= 1023; ++i) {
+
+		assert(avl.add(i) && !avl.add(i));
+	}
+
+	assert(avl.getHeight() == 10 && avl.getNumberOfNodes() == 1023);
+
+	for (int i(0); i <= 1024; ++i) {
+
+		assert(avl.contains(i) == (i >= 1 && i <= 1023));
+	}
+}
+
+/*
+* An AVLTree that can check its own shape
+*/
+class CheckedAVL : public AVLTree<int> {
+
+public:
+
+	CheckedAVL() {}
+
+	CheckedAVL(AVLTree<int>&& other) :AVLTree<int>(std::move(other)) {}
+
+	/*
+	* Checks that every subtree is height balanced and
+	* that getHeight agrees with the real height
+	* @return true if balanced
+	*/
+	bool balanced() const {
+
+		bool ok(true);
+
+		return CheckedAVL::height(this->getRoot(), ok) == this->getHeight() && ok;
+	}
+
+private:
+
+	static int height(Node<int>* curr, bool& ok) {
+
+		if (curr == nullptr) {
+
+			return 0;
+		}
+
+		int left(CheckedAVL::height(curr->getLeft(), ok)),
+			right(CheckedAVL::height(curr->getRight(), ok));
+
+		ok = ok && left - right <= 1 && right - left <= 1;
+
+		return 1 + std::max(left, right);
+	}
+};
+
+/*
+* Unit test for remove, every removal retraces and may rotate
+*/
+void AVLremove() {
+
+	CheckedAVL avl;
+	assert(avl.getHeight() == 0 && !avl.remove(1));
+
+	std::vector<int> keys;
+
+	for (int i(0); i < 4000; ++i) {
+
+		keys.push_back(i);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(11));
+
+	for (int k : keys) {
+
+		assert(avl.add(k));
+	}
+
+	assert(avl.balanced() && avl.size() == 4000);
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(12));
+
+	for (std::size_t i(0); i < keys.size(); ++i) {
+
+		assert(avl.remove(keys[i]) && !avl.remove(keys[i]) && !avl.contains(keys[i]));
+
+		if (i % 97 == 0) {
+
+			assert(avl.balanced() && avl.size() == keys.size() - i - 1);
+		}
+	}
+
+	assert(avl.isEmpty() && avl.getHeight() == 0);
+
+	// removing from the low end only keeps taking the left spine
+	for (int i(0); i < 1023; ++i) {
+
+		avl.add(i);
+	}
+
+	for (int i(0); i < 1000; ++i) {
+
+		assert(avl.remove(i));
+	}
+
+	assert(avl.balanced() && avl.getHeight() == 5 && avl.select(0) == 1000);
+
+	BinarySearchTree<int>* base = new AVLTree<int>(5);
+	assert(base->add(3) && base->add(8) && base->add(9));
+	assert(base->remove(3) && base->getHeight() == 2 && base->getNumberOfNodes() == 3);
+	delete base;
+}
+
+/*
+* Unit test for copying, assigning and rebalancing
+*/
+void AVLcopy() {
+
+	CheckedAVL avl;
+
+	for (int i(0); i < 3000; ++i) {
+
+		avl.add((i * 7919) % 3000);
+	}
+
+	AVLTree<int> copy(avl);
+	assert(copy == avl && copy.getHeight() == avl.getHeight() && copy.size() == 3000);
+
+	// the copy keeps its heights, so it keeps balancing correctly
+	for (int i(0); i < 3000; i += 2) {
+
+		assert(copy.remove(i));
+	}
+
+	assert(copy.size() == 1500 && copy != avl && copy.getHeight() <= 13);
+
+	AVLTree<int> assigned;
+	assigned.add(-1);
+	assigned = copy;
+	assert(assigned == copy && !assigned.contains(-1) && assigned.getHeight() == copy.getHeight());
+
+	avl.rebalance();
+	assert(avl.balanced() && avl.getHeight() == 12 && avl.size() == 3000);
+	assert(avl.add(3000) && avl.remove(0) && avl.balanced());
+
+	std::vector<int> cousins = avl.getCousins(1500);
+	assert(avl.getNumberOfNodes() == 3000 && cousins.size() <= 2);
+
+	int count(0);
+
+	avl.inorderTraverse([](int& x) { ++x; });
+
+	for (int num : avl) {
+
+		assert(num == count + 2);
+
+		++count;
+	}
+
+	assert(count == 3000);
+
+	AVLTree<int> empty;
+	assert(empty.getHeight() == 0 && empty.isEmpty());
+}
+
+/*
+* Unit test for moving, and extract and insert keeping balance
+*/
+void AVLmove() {
+
+	CheckedAVL avl;
+
+	for (int i(0); i < 3000; ++i) {
+
+		avl.add((i * 7919) % 3000);
+	}
+
+	CheckedAVL moved(std::move(avl));
+	assert(avl.isEmpty() && avl.getHeight() == 0 && moved.balanced() && moved.size() == 3000);
+
+	// extract retraces like remove
+	AVLTree<int> evens;
+
+	for (int i(0); i < 3000; i += 2) {
+
+		assert(evens.insert(moved.extract(i)));
+
+		if (i % 101 == 0) {
+
+			assert(moved.balanced());
+		}
+	}
+
+	assert(moved.balanced() && moved.size() == 1500 && evens.size() == 1500 && evens.getHeight() <= 13);
+
+	avl = std::move(moved);
+	assert(avl.balanced() && avl.size() == 1500 && moved.isEmpty());
+	assert(avl.add(0) && moved.add(1) && moved.balanced() && avl.balanced());
+
+	AVLTree<std::string> words;
+
+	for (int i(0); i < 520; ++i) {
+
+		assert(words.emplace(1 + i % 40, static_cast<char>('a' + i / 40)));
+	}
+
+	assert(words.size() == 520 && words.getHeight() <= 11 && words.contains("mmmmmmmmmm"));
+}
+
+/*
+* Unit test for split and join, both relink the nodes (the largest item
+* keeps its address) and keep balance and subtree sizes
+*/
+void AVLsplit() {
+
+	CheckedAVL avl;
+
+	for (int i(0); i < 3000; ++i) {
+
+		avl.add((i * 7919) % 3000);
+	}
+
+	const int* last(&*avl.rbegin());
+
+	CheckedAVL upper(avl.split(1000));
+	assert(avl.balanced() && upper.balanced() && avl.size() == 1000 && upper.size() == 2000);
+	assert(*avl.rbegin() == 999 && *upper.begin() == 1000 && &*upper.rbegin() == last);
+	assert(avl.select(500) == 500 && upper.rank(1500) == 500);
+
+	CheckedAVL none(upper.split(5000)),
+			   all(avl.split(0));
+	assert(none.isEmpty() && upper.size() == 2000 && avl.isEmpty() && all.size() == 1000 && all.balanced());
+
+	all.join(upper);
+	assert(upper.isEmpty() && all.size() == 3000 && all.balanced() && &*all.rbegin() == last);
+
+	for (int i(0); i < 3000; ++i) {
+
+		assert(all.select(i) == i);
+	}
+
+	// a short tree on either side of a tall one
+	CheckedAVL high, low(all.split(10));
+	high.add(5000);
+	low.join(high);
+	all.join(low);
+	assert(all.size() == 3001 && all.balanced() && all.rank(5000) == 3000 && high.isEmpty());
+
+	CheckedAVL overlap;
+	overlap.add(3);
+
+	bool threw(false);
+
+	try {
+
+		all.join(overlap);
+
+	} catch (const std::invalid_argument&) {
+
+		threw = true;
+	}
+
+	assert(threw && overlap.size() == 1 && all.size() == 3001);
+
+	std::mt19937 rng(7);
+
+	for (int round(0); round < 300; ++round) {
+
+		int key(static_cast<int>(rng() % 3100));
+
+		CheckedAVL right(all.split(key));
+		assert(all.balanced() && right.balanced() && all.size() + right.size() == 3001);
+		assert((all.isEmpty() || *all.rbegin() < key) && (right.isEmpty() || *right.begin() >= key));
+
+		all.join(right);
+	}
+
+	assert(all.size() == 3001 && all.balanced());
+
+	// split trees share an arena, either can change or be cleared
+	CheckedAVL right(all.split(1500));
+
+	for (int i(0); i < 1500; i += 2) {
+
+		assert(all.remove(i) && right.remove(1500 + i) && right.add(5001 + i));
+	}
+
+	all.clear();
+	assert(right.balanced() && right.size() == 1501 && right.contains(1501) && !right.contains(1500));
+	assert(all.add(1) && all.size() == 1);
+
+	// and each can go to a different thread, the arena is locked
+	CheckedAVL other(right.split(3000));
+
+	std::size_t rightSize(right.size()), otherSize(other.size());
+
+	std::thread worker([&other] {
+
+		for (int i(0); i < 2000; ++i) {
+
+			other.add(10000 + i);
+			other.remove(10000 + i / 2);
+		}
+	});
+
+	for (int i(0); i < 2000; ++i) {
+
+		right.add(-i);
+		right.remove(-i / 2);
+	}
+
+	worker.join();
+	assert(right.balanced() && other.balanced() && right.size() == rightSize + 1000 && other.size() == otherSize + 1000);
+	assert(right.contains(-1999) && !right.contains(-999) && other.contains(11999) && !other.contains(10999));
+
+	// when both arenas are already shared the items move instead
+	CheckedAVL lows, highs;
+
+	for (int i(0); i < 200; ++i) {
+
+		(i < 100 ? lows : highs).add(i);
+	}
+
+	CheckedAVL lowsRest(lows.split(50)),
+			   highsRest(highs.split(150));
+
+	lows.join(highsRest);
+	assert(lows.balanced() && lows.size() == 100 && highsRest.isEmpty() && lows.rank(150) == 50);
+	assert(lowsRest.size() == 50 && highs.size() == 50);
+
+	// a sliding window: the oldest keys are split off and dropped every
+	// round, the slots they free must be reused by the keys added next
+	CheckedAVL window;
+	std::size_t steadyBytes(0);
+
+	for (int round(0); round < 40; ++round) {
+
+		for (int i(0); i < 1000; ++i) {
+
+			window.add(round * 1000 + i);
+		}
+
+		CheckedAVL newer(window.split((round - 4) * 1000));
+		window.clear();
+		window = std::move(newer);
+
+		assert(window.balanced() && window.size() == static_cast<std::size_t>(std::min(round + 1, 5) * 1000));
+
+		if (round == 10) {
+
+			steadyBytes = window.bytesReserved();
+		}
+	}
+
+	assert(window.bytesReserved() <= steadyBytes);
+
+	// erasing ranges splits twice and joins once
+	CheckedAVL erased;
+
+	for (int i(0); i < 2000; ++i) {
+
+		erased.add(i);
+	}
+
+	assert(erased.eraseRange(500, 1500) == 1000 && erased.balanced() && erased.size() == 1000);
+	assert(erased.eraseRange(0, 10) == 10 && erased.eraseRange(1990, 5000) == 10 && erased.balanced());
+	assert(erased.eraseRange(400, 1600) == 200 && erased.balanced() && erased.select(390) == 1600);
+	assert(erased.countRange(0, 2000) == 780 && *erased.floor(1000) == 399 && *erased.ceiling(1000) == 1600);
+}
+
+/*
+* Unit test for unionWith, intersect and difference against std::set,
+* serial and on several threads, with the other tree of another kind
+*/
+void AVLsets() {
+
+	std::mt19937 rng(5);
+
+	for (unsigned threads : {1u, 4u}) {
+
+		for (int n : {0, 1, 100, 40000}) {
+
+			CheckedAVL avl;
+			BinarySearchTree<int> bst;
+			std::set<int> inAVL, inBST;
+
+			for (int i(0); i < n; ++i) {
+
+				int a(static_cast<int>(rng() % (3 * n + 1))),
+					b(static_cast<int>(rng() % (3 * n + 1)));
+
+				avl.add(a);
+				bst.add(b);
+				inAVL.insert(a);
+				inBST.insert(b);
+			}
+
+			std::set<int> both, either(inAVL), onlyAVL;
+
+			either.insert(inBST.begin(), inBST.end());
+
+			for (int k : inAVL) {
+
+				(inBST.count(k) ? both : onlyAVL).insert(k);
+			}
+
+			CheckedAVL united(avl), common(avl), rest(avl);
+
+			united.useThreads(threads);
+			common.useThreads(threads);
+			rest.useThreads(threads);
+
+			united.unionWith(bst);
+			common.intersect(bst);
+			rest.difference(bst);
+
+			assert(united.balanced() && sameItems(united, either));
+			assert(common.balanced() && sameItems(common, both));
+			assert(rest.balanced() && sameItems(rest, onlyAVL));
+			assert(n == 0 || united.select(united.size() - 1) == *either.rbegin());
+
+			// the trees keep working, and with themselves nothing changes or all goes
+			assert(united.add(-1) && common.add(-1) && rest.add(-1) && united.remove(-1));
+
+			united.unionWith(united);
+			common.intersect(common);
+			rest.difference(rest);
+			assert(sameItems(united, either) && common.size() == both.size() + 1 && rest.isEmpty());
+		}
+	}
+
+	// nodes left out are destroyed, their items freed
+	AVLTree<std::string> words;
+	RedBlackTree<std::string> vowels;
+
+	for (char c('a'); c <= 'z'; ++c) {
+
+		words.add(std::string(40, c));
+
+		if (std::string("aeiou").find(c) != std::string::npos) {
+
+			vowels.add(std::string(40, c));
+		}
+	}
+
+	AVLTree<std::string> consonants(words);
+
+	words.intersect(vowels);
+	consonants.difference(vowels);
+	assert(words.size() == 5 && consonants.size() == 21 && !consonants.contains(std::string(40, 'e')));
+
+	consonants.unionWith(words);
+	assert(consonants.size() == 26 && consonants.getHeight() <= 6);
+
+	// a copy that throws leaves the tree as it was, and it still merges after
+	AVLTree<Fragile> evens;
+	RedBlackTree<Fragile> all;
+
+	Fragile::copiesLeft = 1000;
+
+	for (int i(0); i < 100; ++i) {
+
+		evens.add(Fragile(2 * i));
+		all.add(Fragile(i));
+	}
+
+	bool thrown(false);
+
+	Fragile::copiesLeft = 40;
+
+	try {
+
+		evens.unionWith(all);
+
+	} catch (const std::runtime_error&) {
+
+		thrown = true;
+	}
+
+	assert(thrown && evens.size() == 100 && evens.select(99).key == 198 && !evens.contains(Fragile(1)));
+
+	Fragile::copiesLeft = 1000;
+
+	evens.unionWith(all);
+	assert(evens.size() == 150 && evens.contains(Fragile(99)) && evens.getHeight() <= 8);
+
+	// a much smaller tree is added item by item, and taken back when a copy throws
+	AVLTree<Fragile> few;
+
+	few.add(Fragile(201));
+	few.add(Fragile(203));
+	few.add(Fragile(205));
+
+	thrown = false;
+
+	Fragile::copiesLeft = 2;
+
+	try {
+
+		evens.unionWith(few);
+
+	} catch (const std::runtime_error&) {
+
+		thrown = true;
+	}
+
+	assert(thrown && evens.size() == 150 && !evens.contains(Fragile(201)) && !evens.contains(Fragile(203)));
+
+	Fragile::copiesLeft = 1000;
+
+	evens.unionWith(few);
+	assert(evens.size() == 153 && evens.select(152).key == 205 && evens.getHeight() <= 8);
+}
+
+/*
+* Runs all AVL unit tests in order
+*/
+void AVLTests() {
+
+	AVLcontains();
+	AVLadd();
+	AVLsorted();
+	AVLremove();
+	AVLcopy();
+	AVLmove();
+	AVLsplit();
+	AVLsets();
+
+}
+
+/*
+* A RedBlackTree that can check its own colors
+*/
+class CheckedRB : public RedBlackTree<int> {
+
+public:
+
+	CheckedRB() {}
+
+	CheckedRB(RedBlackTree<int>&& other) :RedBlackTree<int>(std::move(other)) {}
+
+	/*
+	* Checks that the root is black, no red node has a red child,
+	* every path has the same number of black nodes and the height
+	* is within the red-black bound
+	* @return true if all rules hold
+	*/
+	bool valid() const {
+
+		bool ok(this->getRoot() == nullptr || !this->getRoot()->isRed());
+
+		CheckedRB::blackHeight(this->getRoot(), ok);
+
+		int bound(0);
+
+		for (std::size_t n(this->size() + 1); n > 1; n /= 2) {
+
+			++bound;
+		}
+
+		return ok && this->getHeight() <= 2 * (bound + 1);
+	}
+
+private:
+
+	static int blackHeight(Node<int>* curr, bool& ok) {
+
+		if (curr == nullptr) {
+
+			return 1;
+		}
+
+		if (curr->isRed() && ((curr->getLeft() != nullptr && curr->getLeft()->isRed()) ||
+		                      (curr->getRight() != nullptr && curr->getRight()->isRed()))) {
+
+			ok = false;
+		}
+
+		int left(CheckedRB::blackHeight(curr->getLeft(), ok)),
+			right(CheckedRB::blackHeight(curr->getRight(), ok));
+
+		ok = ok && left == right;
+
+		return left + (curr->isRed() ? 0 : 1);
+	}
+};
+
+/*
+* Unit test for add, sorted input is the worst case for recoloring
+*/
+void RBadd() {
+
+	CheckedRB rb;
+	assert(rb.valid() && rb.isEmpty());
+
+	for (int i(0); i < 5000; ++i) {
+
+		assert(rb.add(i) && !rb.add(i));
+
+		if (i % 101 == 0) {
+
+			assert(rb.valid());
+		}
+	}
+
+	assert(rb.valid() && rb.size() == 5000 && rb.select(4321) == 4321);
+
+	RedBlackTree<int> single(7);
+	assert(single.contains(7) && single.getHeight() == 1);
+
+	BinarySearchTree<int>* base = new RedBlackTree<int>();
+
+	for (int i(10); i > 0; --i) {
+
+		assert(base->add(i));
+	}
+
+	assert(base->getHeight() <= 5 && base->getNumberOfNodes() == 10);
+
+	delete base;
+}
+
+/*
+* Unit test for remove, every case of the fixup is hit by random removals
+*/
+void RBremove() {
+
+	CheckedRB rb;
+	assert(!rb.remove(1));
+
+	std::vector<int> keys;
+
+	for (int i(0); i < 4000; ++i) {
+
+		keys.push_back(i);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(21));
+
+	for (int k : keys) {
+
+		assert(rb.add(k));
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(22));
+
+	for (std::size_t i(0); i < keys.size(); ++i) {
+
+		assert(rb.remove(keys[i]) && !rb.remove(keys[i]) && !rb.contains(keys[i]));
+
+		if (i % 89 == 0) {
+
+			assert(rb.valid() && rb.size() == keys.size() - i - 1);
+		}
+	}
+
+	assert(rb.isEmpty() && rb.valid());
+
+	// interleaved adds and removes, as in a write heavy workload
+	for (int i(0); i < 20000; ++i) {
+
+		rb.add((i * 7) % 1000);
+		rb.remove((i * 13) % 1000);
+	}
+
+	assert(rb.valid());
+
+	for (int i(0); i < 1000; ++i) {
+
+		assert(rb.contains(i) == (rb.rank(i) < rb.size() && rb.select(rb.rank(i)) == i));
+	}
+}
+
+/*
+* Unit test for copying, readTree and rebalance, which color the tree
+*/
+void RBcopy() {
+
+	CheckedRB rb;
+
+	for (int i(0); i < 3000; ++i) {
+
+		rb.add((i * 7919) % 3000);
+	}
+
+	RedBlackTree<int> copy(rb);
+	assert(copy == rb && copy.size() == 3000);
+
+	for (int i(0); i < 3000; i += 2) {
+
+		assert(copy.remove(i));
+	}
+
+	RedBlackTree<int> assigned;
+	assigned.add(-1);
+	assigned = copy;
+	assert(assigned == copy && !assigned.contains(-1) && copy != rb);
+
+	for (int n : {1, 2, 3, 7, 8, 1000, 1023, 1024}) {
+
+		std::vector<int> keys;
+
+		for (int i(0); i < n; ++i) {
+
+			keys.push_back(i);
+		}
+
+		assert(rb.readTree(keys.begin(), keys.end()) && rb.valid() && rb.size() == static_cast<std::size_t>(n));
+		assert(rb.add(n) && rb.remove(0) && rb.valid());
+	}
+
+	for (int i(0); i < 5000; ++i) {
+
+		rb.add(i * 3);
+	}
+
+	rb.rebalance();
+	assert(rb.valid() && rb.getHeight() == 13);
+
+	for (int i(0); i < 2000; ++i) {
+
+		rb.remove(i * 3);
+	}
+
+	assert(rb.valid());
+}
+
+/*
+* Unit test for moving, and extract and insert keeping the colors
+*/
+void RBmove() {
+
+	CheckedRB rb;
+
+	for (int i(0); i < 2000; ++i) {
+
+		assert(rb.emplace(i));
+	}
+
+	CheckedRB moved(std::move(rb));
+	assert(rb.isEmpty() && rb.valid() && moved.valid() && moved.size() == 2000);
+
+	for (int i(0); i < 2000; i += 3) {
+
+		assert(rb.insert(moved.extract(i)));
+	}
+
+	assert(rb.valid() && moved.valid() && rb.size() == 667 && moved.size() == 1333);
+
+	rb = std::move(moved);
+	assert(rb.valid() && rb.size() == 1333 && moved.isEmpty() && !rb.contains(0) && rb.contains(1));
+}
+
+/*
+* Unit test for split and join, subtrees are linked by black height
+*/
+void RBsplit() {
+
+	CheckedRB rb;
+
+	for (int i(0); i < 2000; ++i) {
+
+		assert(rb.add(i));
+	}
+
+	const int* first(&*rb.begin());
+
+	CheckedRB upper(rb.split(700));
+	assert(rb.valid() && upper.valid() && rb.size() == 700 && upper.size() == 1300);
+	assert(&*rb.begin() == first && *upper.begin() == 700 && upper.rank(1999) == 1299);
+
+	rb.join(upper);
+	assert(rb.valid() && rb.size() == 2000 && upper.isEmpty() && rb.select(1999) == 1999);
+
+	std::mt19937 rng(11);
+
+	for (int round(0); round < 300; ++round) {
+
+		int key(static_cast<int>(rng() % 2100));
+
+		CheckedRB right(rb.split(key));
+		assert(rb.valid() && right.valid() && rb.size() + right.size() == 2000);
+		assert((rb.isEmpty() || *rb.rbegin() < key) && (right.isEmpty() || *right.begin() >= key));
+
+		// a tree of one item against a tall one
+		CheckedRB single;
+		single.add(3000 + round);
+		right.join(single);
+		assert(right.valid() && single.isEmpty() && right.remove(3000 + round));
+
+		rb.join(right);
+	}
+
+	CheckedRB right(rb.split(1000));
+
+	for (int i(0); i < 1000; i += 3) {
+
+		assert(rb.remove(i) && right.remove(1000 + i));
+	}
+
+	assert(rb.valid() && right.valid() && rb.size() == 666 && right.size() == 666);
+
+	rb.join(right);
+	assert(rb.valid() && rb.size() == 1332 && rb.select(666) == 1001);
+
+	// a split can hand back a red subtree whole, the tree must still
+	// take adds and removes afterwards
+	for (int n(1); n <= 20; ++n) {
+
+		for (int key(0); key <= n; ++key) {
+
+			CheckedRB small;
+
+			for (int i(0); i < n; ++i) {
+
+				small.add(i);
+			}
+
+			CheckedRB rest(small.split(key));
+			assert(small.valid() && rest.valid());
+
+			assert(small.add(-1) && rest.add(100) && small.valid() && rest.valid());
+			assert(small.remove(-1) && rest.remove(100) && small.valid() && rest.valid());
+
+			small.join(rest);
+			assert(small.valid() && small.size() == static_cast<std::size_t>(n));
+			assert(small.add(-1) && small.remove(0) && small.valid());
+		}
+	}
+
+	for (int round(0); round < 100; ++round) {
+
+		int low(static_cast<int>(rng() % 2000));
+
+		std::size_t count(rb.countRange(low, low + 20));
+
+		assert(rb.eraseRange(low, low + 20) == count && rb.valid() && rb.countRange(low, low + 20) == 0);
+	}
+
+	// erasing may leave a red subtree as the whole tree
+	for (int n(1); n <= 12; ++n) {
+
+		for (int low(0); low <= n; ++low) {
+
+			for (int high(low + 1); high <= n + 1; ++high) {
+
+				CheckedRB small;
+
+				for (int i(0); i < n; ++i) {
+
+					small.add(i);
+				}
+
+				small.eraseRange(low, high);
+				assert(small.valid() && small.add(-1) && small.add(100) && small.valid());
+				assert(small.remove(-1) && small.valid());
+			}
+		}
+	}
+}
+
+/*
+* Unit test for unionWith, intersect and difference keeping the colors
+*/
+void RBsets() {
+
+	CheckedRB evens, threes;
+
+	for (int i(0); i < 3000; ++i) {
+
+		evens.add(2 * i);
+		threes.add(3 * i);
+	}
+
+	CheckedRB united(evens), common(evens), rest(evens);
+
+	united.useThreads(4);
+	united.unionWith(threes);
+	common.intersect(threes);
+	rest.difference(threes);
+
+	assert(united.valid() && common.valid() && rest.valid());
+	assert(united.size() == 5000 && common.size() == 1000 && rest.size() == 2000);
+	assert(common.select(1) == 6 && rest.select(1) == 4 && united.rank(8997) == 4999);
+
+	assert(united.add(-1) && common.add(-1) && rest.add(-1) && rest.remove(4));
+	assert(united.valid() && common.valid() && rest.valid());
+
+	// every pair of subsets of 0..5, the results take adds and removes
+	for (int mine(0); mine < 64; ++mine) {
+
+		for (int theirs(0); theirs < 64; ++theirs) {
+
+			CheckedRB a, b, c;
+			RedBlackTree<int> other;
+
+			for (int i(0); i < 6; ++i) {
+
+				if (mine & (1 << i)) {
+
+					a.add(i);
+					b.add(i);
+					c.add(i);
+				}
+
+				if (theirs & (1 << i)) {
+
+					other.add(i);
+				}
+			}
+
+			a.unionWith(other);
+			b.intersect(other);
+			c.difference(other);
+
+			for (CheckedRB* tree : {&a, &b, &c}) {
+
+				assert(tree->valid() && tree->add(-1) && tree->add(10) && tree->valid());
+				assert(tree->remove(-1) && tree->valid());
+			}
+		}
+	}
+}
+
+/*
+* Runs all RedBlackTree unit tests in order
+*/
+void RBTests() {
+
+	RBadd();
+	RBremove();
+	RBcopy();
+	RBmove();
+	RBsplit();
+	RBsets();
+}
+
+/*
+* A BTree with small nodes, so few items make many levels,
+* that can check its own shape
+*/
+class CheckedBTree : public BTree<int, 6> {
+
+public:
+
+	/*
+	* Checks that every node but the root holds between MIN_ITEMS and
+	* MAX_ITEMS sorted items, that all leaves are at the same depth,
+	* that parent links are right and that size() counts every item
+	* @return true if all rules hold
+	*/
+	bool valid() const {
+
+		bool ok(true);
+
+		std::size_t items(0);
+
+		int leafDepth(-1);
+
+		if (this->getRoot() != nullptr) {
+
+			ok = this->getRoot()->parent == nullptr && this->getRoot()->count > 0;
+
+			CheckedBTree::walk(this->getRoot(), 1, leafDepth, items, ok);
+		}
+
+		return ok && items == this->size() && leafDepth == (this->isEmpty() ? -1 : this->getHeight());
+	}
+
+private:
+
+	static void walk(const LeafNode* node, int depth, int& leafDepth, std::size_t& items, bool& ok) {
+
+		ok = ok && node->count <= MAX_ITEMS && (node->parent == nullptr || node->count >= MIN_ITEMS);
+
+		for (unsigned i(1); i < node->count; ++i) {
+
+			ok = ok && node->items()[i - 1] < node->items()[i];
+		}
+
+		items += node->count;
+
+		if (node->leaf) {
+
+			ok = ok && (leafDepth == -1 || leafDepth == depth);
+			leafDepth = depth;
+
+			return;
+		}
+
+		const InnerNode* inner = static_cast<const InnerNode*>(node);
+
+		for (unsigned c(0); c <= node->count; ++c) {
+
+			const LeafNode* child = inner->children[c];
+
+			// every item of child c is between items c - 1 and c
+			ok = ok && child->parent == inner &&
+			     (c == 0 || node->items()[c - 1] < child->items()[0]) &&
+			     (c == node->count || child->items()[child->count - 1] < node->items()[c]);
+
+			CheckedBTree::walk(child, depth + 1, leafDepth, items, ok);
+		}
+	}
+};
+
+/*
+* Unit test for add, sorted and shuffled items split nodes on every level
+*/
+void BTadd() {
+
+	CheckedBTree tree;
+	assert(tree.valid() && tree.isEmpty() && tree.getHeight() == 0 && !tree.contains(1));
+
+	for (int i(0); i < 3000; ++i) {
+
+		assert(tree.add(i) && !tree.add(i));
+
+		if (i % 97 == 0) {
+
+			assert(tree.valid());
+		}
+	}
+
+	assert(tree.valid() && tree.size() == 3000 && tree.getNumberOfNodes() == 3000);
+	assert(tree.getHeight() <= 8);
+
+	std::vector<int> keys;
+
+	for (int i(0); i < 5000; ++i) {
+
+		keys.push_back(-i);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(41));
+
+	for (int k : keys) {
+
+		assert(tree.add(k) == (k != 0));
+	}
+
+	assert(tree.valid() && tree.size() == 7999);
+
+	for (int i(-4999); i < 3000; ++i) {
+
+		assert(tree.contains(i));
+	}
+
+	assert(!tree.contains(-5000) && !tree.contains(3000));
+
+	BTree<int> wide(5);
+	assert(wide.contains(5) && wide.getHeight() == 1 && !wide.add(5));
+
+	BTree<std::string, 4, std::less<>> words;
+
+	for (int i(0); i < 500; ++i) {
+
+		assert(words.add("word number " + std::to_string(i)));
+	}
+
+	assert(words.contains("word number 250") && !words.contains("word number 500"));
+}
+
+/*
+* Unit test for remove, borrowing from and merging with siblings
+*/
+void BTremove() {
+
+	CheckedBTree tree;
+	assert(!tree.remove(1));
+
+	std::vector<int> keys;
+
+	for (int i(0); i < 4000; ++i) {
+
+		keys.push_back(i);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+	for (int k : keys) {
+
+		tree.add(k);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(43));
+
+	for (std::size_t i(0); i < keys.size(); ++i) {
+
+		assert(tree.remove(keys[i]) && !tree.remove(keys[i]) && !tree.contains(keys[i]));
+
+		if (i % 83 == 0) {
+
+			assert(tree.valid() && tree.size() == keys.size() - i - 1);
+		}
+	}
+
+	assert(tree.isEmpty() && tree.valid() && tree.begin() == tree.end());
+
+	// interleaved adds and removes
+	for (int i(0); i < 20000; ++i) {
+
+		tree.add((i * 7) % 1000);
+		tree.remove((i * 13) % 1000);
+	}
+
+	assert(tree.valid());
+
+	BTree<std::string, 6> words;
+
+	for (int i(0); i < 2000; ++i) {
+
+		words.add("a string long enough to live on the heap " + std::to_string(i));
+	}
+
+	for (int i(0); i < 2000; i += 2) {
+
+		assert(words.remove("a string long enough to live on the heap " + std::to_string(i)));
+	}
+
+	assert(words.size() == 1000 && words.contains("a string long enough to live on the heap 1"));
+}
+
+/*
+* Unit test for readTree, copying, equality, iterators and inorderTraverse
+*/
+void BTread() {
+
+	CheckedBTree tree;
+
+	for (int n : {1, 2, 5, 6, 7, 36, 215, 216, 1000, 4096}) {
+
+		std::vector<int> keys;
+
+		for (int i(0); i < n; ++i) {
+
+			keys.push_back(2 * i);
+		}
+
+		assert(tree.readTree(keys.begin(), keys.end()) && tree.valid() && tree.size() == static_cast<std::size_t>(n));
+		assert(tree.add(1) && tree.remove(0) && tree.valid());
+	}
+
+	std::vector<int> unsorted = {5, 3, 9, 3, 1, 9};
+	assert(tree.readTree(std::move(unsorted), false) && tree.valid() && tree.size() == 4);
+
+	int arr[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+	assert(tree.readTree(arr, 10) && tree.valid() && !tree.readTree(arr, 0) && tree.size() == 10);
+
+	for (int i(0); i < 3000; ++i) {
+
+		tree.add((i * 7919) % 3000);
+	}
+
+	BTree<int, 6> copy(tree);
+	assert(copy == tree && copy.size() == 3000);
+
+	for (int i(0); i < 3000; i += 2) {
+
+		assert(copy.remove(i));
+	}
+
+	BTree<int, 6> assigned;
+	assigned.add(-1);
+	assigned = copy;
+	assert(assigned == copy && !assigned.contains(-1) && copy != tree);
+
+	int expected(0);
+
+	for (int num : tree) {
+
+		assert(num == expected++);
+	}
+
+	assert(expected == 3000);
+
+	for (BTree<int, 6>::reverse_iterator it = copy.rbegin(); it != copy.rend(); ++it) {
+
+		assert(*it == (expected -= 2) + 1);
+	}
+
+	BTree<int, 6>::iterator it = copy.end();
+	assert(*--it == 2999 && *it-- == 2999 && *it == 2997 && *++it == 2999 && ++it == copy.end());
+
+	static int visited;
+	visited = 0;
+
+	copy.inorderTraverse([](int& num) {
+
+		assert(num == 2 * visited++ + 1);
+	});
+
+	assert(visited == 1500);
+
+	copy.clear();
+	assert(copy.isEmpty() && copy.size() == 0 && copy.add(1) && copy.size() == 1);
+}
+
+/*
+* Runs all BTree unit tests in order
+*/
+void BTTests() {
+
+	BTadd();
+	BTremove();
+	BTread();
+}
+
+/*
+* Checks the kernels for one key type at the instruction set in use:
+* countLess on blocks of every length up to two BTree nodes, and the
+* batch lower bounds and containsBatch against FrozenTree::lowerBound
+*/
+template<class T>
+void assertKernels() {
+
+	std::mt19937 gen(51);
+
+	std::vector<T> block;
+
+	for (unsigned n(0); n <= 130; ++n) {
+
+		for (T query : {static_cast<T>(-1), static_cast<T>(n), static_cast<T>(gen() % 200)}) {
+
+			unsigned less(0);
+
+			for (T key : block) {
+
+				less += key < query;
+			}
+
+			assert(SimdSearch::countLess(block.data(), n, query) == less);
+		}
+
+		block.push_back(static_cast<T>(gen() % 200) - static_cast<T>(100));
+	}
+
+	for (std::size_t n : {0, 1, 2, 7, 8, 9, 100, 1000}) {
+
+		std::vector<T> keys;
+
+		for (std::size_t i(0); i < n; ++i) {
+
+			keys.push_back(static_cast<T>(3 * i));
+		}
+
+		FrozenTree<T> frozen(keys.begin(), n);
+
+		std::vector<T> queries;
+
+		for (int q(-2); q <= static_cast<int>(3 * n + 2); ++q) {
+
+			queries.push_back(static_cast<T>(q));
+		}
+
+		for (std::size_t count : {std::size_t(0), std::size_t(5), std::size_t(8), queries.size()}) {
+
+			bool* found = new bool[count + 1];
+
+			frozen.containsBatch(queries.data(), count, found);
+
+			for (std::size_t i(0); i < count; ++i) {
+
+				assert(found[i] == frozen.contains(queries[i]));
+			}
+
+			delete[] found;
+		}
+	}
+
+	BTree<T> tree;
+
+	for (int i(0); i < 5000; ++i) {
+
+		tree.add(static_cast<T>((i * 7919) % 5000));
+	}
+
+	for (int i(-10); i < 5010; ++i) {
+
+		assert(tree.contains(static_cast<T>(i)) == (i >= 0 && i < 5000));
+	}
+}
+
+/*
+* Unit test for the search kernels, every instruction set
+* the processor has must give the scalar answers
+*/
+void simd() {
+
+	SimdSearch::Level best = SimdSearch::supported();
+
+	for (int level(SimdSearch::SCALAR); level <= best; ++level) {
+
+		SimdSearch::useLevel(static_cast<SimdSearch::Level>(level));
+		assert(SimdSearch::level() == level);
+
+		assertKernels<int>();
+		assertKernels<long>();
+		assertKernels<long long>();
+		assertKernels<float>();
+		assertKernels<double>();
+		assertKernels<short>();
+	}
+
+	SimdSearch::useLevel(SimdSearch::AVX2);
+	assert(SimdSearch::level() == best);
+
+	// no vector kernels for strings, the batch is scalar
+	FrozenTree<std::string> words;
+	std::string word("absent");
+	bool found(true);
+	words.containsBatch(&word, 1, &found);
+	assert(!found);
+}
+
+/*
+* A CompactAVLTree that can check its links, balance bits and
+* whichever optional fields it has
+*/
+template<class Fields = CompactFields<>>
+class CheckedCompact : public CompactAVLTree<int, std::less<int>, Fields> {
+
+	typedef CompactAVLTree<int, std::less<int>, Fields> Base;
+
+public:
+
+	// Bytes of one node
+	static const std::size_t NODE_BYTES = sizeof(typename Base::CompactNode);
+
+	/*
+	* Checks that items are in order, that parent indices are right,
+	* that the balance bits match the heights of the subtrees, which
+	* differ by at most one, that subtree sizes and sums are right,
+	* and that size() counts every item
+	* @return true if all rules hold
+	*/
+	bool valid() const {
+
+		bool ok(true);
+
+		std::size_t items(0);
+
+		long long sum(0);
+
+		int height = (this->getRoot() != Base::NIL) ? this->walk(this->getRoot(), Base::NIL, items, sum, ok) : 0;
+
+		return ok && items == this->size() && height == this->getHeight();
+	}
+
+private:
+
+	int walk(std::uint32_t i, std::uint32_t parent, std::size_t& items, long long& sum, bool& ok) const {
+
+		std::uint32_t leftChild = this->leftOf(i);
+		std::uint32_t rightChild = this->rightOf(i);
+
+		int item = this->node(i).item();
+
+		int left(0), right(0);
+
+		std::size_t before(items);
+
+		long long below(0);
+
+		if (leftChild != Base::NIL) {
+
+			ok = ok && this->node(leftChild).item() < item;
+			left = this->walk(leftChild, i, items, below, ok);
+		}
+
+		if (rightChild != Base::NIL) {
+
+			ok = ok && item < this->node(rightChild).item();
+			right = this->walk(rightChild, i, items, below, ok);
+		}
+
+		ok = ok && this->balanceOf(i) == right - left;
+
+		if constexpr (Fields::parent) {
+
+			ok = ok && this->parentOf(i) == parent;
+		}
+
+		++items;
+		below += item;
+		sum += below;
+
+		if constexpr (Fields::size) {
+
+			ok = ok && this->node(i).size == items - before;
+		}
+
+		if constexpr (Fields::augmented) {
+
+			ok = ok && this->node(i).augment == below;
+		}
+
+		(void)parent;
+
+		return std::max(left, right) + 1;
+	}
+};
+
+/*
+* Augmentation summing the items of a subtree
+*/
+struct CompactSum {
+
+	typedef long long value_type;
+
+	static value_type value(int item) { return item; }
+
+	static value_type combine(value_type left, value_type right) { return left + right; }
+};
+
+/*
+* Augmentation keeping the longest string of a subtree
+*/
+struct CompactLongest {
+
+	typedef std::size_t value_type;
+
+	static value_type value(const std::string& item) { return item.size(); }
+
+	static value_type combine(value_type left, value_type right) { return std::max(left, right); }
+};
+
+/*
+* Unit test for add, sorted and shuffled items rotate on every level
+*/
+void CTadd() {
+
+	CheckedCompact<> tree;
+	assert(tree.valid() && tree.isEmpty() && tree.getHeight() == 0 && !tree.contains(1));
+
+	for (int i(0); i < 3000; ++i) {
+
+		assert(tree.add(i) && !tree.add(i));
+
+		if (i % 97 == 0) {
+
+			assert(tree.valid());
+		}
+	}
+
+	// an AVL tree of 3000 nodes is at most 16 levels
+	assert(tree.valid() && tree.size() == 3000 && tree.getNumberOfNodes() == 3000);
+	assert(tree.getHeight() <= 16);
+
+	std::vector<int> keys;
+
+	for (int i(0); i < 5000; ++i) {
+
+		keys.push_back(-i);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(51));
+
+	for (int k : keys) {
+
+		assert(tree.add(k) == (k != 0));
+	}
+
+	assert(tree.valid() && tree.size() == 7999 && tree.bytesReserved() >= 7999 * 16);
+
+	for (int i(-4999); i < 3000; ++i) {
+
+		assert(tree.contains(i));
+	}
+
+	assert(!tree.contains(-5000) && !tree.contains(3000));
+
+	CompactAVLTree<std::string, std::less<>> words;
+
+	for (int i(0); i < 500; ++i) {
+
+		assert(words.add("a string long enough to live on the heap " + std::to_string(i)));
+	}
+
+	assert(words.contains("a string long enough to live on the heap 250"));
+	assert(!words.contains("a string long enough to live on the heap 500"));
+}
+
+/*
+* Unit test for remove, every case of retracing and reusing free slots
+*/
+void CTremove() {
+
+	CheckedCompact<> tree;
+	assert(!tree.remove(1));
+
+	std::vector<int> keys;
+
+	for (int i(0); i < 4000; ++i) {
+
+		keys.push_back(i);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(52));
+
+	for (int k : keys) {
+
+		tree.add(k);
+	}
+
+	std::size_t bytes = tree.bytesReserved();
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(53));
+
+	for (std::size_t i(0); i < keys.size(); ++i) {
+
+		assert(tree.remove(keys[i]) && !tree.remove(keys[i]) && !tree.contains(keys[i]));
+
+		if (i % 83 == 0) {
+
+			assert(tree.valid() && tree.size() == keys.size() - i - 1);
+		}
+	}
+
+	assert(tree.isEmpty() && tree.valid() && tree.begin() == tree.end());
+
+	// interleaved adds and removes reuse the freed slots
+	for (int i(0); i < 20000; ++i) {
+
+		tree.add((i * 7) % 1000);
+		tree.remove((i * 13) % 1000);
+
+		if (i % 501 == 0) {
+
+			assert(tree.valid());
+		}
+	}
+
+	assert(tree.valid() && tree.bytesReserved() == bytes);
+
+	CompactAVLTree<std::string> words;
+
+	for (int i(0); i < 2000; ++i) {
+
+		words.add("a string long enough to live on the heap " + std::to_string(i));
+	}
+
+	for (int i(0); i < 2000; i += 2) {
+
+		assert(words.remove("a string long enough to live on the heap " + std::to_string(i)));
+	}
+
+	// the pool moves the strings when it grows
+	for (int i(2000); i < 5000; ++i) {
+
+		words.add("a string long enough to live on the heap " + std::to_string(i));
+	}
+
+	assert(words.size() == 4000 && words.contains("a string long enough to live on the heap 1"));
+	assert(words.contains("a string long enough to live on the heap 4999"));
+}
+
+/*
+* Unit test for readTree, copying, equality, iterators and inorderTraverse
+*/
+void CTread() {
+
+	CheckedCompact<> tree;
+
+	for (int n : {1, 2, 3, 4, 7, 8, 100, 1023, 1024, 4097}) {
+
+		std::vector<int> keys;
+
+		for (int i(0); i < n; ++i) {
+
+			keys.push_back(2 * i);
+		}
+
+		assert(tree.readTree(keys.begin(), keys.end()) && tree.valid() && tree.size() == static_cast<std::size_t>(n));
+		assert(tree.add(1) && tree.remove(0) && tree.valid());
+	}
+
+	std::vector<int> unsorted = {5, 3, 9, 3, 1, 9};
+	assert(tree.readTree(std::move(unsorted), false) && tree.valid() && tree.size() == 4);
+
+	int arr[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+	assert(tree.readTree(arr, 10) && tree.valid() && !tree.readTree(arr, 0) && tree.size() == 10);
+
+	for (int i(0); i < 3000; ++i) {
+
+		tree.add((i * 7919) % 3000);
+	}
+
+	CompactAVLTree<int> copy(tree);
+	assert(copy.size() == 3000 && std::equal(copy.begin(), copy.end(), tree.begin()));
+
+	for (int i(0); i < 3000; i += 2) {
+
+		assert(copy.remove(i));
+	}
+
+	CompactAVLTree<int> assigned;
+	assigned.add(-1);
+	assigned = copy;
+	assert(assigned == copy && !assigned.contains(-1) && assigned.add(0));
+
+	int expected(0);
+
+	for (int num : tree) {
+
+		assert(num == expected++);
+	}
+
+	assert(expected == 3000);
+
+	for (CompactAVLTree<int>::reverse_iterator it = copy.rbegin(); it != copy.rend(); ++it) {
+
+		assert(*it == (expected -= 2) + 1);
+	}
+
+	CompactAVLTree<int>::iterator it = copy.end();
+	assert(*--it == 2999 && *it-- == 2999 && *it == 2997 && *++it == 2999 && ++it == copy.end());
+
+	static int visited;
+	visited = 0;
+
+	copy.inorderTraverse([](int& num) {
+
+		assert(num == 2 * visited++ + 1);
+	});
+
+	assert(visited == 1500);
+
+	copy.clear();
+	assert(copy.isEmpty() && copy.size() == 0 && copy.add(1) && copy.size() == 1);
+
+	std::vector<std::string> words;
+
+	for (int i(0); i < 300; ++i) {
+
+		words.push_back("a string long enough to live on the heap " + std::to_string(1000 + i));
+	}
+
+	CompactAVLTree<std::string> strings;
+	assert(strings.readTree(std::vector<std::string>(words)) && strings.size() == 300);
+	assert(std::equal(strings.begin(), strings.end(), words.begin()));
+
+	CompactAVLTree<std::string> stringCopy(strings);
+	assert(stringCopy == strings && stringCopy.remove(words[7]) && stringCopy != strings);
+}
+
+/*
+* Unit test for the optional node fields: no parent links, subtree
+* sizes for select and rank, and augmentations for summary
+*/
+void CTfields() {
+
+	// without parent links an int node is 3 words
+	assert(CheckedCompact<CompactFields<false>>::NODE_BYTES == 12 && CheckedCompact<>::NODE_BYTES == 16);
+	assert((CheckedCompact<CompactFields<false, true, CompactSum>>::NODE_BYTES == 24));
+	assert(CompactFields<>::parent && !CompactFields<>::size && !CompactFields<>::augmented);
+
+	CheckedCompact<CompactFields<false>> bare;
+	CheckedCompact<CompactFields<false, true, CompactSum>> ranked;
+	CheckedCompact<CompactFields<true, true>> sized;
+
+	std::vector<int> keys;
+
+	for (int i(0); i < 3000; ++i) {
+
+		keys.push_back(3 * i);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(54));
+
+	for (int k : keys) {
+
+		assert(bare.add(k) && ranked.add(k) && sized.add(k));
+	}
+
+	assert(bare.valid() && ranked.valid() && sized.valid());
+	assert(bare.bytesReserved() < sized.bytesReserved());
+	assert(ranked.summary() == 3LL * 2999 * 3000 / 2);
+
+	for (std::size_t k(0); k < 3000; k += 7) {
+
+		int item = static_cast<int>(3 * k);
+
+		assert(ranked.select(k) == item && sized.select(k) == item);
+		assert(ranked.rank(item) == k && ranked.rank(item + 1) == k + 1 && sized.rank(item - 1) == k);
+	}
+
+	try {
+
+		ranked.select(3000);
+		assert(false);
+
+	} catch (const std::out_of_range&) {}
+
+	// iterators and traversals without parent links search from the root
+	int expected(0);
+
+	for (int num : bare) {
+
+		assert(num == expected);
+		expected += 3;
+	}
+
+	assert(expected == 9000 && *bare.rbegin() == 8997 && *--bare.end() == 8997);
+
+	static int visited;
+	visited = 0;
+
+	bare.inorderTraverse([](int& num) {
+
+		assert(num == 3 * visited++);
+	});
+
+	assert(visited == 3000);
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(55));
+
+	for (std::size_t i(0); i < 2000; ++i) {
+
+		assert(bare.remove(keys[i]) && ranked.remove(keys[i]) && sized.remove(keys[i]));
+
+		if (i % 97 == 0) {
+
+			assert(bare.valid() && ranked.valid() && sized.valid());
+		}
+	}
+
+	assert(bare.valid() && ranked.valid() && sized.valid() && ranked.size() == 1000);
+	assert(std::equal(bare.begin(), bare.end(), ranked.begin()) && ranked.select(999) == *sized.rbegin());
+
+	CompactAVLTree<int, std::less<int>, CompactFields<false, true, CompactSum>> copy(ranked);
+	assert(copy == ranked && copy.summary() == ranked.summary() && copy.remove(ranked.select(0)));
+
+	for (int i(0); i < 1000; ++i) {
+
+		copy.add(i);
+	}
+
+	assert(copy.rank(1000) >= 1000 && copy.summary() > ranked.summary());
+
+	ranked.readTree(keys.begin(), keys.end(), false);
+	assert(ranked.valid() && ranked.size() == 3000 && ranked.summary() == 3LL * 2999 * 3000 / 2);
+
+	CompactAVLTree<std::string, std::less<>, CompactFields<false, false, CompactLongest>> words;
+
+	for (int i(0); i < 1000; ++i) {
+
+		words.add(std::string(i % 300, 'x') + std::to_string(i));
+	}
+
+	assert(words.summary() == 299 + 3);
+
+	for (int i(299); i < 1000; i += 300) {
+
+		words.remove(std::string(299, 'x') + std::to_string(i));
+	}
+
+	assert(words.summary() == 298 + 3 && words.contains(std::string(298, 'x') + "298"));
+}
+
+/*
+* Runs all CompactAVLTree unit tests in order
+*/
+void CompactTests() {
+
+	CTadd();
+	CTremove();
+	CTread();
+	CTfields();
+}
+
+/*
+* A ConcurrentAVLTree that can check its links, heights and routing
+* nodes while no other thread uses it
+*/
+template<class T, class Compare = std::less<T>>
+class CheckedConcurrent : public ConcurrentAVLTree<T, Compare> {
+
+	typedef typename ConcurrentAVLTree<T, Compare>::Node Node;
+
+public:
+
+	/*
+	* Checks that items are in order, that parent links are right, that
+	* stored heights are the real ones and differ by at most one between
+	* siblings, that routing nodes have two children, and that size()
+	* counts every item
+	* @return true if all rules hold
+	*/
+	bool valid() const {
+
+		bool ok(true);
+
+		std::size_t items(0);
+
+		const Node* root = this->getRoot();
+
+		int height = (root != nullptr) ? this->walk(root, root->parent.load(), items, ok) : 0;
+
+		return ok && items == this->size() && height == this->getHeight();
+	}
+
+private:
+
+	int walk(const Node* node, const Node* parent, std::size_t& items, bool& ok) const {
+
+		const Node* leftChild = node->child[0].load();
+		const Node* rightChild = node->child[1].load();
+
+		int left(0), right(0);
+
+		if (leftChild != nullptr) {
+
+			ok = ok && this->itemOf(leftChild) < this->itemOf(node);
+			left = this->walk(leftChild, node, items, ok);
+		}
+
+		if (rightChild != nullptr) {
+
+			ok = ok && this->itemOf(node) < this->itemOf(rightChild);
+			right = this->walk(rightChild, node, items, ok);
+		}
+
+		ok = ok && node->parent.load() == parent && node->height.load() == std::max(left, right) + 1;
+		ok = ok && left - right <= 1 && right - left <= 1;
+		ok = ok && (node->present.load() || (leftChild != nullptr && rightChild != nullptr));
+
+		items += node->present.load();
+
+		return std::max(left, right) + 1;
+	}
+};
+
+/*
+* Unit test for EpochReclaimer, nothing retired inside a Guard is
+* freed until it closes
+*/
+void epoch() {
+
+	static int freed;
+	freed = 0;
+
+	{
+		EpochReclaimer::Guard guard;
+		EpochReclaimer::Guard nested;
+
+		for (int i(0); i < 3; ++i) {
+
+			EpochReclaimer::retire(new int(i), [](void* num) {
+
+				delete static_cast<int*>(num);
+				++freed;
+			});
+		}
+
+		EpochReclaimer::collect();
+		EpochReclaimer::collect();
+		EpochReclaimer::collect();
+		assert(freed == 0);
+	}
+
+	EpochReclaimer::collect();
+	EpochReclaimer::collect();
+	EpochReclaimer::collect();
+	assert(freed == 3);
+}
+
+/*
+* Unit test for add, remove and contains on one thread, removing
+* items with two children leaves routing nodes that adding revives
+*/
+void CCsingle() {
+
+	CheckedConcurrent<int> tree;
+	assert(tree.valid() && tree.isEmpty() && tree.getHeight() == 0 && !tree.contains(1) && !tree.remove(1));
+
+	for (int i(0); i < 3000; ++i) {
+
+		assert(tree.add(i) && !tree.add(i));
+
+		if (i % 97 == 0) {
+
+			assert(tree.valid());
+		}
+	}
+
+	// an AVL tree of 3000 nodes is at most 16 levels
+	assert(tree.valid() && tree.size() == 3000 && tree.getHeight() <= 16);
+
+	for (int i(0); i < 3000; i += 2) {
+
+		assert(tree.remove(i) && !tree.remove(i) && !tree.contains(i) && tree.contains(i + 1));
+	}
+
+	assert(tree.valid() && tree.size() == 1500);
+
+	for (int i(0); i < 3000; i += 4) {
+
+		assert(tree.add(i) && tree.contains(i));
+	}
+
+	assert(tree.valid() && tree.size() == 2250);
+
+	std::vector<int> keys;
+
+	for (int i(0); i < 3000; ++i) {
+
+		keys.push_back(i);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(61));
+
+	for (std::size_t i(0); i < keys.size(); ++i) {
+
+		tree.remove(keys[i]);
+
+		if (i % 89 == 0) {
+
+			assert(tree.valid() && !tree.contains(keys[i]));
+		}
+	}
+
+	assert(tree.valid() && tree.isEmpty() && tree.getHeight() == 0);
+
+	for (int i(0); i < 20000; ++i) {
+
+		tree.add((i * 7) % 1000);
+		tree.remove((i * 13) % 1000);
+
+		if (i % 501 == 0) {
+
+			assert(tree.valid());
+		}
+	}
+
+	static int visited;
+	visited = 0;
+
+	tree.inorderTraverse([](const int& num) {
+
+		assert(num >= visited);
+		visited = num + 1;
+	});
+
+	tree.clear();
+	assert(tree.valid() && tree.isEmpty() && tree.add(1) && tree.size() == 1);
+
+	CheckedConcurrent<std::string, std::less<>> words;
+
+	for (int i(0); i < 500; ++i) {
+
+		assert(words.add("a string long enough to live on the heap " + std::to_string(i)));
+	}
+
+	assert(words.contains("a string long enough to live on the heap 250"));
+	assert(!words.contains("a string long enough to live on the heap 500"));
+	assert(words.remove("a string long enough to live on the heap 250") && words.valid());
+}
+
+/*
+* Unit test for several writers on their own keys and readers of keys
+* no one removes, all at once
+*/
+void CCthreads() {
+
+	CheckedConcurrent<int> tree;
+
+	const int writers(4), rounds(3), span(3000);
+
+	// never removed, readers must always find them
+	for (int i(-1); i >= -200; --i) {
+
+		tree.add(i);
+	}
+
+	std::atomic<bool> done(false);
+	std::atomic<int> misses(0);
+
+	std::vector<std::thread> threads;
+
+	for (int w(0); w < writers; ++w) {
+
+		threads.emplace_back([&tree, w] {
+
+			for (int r(0); r < rounds; ++r) {
+
+				for (int i(w); i < span; i += writers) {
+
+					assert(tree.add(i));
+				}
+
+				for (int i(w); i < span; i += 2 * writers) {
+
+					assert(tree.remove(i) && !tree.contains(i));
+				}
+
+				for (int i(w); i < span; i += writers) {
+
+					tree.remove(i);
+				}
+			}
+
+			// keys w mod writers, but not 0 mod 3
+			for (int i(w); i < span; i += writers) {
+
+				if (i % 3 != 0) {
+
+					assert(tree.add(i));
+				}
+			}
+		});
+	}
+
+	for (int r(0); r < 2; ++r) {
+
+		threads.emplace_back([&tree, &done, &misses] {
+
+			while (!done.load()) {
+
+				for (int i(-1); i >= -200; i -= 7) {
+
+					if (!tree.contains(i) || tree.contains(-i - span)) {
+
+						++misses;
+					}
+				}
+			}
+		});
+	}
+
+	for (int w(0); w < writers; ++w) {
+
+		threads[w].join();
+	}
+
+	done.store(true);
+
+	for (std::size_t t(writers); t < threads.size(); ++t) {
+
+		threads[t].join();
+	}
+
+	assert(misses.load() == 0 && tree.valid() && tree.size() == 200 + static_cast<std::size_t>(span - span / 3));
+
+	for (int i(-200); i < span; ++i) {
+
+		assert(tree.contains(i) == (i < 0 || i % 3 != 0));
+	}
+}
+
+/*
+* Runs all EpochReclaimer and ConcurrentAVLTree unit tests in order
+*/
+void ConcurrentTests() {
+
+	epoch();
+	CCsingle();
+	CCthreads();
+}
+
+/*
+* A PersistentAVLTree that can check its heights and balance, and
+* list its nodes to see what it shares with other trees
+*/
+template<class T, class Compare = std::less<T>>
+class CheckedPersistent : public PersistentAVLTree<T, Compare> {
+
+	typedef typename PersistentAVLTree<T, Compare>::PersistentNode PersistentNode;
+
+public:
+
+	/*
+	* Checks that items are in order, that stored heights are the real
+	* ones and differ by at most one between siblings, that reference
+	* counts are positive, and that size() counts every item
+	* @return true if all rules hold
+	*/
+	bool valid() const {
+
+		bool ok(true);
+
+		std::size_t items(0);
+
+		int height = this->walk(this->getRoot(), items, ok);
+
+		return ok && items == this->size() && height == this->getHeight();
+	}
+
+	/*
+	* Adds the address of every node of the tree to a set
+	* @param nodes The set
+	*/
+	void collect(std::set<const void*>& nodes) const {
+
+		this->collect(this->getRoot(), nodes);
+	}
+
+private:
+
+	int walk(const PersistentNode* node, std::size_t& items, bool& ok) const {
+
+		if (node == nullptr) {
+
+			return 0;
+		}
+
+		int left = this->walk(node->left, items, ok);
+		int right = this->walk(node->right, items, ok);
+
+		ok = ok && (node->left == nullptr || node->left->item < node->item);
+		ok = ok && (node->right == nullptr || node->item < node->right->item);
+		ok = ok && node->height == std::max(left, right) + 1 && node->refs.load() > 0;
+		ok = ok && left - right <= 1 && right - left <= 1;
+
+		++items;
+
+		return std::max(left, right) + 1;
+	}
+
+	void collect(const PersistentNode* node, std::set<const void*>& nodes) const {
+
+		if (node != nullptr) {
+
+			nodes.insert(node);
+
+			this->collect(node->left, nodes);
+			this->collect(node->right, nodes);
+		}
+	}
+};
+
+/*
+* Unit test for add, remove and contains, snapshots never see later
+* changes and share every node the changes did not touch
+*/
+void PTsnapshot() {
+
+	CheckedPersistent<int> tree;
+	assert(tree.valid() && tree.isEmpty() && tree.getHeight() == 0 && !tree.contains(1) && !tree.remove(1));
+
+	for (int i(0); i < 3000; ++i) {
+
+		assert(tree.add(i) && !tree.add(i));
+
+		if (i % 97 == 0) {
+
+			assert(tree.valid());
+		}
+	}
+
+	// an AVL tree of 3000 nodes is at most 16 levels
+	assert(tree.valid() && tree.size() == 3000 && tree.getHeight() <= 16);
+
+	CheckedPersistent<int> before;
+	before = tree;
+	assert(before == tree && before.valid());
+
+	std::set<const void*> nodes;
+
+	// one add copies a path and what its rotations touch, the rest is shared
+	assert(tree.add(3000) && !before.contains(3000) && tree != before);
+
+	tree.collect(nodes);
+	before.collect(nodes);
+	assert(nodes.size() <= 3001 + 2 * 16);
+
+	for (int i(0); i < 3000; i += 2) {
+
+		assert(tree.remove(i) && !tree.remove(i) && !tree.contains(i) && tree.contains(i + 1));
+	}
+
+	assert(tree.valid() && tree.size() == 1501);
+	assert(before.valid() && before.size() == 3000);
+
+	for (int i(0); i < 3000; ++i) {
+
+		assert(before.contains(i) && tree.contains(i) == (i % 2 == 1));
+	}
+
+	// a snapshot per change, each one keeps what the tree had then
+	std::vector<CheckedPersistent<int>> versions;
+
+	std::vector<int> keys;
+
+	for (int i(0); i < 3000; ++i) {
+
+		keys.push_back(i);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(67));
+
+	for (std::size_t i(0); i < 300; ++i) {
+
+		versions.push_back(CheckedPersistent<int>());
+		versions.back() = tree;
+
+		if (keys[i] % 2 == 1) {
+
+			assert(tree.remove(keys[i]));
+
+		} else {
+
+			assert(tree.add(keys[i]));
+		}
+	}
+
+	assert(tree.valid());
+
+	for (std::size_t i(0); i < versions.size(); ++i) {
+
+		assert(versions[i].valid() && versions[i].contains(keys[i]) == (keys[i] % 2 == 1));
+		assert(tree.contains(keys[i]) == (keys[i] % 2 == 0));
+	}
+
+	// dropping the versions out of order frees only what no one else holds
+	for (std::size_t i(0); i < versions.size(); i += 2) {
+
+		versions[i].clear();
+	}
+
+	for (std::size_t i(1); i < versions.size(); i += 2) {
+
+		assert(versions[i].valid());
+	}
+
+	PersistentAVLTree<int> copy(tree);
+	PersistentAVLTree<int> snapshot = tree.snapshot();
+
+	tree.clear();
+	assert(tree.valid() && tree.isEmpty() && copy == snapshot && copy.size() == snapshot.size());
+
+	copy = copy;
+	assert(copy == snapshot);
+
+	CheckedPersistent<std::string, std::less<>> words;
+
+	for (int i(0); i < 500; ++i) {
+
+		assert(words.add("a string long enough to live on the heap " + std::to_string(i)));
+	}
+
+	PersistentAVLTree<std::string, std::less<>> kept(words);
+
+	assert(words.contains("a string long enough to live on the heap 250"));
+	assert(!words.contains("a string long enough to live on the heap 500"));
+	assert(words.remove("a string long enough to live on the heap 250") && words.valid());
+	assert(kept.contains("a string long enough to live on the heap 250"));
+
+	// removing through an item of the tree itself
+	assert(words.remove(*words.begin()) && words.valid() && words.size() == 498);
+}
+
+/*
+* Unit test for readTree, iterators, inorderTraverse and equality
+*/
+void PTread() {
+
+	int arr[] = {2, 4, 6, 8, 10, 12, 14};
+
+	CheckedPersistent<int> tree;
+	assert(!tree.readTree(arr, 0) && tree.begin() == tree.end() && tree.rbegin() == tree.rend());
+	assert(tree.readTree(arr, 7) && tree.valid() && tree.size() == 7 && tree.getHeight() == 3);
+
+	std::vector<int> seen(tree.begin(), tree.end());
+	assert(std::equal(seen.begin(), seen.end(), arr) && seen.size() == 7);
+
+	seen.assign(tree.rbegin(), tree.rend());
+	assert(std::equal(seen.rbegin(), seen.rend(), arr));
+
+	PersistentAVLTree<int>::Iterator it = tree.end();
+	assert(*--it == 14 && *it-- == 14 && *it == 12 && *++it == 14 && ++it == tree.end());
+
+	static int visited;
+	visited = 0;
+
+	tree.inorderTraverse([](const int& num) {
+
+		assert(num == 2 * ++visited);
+	});
+
+	assert(visited == 7);
+
+	std::list<int> unsorted = {5, 3, 9, 3, 1, 7, 5};
+
+	CheckedPersistent<int> other;
+	assert(other.readTree(unsorted.begin(), unsorted.end(), false) && other.valid() && other.size() == 5);
+	assert(*other.begin() == 1 && *other.rbegin() == 9);
+
+	// equal items, different shape
+	CheckedPersistent<int> added;
+
+	for (int i(0); i < 7; ++i) {
+
+		added.add(arr[6 - i]);
+	}
+
+	assert(added == tree && !(added != tree));
+	assert(added.remove(8) && added != tree && added.add(8) && added == tree);
+
+	std::vector<int> big;
+
+	for (int i(0); i < 10000; ++i) {
+
+		big.push_back(i);
+	}
+
+	assert(tree.readTree(big.begin(), big.end()) && tree.valid() && tree.getHeight() == 14);
+	assert(std::distance(tree.begin(), tree.end()) == 10000);
+}
+
+/*
+* Unit test for a reader on a snapshot while the tree it came from
+* keeps changing on another thread, and snapshots taken and dropped
+* on both threads
+*/
+void PTthreads() {
+
+	PersistentAVLTree<int> tree;
+
+	for (int i(0); i < 2000; ++i) {
+
+		tree.add(i);
+	}
+
+	std::atomic<bool> done(false);
+	std::atomic<int> misses(0);
+
+	PersistentAVLTree<int> snapshot(tree);
+
+	std::thread reader([snapshot, &done, &misses] {
+
+		while (!done.load()) {
+
+			int expected(0);
+
+			for (PersistentAVLTree<int>::Iterator it = snapshot.begin(); it != snapshot.end(); ++it) {
+
+				misses += *it != expected++;
+			}
+
+			misses += expected != 2000;
+
+			// copies of the snapshot, released on this thread
+			PersistentAVLTree<int> copy(snapshot);
+			misses += !copy.contains(1999) || copy.contains(2000);
+		}
+	});
+
+	for (int r(0); r < 20; ++r) {
+
+		PersistentAVLTree<int> kept(tree);
+
+		std::size_t before = tree.size();
+
+		for (int i(0); i < 2000; i += 3) {
+
+			tree.remove(i);
+			tree.add(2000 + i + r);
+		}
+
+		assert(kept.size() == before && kept != tree);
+	}
+
+	done.store(true);
+	reader.join();
+
+	assert(misses.load() == 0 && snapshot.size() == 2000);
+
+	for (int i(0); i < 2000; ++i) {
+
+		assert(snapshot.contains(i) && tree.contains(i) == (i % 3 != 0));
+	}
+}
+
+/*
+* Runs all PersistentAVLTree unit tests in order
+*/
+void PersistentTests() {
+
+	PTsnapshot();
+	PTread();
+	PTthreads();
+}
+
+/*
+* Begins unit testing
+*/
+int main() {
+	
+	BSTTests();
+
+	AVLTests();
+
+	RBTests();
+
+	BTTests();
+
+	simd();
+
+	CompactTests();
+
+	ConcurrentTests();
+
+	PersistentTests();
 
 	std::cout << "Success!" << std::endl;
 
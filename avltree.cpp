@@ -5,13 +5,15 @@
 *
 */
 
+#include <algorithm>
 #include <cassert>
+#include <utility>
 
 /*
 * Virtual desctructor
 */
-template <class T>
-AVLTree<T>::~AVLTree() {
+template<class T, class Compare>
+AVLTree<T, Compare>::~AVLTree() {
 	
 	this->clear();
 }
@@ -19,263 +21,502 @@ AVLTree<T>::~AVLTree() {
 /*
 * Constructor
 */
-template<class T>
-AVLTree<T>::AVLTree() :root(nullptr) {
+template<class T, class Compare>
+AVLTree<T, Compare>::AVLTree() {
 
 }
 
 /*
 * Constructor setting the data to be stored
 */
-template<class T>
-AVLTree<T>::AVLTree(const T& item) :root(new AVLNode(item)) {
+template<class T, class Compare>
+AVLTree<T, Compare>::AVLTree(const T& item) {
 
+	this->add(item);
 }
 
+/*
+* Constructor setting the comparator, which may hold state
+* @param comp The comparator
+*/
+template<class T, class Compare>
+AVLTree<T, Compare>::AVLTree(const Compare& comp)
+
+	:BinarySearchTree<T, Compare>(comp) {}
+
 /*
 * Copy constructor
 * @param bst The other tree to copy
 */
-template<class T>
-AVLTree<T>::AVLTree(const AVLTree<T>& other) :root(nullptr) {
+template<class T, class Compare>
+AVLTree<T, Compare>::AVLTree(const AVLTree<T, Compare>& other)
+
+	:BinarySearchTree<T, Compare>() {
 
 	*this = other;
 }
 
+/*
+* Move constructor, takes the nodes of other in O(1), other is left empty
+* @param other The other tree to move from
+*/
+template<class T, class Compare>
+AVLTree<T, Compare>::AVLTree(AVLTree<T, Compare>&& other) noexcept
+
+	:BinarySearchTree<T, Compare>(std::move(other)), avlNodes(std::move(other.avlNodes)) {}
+
 /*
 * Assignment operator overload, makes this a deep copy of other
 * @param other The other tree to copy
 * @return this by reference
 */
-template<class T>
-AVLTree<T>& AVLTree<T>::operator=(const AVLTree<T>& other) {
+template<class T, class Compare>
+AVLTree<T, Compare>& AVLTree<T, Compare>::operator=(const AVLTree<T, Compare>& other) {
 
 	if (this != &other) {
-		
-		this->clear();
 
-		// new copy node method
+		BinarySearchTree<T, Compare>::operator=(other);
 	}
 
 	return *this;
 }
 
 /*
-* Checks if tree is empty
-* @return true if rootPtr == nullptr, false otherwise
+* Move assignment, clears this and takes the nodes of other in O(1),
+* other is left empty
+* @param other The other tree to move from
+* @return this by reference
 */
-template<class T>
-bool AVLTree<T>::isEmpty() const {
+template<class T, class Compare>
+AVLTree<T, Compare>& AVLTree<T, Compare>::operator=(AVLTree<T, Compare>&& other) noexcept {
+
+	if (this != &other) {
+
+		BinarySearchTree<T, Compare>::operator=(std::move(other));
+
+		this->avlNodes = std::move(other.avlNodes);
+	}
 
-	return this->root == nullptr;
+	return *this;
 }
 
 /*
 * Gets the height of the tree
 * @return the height of the tree
 */
-template<class T>
-int AVLTree<T>::getHeight() const {
+template<class T, class Compare>
+int AVLTree<T, Compare>::getHeight() const {
 
-	return this->root->getHeight();
+	return AVLTree::heightOf(this->getRoot());
 }
 
 /*
-* Adds a given item to the tree, if not duplicate
-* @param item The item to add
-* @return true if item added, false otherwise
+* Retraces from the parent of a new node and rotates where out
+* of balance, O(log n)
+* @param node The node holding the item
+* @param added true if node was just linked, false if it was there
 */
-template<class T>
-bool AVLTree<T>::add(const T& item) {
-	
-	bool added{false};
+template<class T, class Compare>
+void AVLTree<T, Compare>::afterInsert(Node<T>* node, bool added) {
 
-	if (!this->contains(item)) {
-		
-		if (this->root == nullptr) {
-			
-			this->root = new AVLNode(item);
+	if (added) {
 
-		} else {
+		this->updateHeights(node->getParent());
+	}
+}
 
-			AVLTree::addNode(this->root, nullptr, item);
-		}
+/*
+* Removes a node, then retraces and rotates from where the tree
+* changed, O(log n)
+* @param node The node to remove
+*/
+template<class T, class Compare>
+void AVLTree<T, Compare>::removeNode(Node<T>* node) {
+
+	if (node->getLeft() != nullptr && node->getRight() != nullptr) {
+
+		// the successor takes node's place, so the retrace must compare
+		// against the height node had there
+		AVLNode* successor = static_cast<AVLNode*>(AVLTree::leftMost(node->getRight()));
 
-		added = true;
+		successor->setHeight(static_cast<AVLNode*>(node)->getHeight());
 	}
 
-	return added;
+	this->updateHeights(this->eraseNode(node));
 }
 
 /*
-* Checks for membership of given item
-* @param item The item to check for
-* @return true if tree contains item, false otherwise
+* Makes room for n more nodes so adding them does not allocate
+* @param n The number of nodes to make room for
 */
-template<class T>
-bool AVLTree<T>::contains(const T& item) const {
+template<class T, class Compare>
+void AVLTree<T, Compare>::reserve(std::size_t n) {
 
-	return BinarySearchTree<T>::getNode(this->root, item) != nullptr;
+	this->avlNodes.reserve(n);
 }
 
 /*
-* Creates a dynamic array, copies all items to the array
-* and then reads the array to re-balance this tree
+* Turns huge page backing of the node arena on or off,
+* affects memory allocated from now on
+* @param enable true to use huge pages
 */
-template<class T>
-void AVLTree<T>::rebalance() {
+template<class T, class Compare>
+void AVLTree<T, Compare>::useHugePages(bool enable) {
 
+	this->avlNodes.setHugePages(enable);
 }
 
 /*
-* Deletes all nodes in the tree
+* Gets the number of bytes held by the AVLNode arena, including
+* what trees sharing it (after a split) hold
+* @return bytes held by the arena
 */
-template<class T>
-void AVLTree<T>::clear() {
-	 
-	BinarySearchTree<T>::deleteNodes(this->root);
+template<class T, class Compare>
+std::size_t AVLTree<T, Compare>::bytesReserved() const {
+
+	return this->avlNodes.bytesReserved();
 }
 
 /*
-* Prints the tree sideways
+* Splits the tree by key in O(log n): items less than key stay in this
+* tree and the others move to the returned tree. Nodes are relinked,
+* never copied, and the returned tree allocates from this tree's
+* arena. The shared arena locks every allocation and release, so
+* the two trees may then be changed on different threads, but
+* clearing either one destroys its nodes one by one.
+* @param key The first item of the returned tree
+* @return the tree with every item not less than key
 */
-template<class T>
-void AVLTree<T>::displaySideways() const {
+template<class T, class Compare>
+AVLTree<T, Compare> AVLTree<T, Compare>::split(const T& key) {
+
+	AVLTree<T, Compare> right;
 
-	BinarySearchTree<T>::sideways(this->root, 0);
+	this->splitTree(key, right);
+
+	return right;
 }
 
 /*
-* Adds new node
+* Moves every item of right to the end of this tree in O(log n),
+* relinking its nodes, right is left empty. The trees allocate from
+* the same arena afterwards, and neither may be in use on another
+* thread during the join. When both arenas are already shared with
+* other trees (after splits) the items are moved one by one instead.
+* @param right The tree with the items greater than this tree's
+* @throws std::invalid_argument if an item of right is not greater
+*         than every item of this tree
 */
-template<class T>
-void AVLTree<T>::addNode(AVLNode* curr, AVLNode* parent, const T& item) {
+template<class T, class Compare>
+void AVLTree<T, Compare>::join(AVLTree<T, Compare>& right) {
 
-	if (curr == nullptr) {
-		
-		curr = new AVLNode(item);
-		
-		curr->setParent(parent);
-		
-		if (parent != nullptr) {
-			if (item == 10) { std::cout << "parent " << *parent << "\n"; }
-			if (parent->getItem() < item) {
-				
-				parent->setRight(curr);
-
-			} else {
-				
-				parent->setLeft(curr);
-			}
+	this->joinTree(right);
+}
+
+/*
+* Creates an AVLNode for item
+* @param item The item for the node
+* @return the new node
+*/
+template<class T, class Compare>
+Node<T>* AVLTree<T, Compare>::createNode(const T& item) {
+
+	return this->avlNodes.create(item);
+}
+
+/*
+* Creates an AVLNode moving item into it
+* @param item The item for the node
+* @return the new node
+*/
+template<class T, class Compare>
+Node<T>* AVLTree<T, Compare>::createNode(T&& item) {
+
+	return this->avlNodes.create(std::move(item));
+}
+
+/*
+* Creates a copy of an AVLNode with its item, size and height
+* @param other The node to copy
+* @return the new node
+*/
+template<class T, class Compare>
+Node<T>* AVLTree<T, Compare>::cloneNode(const Node<T>* other) {
+
+	AVLNode* node = this->avlNodes.create(other->getItem());
+
+	node->setSize(other->getSize());
+	node->setHeight(static_cast<const AVLNode*>(other)->getHeight());
+
+	return node;
+}
+
+/*
+* Recomputes the size and height of node from its children
+* @param node The node to update
+*/
+template<class T, class Compare>
+void AVLTree<T, Compare>::fixNode(Node<T>* node) {
+
+	BinarySearchTree<T, Compare>::fixNode(node);
+
+	AVLTree::fixHeight(static_cast<AVLNode*>(node));
+}
+
+/*
+* Links left, middle and right by height: when one side is more than
+* one taller middle takes the place of the first node down its inner
+* spine that is at most one taller than the other side, then the
+* path above is retraced, O(difference in height). The heights are
+* read from the nodes, the ranks are left at 0.
+* @param left The lower subtree, its root possibly nullptr
+* @param middle The node in between
+* @param right The upper subtree, its root possibly nullptr
+* @return the joined subtree
+*/
+template<class T, class Compare>
+typename AVLTree<T, Compare>::Subtree AVLTree<T, Compare>::joinNodes(Subtree left, Node<T>* middle,
+                                                                     Subtree right) {
+
+	int  leftHeight = AVLTree::heightOf(left.root),
+		rightHeight = AVLTree::heightOf(right.root);
+
+	if (leftHeight > rightHeight + 1) {
+
+		left.root->setParent(nullptr);
+
+		Node<T>* parent = left.root;
+
+		while (AVLTree::heightOf(parent->getRight()) > rightHeight + 1) {
+
+			parent = parent->getRight();
 		}
 
+		BinarySearchTree<T, Compare>::joinNodes({parent->getRight(), 0}, middle, right);
+
+		parent->setRight(middle);
+		middle->setParent(parent);
+
+		AVLTree::fixSizes(parent);
+
 		this->updateHeights(parent);
 
-	} else if (curr->getItem() < item) {
-		
-		AVLNode* right = static_cast<AVLNode*>(curr->getRight());
+		return {AVLTree::topOf(middle), 0};
+	}
+
+	if (rightHeight > leftHeight + 1) {
+
+		right.root->setParent(nullptr);
+
+		Node<T>* parent = right.root;
+
+		while (AVLTree::heightOf(parent->getLeft()) > leftHeight + 1) {
+
+			parent = parent->getLeft();
+		}
 
-		AVLTree::addNode(right, curr, item);
+		BinarySearchTree<T, Compare>::joinNodes(left, middle, {parent->getLeft(), 0});
 
-	} else {
+		parent->setLeft(middle);
+		middle->setParent(parent);
 
-		AVLNode* left = static_cast<AVLNode*>(curr->getLeft());
+		AVLTree::fixSizes(parent);
 
-		AVLTree::addNode(left, curr, item);
+		this->updateHeights(parent);
+
+		return {AVLTree::topOf(middle), 0};
 	}
+
+	return BinarySearchTree<T, Compare>::joinNodes(left, middle, right);
+}
+
+/*
+* Makes this tree and other allocate AVLNodes from the same slabs
+* @param other An AVLTree
+* @return false if both arenas are already shared with other trees
+*/
+template<class T, class Compare>
+bool AVLTree<T, Compare>::shareNodes(BinarySearchTree<T, Compare>& other) {
+
+	return this->avlNodes.absorb(static_cast<AVLTree<T, Compare>&>(other).avlNodes);
+}
+
+/*
+* Destroys an AVLNode created by createNode
+* @param node The node to destroy
+*/
+template<class T, class Compare>
+void AVLTree<T, Compare>::destroyNode(Node<T>* node) {
+
+	this->avlNodes.destroy(static_cast<AVLNode*>(node));
+}
+
+/*
+* Releases the memory of every AVLNode at once
+*/
+template<class T, class Compare>
+void AVLTree<T, Compare>::releaseNodes() {
+
+	this->avlNodes.reset();
 }
 
 /*
-* Adds new node
+* Checks if another tree allocates from the same AVLNode slabs
+* @return true if the arena is shared
 */
-template<class T>
-void AVLTree<T>::updateHeights(AVLNode* curr) {
+template<class T, class Compare>
+bool AVLTree<T, Compare>::nodesShared() const {
+
+	return this->avlNodes.shared();
+}
+
+/*
+* Takes uninitialized storage for n AVLNodes in a row
+* @param n The number of nodes
+* @return the storage, filled with createNodeAt
+*/
+template<class T, class Compare>
+void* AVLTree<T, Compare>::takeRun(std::size_t n) {
+
+	return this->avlNodes.takeRun(n);
+}
+
+/*
+* Constructs AVLNode i of a run taken with takeRun
+* @param run The storage returned by takeRun
+* @param i The index of the node in the run
+* @param item The item for the node
+* @return the new node
+*/
+template<class T, class Compare>
+Node<T>* AVLTree<T, Compare>::createNodeAt(void* run, std::size_t i, const T& item) {
+
+	return NodeArena<AVLNode>::createAt(static_cast<AVLNode*>(run), i, item);
+}
+
+/*
+* Constructs AVLNode i of a run taken with takeRun moving item into it
+* @param run The storage returned by takeRun
+* @param i The index of the node in the run
+* @param item The item for the node
+* @return the new node
+*/
+template<class T, class Compare>
+Node<T>* AVLTree<T, Compare>::createNodeAt(void* run, std::size_t i, T&& item) {
+
+	return NodeArena<AVLNode>::createAt(static_cast<AVLNode*>(run), i, std::move(item));
+}
+
+/*
+* Gives back slot i of a run of AVLNodes that was never constructed
+* @param run The storage returned by takeRun
+* @param i The index of the slot in the run
+*/
+template<class T, class Compare>
+void AVLTree<T, Compare>::recycleAt(void* run, std::size_t i) {
+
+	this->avlNodes.recycle(static_cast<AVLNode*>(run) + i);
+}
+
+/*
+* Update heights from curr up to the root after the subtree
+* below curr changed, rotating where out of balance.
+* Stops as soon as a subtree keeps its old height.
+* @param curr The lowest node whose subtree changed
+*/
+template<class T, class Compare>
+void AVLTree<T, Compare>::updateHeights(Node<T>* curr) {
 	
 	while (curr != nullptr) {
 		
-		AVLNode*  left = static_cast<AVLNode*>(curr->getLeft()),
-			   * right = static_cast<AVLNode*>(curr->getRight());
-		
-		int leftHeight =  left != nullptr ?  left->getHeight() : 0,
-		   rightHeight = right != nullptr ? right->getHeight() : 0;
+		AVLNode* node = static_cast<AVLNode*>(curr),
+			   * top = node;
 
-		if (leftHeight - rightHeight > 1) {
+		Node<T>* parent = node->getParent();
 
-			AVLTree::leftRotation(curr, left);
+		int oldHeight = node->getHeight(),
+			balance = AVLTree::heightOf(node->getLeft()) - AVLTree::heightOf(node->getRight());
 
-			this->root = (this->root == curr) ? left : this->root;
+		if (balance > 1) {
 
-			break;
+			top = this->leftRotation(node);
 
-		} else if (rightHeight - leftHeight > 1) {
+		} else if (balance < -1) {
 			
-			AVLTree::rightRotation(curr, right);
-
-			this->root = (this->root == curr) ? right : this->root;
+			top = this->rightRotation(node);
 
-			break;
-
-		} else if (leftHeight != rightHeight) {
+		} else {
 			
-			++(*curr);
-
-			curr = static_cast<AVLNode*>(curr->getParent());
+			AVLTree::fixHeight(node);
+		}
 
-		} else {
+		if (top->getHeight() == oldHeight) {
 			
 			break;
 		}
+
+		curr = parent;
 	}
 }
 
 /*
-* Left AVL rotation
+* Left AVL rotation, fixes a left heavy curr
+* @param curr The node out of balance
+* @return the new root of the subtree
 */
-template<class T>
-void AVLTree<T>::leftRotation(AVLNode* curr, AVLNode* left) {
-
-	AVLNode*  leftLeft = static_cast<AVLNode*>(left->getLeft()),
-		   * leftRight = static_cast<AVLNode*>(left->getRight());
+template<class T, class Compare>
+typename AVLTree<T, Compare>::AVLNode* AVLTree<T, Compare>::leftRotation(AVLNode* curr) {
 
-	int  leftLeftHeight =  leftLeft != nullptr ?  leftLeft->getHeight() : 0,
-		leftRightHeight = leftRight != nullptr ? leftRight->getHeight() : 0;
+	AVLNode* left = static_cast<AVLNode*>(curr->getLeft());
 
-	if (leftRightHeight > leftLeftHeight) {
+	if (AVLTree::heightOf(left->getRight()) > AVLTree::heightOf(left->getLeft())) {
 		
-		AVLTree::rightRotation(left, leftRight);
+		this->rotateLeft(left);
 	}
 
-	left->setParent(curr->getParent());
-	curr->setLeft(left->getRight());
-	left->setRight(curr);
-	curr->setParent(left);
-	
-	--(*curr);
+	return static_cast<AVLNode*>(this->rotateRight(curr));
 }
 
 /*
-* Right AVL rotation
+* Right AVL rotation, fixes a right heavy curr
+* @param curr The node out of balance
+* @return the new root of the subtree
 */
-template<class T>
-void AVLTree<T>::rightRotation(AVLNode* curr, AVLNode* right) {
-
-	AVLNode*  rightLeft = static_cast<AVLNode*>(right->getLeft()),
-		   * rightRight = static_cast<AVLNode*>(right->getRight());
+template<class T, class Compare>
+typename AVLTree<T, Compare>::AVLNode* AVLTree<T, Compare>::rightRotation(AVLNode* curr) {
 
-	int  rightLeftHeight =  rightLeft != nullptr ?  rightLeft->getHeight() : 0,
-		rightRightHeight = rightRight != nullptr ? rightRight->getHeight() : 0;
+	AVLNode* right = static_cast<AVLNode*>(curr->getRight());
 
-	if (rightLeftHeight > rightRightHeight) {
+	if (AVLTree::heightOf(right->getLeft()) > AVLTree::heightOf(right->getRight())) {
 
-		AVLTree::leftRotation(right, rightLeft);
+		this->rotateRight(right);
 	}
 
-	right->setParent(curr->getParent());
-	curr->setRight(right->getLeft());
-	right->setLeft(curr);
-	curr->setParent(right);
+	return static_cast<AVLNode*>(this->rotateLeft(curr));
+}
+
+/*
+* Gets the height of a possibly null node
+* @param node The node
+* @return its height, 0 for nullptr
+*/
+template<class T, class Compare>
+int AVLTree<T, Compare>::heightOf(Node<T>* node) {
+
+	return (node != nullptr) ? static_cast<AVLNode*>(node)->getHeight() : 0;
+}
+
+/*
+* Recomputes the height of node from its children
+* @param node The node to update
+*/
+template<class T, class Compare>
+void AVLTree<T, Compare>::fixHeight(AVLNode* node) {
+
+	int  leftHeight = AVLTree::heightOf(node->getLeft()),
+		rightHeight = AVLTree::heightOf(node->getRight());
 
-	--(*curr);
+	node->setHeight(1 + std::max(leftHeight, rightHeight));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -285,8 +526,17 @@ void AVLTree<T>::rightRotation(AVLNode* curr, AVLNode* right) {
 /*
 *  constructor setting the data to be stored
 */
-template<class T>
-AVLTree<T>::AVLNode::AVLNode(const T& item) :Node<T>(item) {
+template<class T, class Compare>
+AVLTree<T, Compare>::AVLNode::AVLNode(const T& item) :Node<T>(item) {
+
+	this->height = 1;
+}
+
+/*
+*  constructor moving the data to be stored
+*/
+template<class T, class Compare>
+AVLTree<T, Compare>::AVLNode::AVLNode(T&& item) :Node<T>(std::move(item)) {
 
 	this->height = 1;
 }
@@ -295,18 +545,28 @@ AVLTree<T>::AVLNode::AVLNode(const T& item) :Node<T>(item) {
 * Get the height of the Node
 * @return height of the Node
 */
-template<class T>
-int AVLTree<T>::AVLNode::getHeight() const {
+template<class T, class Compare>
+int AVLTree<T, Compare>::AVLNode::getHeight() const {
 
 	return this->height;
 }
 
+/*
+* Set the height of the Node
+* @param height The new height
+*/
+template<class T, class Compare>
+void AVLTree<T, Compare>::AVLNode::setHeight(int height) {
+
+	this->height = height;
+}
+
 /*
 * Increment operator overload
 * increments height of Node
 */
-template<class T>
-void AVLTree<T>::AVLNode::operator++() {
+template<class T, class Compare>
+void AVLTree<T, Compare>::AVLNode::operator++() {
 
 	++this->height;
 }
@@ -315,8 +575,8 @@ void AVLTree<T>::AVLNode::operator++() {
 * Decrement operator overload
 * decrements height of Node
 */
-template<class T>
-void AVLTree<T>::AVLNode::operator--() {
+template<class T, class Compare>
+void AVLTree<T, Compare>::AVLNode::operator--() {
 
 	--this->height;
 }
@@ -3,6 +3,13 @@
 *
 * AVLTree specs
 *
+* An AVLTree is a BinarySearchTree that keeps the heights of the two
+* subtrees of every node within one of each other, so adding and
+* removing items retrace the path to the root and rotate where needed.
+* Every other operation (queries, iterators, copying, readTree,
+* rebalance) is inherited and keeps heights up to date through the
+* node hooks, so all of them stay O(log n) per item. Splitting by key
+* and joining two trees relink subtrees by height in O(log n).
 */
 
 #ifndef AVLTREE_H
@@ -16,8 +23,8 @@
 * @author Juan Arias
 *
 */
-template <class T>
-class AVLTree : public BinarySearchTree<T> {
+template<class T, class Compare = std::less<T>>
+class AVLTree : public BinarySearchTree<T, Compare> {
 
 public:
 
@@ -36,24 +43,38 @@ public:
 	*/
 	explicit AVLTree(const T& item);
 
+	/*
+	* Constructor setting the comparator, which may hold state
+	* @param comp The comparator
+	*/
+	explicit AVLTree(const Compare& comp);
+
 	/*
 	* Copy constructor
 	* @param bst The other tree to copy
 	*/
-	AVLTree(const AVLTree<T>& other);
+	AVLTree(const AVLTree<T, Compare>& other);
+
+	/*
+	* Move constructor, takes the nodes of other in O(1), other is left empty
+	* @param other The other tree to move from
+	*/
+	AVLTree(AVLTree<T, Compare>&& other) noexcept;
 
 	/*
 	* Assignment operator overload, makes this a deep copy of other
 	* @param other The other tree to copy
 	* @return this by reference
 	*/
-	AVLTree<T>& operator=(const AVLTree<T>& other);
+	AVLTree<T, Compare>& operator=(const AVLTree<T, Compare>& other);
 
 	/*
-	* Checks if tree is empty
-	* @return true if rootPtr == nullptr, false otherwise
+	* Move assignment, clears this and takes the nodes of other in O(1),
+	* other is left empty
+	* @param other The other tree to move from
+	* @return this by reference
 	*/
-	bool isEmpty() const override;
+	AVLTree<T, Compare>& operator=(AVLTree<T, Compare>&& other) noexcept;
 
 	/*
 	* Gets the height of the tree
@@ -62,34 +83,164 @@ public:
 	int getHeight() const override;
 
 	/*
-	* Adds a given item to the tree, if not duplicate
-	* @param item The item to add
-	* @return true if item added, false otherwise
+	* Makes room for n more nodes so adding them does not allocate
+	* @param n The number of nodes to make room for
+	*/
+	void reserve(std::size_t n) override;
+
+	/*
+	* Turns huge page backing of the node arena on or off,
+	* affects memory allocated from now on
+	* @param enable true to use huge pages
+	*/
+	void useHugePages(bool enable) override;
+
+	/*
+	* Gets the number of bytes held by the AVLNode arena, including
+	* what trees sharing it (after a split) hold
+	* @return bytes held by the arena
+	*/
+	std::size_t bytesReserved() const override;
+
+	/*
+	* Splits the tree by key in O(log n): items less than key stay in this
+	* tree and the others move to the returned tree. Nodes are relinked,
+	* never copied, and the returned tree allocates from this tree's
+	* arena. The shared arena locks every allocation and release, so
+	* the two trees may then be changed on different threads, but
+	* clearing either one destroys its nodes one by one.
+	* @param key The first item of the returned tree
+	* @return the tree with every item not less than key
 	*/
-	bool add(const T& item) override;
+	AVLTree<T, Compare> split(const T& key);
 
 	/*
-	* Checks for membership of given item
-	* @param item The item to check for
-	* @return true if tree contains item, false otherwise
+	* Moves every item of right to the end of this tree in O(log n),
+	* relinking its nodes, right is left empty. The trees allocate from
+	* the same arena afterwards, and neither may be in use on another
+	* thread during the join. When both arenas are already shared with
+	* other trees (after splits) the items are moved one by one instead.
+	* @param right The tree with the items greater than this tree's
+	* @throws std::invalid_argument if an item of right is not greater
+	*         than every item of this tree
 	*/
-	bool contains(const T& item) const override;
+	void join(AVLTree<T, Compare>& right);
+
+protected:
+
+	// a subtree and its rank (see BinarySearchTree::Subtree)
+	using typename BinarySearchTree<T, Compare>::Subtree;
+
+	/*
+	* Retraces from the parent of a new node and rotates where out
+	* of balance, O(log n)
+	* @param node The node holding the item
+	* @param added true if node was just linked, false if it was there
+	*/
+	void afterInsert(Node<T>* node, bool added) override;
+
+	/*
+	* Removes a node, then retraces and rotates from where the tree
+	* changed, O(log n)
+	* @param node The node to remove
+	*/
+	void removeNode(Node<T>* node) override;
 
 	/*
-	* Creates a dynamic array, copies all items to the array
-	* and then reads the array to re-balance this tree
+	* Creates an AVLNode for item
+	* @param item The item for the node
+	* @return the new node
 	*/
-	void rebalance() override;
+	Node<T>* createNode(const T& item) override;
 
 	/*
-	* Deletes all nodes in the tree
+	* Creates an AVLNode moving item into it
+	* @param item The item for the node
+	* @return the new node
 	*/
-	void clear() override;
+	Node<T>* createNode(T&& item) override;
 
 	/*
-	* Prints the tree sideways
+	* Creates a copy of an AVLNode with its item, size and height
+	* @param other The node to copy
+	* @return the new node
 	*/
-	void displaySideways() const override;
+	Node<T>* cloneNode(const Node<T>* other) override;
+
+	/*
+	* Recomputes the size and height of node from its children
+	* @param node The node to update
+	*/
+	void fixNode(Node<T>* node) override;
+
+	/*
+	* Links left, middle and right by height: when one side is more than
+	* one taller middle takes the place of the first node down its inner
+	* spine that is at most one taller than the other side, then the
+	* path above is retraced, O(difference in height). The heights are
+	* read from the nodes, the ranks are left at 0.
+	* @param left The lower subtree, its root possibly nullptr
+	* @param middle The node in between
+	* @param right The upper subtree, its root possibly nullptr
+	* @return the joined subtree
+	*/
+	Subtree joinNodes(Subtree left, Node<T>* middle, Subtree right) override;
+
+	/*
+	* Makes this tree and other allocate AVLNodes from the same slabs
+	* @param other An AVLTree
+	* @return false if both arenas are already shared with other trees
+	*/
+	bool shareNodes(BinarySearchTree<T, Compare>& other) override;
+
+	/*
+	* Destroys an AVLNode created by createNode
+	* @param node The node to destroy
+	*/
+	void destroyNode(Node<T>* node) override;
+
+	/*
+	* Releases the memory of every AVLNode at once
+	*/
+	void releaseNodes() override;
+
+	/*
+	* Checks if another tree allocates from the same AVLNode slabs
+	* @return true if the arena is shared
+	*/
+	bool nodesShared() const override;
+
+	/*
+	* Takes uninitialized storage for n AVLNodes in a row
+	* @param n The number of nodes
+	* @return the storage, filled with createNodeAt
+	*/
+	void* takeRun(std::size_t n) override;
+
+	/*
+	* Constructs AVLNode i of a run taken with takeRun
+	* @param run The storage returned by takeRun
+	* @param i The index of the node in the run
+	* @param item The item for the node
+	* @return the new node
+	*/
+	Node<T>* createNodeAt(void* run, std::size_t i, const T& item) override;
+
+	/*
+	* Constructs AVLNode i of a run taken with takeRun moving item into it
+	* @param run The storage returned by takeRun
+	* @param i The index of the node in the run
+	* @param item The item for the node
+	* @return the new node
+	*/
+	Node<T>* createNodeAt(void* run, std::size_t i, T&& item) override;
+
+	/*
+	* Gives back slot i of a run of AVLNodes that was never constructed
+	* @param run The storage returned by takeRun
+	* @param i The index of the slot in the run
+	*/
+	void recycleAt(void* run, std::size_t i) override;
 
 private:
 
@@ -105,12 +256,23 @@ private:
 		*/
 		explicit AVLNode(const T& item);
 
+		/*
+		* Constructor moving the data to be stored
+		*/
+		explicit AVLNode(T&& item);
+
 		/*
 		* Get the height of the Node
 		* @return height of the Node
 		*/
 		int getHeight() const;
 
+		/*
+		* Set the height of the Node
+		* @param height The new height
+		*/
+		void setHeight(int height);
+
 		/*
 		* Increment operator overload
 		* increments height of Node
@@ -134,28 +296,42 @@ private:
 		int height;
 	};
 
-	/* Root of AVLTree*/
-	AVLNode* root;
+	/* Storage for all nodes of the AVLTree */
+	NodeArena<AVLNode> avlNodes;
+
+	/*
+	* Update heights from curr up to the root after the subtree
+	* below curr changed, rotating where out of balance
+	* @param curr The lowest node whose subtree changed
+	*/
+	void updateHeights(Node<T>* curr);
 
 	/*
-	* Adds new Node
+	* Left AVL rotation, fixes a left heavy curr
+	* @param curr The node out of balance
+	* @return the new root of the subtree
 	*/
-	void addNode(AVLNode* curr, AVLNode* parent, const T& item);
+	AVLNode* leftRotation(AVLNode* curr);
 
 	/*
-	* Update heights after adding Node
+	* Right AVL rotation, fixes a right heavy curr
+	* @param curr The node out of balance
+	* @return the new root of the subtree
 	*/
-	void updateHeights(AVLNode* curr);
+	AVLNode* rightRotation(AVLNode* curr);
 
 	/*
-	* Left AVL rotation
+	* Gets the height of a possibly null node
+	* @param node The node
+	* @return its height, 0 for nullptr
 	*/
-	static void leftRotation(AVLNode* curr, AVLNode* left);
+	static int heightOf(Node<T>* node);
 
 	/*
-	* Right AVL rotation
+	* Recomputes the height of node from its children
+	* @param node The node to update
 	*/
-	static void rightRotation(AVLNode* curr, AVLNode* right);
+	static void fixHeight(AVLNode* node);
 };
 
 #include "avltree.cpp"
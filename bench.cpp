@@ -0,0 +1,1484 @@
+/*
+* bench.cpp
+*
+* @author Juan Arias
+*
+* Benchmarks for the tree classes, build with optimizations:
+*
+*	g++ -std=c++17 -O2 -pthread bench.cpp -o bench
+*	./bench [name] [n]
+*
+* With no name every benchmark is run, n is the number of keys (default 1M).
+* Benchmarks are:
+*
+*	- arena: build and clear throughput, arena vs per-node heap allocation
+*	- strings: heap allocations and throughput of contains() on string keys
+*	- rebalance: in-place rebalance vs copying out and rebuilding
+*	- readtree: bulk build from sorted input vs adding the middle items
+*	- parallel: readTree, sorting readTree and rebalance on 1 vs all threads
+*	- balanced: insert/remove throughput and lookup latency,
+*	  RedBlackTree vs AVLTree vs std::set
+*	- btree: insert/remove throughput, lookup latency and readTree,
+*	  BTree vs AVLTree vs std::set
+*	- frozen: contains, containsBatch and lower bound on a frozen
+*	  snapshot vs the pointer trees it was made from
+*	- simd: search kernels for int, long, float and double at every
+*	  instruction set the processor has (scalar, SSE4.2, AVX2): one
+*	  64 key block, BTree lookups and batched FrozenTree lookups
+*	- memory: heap bytes per item of every tree for int and string
+*	  keys, and lookups on CompactAVLTree, with and without parent
+*	  links, vs AVLTree
+*	- concurrent: read heavy and write heavy mixes of lookups, adds and
+*	  removes on 1 up to one thread per hardware thread sharing one set,
+*	  ConcurrentAVLTree vs AVLTree behind one mutex
+*	- moves: handing a tree of strings to the next stage by copy vs
+*	  move, and moving items between trees with extract and insert vs
+*	  copying them with add and remove
+*	- persistent: taking a snapshot, PersistentAVLTree vs copying an
+*	  AVLTree, and adds with and without a snapshot every few adds
+*	- split: partitioning a tree at a random watermark and merging it
+*	  back, copying out with two readTree calls vs split and join, for
+*	  AVLTree and RedBlackTree
+*	- sets: union of two AVLTrees by adding every item vs unionWith on
+*	  1 and all threads, and intersect and difference, for a second
+*	  tree as large as the first, half its size and a hundredth its size
+*	- ranges: items of a key range [low, high) of an AVLTree by
+*	  filtering a full scan vs range and countRange, and removing a
+*	  range key by key vs eraseRange
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include "avltree.h"
+#include "btree.h"
+#include "compacttree.h"
+#include "concurrenttree.h"
+#include "persistenttree.h"
+#include "rbtree.h"
+
+// Number of calls to operator new, read by the benchmarks
+static std::size_t allocations = 0;
+
+// The replacements are kept out of line: once inlined, GCC sees new
+// expressions paired with std::free and warns (-Wmismatched-new-delete)
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+/*
+* Counting replacement for the global operator new
+*/
+BENCH_NOINLINE void* operator new(std::size_t bytes) {
+
+	++allocations;
+
+	void* mem = std::malloc(bytes != 0 ? bytes : 1);
+
+	if (mem == nullptr) {
+
+		throw std::bad_alloc();
+	}
+
+	return mem;
+}
+
+/*
+* Matching replacement for the global operator delete
+*/
+BENCH_NOINLINE void operator delete(void* mem) noexcept {
+
+	std::free(mem);
+}
+
+/*
+* Matching replacement for the sized global operator delete
+*/
+BENCH_NOINLINE void operator delete(void* mem, std::size_t) noexcept {
+
+	std::free(mem);
+}
+
+/*
+* Seconds elapsed while running a function
+* @param fn The function to time
+* @return wall clock seconds
+*/
+template<class F>
+double timeIt(F fn) {
+
+	auto start = std::chrono::steady_clock::now();
+
+	fn();
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	return elapsed.count();
+}
+
+/*
+* Prints one result line as name, millions of operations per second
+* @param name The name of the measurement
+* @param ops The number of operations
+* @param seconds The time they took
+*/
+void report(const std::string& name, std::size_t ops, double seconds) {
+
+	std::cout << "  " << name;
+
+	for (std::size_t i(name.size()); i < 36; ++i) {
+
+		std::cout << ' ';
+	}
+
+	std::cout << ops / seconds / 1e6 << " Mops/s" << std::endl;
+}
+
+/*
+* n distinct keys in random order
+* @param n The number of keys
+* @return the shuffled keys
+*/
+std::vector<int> shuffledKeys(std::size_t n) {
+
+	std::vector<int> keys(n);
+
+	for (std::size_t i(0); i < n; ++i) {
+
+		keys[i] = static_cast<int>(i);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+	return keys;
+}
+
+/*
+* The per-node heap path the trees used before NodeArena, kept here
+* only as a baseline. Like BinarySearchTree::add it looks the item up
+* before descending again to link the new node.
+*/
+template<class T>
+class HeapTree {
+
+public:
+
+	~HeapTree() {
+
+		this->clear();
+	}
+
+	void add(const T& item) {
+
+		for (Node<T>* curr = this->root; curr != nullptr; ) {
+
+			if (curr->getItem() == item) {
+
+				return;
+			}
+
+			curr = (curr->getItem() < item) ? curr->getRight() : curr->getLeft();
+		}
+
+		Node<T>* node = new Node<T>(item);
+
+		if (this->root == nullptr) {
+
+			this->root = node;
+
+			return;
+		}
+
+		Node<T>* curr = this->root;
+
+		while (true) {
+
+			Node<T>* next = (curr->getItem() < item) ? curr->getRight() : curr->getLeft();
+
+			if (next == nullptr) {
+
+				break;
+			}
+
+			curr = next;
+		}
+
+		node->setParent(curr);
+
+		if (curr->getItem() < item) {
+
+			curr->setRight(node);
+
+		} else {
+
+			curr->setLeft(node);
+		}
+	}
+
+	void clear() {
+
+		HeapTree<T>::deleteNodes(this->root);
+
+		this->root = nullptr;
+	}
+
+private:
+
+	Node<T>* root = nullptr;
+
+	static void deleteNodes(Node<T>* curr) {
+
+		if (curr != nullptr) {
+
+			HeapTree<T>::deleteNodes(curr->getLeft());
+			HeapTree<T>::deleteNodes(curr->getRight());
+
+			delete curr;
+		}
+	}
+};
+
+/*
+* Build and clear throughput, NodeArena vs per-node heap allocation
+* @param n The number of keys
+*/
+void arenaBench(std::size_t n) {
+
+	std::cout << "arena: build/clear " << n << " random int keys" << std::endl;
+
+	std::vector<int> keys = shuffledKeys(n);
+
+	HeapTree<int> heap;
+	BinarySearchTree<int> tree;
+	BinarySearchTree<int> huge;
+	huge.useHugePages(true);
+
+	report("heap   build", n, timeIt([&] { for (int k : keys) heap.add(k); }));
+	report("heap   clear", n, timeIt([&] { heap.clear(); }));
+
+	report("arena  build", n, timeIt([&] { for (int k : keys) tree.add(k); }));
+	report("arena  clear", n, timeIt([&] { tree.clear(); }));
+	report("arena  rebuild (slab reused)", n, timeIt([&] { for (int k : keys) tree.add(k); }));
+	report("arena  clear", n, timeIt([&] { tree.clear(); }));
+
+	report("arena+huge pages build", n, timeIt([&] { for (int k : keys) huge.add(k); }));
+	report("arena+huge pages clear", n, timeIt([&] { huge.clear(); }));
+}
+
+/*
+* Heap allocations and throughput of contains() on string keys too long
+* for the small string optimization
+* @param n The number of keys
+*/
+void stringsBench(std::size_t n) {
+
+	std::cout << "strings: contains() on " << n << " string keys" << std::endl;
+
+	std::vector<int> order = shuffledKeys(n);
+	std::vector<std::string> keys;
+
+	for (int k : order) {
+
+		keys.push_back("a fairly long key prefix #" + std::to_string(k));
+	}
+
+	BinarySearchTree<std::string> tree;
+
+	for (const std::string& k : keys) {
+
+		tree.add(k);
+	}
+
+	std::size_t found(0);
+	std::size_t before(allocations);
+
+	double seconds = timeIt([&] {
+
+		for (const std::string& k : keys) {
+
+			found += tree.contains(k);
+		}
+	});
+
+	std::size_t allocated = allocations - before;
+
+	report("contains", n, seconds);
+
+	std::cout << "  allocations per contains()          "
+	          << static_cast<double>(allocated) / n
+	          << " (found " << found << ")" << std::endl;
+}
+
+/*
+* In-place rebalance vs the old path of copying every item to an array
+* and rebuilding the tree from it
+* @param n The number of keys
+*/
+void rebalanceBench(std::size_t n) {
+
+	std::cout << "rebalance: " << n << " random int keys" << std::endl;
+
+	std::vector<int> keys = shuffledKeys(n);
+
+	BinarySearchTree<int> tree;
+
+	for (int k : keys) {
+
+		tree.add(k);
+	}
+
+	std::size_t before(allocations);
+
+	report("copy out + readTree", n, timeIt([&] {
+
+		std::vector<int> items(tree.begin(), tree.end());
+
+		tree.readTree(&items[0], static_cast<int>(items.size()));
+	}));
+
+	std::cout << "  allocations                         " << allocations - before << std::endl;
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+	tree.clear();
+
+	for (int k : keys) {
+
+		tree.add(k);
+	}
+
+	before = allocations;
+
+	report("in place (DSW)", n, timeIt([&] { tree.rebalance(); }));
+
+	std::cout << "  allocations                         " << allocations - before
+	          << " (height " << tree.getHeight() << ")" << std::endl;
+}
+
+/*
+* The old readTree path, adds the middle item of each subrange
+* @param tree The tree to add to
+* @param arr The sorted items
+* @param first The first index of the subrange
+* @param last The last index of the subrange
+*/
+template<class T>
+void addMiddles(BinarySearchTree<T>& tree, const T arr[], long first, long last) {
+
+	if (first <= last) {
+
+		long mid = (first + last) / 2;
+
+		tree.add(arr[mid]);
+
+		addMiddles(tree, arr, first, mid - 1);
+		addMiddles(tree, arr, mid + 1, last);
+	}
+}
+
+/*
+* Bulk build from sorted input vs adding the middle item of every subrange
+* @param n The number of keys
+*/
+void readTreeBench(std::size_t n) {
+
+	std::cout << "readtree: " << n << " sorted keys" << std::endl;
+
+	std::vector<int> ints(n);
+	std::vector<std::string> strings;
+
+	for (std::size_t i(0); i < n; ++i) {
+
+		ints[i] = static_cast<int>(i);
+		strings.push_back("a fairly long key prefix #" + std::to_string(1000000000 + i));
+	}
+
+	BinarySearchTree<int> intTree;
+	BinarySearchTree<std::string> stringTree;
+
+	report("int    add middles", n, timeIt([&] {
+
+		intTree.clear();
+		addMiddles(intTree, &ints[0], 0, static_cast<long>(n) - 1);
+	}));
+	report("int    readTree", n, timeIt([&] { intTree.readTree(ints.begin(), ints.end()); }));
+
+	report("string add middles", n, timeIt([&] {
+
+		stringTree.clear();
+		addMiddles(stringTree, &strings[0], 0, static_cast<long>(n) - 1);
+	}));
+	report("string readTree (copy)", n, timeIt([&] {
+
+		stringTree.readTree(strings.begin(), strings.end());
+	}));
+	report("string readTree (move)", n, timeIt([&] { stringTree.readTree(std::move(strings)); }));
+}
+
+/*
+* readTree, sorting readTree and rebalance on one thread vs one thread
+* per hardware thread
+* @param n The number of keys
+*/
+void parallelBench(std::size_t n) {
+
+	unsigned threads = std::thread::hardware_concurrency();
+
+	std::cout << "parallel: " << n << " int keys, 1 vs " << threads << " threads" << std::endl;
+
+	std::vector<int> sorted(n);
+
+	for (std::size_t i(0); i < n; ++i) {
+
+		sorted[i] = static_cast<int>(i);
+	}
+
+	std::vector<int> keys = shuffledKeys(n);
+
+	for (unsigned t : {1u, threads}) {
+
+		std::string label = (t == 1) ? "serial   " : "parallel ";
+
+		BinarySearchTree<int> tree;
+		tree.useThreads(t);
+
+		report(label + "readTree sorted", n, timeIt([&] { tree.readTree(sorted.begin(), sorted.end()); }));
+		report(label + "readTree unsorted", n, timeIt([&] {
+
+			tree.readTree(std::vector<int>(keys), false);
+		}));
+
+		tree.clear();
+
+		for (int k : keys) {
+
+			tree.add(k);
+		}
+
+		report(label + "rebalance", n, timeIt([&] { tree.rebalance(); }));
+	}
+}
+
+/*
+* Inserts, lookups, a write heavy mix and removes on one tree type
+* @param name The name of the tree
+* @param tree An empty tree
+* @param keys The keys in insertion order
+* @param probes The keys to look up
+*/
+template<class Tree>
+void balancedRun(const std::string& name, Tree& tree, const std::vector<int>& keys,
+                 const std::vector<int>& probes) {
+
+	std::size_t n(keys.size()), found(0);
+
+	report(name + " insert", n, timeIt([&] { for (int k : keys) tree.add(k); }));
+
+	double seconds = timeIt([&] { for (int k : probes) found += tree.contains(k); });
+
+	report(name + " lookup", n, seconds);
+
+	std::cout << "  " << name << " lookup latency" << std::string(36 - name.size() - 15, ' ')
+	          << seconds / n * 1e9 << " ns (found " << found << ")" << std::endl;
+
+	// each step removes one key and adds it back
+	report(name + " remove+insert mix", 2 * n, timeIt([&] {
+
+		for (int k : probes) {
+
+			tree.remove(k);
+			tree.add(k);
+		}
+	}));
+
+	report(name + " remove", n, timeIt([&] { for (int k : probes) tree.remove(k); }));
+}
+
+/*
+* std::set with the add/remove/contains names of the trees
+*/
+template<class T = int>
+struct StdSet {
+
+	std::set<T> set;
+
+	void add(const T& k) {
+
+		this->set.insert(k);
+	}
+
+	void remove(const T& k) {
+
+		this->set.erase(k);
+	}
+
+	bool contains(const T& k) const {
+
+		return this->set.find(k) != this->set.end();
+	}
+};
+
+/*
+* Insert/remove throughput and lookup latency of the balanced trees
+* @param n The number of keys
+*/
+void balancedBench(std::size_t n) {
+
+	std::cout << "balanced: " << n << " random int keys" << std::endl;
+
+	std::vector<int> keys = shuffledKeys(n);
+	std::vector<int> probes(keys);
+
+	std::shuffle(probes.begin(), probes.end(), std::mt19937(9));
+
+	RedBlackTree<int> rb;
+	AVLTree<int> avl;
+	StdSet<> set;
+
+	balancedRun("red-black", rb, keys, probes);
+	balancedRun("avl      ", avl, keys, probes);
+	balancedRun("std::set ", set, keys, probes);
+}
+
+/*
+* Insert, lookup and remove of random keys with BTree against the binary
+* trees, then building from sorted keys with readTree
+*/
+void btreeBench(std::size_t n) {
+
+	std::cout << "btree: " << n << " random int keys" << std::endl;
+
+	std::vector<int> keys = shuffledKeys(n);
+	std::vector<int> probes(keys);
+
+	std::shuffle(probes.begin(), probes.end(), std::mt19937(9));
+
+	BTree<int> btree;
+	AVLTree<int> avl;
+	StdSet<> set;
+
+	balancedRun("btree    ", btree, keys, probes);
+	balancedRun("avl      ", avl, keys, probes);
+	balancedRun("std::set ", set, keys, probes);
+
+	std::vector<int> sorted(keys);
+
+	std::sort(sorted.begin(), sorted.end());
+
+	report("btree     readTree", n, timeIt([&] { btree.readTree(sorted.begin(), sorted.end()); }));
+	report("avl       readTree", n, timeIt([&] { avl.readTree(sorted.begin(), sorted.end()); }));
+
+	std::size_t found(0);
+
+	double seconds = timeIt([&] { for (int k : probes) found += btree.contains(k); });
+
+	std::cout << "  btree     lookup latency after readTree " << seconds / n * 1e9
+	          << " ns (found " << found << ", height " << btree.getHeight() << ")" << std::endl;
+}
+
+/*
+* Lookups on a FrozenTree against the trees it was frozen from: an
+* AVLTree built by adding random keys, its nodes scattered in memory,
+* and a BinarySearchTree built by readTree, its nodes in sorted order.
+* Half of the probes miss.
+*/
+void frozenBench(std::size_t n) {
+
+	std::cout << "frozen: " << n << " lookups in " << n << " int keys" << std::endl;
+
+	std::vector<int> keys = shuffledKeys(n);
+	std::vector<int> probes(n);
+
+	std::mt19937 gen(13);
+
+	for (std::size_t i(0); i < n; ++i) {
+
+		// keys are doubled below, odd probes miss
+		probes[i] = static_cast<int>(gen() % (2 * n));
+	}
+
+	AVLTree<int> avl;
+
+	for (int k : keys) {
+
+		avl.add(2 * k);
+	}
+
+	BinarySearchTree<int> bst;
+
+	bst.readTree(avl.begin(), avl.end());
+
+	FrozenTree<int> frozen;
+
+	report("freeze", n, timeIt([&] { frozen = avl.freeze(); }));
+
+	std::size_t found(0);
+
+	report("avl    contains", n, timeIt([&] { for (int k : probes) found += avl.contains(k); }));
+	report("bst    contains", n, timeIt([&] { for (int k : probes) found += bst.contains(k); }));
+	report("frozen contains", n, timeIt([&] { for (int k : probes) found += frozen.contains(k); }));
+
+	// batches of a few thousand lookups, as a server would get them
+	const std::size_t batch(4096);
+
+	bool hits[batch];
+
+	auto batches = [&](const auto& tree) {
+
+		for (std::size_t i(0); i < n; i += batch) {
+
+			std::size_t count = std::min(batch, n - i);
+
+			tree.containsBatch(probes.data() + i, count, hits);
+
+			found += std::count(hits, hits + count, true);
+		}
+	};
+
+	report("avl    containsBatch", n, timeIt([&] { batches(avl); }));
+	report("bst    containsBatch", n, timeIt([&] { batches(bst); }));
+	report("frozen containsBatch", n, timeIt([&] { batches(frozen); }));
+	report("frozen lowerBound", n, timeIt([&] {
+
+		for (int k : probes) {
+
+			found += frozen.lowerBound(k) != frozen.end();
+		}
+	}));
+
+	long long sum(0);
+
+	report("avl    iterate", n, timeIt([&] { for (int k : avl) sum += k; }));
+	report("frozen iterate", n, timeIt([&] { for (int k : frozen) sum += k; }));
+
+	std::cout << "  (found " << found << ", sum " << sum << ")" << std::endl;
+}
+
+/*
+* One key type of simdBench at the instruction set in use
+* @param type The name of the key type
+* @param n The number of keys and of lookups
+*/
+template<class T>
+void simdRun(const std::string& type, std::size_t n) {
+
+	std::vector<int> keys = shuffledKeys(n);
+	std::vector<T> probes(n), block(64);
+
+	std::mt19937 gen(17);
+
+	for (std::size_t i(0); i < n; ++i) {
+
+		probes[i] = static_cast<T>(gen() % (2 * n));
+	}
+
+	for (std::size_t i(0); i < block.size(); ++i) {
+
+		block[i] = static_cast<T>(i * 2 * n / block.size());
+	}
+
+	BTree<T> btree;
+
+	for (int k : keys) {
+
+		btree.add(static_cast<T>(2 * k));
+	}
+
+	FrozenTree<T> frozen(btree.begin(), btree.size());
+
+	std::size_t found(0);
+
+	report(type + " countLess 64 keys", n, timeIt([&] {
+
+		for (T k : probes) {
+
+			found += SimdSearch::countLess(block.data(), 64, k);
+		}
+	}));
+
+	report(type + " btree contains", n, timeIt([&] { for (T k : probes) found += btree.contains(k); }));
+	report(type + " frozen contains", n, timeIt([&] { for (T k : probes) found += frozen.contains(k); }));
+
+	bool* hits = new bool[n];
+
+	report(type + " frozen containsBatch", n, timeIt([&] { frozen.containsBatch(probes.data(), n, hits); }));
+
+	found += std::count(hits, hits + n, true);
+
+	delete[] hits;
+
+	std::cout << "  (found " << found << ")" << std::endl;
+}
+
+/*
+* The search kernels at every instruction set the processor has
+*/
+void simdBench(std::size_t n) {
+
+	const char* names[] = {"scalar", "sse4.2", "avx2"};
+
+	std::cout << "simd: " << n << " lookups in " << n << " keys, processor supports "
+	          << names[SimdSearch::supported()] << std::endl;
+
+	for (int level(SimdSearch::SCALAR); level <= SimdSearch::supported(); ++level) {
+
+		SimdSearch::useLevel(static_cast<SimdSearch::Level>(level));
+
+		std::cout << " " << names[level] << std::endl;
+
+		simdRun<int>("int   ", n);
+		simdRun<long>("long  ", n);
+		simdRun<float>("float ", n);
+		simdRun<double>("double", n);
+	}
+
+	SimdSearch::useLevel(SimdSearch::supported());
+}
+
+/*
+* Bytes of heap memory in use, 0 where malloc cannot tell
+* @return the bytes allocated and not freed
+*/
+std::size_t heapBytes() {
+
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+	struct mallinfo2 info = mallinfo2();
+
+	return info.uordblks + info.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+/*
+* Prints the heap bytes per item of one tree type built by adding keys,
+* including slack in arenas and pools
+* @param name The name of the tree
+* @param keys The keys in insertion order
+*/
+template<class Tree, class T>
+void memoryRun(const std::string& name, const std::vector<T>& keys) {
+
+	std::size_t before = heapBytes();
+
+	Tree* tree = new Tree();
+
+	for (const T& k : keys) {
+
+		tree->add(k);
+	}
+
+	std::size_t bytes = heapBytes() - before;
+
+	delete tree;
+
+	std::cout << "  " << name << std::string(36 - name.size(), ' ')
+	          << static_cast<double>(bytes) / keys.size() << " bytes/item" << std::endl;
+}
+
+/*
+* Heap memory per item of every tree, and what the smaller nodes of
+* CompactAVLTree do for lookups
+* @param n The number of keys
+*/
+void memoryBench(std::size_t n) {
+
+	std::cout << "memory: " << n << " random keys" << std::endl;
+
+	if (heapBytes() == 0) {
+
+		std::cout << "  malloc statistics are not available" << std::endl;
+	}
+
+	std::vector<int> keys = shuffledKeys(n);
+	std::vector<std::string> words;
+
+	for (int k : keys) {
+
+		// short enough to be stored inside the std::string
+		words.push_back("key:" + std::to_string(k));
+	}
+
+	memoryRun<BinarySearchTree<int>>("bst      int", keys);
+	memoryRun<AVLTree<int>>("avl      int", keys);
+	memoryRun<RedBlackTree<int>>("red-black int", keys);
+	memoryRun<StdSet<int>>("std::set int", keys);
+	memoryRun<BTree<int>>("btree    int", keys);
+	memoryRun<CompactAVLTree<int>>("compact  int", keys);
+	memoryRun<CompactAVLTree<int, std::less<int>, CompactFields<false>>>("compact  int, no parent", keys);
+	memoryRun<CompactAVLTree<int, std::less<int>, CompactFields<true, true>>>("compact  int, size", keys);
+
+	memoryRun<BinarySearchTree<std::string>>("bst      string", words);
+	memoryRun<AVLTree<std::string>>("avl      string", words);
+	memoryRun<RedBlackTree<std::string>>("red-black string", words);
+	memoryRun<StdSet<std::string>>("std::set string", words);
+	memoryRun<BTree<std::string>>("btree    string", words);
+	memoryRun<CompactAVLTree<std::string>>("compact  string", words);
+
+	std::vector<int> probes(keys);
+
+	std::shuffle(probes.begin(), probes.end(), std::mt19937(9));
+
+	AVLTree<int> avl;
+	CompactAVLTree<int> compact;
+	CompactAVLTree<int, std::less<int>, CompactFields<false>> bare;
+
+	report("avl     insert", n, timeIt([&] { for (int k : keys) avl.add(k); }));
+	report("compact insert", n, timeIt([&] { for (int k : keys) compact.add(k); }));
+	report("bare    insert", n, timeIt([&] { for (int k : keys) bare.add(k); }));
+
+	std::size_t found(0);
+
+	report("avl     lookup", n, timeIt([&] { for (int k : probes) found += avl.contains(k); }));
+	report("compact lookup", n, timeIt([&] { for (int k : probes) found += compact.contains(k); }));
+	report("bare    lookup", n, timeIt([&] { for (int k : probes) found += bare.contains(k); }));
+	report("avl     remove", n, timeIt([&] { for (int k : probes) avl.remove(k); }));
+	report("compact remove", n, timeIt([&] { for (int k : probes) compact.remove(k); }));
+	report("bare    remove", n, timeIt([&] { for (int k : probes) bare.remove(k); }));
+
+	std::cout << "  (found " << found << ")" << std::endl;
+}
+
+/*
+* An AVLTree every thread may use, one at a time
+*/
+struct LockedAVL {
+
+	AVLTree<int> tree;
+
+	mutable std::mutex lock;
+
+	void add(int k) {
+
+		std::lock_guard<std::mutex> guard(this->lock);
+
+		this->tree.add(k);
+	}
+
+	void remove(int k) {
+
+		std::lock_guard<std::mutex> guard(this->lock);
+
+		this->tree.remove(k);
+	}
+
+	bool contains(int k) const {
+
+		std::lock_guard<std::mutex> guard(this->lock);
+
+		return this->tree.contains(k);
+	}
+};
+
+/*
+* Runs every thread's operations on one shared set at once
+* @param set The set, holding about half the keys
+* @param ops The operations of each thread: key * 4 + 2 to add,
+*        key * 4 + 3 to remove, anything else to look key up
+* @return wall clock seconds until the last thread is done
+*/
+template<class Set>
+double mixRun(Set& set, const std::vector<std::vector<unsigned>>& ops) {
+
+	std::atomic<std::size_t> found(0);
+
+	return timeIt([&] {
+
+		std::vector<std::thread> threads;
+
+		for (const std::vector<unsigned>& mine : ops) {
+
+			threads.emplace_back([&set, &mine, &found] {
+
+				std::size_t hits(0);
+
+				for (unsigned op : mine) {
+
+					int k = static_cast<int>(op >> 2);
+
+					if ((op & 3) == 2) {
+
+						set.add(k);
+
+					} else if ((op & 3) == 3) {
+
+						set.remove(k);
+
+					} else {
+
+						hits += set.contains(k);
+					}
+				}
+
+				found += hits;
+			});
+		}
+
+		for (std::thread& thread : threads) {
+
+			thread.join();
+		}
+	});
+}
+
+/*
+* Throughput of one shared set as threads are added, for a read heavy
+* (90% lookups) and a write heavy (50% lookups) mix of n operations
+* @param n The number of keys, and of operations per run
+*/
+void concurrentBench(std::size_t n) {
+
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+	std::cout << "concurrent: " << n << " int keys, " << n << " operations, up to "
+	          << cores << " threads" << std::endl;
+
+	std::vector<unsigned> counts;
+
+	for (unsigned t(1); t < cores; t *= 2) {
+
+		counts.push_back(t);
+	}
+
+	counts.push_back(cores);
+
+	std::vector<int> keys = shuffledKeys(2 * n);
+
+	for (unsigned lookups : {90u, 50u}) {
+
+		for (unsigned t : counts) {
+
+			std::vector<std::vector<unsigned>> ops(t);
+
+			std::mt19937 random(t);
+
+			for (std::size_t i(0); i < n; ++i) {
+
+				unsigned k = random() % (2 * n), dice = random() % 100;
+				unsigned op = (dice < lookups) ? 0 : ((dice - lookups) % 2 + 2);
+
+				ops[i % t].push_back(k * 4 + op);
+			}
+
+			ConcurrentAVLTree<int> concurrent;
+			LockedAVL locked;
+
+			for (std::size_t i(0); i < n; ++i) {
+
+				concurrent.add(keys[i]);
+				locked.add(keys[i]);
+			}
+
+			std::string label = std::to_string(lookups) + "% lookups, " + std::to_string(t) + " threads ";
+
+			report(label + "concurrent", n, mixRun(concurrent, ops));
+			report(label + "mutex", n, mixRun(locked, ops));
+		}
+	}
+}
+
+/*
+* What a pipeline pays to pass string trees between stages: a whole
+* tree by copy or by move, and single items by add and remove or by
+* extract and insert
+* @param n The number of keys
+*/
+void movesBench(std::size_t n) {
+
+	std::cout << "moves: " << n << " string keys" << std::endl;
+
+	std::vector<int> order = shuffledKeys(n);
+	std::vector<std::string> keys;
+
+	for (int k : order) {
+
+		keys.push_back("a fairly long key prefix #" + std::to_string(k));
+	}
+
+	AVLTree<std::string> stage;
+
+	std::size_t before(allocations);
+
+	report("add copies", n, timeIt([&] {
+
+		for (const std::string& k : keys) {
+
+			stage.add(k);
+		}
+	}));
+
+	std::cout << "  allocations per add                 " << static_cast<double>(allocations - before) / n << std::endl;
+
+	std::vector<std::string> moved(keys);
+	AVLTree<std::string> emplaced;
+
+	before = allocations;
+
+	report("add moved items", n, timeIt([&] {
+
+		for (std::string& k : moved) {
+
+			emplaced.add(std::move(k));
+		}
+	}));
+
+	std::cout << "  allocations per add                 " << static_cast<double>(allocations - before) / n << std::endl;
+
+	report("copy tree to next stage (trees)", 1, timeIt([&] {
+
+		AVLTree<std::string> next(stage);
+	}));
+
+	report("move tree to next stage (trees)", 1, timeIt([&] {
+
+		AVLTree<std::string> next(std::move(stage));
+
+		stage = std::move(next);
+	}));
+
+	AVLTree<std::string> target;
+
+	before = allocations;
+
+	report("item by add + remove", n, timeIt([&] {
+
+		for (const std::string& k : keys) {
+
+			target.add(k);
+			stage.remove(k);
+		}
+	}));
+
+	std::cout << "  allocations per item                " << static_cast<double>(allocations - before) / n << std::endl;
+
+	before = allocations;
+
+	report("item by extract + insert", n, timeIt([&] {
+
+		for (const std::string& k : keys) {
+
+			stage.insert(target.extract(k));
+		}
+	}));
+
+	std::cout << "  allocations per item                " << static_cast<double>(allocations - before) / n << std::endl;
+}
+
+/*
+* Cost of a snapshot, copying an AVLTree vs sharing the nodes of a
+* PersistentAVLTree, and what path copying costs adds when snapshots
+* are taken while adding
+* @param n The number of keys
+*/
+void persistentBench(std::size_t n) {
+
+	std::cout << "persistent: " << n << " random int keys" << std::endl;
+
+	std::vector<int> keys = shuffledKeys(n);
+
+	AVLTree<int> avl;
+	PersistentAVLTree<int> persistent;
+
+	report("add AVLTree", n, timeIt([&] {
+
+		for (int k : keys) {
+
+			avl.add(k);
+		}
+	}));
+
+	report("add persistent, no snapshots", n, timeIt([&] {
+
+		for (int k : keys) {
+
+			persistent.add(k);
+		}
+	}));
+
+	const std::size_t copies(5), snapshots(1000000);
+
+	report("copy AVLTree (snapshots)", copies, timeIt([&] {
+
+		for (std::size_t i(0); i < copies; ++i) {
+
+			AVLTree<int> copy(avl);
+		}
+	}));
+
+	report("snapshot persistent (snapshots)", snapshots, timeIt([&] {
+
+		for (std::size_t i(0); i < snapshots; ++i) {
+
+			PersistentAVLTree<int> copy(persistent);
+		}
+	}));
+
+	for (std::size_t every : {1000, 64, 1}) {
+
+		persistent.clear();
+
+		PersistentAVLTree<int> snapshot;
+
+		std::size_t before(allocations);
+
+		report("add persistent, snapshot every " + std::to_string(every), n, timeIt([&] {
+
+			for (std::size_t i(0); i < n; ++i) {
+
+				if (i % every == 0) {
+
+					snapshot = persistent;
+				}
+
+				persistent.add(keys[i]);
+			}
+		}));
+
+		std::cout << "  allocations per add                 "
+		          << static_cast<double>(allocations - before) / n << std::endl;
+	}
+}
+
+/*
+* Partitions a tree of n keys at random watermarks, copying the items
+* out into two new trees vs split, then joins the parts back
+* @param label A short name for the tree type
+* @param n The number of keys
+*/
+template<class Tree>
+void splitRun(const std::string& label, std::size_t n) {
+
+	std::vector<int> keys = shuffledKeys(n);
+
+	Tree tree;
+
+	for (int k : keys) {
+
+		tree.add(k);
+	}
+
+	const std::size_t copies(5), splits(100000);
+
+	std::mt19937 rng(3);
+
+	std::size_t before(allocations);
+
+	report(label + " copy + readTree (partitions)", copies, timeIt([&] {
+
+		for (std::size_t i(0); i < copies; ++i) {
+
+			int mark(static_cast<int>(rng() % n));
+
+			std::vector<int> below, rest;
+
+			for (int k : tree) {
+
+				(k < mark ? below : rest).push_back(k);
+			}
+
+			Tree lower, upper;
+
+			lower.readTree(std::move(below));
+			upper.readTree(std::move(rest));
+		}
+	}));
+
+	std::cout << "  allocations per partition           "
+	          << static_cast<double>(allocations - before) / copies << std::endl;
+
+	before = allocations;
+
+	report(label + " split + join (partitions)", splits, timeIt([&] {
+
+		for (std::size_t i(0); i < splits; ++i) {
+
+			Tree upper(tree.split(static_cast<int>(rng() % n)));
+
+			tree.join(upper);
+		}
+	}));
+
+	std::cout << "  allocations per partition           "
+	          << static_cast<double>(allocations - before) / splits << std::endl;
+}
+
+/*
+* Partitioning a tree at a watermark and merging the parts back,
+* for both balanced trees
+* @param n The number of keys
+*/
+void splitBench(std::size_t n) {
+
+	std::cout << "split: " << n << " random int keys" << std::endl;
+
+	splitRun<AVLTree<int>>("AVL", n);
+	splitRun<RedBlackTree<int>>("RB", n);
+}
+
+/*
+* Merging, intersecting and subtracting AVLTrees of random keys, the
+* second tree as large as the first, half its size or much smaller
+* @param n The number of keys in the first tree
+*/
+void setsBench(std::size_t n) {
+
+	std::cout << "sets: " << n << " random int keys" << std::endl;
+
+	std::mt19937 rng(9);
+
+	AVLTree<int> first;
+
+	for (std::size_t i(0); i < n; ++i) {
+
+		first.add(static_cast<int>(rng() % (2 * n)));
+	}
+
+	unsigned all(std::max(std::thread::hardware_concurrency(), 2u));
+
+	for (std::size_t m : {n, n / 2, n / 100}) {
+
+		AVLTree<int> second;
+
+		for (std::size_t i(0); i < m; ++i) {
+
+			second.add(static_cast<int>(rng() % (2 * n)));
+		}
+
+		std::string size(m == n ? " (same size)" : (m == n / 2) ? " (1/2)" : " (1/100)");
+
+		AVLTree<int> added;
+
+		for (unsigned threads : {1u, all}) {
+
+			std::string label(" " + std::to_string(threads) + "t" + size);
+
+			AVLTree<int> united(first), common(first), rest(first);
+
+			// added is copied next to the first trees united, so both find the heap alike
+			if (threads == 1) {
+
+				added = first;
+
+				report("union by add" + size, m, timeIt([&] {
+
+					for (int k : second) {
+
+						added.add(k);
+					}
+				}));
+			}
+
+			united.useThreads(threads);
+			common.useThreads(threads);
+			rest.useThreads(threads);
+
+			report("unionWith" + label, m, timeIt([&] {
+
+				united.unionWith(second);
+			}));
+
+			report("intersect" + label, m, timeIt([&] {
+
+				common.intersect(second);
+			}));
+
+			report("difference" + label, m, timeIt([&] {
+
+				rest.difference(second);
+			}));
+
+			if (!std::equal(united.begin(), united.end(), added.begin(), added.end())) {
+
+				std::cout << "  unionWith and add disagree" << std::endl;
+			}
+		}
+	}
+}
+
+/*
+* Reading, counting and removing ranges of 1000 keys of an AVLTree
+* holding the keys 0..n-1
+* @param n The number of keys
+*/
+void rangesBench(std::size_t n) {
+
+	std::cout << "ranges: " << n << " int keys, 1000 keys per range" << std::endl;
+
+	const int width(1000);
+
+	AVLTree<int> tree;
+
+	for (int k : shuffledKeys(n)) {
+
+		tree.add(k);
+	}
+
+	std::mt19937 rng(13);
+
+	std::vector<int> lows(1000);
+
+	for (int& low : lows) {
+
+		low = static_cast<int>(rng() % (n - width));
+	}
+
+	long long sum(0);
+
+	// a few full scans are enough to see the cost
+	report("scan and filter (ranges)", 10, timeIt([&] {
+
+		for (std::size_t i(0); i < 10; ++i) {
+
+			for (int k : tree) {
+
+				if (k >= lows[i] && k < lows[i] + width) {
+
+					sum += k;
+				}
+			}
+		}
+	}));
+
+	report("range (ranges)", lows.size(), timeIt([&] {
+
+		for (int low : lows) {
+
+			for (int k : tree.range(low, low + width)) {
+
+				sum += k;
+			}
+		}
+	}));
+
+	report("countRange (ranges)", lows.size(), timeIt([&] {
+
+		for (int low : lows) {
+
+			sum += static_cast<long long>(tree.countRange(low, low + width));
+		}
+	}));
+
+	// removing every range the queries touched
+	AVLTree<int> byKey(tree);
+
+	std::size_t removed(0), erased(0);
+
+	double seconds = timeIt([&] {
+
+		for (int low : lows) {
+
+			for (int k(low); k < low + width; ++k) {
+
+				removed += byKey.remove(k);
+			}
+		}
+	});
+
+	report("remove each key (keys)", removed, seconds);
+
+	seconds = timeIt([&] {
+
+		for (int low : lows) {
+
+			erased += tree.eraseRange(low, low + width);
+		}
+	});
+
+	report("eraseRange (keys)", erased, seconds);
+
+	if (sum == 0 || removed != erased || tree.size() != byKey.size()) {
+
+		std::cout << "  eraseRange and remove disagree" << std::endl;
+	}
+}
+
+/*
+* Runs the benchmark named in argv[1] or all of them
+*/
+int main(int argc, char* argv[]) {
+
+	std::string name = (argc > 1) ? argv[1] : "all";
+
+	std::size_t n = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+
+	if (name == "all" || name == "arena") {
+
+		arenaBench(n);
+	}
+	if (name == "all" || name == "strings") {
+
+		stringsBench(n);
+	}
+	if (name == "all" || name == "rebalance") {
+
+		rebalanceBench(n);
+	}
+	if (name == "all" || name == "readtree") {
+
+		readTreeBench(n);
+	}
+	if (name == "all" || name == "parallel") {
+
+		parallelBench(n);
+	}
+	if (name == "all" || name == "balanced") {
+
+		balancedBench(n);
+	}
+	if (name == "all" || name == "btree") {
+
+		btreeBench(n);
+	}
+	if (name == "all" || name == "frozen") {
+
+		frozenBench(n);
+	}
+	if (name == "all" || name == "simd") {
+
+		simdBench(n);
+	}
+	if (name == "all" || name == "memory") {
+
+		memoryBench(n);
+	}
+	if (name == "all" || name == "concurrent") {
+
+		concurrentBench(n);
+	}
+	if (name == "all" || name == "moves") {
+
+		movesBench(n);
+	}
+	if (name == "all" || name == "persistent") {
+
+		persistentBench(n);
+	}
+	if (name == "all" || name == "split") {
+
+		splitBench(n);
+	}
+	if (name == "all" || name == "sets") {
+
+		setsBench(n);
+	}
+	if (name == "all" || name == "ranges") {
+
+		rangesBench(n);
+	}
+
+	return 0;
+}
@@ -7,57 +7,99 @@
 *
 * A BinarySearchTree is a binary tree where all values to the right of a node
 * are greater and all values left a node are lesser. It is able to locate a
-* a node in O(logn) time. Operations include:
+* a node in O(logn) time. Items are ordered by Compare, which may be a bool
+* "less" comparator or a three-way comparator (see compare.h). Operations
+* include:
 *
 *	- checking if empty
 *	- getting height
-*	- getting number of nodes
-*	- checking for an item
+*	- getting number of nodes in O(1)
+*	- selecting the k-th smallest item and ranking an item in O(height)
+*	- checking for an item, or for a key of another type with a
+*	  transparent comparator
 *	- adding an item
 *	- displaying the tree sideways
 *	- visiting each item inorder with a function parameter
+*	- bidirectional iterators (begin/end, rbegin/rend)
 *	- rebalancing
 *	- clearing
-*	- creating itself from an array
+*	- creating itself in O(n) from a sorted array, iterator range or
+*	  vector (moving the items), optionally sorting first
+*	- freezing into a read only FrozenTree for faster lookups
 *	- equality and non equality operator overloads
+*
+* Nodes are allocated from a NodeArena owned by the tree, so clearing
+* or destroying a tree releases its memory in bulk. Traversals walk
+* parent pointers instead of recursing, so a tree of any height, even
+* one built from sorted input, can be copied, compared and destroyed.
 */
 
 #include <algorithm>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <stdexcept>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
 #include "bst.h"
 
 /*
 * Constructs empty tree
 */
-template<class T>
-BinarySearchTree<T>::BinarySearchTree() :rootPtr(nullptr) {}
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::BinarySearchTree() :rootPtr(nullptr), threads(1) {}
 
 /*
 * Constructs tree with given item for root node
 * @param rootItem The item for the root node
 */
-template<class T>
-BinarySearchTree<T>::BinarySearchTree(const T& item)
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::BinarySearchTree(const T& item) :rootPtr(nullptr), threads(1) {
+
+	this->rootPtr = this->plainNodes().create(item);
+}
+
+/*
+* Constructs empty tree ordered by a given comparator, which may
+* hold state. Copies and moves of the tree take the comparator along.
+* @param comp The comparator
+*/
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::BinarySearchTree(const Compare& comp)
 
-	:rootPtr(new Node<T>(item)) {}
+	:rootPtr(nullptr), comp(comp), threads(1) {}
 
 /*
 * Copy constructor
 * @param bst The other tree to copy
 */
-template<class T>
-BinarySearchTree<T>::BinarySearchTree(const BinarySearchTree<T>& other)
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::BinarySearchTree(const BinarySearchTree<T, Compare>& other)
 
-	:rootPtr(nullptr) {
+	:rootPtr(nullptr), comp(other.comp), threads(1) {
 
 	*this = other;
 }
 
+/*
+* Move constructor, takes the nodes of other in O(1), other is left empty
+* @param other The other tree to move from
+*/
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::BinarySearchTree(BinarySearchTree<T, Compare>&& other) noexcept
+
+	:rootPtr(other.rootPtr), nodes(std::move(other.nodes)), comp(other.comp), threads(other.threads) {
+
+	other.rootPtr = nullptr;
+}
+
 /*
 * Destroys tree and deallocates all dynamic memory
 */
-template<class T>
-BinarySearchTree<T>::~BinarySearchTree() {
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::~BinarySearchTree() {
 
 	this->clear();
 }
@@ -67,14 +109,41 @@ BinarySearchTree<T>::~BinarySearchTree() {
 * @param other The other tree to copy
 * @return this by reference
 */
-template<class T>
-BinarySearchTree<T>& BinarySearchTree<T>::operator=(const BinarySearchTree<T>& other) {
+template<class T, class Compare>
+BinarySearchTree<T, Compare>& BinarySearchTree<T, Compare>::operator=(const BinarySearchTree<T, Compare>& other) {
+
+	if (this != &other) {
+
+		this->clear();
+
+		this->comp = other.comp;
+		this->threads = other.threads;
+
+		this->rootPtr = BinarySearchTree<T, Compare>::copyNode(this->rootPtr, nullptr, other.rootPtr);
+	}
+
+	return *this;
+}
+
+/*
+* Move assignment, clears this and takes the nodes of other in O(1),
+* other is left empty
+* @param other The other tree to move from
+* @return this by reference
+*/
+template<class T, class Compare>
+BinarySearchTree<T, Compare>& BinarySearchTree<T, Compare>::operator=(BinarySearchTree<T, Compare>&& other) noexcept {
 
 	if (this != &other) {
 
 		this->clear();
 
-		this->rootPtr = BinarySearchTree<T>::copyNode(this->rootPtr, nullptr, other.rootPtr);
+		// other gets the slab this kept after clearing
+		std::swap(this->rootPtr, other.rootPtr);
+
+		std::swap(this->nodes, other.nodes);
+		this->comp = other.comp;
+		this->threads = other.threads;
 	}
 
 	return *this;
@@ -84,8 +153,8 @@ BinarySearchTree<T>& BinarySearchTree<T>::operator=(const BinarySearchTree<T>& o
 * Checks if tree is empty
 * @return true if rootPtr == nullptr, false otherwise
 */
-template<class T>
-bool BinarySearchTree<T>::isEmpty() const {
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::isEmpty() const {
 
 	return this->rootPtr == nullptr;
 }
@@ -94,631 +163,2764 @@ bool BinarySearchTree<T>::isEmpty() const {
 * Gets the height of the tree
 * @return the height of the tree
 */
-template<class T>
-int BinarySearchTree<T>::getHeight() const {
+template<class T, class Compare>
+int BinarySearchTree<T, Compare>::getHeight() const {
 
-	return BinarySearchTree<T>::getHeight(this->rootPtr);
+	return BinarySearchTree<T, Compare>::getHeight(this->rootPtr);
 }
 
 /*
 * Gets the amount of nodes in the tree
 * @return the amount of nodes in the tree
 */
-template<class T>
-int BinarySearchTree<T>::getNumberOfNodes() const {
+template<class T, class Compare>
+int BinarySearchTree<T, Compare>::getNumberOfNodes() const {
 
-	return BinarySearchTree<T>::getNodes(this->rootPtr);
+	return static_cast<int>(this->size());
 }
 
 /*
-* Adds a given item to the tree, if not duplicate
-* @param item The item to add
-* @return true if item added, false otherwise
+* Gets the amount of items in the tree in O(1)
+* @return the amount of items in the tree
 */
-template<class T>
-bool BinarySearchTree<T>::add(const T& item) {
+template<class T, class Compare>
+std::size_t BinarySearchTree<T, Compare>::size() const {
 
-	bool added(false);
+	return BinarySearchTree<T, Compare>::sizeOf(this->rootPtr);
+}
 
-	if (!this->contains(item)) {
+/*
+* Gets the k-th smallest item, counting from 0
+* @param k The position of the item in sorted order
+* @return the item at position k by reference
+* @throws std::out_of_range if k >= size()
+*/
+template<class T, class Compare>
+const T& BinarySearchTree<T, Compare>::select(std::size_t k) const {
 
-		this->rootPtr = BinarySearchTree<T>::addNode(this->rootPtr, nullptr, item);
+	if (k >= this->size()) {
 
-		added = true;
+		throw std::out_of_range("BinarySearchTree::select: k >= size()");
 	}
 
-	return added;
+	Node<T>* curr = this->rootPtr;
+
+	while (true) {
+
+		std::size_t leftSize = BinarySearchTree<T, Compare>::sizeOf(curr->getLeft());
+
+		if (k < leftSize) {
+
+			curr = curr->getLeft();
+
+		} else if (k > leftSize) {
+
+			k -= leftSize + 1;
+			curr = curr->getRight();
+
+		} else {
+
+			return curr->getItem();
+		}
+	}
 }
 
 /*
-* Removes a given item from the tree if there
-* @param item The item to remove
-* @return true if item removed, false otherwise
+* Counts the items less than a given item, which is the position
+* item has or would have in sorted order
+* @param item The item to rank
+* @return the number of items less than item
 */
-template <class T>
-bool BinarySearchTree<T>::remove(const T& item) {
+template<class T, class Compare>
+std::size_t BinarySearchTree<T, Compare>::rank(const T& item) const {
 
-	bool removed(false);
+	std::size_t less(0);
 
-	if (this->contains(item)) {
+	Node<T>* curr = this->rootPtr;
 
-		this->rootPtr = BinarySearchTree<T>::removeItem(this->rootPtr, nullptr, item);
+	while (curr != nullptr) {
 
-		removed = true;
-	}
+		if (this->comp.less(curr->getItem(), item)) {
 
+			less += BinarySearchTree<T, Compare>::sizeOf(curr->getLeft()) + 1;
+			curr = curr->getRight();
 
-	return removed;
+		} else {
+
+			curr = curr->getLeft();
+		}
+	}
+
+	return less;
 }
 
 /*
-* Deletes all nodes in the tree
+* Finds the first item not ordered before item in O(height)
+* @param item The item to look for
+* @return iterator at that item, end() if every item is before item
 */
-template<class T>
-void BinarySearchTree<T>::clear() {
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator BinarySearchTree<T, Compare>::lowerBound(const T& item) const {
 
-	this->rootPtr = BinarySearchTree<T>::deleteNodes(this->rootPtr);
+	return Iterator(this->boundNode(item, false), this);
 }
 
 /*
-* Checks for membership of given item
-* @param item The item to check for
-* @return true if tree contains item, false otherwise
+* Finds the first item ordered after item in O(height)
+* @param item The item to look for
+* @return iterator at that item, end() if no item is after item
 */
-template<class T>
-bool BinarySearchTree<T>::contains(const T& item) const {
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator BinarySearchTree<T, Compare>::upperBound(const T& item) const {
 
-	return BinarySearchTree<T>::getNode(this->rootPtr, item) != nullptr;
+	return Iterator(this->boundNode(item, true), this);
 }
 
 /*
-* Prints the tree sideways
+* Finds the last item not ordered after item in O(height)
+* @param item The item to look for
+* @return iterator at that item, end() if every item is after item
 */
-template<class T>
-void BinarySearchTree<T>::displaySideways() const {
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator BinarySearchTree<T, Compare>::floor(const T& item) const {
+
+	Node<T>* candidate = nullptr,
+		   * curr = this->rootPtr;
+
+	while (curr != nullptr) {
+
+		if (this->comp.less(item, curr->getItem())) {
 
-	BinarySearchTree<T>::sideways(this->rootPtr, 0);
+			curr = curr->getLeft();
+
+		} else {
+
+			candidate = curr;
+			curr = curr->getRight();
+		}
+	}
+
+	return Iterator(candidate, this);
 }
 
 /*
-* Inorder traversal: left-root-right
-* The function can modify the data in tree, but the
-* tree structure is not changed
-* @param visit The function to visit on each node
+* Finds the first item not ordered before item, the same item as
+* lowerBound, named to go with floor
+* @param item The item to look for
+* @return iterator at that item, end() if every item is before item
 */
-template<class T>
-void BinarySearchTree<T>::inorderTraverse(void visit(T& item)) const {
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator BinarySearchTree<T, Compare>::ceiling(const T& item) const {
 
-	BinarySearchTree<T>::inorder(this->rootPtr, visit);
+	return this->lowerBound(item);
 }
 
 /*
-* Creates a dynamic array, copies all items to the array
-* and then reads the array to re-balance this tree
+* Gets the items in [low, high) to iterate over, O(height) to make
+* @param low The first item of the range, included
+* @param high The end of the range, not included
+* @return the range, empty if high is not after low
 */
-template<class T>
-void BinarySearchTree<T>::rebalance() {
-
-	int n(this->getNumberOfNodes());
-
-	T* arr = new T[n];
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Range BinarySearchTree<T, Compare>::range(const T& low, const T& high) const {
 
-	int index(0);
+	if (!this->comp.less(low, high)) {
 
-	BinarySearchTree<T>::toArray(arr, this->rootPtr, &index);
-
-	this->readTree(arr, n);
+		return Range(this->end(), this->end());
+	}
 
-	delete[] arr;
+	return Range(this->lowerBound(low), this->lowerBound(high));
 }
 
 /*
-* Clears the tree and then uses the given array of length n
-* to create this tree with items from the array at minimum height
-* Assumes array is sorted
-* @param arr The given array of elements
-* @param n The size of the array
-* @return true
+* Counts the items in [low, high) in O(height) by ranking both ends,
+* without visiting the items
+* @param low The first item of the range, included
+* @param high The end of the range, not included
+* @return the number of items in the range, 0 if high is not after low
 */
-template<class T>
-bool BinarySearchTree<T>::readTree(const T arr[], int n) {
+template<class T, class Compare>
+std::size_t BinarySearchTree<T, Compare>::countRange(const T& low, const T& high) const {
 
-	bool read(false);
+	if (!this->comp.less(low, high)) {
 
-	if (n > 0) {
+		return 0;
+	}
 
-		this->clear();
+	return this->rank(high) - this->rank(low);
+}
 
-		BinarySearchTree<T>::readHelper(arr, 0, n - 1);
+/*
+* Adds a given item to the tree, if not duplicate
+* @param item The item to add
+* @return true if item added, false otherwise
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::add(const T& item) {
 
-		read = true;
-	}
+	std::pair<Node<T>*, bool> added = this->insertUnique(item);
 
-	return read;
+	this->afterInsert(added.first, added.second);
+
+	return added.second;
 }
 
 /*
-* Equality operator overload
-* @param other The other tree to compare to
-* @return true if all nodes have same value, false otherwise
+* Adds a given item to the tree, if not duplicate, moving it into
+* its node. A duplicate is left as it was.
+* @param item The item to add
+* @return true if item added, false otherwise
 */
-template<class T>
-bool BinarySearchTree<T>::operator==(const BinarySearchTree<T>& other) const {
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::add(T&& item) {
+
+	std::pair<Node<T>*, bool> added = this->insertUnique(std::move(item));
 
-	return BinarySearchTree<T>::equalNode(this->rootPtr, other.rootPtr);
+	this->afterInsert(added.first, added.second);
+
+	return added.second;
 }
 
 /*
-* Inequality operator overload
-* @param other The other tree to compare to
-* @return true if nodes have different value or structure, false otherwise
+* Constructs an item from the arguments and adds it, if not duplicate,
+* moving it into its node
+* @param args The arguments for the item's constructor
+* @return true if item added, false otherwise
 */
-template<class T>
-bool BinarySearchTree<T>::operator!=(const BinarySearchTree<T>& other) const {
+template<class T, class Compare>
+template<class... Args>
+bool BinarySearchTree<T, Compare>::emplace(Args&&... args) {
 
-	return !(*this == other);
+	// the item is needed to find its place before a node can be made
+	return this->add(T(std::forward<Args>(args)...));
 }
 
 /*
-* Get cousins of Node with item
+* Removes a given item from the tree if there
+* @param item The item to remove
+* @return true if item removed, false otherwise
 */
-template<class T>
-std::vector<T> BinarySearchTree<T>::getCousins(const T& item) const {
-
-	std::vector<T> vec;
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::remove(const T& item) {
 
-	Node<T>* curr = BinarySearchTree<T>::getNode(this->rootPtr, item);
+	bool removed(false);
 
-	if (curr != nullptr && curr->getParent() != nullptr && curr->getParent()->getParent() != nullptr) {
-	
-		Node<T>* grandpa = curr->getParent()->getParent();
+	Node<T>* node = this->getNode(this->rootPtr, item);
 
-		Node<T>* uncle = (curr->getParent() != grandpa->getLeft()) ? grandpa->getLeft() : grandpa->getRight();
+	if (node != nullptr) {
 
-		if (uncle->getLeft() != nullptr) {
-			
-			vec.push_back(uncle->getLeft()->getItem());
-		}
-		if (uncle->getRight() != nullptr) {
+		this->removeNode(node);
 
-			vec.push_back(uncle->getRight()->getItem());
-		}
+		removed = true;
 	}
 
-	return vec;
+	return removed;
 }
 
 /*
-* Height is defined by number of nodes to leaf.
-* Height is zero if the item is not found.
-* @param item The item in the Node to get the height of
-* @return height of Node that stores item
+* Removes a given item from the tree if there, moving it into a handle
+* @param item The item to extract
+* @return the handle with the item, empty if item was not in the tree
 */
-template<class T>
-int BinarySearchTree<T>::getHeight(const T& item) const {
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::NodeHandle BinarySearchTree<T, Compare>::extract(const T& item) {
 
-	Node<T>* curr = BinarySearchTree::getNode(this->rootPtr, item);
+	Node<T>* node = this->getNode(this->rootPtr, item);
 
-	return this->getHeight(curr);
-}
+	if (node == nullptr) {
 
-/*
-* Mystery quiz question
-* @return mystery number
-*/
-template<class T>
-int BinarySearchTree<T>::mystery() const {
+		return NodeHandle();
+	}
 
-	int n(0);
+	NodeHandle handle(std::move(node->getItem()));
 
-	return BinarySearchTree::helper(this->rootPtr, n);
+	this->removeNode(node);
+
+	return handle;
 }
 
 /*
-* Helper function for readTree, recursively adds each item
-* in the array by finding the middle item for the next node
-* @param arr The array of items
-* @param first The first index to use in the array/subarray
-* @param last  The  last index to use in the array/subarray
+* Adds the item of a handle, if not duplicate, moving it into its
+* node and leaving the handle empty. A duplicate stays in the handle.
+* @param handle The handle, possibly empty
+* @return true if item added, false if duplicate or handle empty
 */
-template<class T>
-void BinarySearchTree<T>::readHelper(const T arr[], int first, int last) {
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::insert(NodeHandle&& handle) {
 
-	if (first <= last) {
+	if (handle.empty() || !this->add(std::move(*handle.item))) {
 
-		int mid = (first + last) / 2;
+		return false;
+	}
 
-		this->add(arr[mid]);
+	handle.item.reset();
 
-		this->readHelper(arr, first, mid - 1);
-		this->readHelper(arr, mid + 1, last);
-	}
+	return true;
 }
 
 /*
-* Static helper function for add, adds new node in the tree
-* @param curr The current node in the tree
-* @param item  The item to add in a new node
-* @return the current node after the new node is added
+* Adds every item of other not already in the tree. This tree is split
+* by the item at the root of other, each half is merged with one of
+* its subtrees (on two threads when large, see useThreads) and the
+* halves are joined back, O(m log(n/m + 1)) for an AVLTree or a
+* RedBlackTree of n items and m items in other. When other has at
+* most three quarters as many items (UNION_BY_ADD_PERCENT) they are
+* added in order instead, which keeps the paths walked in cache and
+* beats the splits and joins. If copying T can throw, every item of
+* other is copied before the tree is touched and an add that throws
+* takes back the items added before it, so the tree is left as it
+* was. Otherwise only the items missing here are copied.
+* @param other The tree whose items are added, of any kind
 */
-template<class T>
-Node<T>* BinarySearchTree<T>::addNode(Node<T>* curr, Node<T>* parent, const T& item) {
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::unionWith(const BinarySearchTree<T, Compare>& other) {
 
-	if (curr == nullptr) {
+	if (this == &other || other.rootPtr == nullptr) {
 
-		curr = new Node<T>(item);
-		curr->setParent(parent);
+		return;
+	}
 
-	} else if (curr->getItem() < item) {
+	std::size_t m = other.size();
 
-		Node<T>* right = curr->getRight();
-		right = BinarySearchTree<T>::addNode(right, curr, item);
-		curr->setRight(right);
+	if (m * 100 <= this->size() * BinarySearchTree<T, Compare>::UNION_BY_ADD_PERCENT) {
 
-	} else {
+		std::vector<const T*> added;
 
-		Node<T>* left = curr->getLeft();
-		left = BinarySearchTree<T>::addNode(left, curr, item);
-		curr->setLeft(left);
-	}
+		if (!std::is_nothrow_copy_constructible<T>::value) {
 
-	return curr;
-}
+			added.reserve(m);
+		}
 
-/*
-* Static helper function
-* Finds the node in the tree with the target item
-* @param curr The current node in the tree
-* @param target The target item
-* @return pointer to node with target item or nullptr if item not in tree
-*/
-template<class T>
-Node<T>* BinarySearchTree<T>::getNode(Node<T>* curr,
-											const T& target) {
+		try {
 
-	if (curr != nullptr && curr->getItem() != target) {
+			for (const T& item : other) {
 
-		if (curr->getItem() < target) {
+				if (this->add(item) && !std::is_nothrow_copy_constructible<T>::value) {
 
-			Node<T>* right = curr->getRight();
-			curr = BinarySearchTree<T>::getNode(right, target);
+					added.push_back(&item);
+				}
+			}
 
-		} else {
+		} catch (...) {
 
-			Node<T>* left = curr->getLeft();
-			curr = BinarySearchTree<T>::getNode(left, target);
+			for (const T* item : added) {
+
+				this->remove(*item);
+			}
+
+			throw;
 		}
+
+		return;
 	}
 
-	return curr;
-}
+	std::vector<unsigned char> found(m, 0);
+	std::vector<Node<T>*> built;
 
-/*
-* Static helper function for displaySideways
-* @param curr The current node in the tree
-* @param level The current level in the tree
-*/
-template<class T>
-void BinarySearchTree<T>::sideways(Node<T>* curr, int level) {
+	if (!std::is_nothrow_copy_constructible<T>::value) {
 
-	if (curr != NULL) {
+		built.reserve(m);
+	}
 
-		++level;
+	void* run = this->takeRun(m);
 
-		BinarySearchTree<T>::sideways(curr->getRight(), level);
+	if (!std::is_nothrow_copy_constructible<T>::value) {
 
-		for (int i(level); i >= 0; --i) {
+		try {
 
-			std::cout << "    ";
+			for (const T& item : other) {
+
+				built.push_back(this->createNodeAt(run, built.size(), item));
+			}
+
+		} catch (...) {
+
+			for (Node<T>* node : built) {
+
+				this->destroyNode(node);
+			}
+
+			for (std::size_t i(built.size()); i < m; ++i) {
+
+				this->recycleAt(run, i);
+			}
+
+			throw;
 		}
+	}
 
-		std::cout << curr->getItem() << std::endl;
+	Node<T>* root = this->rootPtr;
+	this->rootPtr = nullptr;
+
+	this->setRoot(this->unionParallel({root, this->rankOf(root)}, other.rootPtr, run,
+	                                  built.empty() ? nullptr : built.data(), found.data(), 0, this->threads).root);
+
+	for (std::size_t i(0); i < m; ++i) {
+
+		if (found[i] && built.empty()) {
+
+			this->recycleAt(run, i);
+
+		} else if (found[i]) {
 
-		BinarySearchTree<T>::sideways(curr->getLeft(), level);
+			this->destroyNode(built[i]);
+		}
 	}
 }
 
 /*
-* Static helper function for clear
-* Deletes a nodes children and then deletes node (postorder traversal)
-* @param curr The current node in the tree
-* @return nullptr after all nodes deleted
+* Removes every item not in other, splitting and joining like unionWith.
+* The nodes left out are destroyed once the threads are done.
+* @param other The tree whose items are kept, of any kind
 */
-template<class T>
-Node<T>* BinarySearchTree<T>::deleteNodes(Node<T>* curr) {
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::intersect(const BinarySearchTree<T, Compare>& other) {
 
-	if (curr != nullptr) {
+	if (this == &other) {
+
+		return;
+	}
 
-		if (!curr->isLeaf()) {
+	std::vector<Node<T>*> dropped;
 
-			Node<T>* left  = curr->getLeft(),
-						 * right = curr->getRight();
+	Node<T>* root = this->rootPtr;
+	this->rootPtr = nullptr;
 
-			left  = BinarySearchTree<T>::deleteNodes(left);
-			right = BinarySearchTree<T>::deleteNodes(right);
+	this->setRoot(this->intersectParallel({root, this->rankOf(root)}, other.rootPtr, dropped, this->threads).root);
 
-			curr->setLeft(left);
-			curr->setRight(right);
-		}
+	for (Node<T>* node : dropped) {
 
-		delete curr;
-		curr = nullptr;
+		this->destroyNodes(node);
 	}
-
-	return curr;
 }
 
 /*
-* Static helper function for remove, deletes and replaces it with nullptr
-* or node to retain BST properties
-* @param curr The current node in the tree
-* @return curr after node has been deleted
+* Removes every item in other, splitting and joining like unionWith.
+* The nodes left out are destroyed once the threads are done.
+* @param other The tree whose items are removed, of any kind
 */
-template<class T>
-Node<T>* BinarySearchTree<T>::removeItem(Node<T>* curr, Node<T>* parent, const T& target) {
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::difference(const BinarySearchTree<T, Compare>& other) {
 
-	if (curr->getItem() == target) {
+	if (this == &other) {
 
-		curr = BinarySearchTree<T>::removeNode(curr, parent);
+		this->clear();
 
-	} else if (curr->getItem() < target) {
+		return;
+	}
 
-		Node<T>* right = curr->getRight();
-		right = BinarySearchTree<T>::removeItem(right, curr, target);
-		curr->setRight(right);
+	std::vector<Node<T>*> dropped;
 
-	} else {
+	Node<T>* root = this->rootPtr;
+	this->rootPtr = nullptr;
 
-		Node<T>* left = curr->getLeft();
-		left = BinarySearchTree<T>::removeItem(left, curr, target);
-		curr->setLeft(left);
-	}
+	this->setRoot(this->differenceParallel({root, this->rankOf(root)}, other.rootPtr, dropped, this->threads).root);
 
-	return curr;
+	for (Node<T>* node : dropped) {
+
+		this->destroyNodes(node);
+	}
 }
 
 /*
-* Static helper function for removeItem, deletes curr and returns nullptr,
-* curr's child or curr's inorder successor to take its place
-* @param curr The current node in the tree
-* @return curr after node has been deleted and replaced
+* Removes the items in [low, high): the tree is split at both ends,
+* the middle is destroyed node by node without searching for its
+* items and the two sides are joined, O(log n + k) for k items
+* when joinNodes balances (AVLTree, RedBlackTree)
+* @param low The first item to remove
+* @param high The end of the range, not removed
+* @return the number of items removed, 0 if high is not after low
 */
-template<class T>
-Node<T>* BinarySearchTree<T>::removeNode(Node<T>* curr, Node<T>* parent) {
+template<class T, class Compare>
+std::size_t BinarySearchTree<T, Compare>::eraseRange(const T& low, const T& high) {
 
-	if (!BinarySearchTree<T>::hasTwoChild(curr)) {
+	if (this->rootPtr == nullptr || !this->comp.less(low, high)) {
 
-		Node<T>* temp = curr;
-		
-		if (curr->isLeaf()) {
-			
-			curr = nullptr;
+		return 0;
+	}
 
-		} else {
+	Node<T>* root = this->rootPtr,
+		   * first,
+		   * last;
 
-			curr = BinarySearchTree<T>::only(curr);
+	Subtree lower, middle, upper;
 
-			curr->setParent(parent);
-		}
+	this->rootPtr = nullptr;
 
-		delete temp;
+	// the node equivalent to low is the first of the range and the
+	// one equivalent to high the first after it
+	this->splitNodes({root, this->rankOf(root)}, low, lower, first, middle);
+	this->splitNodes(middle, high, middle, last, upper);
 
-	} else {
+	if (last != nullptr) {
+
+		upper = this->joinNodes({nullptr, 0}, last, upper);
+	}
 
-		T inorderSuccesor;
+	std::size_t erased = BinarySearchTree<T, Compare>::sizeOf(middle.root);
 
-		Node<T>* right = curr->getRight();
-		right = BinarySearchTree<T>::removeLeftMost(right, parent, &inorderSuccesor);
+	if (first != nullptr) {
 
-		curr->setRight(right);
-		curr->setItem(inorderSuccesor);
+		this->destroyNode(first);
+
+		++erased;
 	}
 
-	return curr;
+	this->destroyNodes(middle.root);
+
+	this->setRoot(this->concatNodes(lower, upper).root);
+
+	return erased;
 }
 
 /*
-* Static helper function for removeNode, gets the inorderSuccesor item
-* to replace in node and deletes inorderSuccesor node
-* @param curr The current node in the tree
-* @param newItem The new item for the node
+* Deletes all nodes in the tree
 */
-template<class T>
-Node<T>* BinarySearchTree<T>::removeLeftMost(Node<T>* curr, Node<T>* parent, T* newItem) {
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::clear() {
 
-	if (curr->getLeft() == nullptr) {
+	if (this->nodesShared()) {
 
-		*newItem = curr->getItem();
+		// releasing a shared arena only lets go of it, the slots go
+		// back to its free list one by one or they are lost
+		this->destroyNodes(this->rootPtr);
 
-		curr = BinarySearchTree<T>::removeNode(curr, parent);
+		this->rootPtr = nullptr;
 
 	} else {
 
-		Node<T>* left = curr->getLeft();
-		left = BinarySearchTree<T>::removeLeftMost(left, curr, newItem);
-		curr->setLeft(left);
+		this->rootPtr = this->deleteNodes(this->rootPtr);
 	}
 
-	return curr;
+	this->releaseNodes();
 }
 
 /*
-* Static helper function for removeNode to check
-* if curr has both children
-* @param curr The current node in the tree
-* @return true if has both children, false otherwise
+* Makes room for n more nodes so adding them does not allocate
+* @param n The number of nodes to make room for
 */
-template <class T>
-bool BinarySearchTree<T>::hasTwoChild(Node<T>* curr) {
-	
-	return curr->getLeft()  != nullptr &&
-		   curr->getRight() != nullptr;
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::reserve(std::size_t n) {
+
+	this->plainNodes().reserve(n);
 }
 
 /*
-* Static helper function for removeNode to get only child of curr
-* @param curr The current node in the tree
-* @return the only child of curr
+* Turns huge page backing of the node arena on or off,
+* affects memory allocated from now on
+* @param enable true to use huge pages
 */
-template<class T>
-Node<T>* BinarySearchTree<T>::only(Node<T>* curr) {
-
-	Node<T>* left  = curr->getLeft(),
-				 * right = curr->getRight();
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::useHugePages(bool enable) {
 
-	return (left != nullptr) ? left : right;
+	this->plainNodes().setHugePages(enable);
 }
 
 /*
-* Static helper function for assingment operator overload,
-* copies a given node and all its children (preorder traversal)
-* @param curr The current node in the first tree
-* @param other the current node in the other tree to copy
-* @return curr after all nodes have been copied
+* Gets the number of bytes held by the node arena, including
+* what trees sharing it (after a split) hold
+* @return bytes held by the arena
 */
-template<class T>
-Node<T>* BinarySearchTree<T>::copyNode(Node<T>* curr, Node<T>* currParent, Node<T>* other) {
-
-	if (other != nullptr) {
+template<class T, class Compare>
+std::size_t BinarySearchTree<T, Compare>::bytesReserved() const {
 
-		curr = new Node<T>(other->getItem());
+	return this->nodes ? this->nodes->bytesReserved() : 0;
+}
 
-		Node<T>* left = other->getLeft(),
-			   * right = other->getRight();
+/*
+* Sets how many threads readTree, rebalance and the set operations
+* may use for large trees, 1 (the default) keeps them serial
+* @param threads The number of threads, 0 for one per hardware thread
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::useThreads(unsigned threads) {
 
-		left  = BinarySearchTree<T>::copyNode(nullptr, curr, left);
-		right = BinarySearchTree<T>::copyNode(nullptr, curr, right);
+	if (threads == 0) {
 
-		curr->setLeft(left);
-		curr->setRight(right);
-		curr->setParent(currParent);
+		threads = std::thread::hardware_concurrency();
 	}
 
-	return curr;
+	this->threads = (threads > 0) ? threads : 1;
 }
 
 /*
-* Static helper function for equality operator overload, compares nodes for
-* equal items
-* @param curr The current node in the first tree
-* @param other The current node in the second tree
+* Checks for membership of given item
+* @param item The item to check for
+* @return true if tree contains item, false otherwise
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::contains(const T& item) const {
+
+	return this->getNode(this->rootPtr, item) != nullptr;
+}
+
+/*
+* Checks for membership of a key of another type, only available when
+* Compare is transparent (has is_transparent), no item is constructed
+* @param key The key to check for
+* @return true if tree contains an item equivalent to key
+*/
+template<class T, class Compare>
+template<class K, class C, class>
+bool BinarySearchTree<T, Compare>::contains(const K& key) const {
+
+	return this->getNode(this->rootPtr, key) != nullptr;
+}
+
+/*
+* Checks for membership of many items, BATCH_LOOKUPS searches at a
+* time taking one step each in turn (see searchBatch), so the cache
+* misses of different searches overlap.
+* @param keys The items to check for
+* @param count The number of items
+* @param found Set to whether the tree contains each item
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::containsBatch(const T* keys, std::size_t count, bool* found) const {
+
+	this->searchBatch(keys, count, [found](std::size_t i, Node<T>* node) {
+
+		found[i] = node != nullptr;
+	});
+}
+
+/*
+* Finds many items, searching like containsBatch
+* @param keys The items to find
+* @param count The number of items
+* @param found Set to an iterator at each item, end() if not in the tree
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::findBatch(const T* keys, std::size_t count, Iterator* found) const {
+
+	this->searchBatch(keys, count, [this, found](std::size_t i, Node<T>* node) {
+
+		found[i] = Iterator(node, this);
+	});
+}
+
+/*
+* Prints the tree sideways
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::displaySideways() const {
+
+	BinarySearchTree<T, Compare>::sideways(this->rootPtr, 0);
+}
+
+/*
+* Inorder traversal: left-root-right
+* The function can modify the data in tree, but the
+* tree structure is not changed
+* Items are passed by reference, never copied
+* @param visit The function to visit on each node
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::inorderTraverse(void visit(T& item)) const {
+
+	BinarySearchTree<T, Compare>::inorder(this->rootPtr, visit);
+}
+
+/*
+* Gets an iterator at the smallest item
+* @return iterator at the first item, end() if empty
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator BinarySearchTree<T, Compare>::begin() const {
+
+	Node<T>* first = (this->rootPtr != nullptr) ? BinarySearchTree<T, Compare>::leftMost(this->rootPtr)
+	                                            : nullptr;
+
+	return Iterator(first, this);
+}
+
+/*
+* Gets the iterator past the largest item
+* @return the end iterator
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator BinarySearchTree<T, Compare>::end() const {
+
+	return Iterator(nullptr, this);
+}
+
+/*
+* Gets a reverse iterator at the largest item
+* @return reverse iterator at the last item
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::reverse_iterator BinarySearchTree<T, Compare>::rbegin() const {
+
+	return reverse_iterator(this->end());
+}
+
+/*
+* Gets the reverse iterator past the smallest item
+* @return the reverse end iterator
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::reverse_iterator BinarySearchTree<T, Compare>::rend() const {
+
+	return reverse_iterator(this->begin());
+}
+
+/*
+* Makes an immutable snapshot of the items in O(n), stored without
+* nodes for branch free searches (see frozentree.h). Later changes
+* to the tree do not show in the snapshot.
+* @return the snapshot
+*/
+template<class T, class Compare>
+FrozenTree<T, Compare> BinarySearchTree<T, Compare>::freeze() const {
+
+	return FrozenTree<T, Compare>(this->begin(), this->size(), this->comp.get());
+}
+
+/*
+* Relinks the existing nodes into a tree of minimum height in O(n)
+* time and O(1) extra memory (Day-Stout-Warren), no item is copied
+* and no node is allocated or freed. With useThreads and a large tree
+* the nodes are gathered into an array of n pointers and relinked
+* on several threads instead.
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::rebalance() {
+
+	std::size_t n(this->size());
+
+	if (this->threads > 1 && n >= 2 * PARALLEL_GRAIN) {
+
+		std::vector<Node<T>*> order(n);
+
+		BinarySearchTree<T, Compare>::gatherParallel(this->rootPtr, order.data(), 0, this->threads);
+
+		this->rootPtr = this->linkParallel(order.data(), 0, n, this->threads);
+		this->rootPtr->setParent(nullptr);
+
+		this->fixTree();
+
+		return;
+	}
+
+	this->treeToVine();
+
+	// nodes in the largest perfect tree that fits, the rest
+	// form the partial bottom level
+	std::size_t perfect(1);
+
+	while (perfect <= n) {
+
+		perfect = 2 * perfect + 1;
+	}
+
+	perfect /= 2;
+
+	this->compress(n - perfect);
+
+	while (perfect > 1) {
+
+		perfect /= 2;
+
+		this->compress(perfect);
+	}
+
+	this->fixTree();
+}
+
+/*
+* Clears the tree and then uses the given array of length n
+* to create this tree with items from the array at minimum height
+* Assumes array is sorted
+* @param arr The given array of elements
+* @param n The size of the array
+* @return true
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::readTree(const T arr[], int n) {
+
+	return n > 0 && this->readTree(arr, arr + n);
+}
+
+/*
+* Clears the tree and builds it at minimum height from the items in
+* [first, last) in O(n), each item is read once and linked bottom up.
+* Use std::make_move_iterator to move the items instead of copying.
+* With useThreads and a large random access range the subtrees are
+* built on several threads.
+* @param first Forward iterator to the first item
+* @param last Iterator past the last item
+* @param sorted true if the items are sorted without duplicates,
+*        false to sort them and drop duplicates first
+* @return true if the range was not empty
+*/
+template<class T, class Compare>
+template<class It>
+bool BinarySearchTree<T, Compare>::readTree(It first, It last, bool sorted) {
+
+	if (!sorted) {
+
+		return this->readTree(std::vector<T>(first, last), false);
+	}
+
+	std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+
+	bool read(false);
+
+	if (n > 0) {
+
+		this->clear();
+
+		if constexpr (std::is_base_of<std::random_access_iterator_tag,
+		              typename std::iterator_traits<It>::iterator_category>::value) {
+
+			if (this->threads > 1 && n >= 2 * PARALLEL_GRAIN) {
+
+				void* run = this->takeRun(n);
+
+				this->rootPtr = this->readParallel(first, run, 0, n, this->threads);
+
+				this->fixTree();
+
+				return true;
+			}
+		}
+
+		this->reserve(n);
+
+		this->rootPtr = this->readHelper(first, n);
+
+		this->fixTree();
+
+		read = true;
+	}
+
+	return read;
+}
+
+/*
+* Clears the tree and builds it at minimum height in O(n),
+* moving the items out of a vector
+* @param items The items, left in a valid but unspecified state
+* @param sorted true if the items are sorted without duplicates,
+*        false to sort them and drop duplicates first
+* @return true if items was not empty
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::readTree(std::vector<T>&& items, bool sorted) {
+
+	if (!sorted) {
+
+		const KeyCompare<Compare>& comp = this->comp;
+
+		this->sortParallel(items.begin(), items.end(), this->threads);
+
+		items.erase(std::unique(items.begin(), items.end(), [&comp](const T& a, const T& b) {
+
+			return comp.equivalent(a, b);
+
+		}), items.end());
+	}
+
+	return this->readTree(std::make_move_iterator(items.begin()),
+	                      std::make_move_iterator(items.end()));
+}
+
+/*
+* Equality operator overload
+* @param other The other tree to compare to
+* @return true if all nodes have same value, false otherwise
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::operator==(const BinarySearchTree<T, Compare>& other) const {
+
+	return this->equalNode(this->rootPtr, other.rootPtr);
+}
+
+/*
+* Inequality operator overload
+* @param other The other tree to compare to
+* @return true if nodes have different value or structure, false otherwise
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::operator!=(const BinarySearchTree<T, Compare>& other) const {
+
+	return !(*this == other);
+}
+
+/*
+* Get cousins of Node with item
+*/
+template<class T, class Compare>
+std::vector<T> BinarySearchTree<T, Compare>::getCousins(const T& item) const {
+
+	std::vector<T> vec;
+
+	Node<T>* curr = this->getNode(this->rootPtr, item);
+
+	if (curr != nullptr && curr->getParent() != nullptr && curr->getParent()->getParent() != nullptr) {
+	
+		Node<T>* grandpa = curr->getParent()->getParent();
+
+		Node<T>* uncle = (curr->getParent() != grandpa->getLeft()) ? grandpa->getLeft() : grandpa->getRight();
+
+		if (uncle->getLeft() != nullptr) {
+			
+			vec.push_back(uncle->getLeft()->getItem());
+		}
+		if (uncle->getRight() != nullptr) {
+
+			vec.push_back(uncle->getRight()->getItem());
+		}
+	}
+
+	return vec;
+}
+
+/*
+* Height is defined by number of nodes to leaf.
+* Height is zero if the item is not found.
+* @param item The item in the Node to get the height of
+* @return height of Node that stores item
+*/
+template<class T, class Compare>
+int BinarySearchTree<T, Compare>::getHeight(const T& item) const {
+
+	Node<T>* curr = this->getNode(this->rootPtr, item);
+
+	return this->getHeight(curr);
+}
+
+/*
+* Mystery quiz question
+* @return mystery number
+*/
+template<class T, class Compare>
+int BinarySearchTree<T, Compare>::mystery() const {
+
+	int n(0);
+
+	return BinarySearchTree::helper(this->rootPtr, n);
+}
+
+/*
+* Helper function for readTree, builds a subtree of n nodes taking
+* the items in order from next: the left subtree, then the node,
+* then the right subtree. Nodes end up in memory in sorted order.
+* @param next Iterator to the next unused item, advanced by n
+* @param n The number of nodes in the subtree
+* @return the root of the subtree
+*/
+template<class T, class Compare>
+template<class It>
+Node<T>* BinarySearchTree<T, Compare>::readHelper(It& next, std::size_t n) {
+
+	Node<T>* curr = nullptr;
+
+	if (n > 0) {
+
+		std::size_t leftNodes = (n - 1) / 2;
+
+		Node<T>* left = this->readHelper(next, leftNodes);
+
+		curr = this->createNode(*next);
+		++next;
+
+		Node<T>* right = this->readHelper(next, n - 1 - leftNodes);
+
+		curr->setLeft(left);
+		curr->setRight(right);
+
+		if (left != nullptr) {
+
+			left->setParent(curr);
+		}
+		if (right != nullptr) {
+
+			right->setParent(curr);
+		}
+
+		this->fixNode(curr);
+	}
+
+	return curr;
+}
+
+/*
+* Helper function for readTree, builds the subtree for items
+* [first, first + n) of a random access range into a run of nodes,
+* splitting the left and right halves across tasks threads
+* @param items The whole sorted range
+* @param run The storage for all nodes, node i holds items[i]
+* @param first The index of the first item of the subtree
+* @param n The number of nodes in the subtree
+* @param tasks The number of threads this subtree may use
+* @return the root of the subtree
+*/
+template<class T, class Compare>
+template<class It>
+Node<T>* BinarySearchTree<T, Compare>::readParallel(It items, void* run, std::size_t first,
+                                                    std::size_t n, unsigned tasks) {
+
+	Node<T>* curr = nullptr;
+
+	if (n > 0) {
+
+		std::size_t leftNodes = (n - 1) / 2;
+		std::size_t mid = first + leftNodes;
+
+		Node<T>* left;
+		Node<T>* right;
+
+		if (tasks > 1 && n >= 2 * PARALLEL_GRAIN) {
+
+			std::future<Node<T>*> leftTask = std::async(std::launch::async,
+			                                            &BinarySearchTree<T, Compare>::template readParallel<It>,
+			                                            this, items, run, first, leftNodes, tasks / 2);
+
+			right = this->readParallel(items, run, mid + 1, n - 1 - leftNodes, tasks - tasks / 2);
+			left = leftTask.get();
+
+		} else {
+
+			left = this->readParallel(items, run, first, leftNodes, 1);
+			right = this->readParallel(items, run, mid + 1, n - 1 - leftNodes, 1);
+		}
+
+		curr = this->createNodeAt(run, mid, *(items + mid));
+
+		curr->setLeft(left);
+		curr->setRight(right);
+
+		if (left != nullptr) {
+
+			left->setParent(curr);
+		}
+		if (right != nullptr) {
+
+			right->setParent(curr);
+		}
+
+		this->fixNode(curr);
+	}
+
+	return curr;
+}
+
+/*
+* Helper function for rebalance, relinks the nodes order[first, first + n)
+* into a subtree of minimum height, splitting across tasks threads
+* @param order All nodes in sorted order
+* @param first The index of the first node of the subtree
+* @param n The number of nodes in the subtree
+* @param tasks The number of threads this subtree may use
+* @return the root of the subtree
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::linkParallel(Node<T>** order, std::size_t first,
+                                                    std::size_t n, unsigned tasks) {
+
+	Node<T>* curr = nullptr;
+
+	if (n > 0) {
+
+		std::size_t leftNodes = (n - 1) / 2;
+		std::size_t mid = first + leftNodes;
+
+		Node<T>* left;
+		Node<T>* right;
+
+		if (tasks > 1 && n >= 2 * PARALLEL_GRAIN) {
+
+			std::future<Node<T>*> leftTask = std::async(std::launch::async,
+			                                            &BinarySearchTree<T, Compare>::linkParallel,
+			                                            this, order, first, leftNodes, tasks / 2);
+
+			right = this->linkParallel(order, mid + 1, n - 1 - leftNodes, tasks - tasks / 2);
+			left = leftTask.get();
+
+		} else {
+
+			left = this->linkParallel(order, first, leftNodes, 1);
+			right = this->linkParallel(order, mid + 1, n - 1 - leftNodes, 1);
+		}
+
+		curr = order[mid];
+
+		curr->setLeft(left);
+		curr->setRight(right);
+
+		if (left != nullptr) {
+
+			left->setParent(curr);
+		}
+		if (right != nullptr) {
+
+			right->setParent(curr);
+		}
+
+		this->fixNode(curr);
+	}
+
+	return curr;
+}
+
+/*
+* Static helper function for rebalance, writes the nodes under curr
+* in sorted order to order[first, first + size), walking subtrees on
+* up to tasks threads
+* @param curr The root of the subtree
+* @param order The array of all nodes
+* @param first The index of curr's leftmost node
+* @param tasks The number of threads this subtree may use
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::gatherParallel(Node<T>* curr, Node<T>** order,
+                                                  std::size_t first, unsigned tasks) {
+
+	if (curr == nullptr) {
+
+		return;
+	}
+
+	if (tasks > 1 && curr->getSize() >= 2 * PARALLEL_GRAIN) {
+
+		std::size_t leftSize = BinarySearchTree<T, Compare>::sizeOf(curr->getLeft());
+
+		order[first + leftSize] = curr;
+
+		std::future<void> leftTask = std::async(std::launch::async,
+		                                        &BinarySearchTree<T, Compare>::gatherParallel,
+		                                        curr->getLeft(), order, first, tasks / 2);
+
+		BinarySearchTree<T, Compare>::gatherParallel(curr->getRight(), order,
+		                                             first + leftSize + 1, tasks - tasks / 2);
+		leftTask.get();
+
+	} else {
+
+		std::size_t n = curr->getSize();
+
+		Node<T>* node = BinarySearchTree<T, Compare>::leftMost(curr);
+
+		for (std::size_t i(0); i < n; ++i) {
+
+			order[first + i] = node;
+
+			if (i + 1 < n) {
+
+				node = BinarySearchTree<T, Compare>::successor(node);
+			}
+		}
+	}
+}
+
+/*
+* Helper function for readTree, sorts items with the tree's
+* comparator splitting the work across tasks threads
+* @param first The first item
+* @param last Past the last item
+* @param tasks The number of threads to use
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::sortParallel(typename std::vector<T>::iterator first,
+                                                typename std::vector<T>::iterator last,
+                                                unsigned tasks) const {
+
+	const KeyCompare<Compare>& comp = this->comp;
+
+	auto less = [&comp](const T& a, const T& b) {
+
+		return comp.less(a, b);
+	};
+
+	if (tasks > 1 && static_cast<std::size_t>(last - first) >= 2 * PARALLEL_GRAIN) {
+
+		typename std::vector<T>::iterator mid = first + (last - first) / 2;
+
+		std::future<void> leftTask = std::async(std::launch::async,
+		                                        &BinarySearchTree<T, Compare>::sortParallel,
+		                                        this, first, mid, tasks / 2);
+
+		this->sortParallel(mid, last, tasks - tasks / 2);
+		leftTask.get();
+
+		std::inplace_merge(first, mid, last, less);
+
+	} else {
+
+		std::sort(first, last, less);
+	}
+}
+
+/*
+* Helper function for unionWith, merges the items under other into
+* the nodes under curr, splitting across tasks threads. The node for
+* an item missing under curr is slot first + rank of the item under
+* other of run, built already if built is not nullptr, the slots of
+* items found are flagged in found. If a thread cannot be started
+* the work stays on this one, so nothing here throws when copying T
+* cannot.
+* @param curr The subtree of this tree, its root possibly nullptr
+* @param other The root of the subtree of the other tree, possibly nullptr
+* @param run Storage for a node per item of the other tree
+* @param built The nodes of the run in order, or nullptr to build them here
+* @param found A flag per slot of the run, set for the items found
+* @param first The slot for the smallest item under other
+* @param tasks The number of threads this subtree may use
+* @return the merged subtree
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Subtree BinarySearchTree<T, Compare>::unionParallel(Subtree curr,
+                                       const Node<T>* other, void* run, Node<T>* const* built,
+                                       unsigned char* found, std::size_t first, unsigned tasks) {
+
+	if (other == nullptr) {
+
+		return curr;
+	}
+
+	std::size_t n = BinarySearchTree<T, Compare>::sizeOf(curr.root) + other->getSize(),
+		slot = first + BinarySearchTree<T, Compare>::sizeOf(other->getLeft());
+
+	Node<T>* equal;
+
+	Subtree lower, upper, left, right;
+
+	this->splitNodes(curr, other->getItem(), lower, equal, upper);
+
+	if (equal != nullptr) {
+
+		found[slot] = 1;
+
+	} else if (built != nullptr) {
+
+		equal = built[slot];
+
+	} else {
+
+		equal = this->createNodeAt(run, slot, other->getItem());
+	}
+
+	std::future<Subtree> leftTask;
+
+	if (tasks > 1 && n >= 2 * PARALLEL_GRAIN) {
+
+		try {
+
+			leftTask = std::async(std::launch::async, &BinarySearchTree<T, Compare>::unionParallel,
+			                      this, lower, other->getLeft(), run, built, found, first, tasks / 2);
+
+		} catch (const std::system_error&) {
+
+			// no thread to spare, the left half is merged on this one below
+		}
+	}
+
+	if (leftTask.valid()) {
+
+		right = this->unionParallel(upper, other->getRight(), run, built, found, slot + 1, tasks - tasks / 2);
+		left = leftTask.get();
+
+	} else {
+
+		left = this->unionParallel(lower, other->getLeft(), run, built, found, first, tasks);
+		right = this->unionParallel(upper, other->getRight(), run, built, found, slot + 1, tasks);
+	}
+
+	return this->joinNodes(left, equal, right);
+}
+
+/*
+* Helper function for intersect, keeps the nodes under curr whose
+* items are under other, splitting across tasks threads
+* @param curr The subtree of this tree, its root possibly nullptr
+* @param other The root of the subtree of the other tree, possibly nullptr
+* @param dropped The roots of the subtrees left out, appended to
+* @param tasks The number of threads this subtree may use
+* @return the nodes kept
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Subtree BinarySearchTree<T, Compare>::intersectParallel(Subtree curr,
+                                       const Node<T>* other, std::vector<Node<T>*>& dropped, unsigned tasks) {
+
+	if (curr.root == nullptr || other == nullptr) {
+
+		if (curr.root != nullptr) {
+
+			dropped.push_back(curr.root);
+		}
+
+		return {nullptr, 0};
+	}
+
+	std::size_t n = curr.root->getSize() + other->getSize();
+
+	Node<T>* equal;
+
+	Subtree lower, upper, left, right;
+
+	this->splitNodes(curr, other->getItem(), lower, equal, upper);
+
+	if (tasks > 1 && n >= 2 * PARALLEL_GRAIN) {
+
+		std::vector<Node<T>*> leftDropped;
+
+		std::future<Subtree> leftTask = std::async(std::launch::async,
+		                                           &BinarySearchTree<T, Compare>::intersectParallel,
+		                                           this, lower, other->getLeft(),
+		                                           std::ref(leftDropped), tasks / 2);
+
+		right = this->intersectParallel(upper, other->getRight(), dropped, tasks - tasks / 2);
+		left = leftTask.get();
+
+		dropped.insert(dropped.end(), leftDropped.begin(), leftDropped.end());
+
+	} else {
+
+		left = this->intersectParallel(lower, other->getLeft(), dropped, tasks);
+		right = this->intersectParallel(upper, other->getRight(), dropped, tasks);
+	}
+
+	return (equal != nullptr) ? this->joinNodes(left, equal, right) : this->concatNodes(left, right);
+}
+
+/*
+* Helper function for difference, keeps the nodes under curr whose
+* items are not under other, splitting across tasks threads
+* @param curr The subtree of this tree, its root possibly nullptr
+* @param other The root of the subtree of the other tree, possibly nullptr
+* @param dropped The nodes left out, appended to
+* @param tasks The number of threads this subtree may use
+* @return the nodes kept
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Subtree BinarySearchTree<T, Compare>::differenceParallel(Subtree curr,
+                                       const Node<T>* other, std::vector<Node<T>*>& dropped, unsigned tasks) {
+
+	if (curr.root == nullptr || other == nullptr) {
+
+		return curr;
+	}
+
+	std::size_t n = curr.root->getSize() + other->getSize();
+
+	Node<T>* equal;
+
+	Subtree lower, upper, left, right;
+
+	this->splitNodes(curr, other->getItem(), lower, equal, upper);
+
+	if (equal != nullptr) {
+
+		equal->setLeft(nullptr);
+		equal->setRight(nullptr);
+
+		dropped.push_back(equal);
+	}
+
+	if (tasks > 1 && n >= 2 * PARALLEL_GRAIN) {
+
+		std::vector<Node<T>*> leftDropped;
+
+		std::future<Subtree> leftTask = std::async(std::launch::async,
+		                                           &BinarySearchTree<T, Compare>::differenceParallel,
+		                                           this, lower, other->getLeft(),
+		                                           std::ref(leftDropped), tasks / 2);
+
+		right = this->differenceParallel(upper, other->getRight(), dropped, tasks - tasks / 2);
+		left = leftTask.get();
+
+		dropped.insert(dropped.end(), leftDropped.begin(), leftDropped.end());
+
+	} else {
+
+		left = this->differenceParallel(lower, other->getLeft(), dropped, tasks);
+		right = this->differenceParallel(upper, other->getRight(), dropped, tasks);
+	}
+
+	return this->concatNodes(left, right);
+}
+
+/*
+* Helper function for intersect, difference and eraseRange, destroys
+* every node under curr one by one, rotating left children up so the
+* walk needs neither recursion nor a stack
+* @param curr The root of a subtree no longer linked to the tree
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::destroyNodes(Node<T>* curr) {
+
+	while (curr != nullptr) {
+
+		Node<T>* left = curr->getLeft();
+
+		if (left != nullptr) {
+
+			curr->setLeft(left->getRight());
+			left->setRight(curr);
+
+			curr = left;
+
+		} else {
+
+			Node<T>* right = curr->getRight();
+
+			this->destroyNode(curr);
+
+			curr = right;
+		}
+	}
+}
+
+/*
+* Finds the node with item or links a new node for it, descending
+* the tree only once
+* @param item The item to find or add, moved into the new node
+*        when an rvalue
+* @return the node holding item, and true if it was added or
+*         false if it was already in the tree
+*/
+template<class T, class Compare>
+template<class Item>
+std::pair<Node<T>*, bool> BinarySearchTree<T, Compare>::insertUnique(Item&& item) {
+
+	Node<T>* parent = nullptr;
+	Node<T>* curr = this->rootPtr;
+
+	bool right(false);
+
+	if constexpr (KeyCompare<Compare>::template isThreeWay<T, T>()) {
+
+		while (curr != nullptr) {
+
+			int order = this->comp.order(item, curr->getItem());
+
+			if (order == 0) {
+
+				return std::pair<Node<T>*, bool>(curr, false);
+			}
+
+			parent = curr;
+			right = order > 0;
+			curr = right ? curr->getRight() : curr->getLeft();
+		}
+
+	} else {
+
+		// one comparison per level, the last node not less than item
+		// is the only one that can be equivalent to it
+		Node<T>* candidate = nullptr;
+
+		while (curr != nullptr) {
+
+			parent = curr;
+			right = this->comp.less(curr->getItem(), item);
+
+			if (right) {
+
+				curr = curr->getRight();
+
+			} else {
+
+				candidate = curr;
+				curr = curr->getLeft();
+			}
+		}
+
+		if (candidate != nullptr && !this->comp.less(item, candidate->getItem())) {
+
+			return std::pair<Node<T>*, bool>(candidate, false);
+		}
+	}
+
+	curr = this->createNode(std::forward<Item>(item));
+	curr->setParent(parent);
+
+	if (parent == nullptr) {
+
+		this->rootPtr = curr;
+
+	} else if (right) {
+
+		parent->setRight(curr);
+
+	} else {
+
+		parent->setLeft(curr);
+	}
+
+	for (; parent != nullptr; parent = parent->getParent()) {
+
+		parent->setSize(parent->getSize() + 1);
+	}
+
+	return std::pair<Node<T>*, bool>(curr, true);
+}
+
+/*
+* Called by add after insertUnique, for what a derived tree does
+* about a new or found node (rebalancing, recoloring). Nothing to do
+* for a plain tree.
+* @param node The node holding the item
+* @param added true if node was just linked, false if it was there
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::afterInsert(Node<T>*, bool) {}
+
+/*
+* Takes a node found by remove or extract out of the tree and
+* destroys it, derived trees rebalance afterwards. Its item may
+* already be moved out, so it is not compared.
+* @param node The node to remove
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::removeNode(Node<T>* node) {
+
+	this->eraseNode(node);
+}
+
+/*
+* Unlinks a node from the tree and destroys it. A node with two
+* children is replaced by its inorder successor node, items are
+* never copied.
+* @param node The node to erase
+* @return the lowest node whose subtree changed, nullptr if none
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::eraseNode(Node<T>* node) {
+
+	Node<T>* parent = node->getParent();
+	Node<T>* changed = parent;
+
+	if (!BinarySearchTree<T, Compare>::hasTwoChild(node)) {
+
+		this->replaceChild(parent, node, BinarySearchTree<T, Compare>::only(node));
+
+	} else {
+
+		Node<T>* left  = node->getLeft(),
+			   * right = node->getRight(),
+			   * successor = right;
+
+		while (successor->getLeft() != nullptr) {
+
+			successor = successor->getLeft();
+		}
+
+		changed = successor;
+
+		if (successor != right) {
+
+			changed = successor->getParent();
+
+			this->replaceChild(changed, successor, successor->getRight());
+
+			successor->setRight(right);
+			right->setParent(successor);
+		}
+
+		successor->setLeft(left);
+		left->setParent(successor);
+
+		this->replaceChild(parent, node, successor);
+	}
+
+	this->destroyNode(node);
+
+	BinarySearchTree<T, Compare>::fixSizes(changed);
+
+	return changed;
+}
+
+/*
+* Rotates curr's right child into curr's place
+* @param curr The root of the subtree to rotate
+* @return the new root of the subtree
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::rotateLeft(Node<T>* curr) {
+
+	Node<T>* right = curr->getRight(),
+		   * inner = right->getLeft();
+
+	this->replaceChild(curr->getParent(), curr, right);
+
+	curr->setRight(inner);
+
+	if (inner != nullptr) {
+
+		inner->setParent(curr);
+	}
+
+	right->setLeft(curr);
+	curr->setParent(right);
+
+	this->fixNode(curr);
+	this->fixNode(right);
+
+	return right;
+}
+
+/*
+* Rotates curr's left child into curr's place
+* @param curr The root of the subtree to rotate
+* @return the new root of the subtree
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::rotateRight(Node<T>* curr) {
+
+	Node<T>* left  = curr->getLeft(),
+		   * inner = left->getRight();
+
+	this->replaceChild(curr->getParent(), curr, left);
+
+	curr->setLeft(inner);
+
+	if (inner != nullptr) {
+
+		inner->setParent(curr);
+	}
+
+	left->setRight(curr);
+	curr->setParent(left);
+
+	this->fixNode(curr);
+	this->fixNode(left);
+
+	return left;
+}
+
+/*
+* Makes child take the place of old under parent, or the root
+* when parent is nullptr
+* @param parent The parent of old
+* @param old The child being replaced
+* @param child The new child, possibly nullptr
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::replaceChild(Node<T>* parent, Node<T>* old, Node<T>* child) {
+
+	if (parent == nullptr) {
+
+		// a subtree being split or joined has no parent either
+		if (this->rootPtr == old) {
+
+			this->rootPtr = child;
+		}
+
+	} else if (parent->getLeft() == old) {
+
+		parent->setLeft(child);
+
+	} else {
+
+		parent->setRight(child);
+	}
+
+	if (child != nullptr) {
+
+		child->setParent(parent);
+	}
+}
+
+/*
+* Makes root the root of the tree, possibly nullptr, without
+* touching the nodes the tree held before. Derived trees fix what
+* their rules ask of a root (RedBlackTree blackens it).
+* @param root The new root
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::setRoot(Node<T>* root) {
+
+	this->rootPtr = root;
+
+	if (root != nullptr) {
+
+		root->setParent(nullptr);
+	}
+}
+
+/*
+* Moves every item not less than key into right, cutting the path
+* down to key and linking the pieces on each side back together
+* with joinNodes, O(log n) when joinNodes balances. Nodes are
+* relinked, never copied, and right uses this tree's arena.
+* @param key The first item to move
+* @param right An empty tree of the same type as this one
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::splitTree(const T& key, BinarySearchTree<T, Compare>& right) {
+
+	right.shareNodes(*this);
+
+	Node<T>* root = this->rootPtr,
+		   * equal;
+
+	Subtree lower, upper;
+
+	this->rootPtr = nullptr;
+
+	this->splitNodes({root, this->rankOf(root)}, key, lower, equal, upper);
+
+	if (equal != nullptr) {
+
+		upper = this->joinNodes({nullptr, 0}, equal, upper);
+	}
+
+	this->setRoot(lower.root);
+	right.setRoot(upper.root);
+}
+
+/*
+* Moves every item of right to the end of this tree: the smallest
+* node of right is cut out and joinNodes links it between the two,
+* O(log n) when joinNodes balances. When both arenas are already
+* shared with other trees the items are moved one by one instead.
+* @param right A tree of the same type as this one, left empty
+* @throws std::invalid_argument if an item of right is not greater
+*         than every item of this tree
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::joinTree(BinarySearchTree<T, Compare>& right) {
+
+	if (right.rootPtr == nullptr) {
+
+		return;
+	}
+
+	if (this->rootPtr != nullptr &&
+	    !this->comp.less(BinarySearchTree<T, Compare>::rightMost(this->rootPtr)->getItem(),
+	                     BinarySearchTree<T, Compare>::leftMost(right.rootPtr)->getItem())) {
+
+		throw std::invalid_argument("BinarySearchTree::join: items of right must be greater");
+	}
+
+	if (!this->shareNodes(right)) {
+
+		while (right.rootPtr != nullptr) {
+
+			Node<T>* node = BinarySearchTree<T, Compare>::leftMost(right.rootPtr);
+
+			this->add(std::move(node->getItem()));
+
+			right.removeNode(node);
+		}
+
+		return;
+	}
+
+	Subtree lower = {this->rootPtr, this->rankOf(this->rootPtr)},
+	        upper = {right.rootPtr, this->rankOf(right.rootPtr)};
+
+	this->rootPtr = nullptr;
+	right.rootPtr = nullptr;
+
+	this->setRoot(this->concatNodes(lower, upper).root);
+}
+
+/*
+* Splits the subtree under root into the nodes before key, the node
+* equivalent to key if any and the nodes after it: the path down to
+* key is cut and the pieces on each side are linked back together
+* with joinNodes, bottom up, O(log n) when joinNodes balances. The
+* rank of each piece follows from the rank of root. Only nodes under
+* root are touched, so different subtrees can be split on different
+* threads.
+* @param root The subtree, its root possibly nullptr
+* @param key The item to split by
+* @param lower Set to the nodes before key
+* @param equal Set to the node equivalent to key, unlinked, or nullptr
+* @param upper Set to the nodes after key
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::splitNodes(Subtree root, const T& key,
+                                              Subtree& lower, Node<T>*& equal, Subtree& upper) {
+
+	lower = {nullptr, 0};
+	equal = nullptr;
+	upper = {nullptr, 0};
+
+	if (root.root == nullptr) {
+
+		return;
+	}
+
+	root.root->setParent(nullptr);
+
+	Node<T>* curr = root.root,
+		   * last = nullptr;
+
+	// the rank of curr, then of the node below last on the path
+	int rank = root.rank;
+
+	while (curr != nullptr) {
+
+		int order = this->comp.order(key, curr->getItem());
+
+		if (order == 0) {
+
+			equal = curr;
+			lower = {curr->getLeft(), rank - this->rankStep(curr)};
+			upper = {curr->getRight(), lower.rank};
+			last = curr->getParent();
+
+			break;
+		}
+
+		rank -= this->rankStep(curr);
+
+		last = curr;
+		curr = (order < 0) ? curr->getLeft() : curr->getRight();
+	}
+
+	// back up the path every node goes to its side of key along with
+	// its subtree on that side, the joins only touch nodes below it.
+	// Both children of a node have the same rank, so the subtree left
+	// behind has the rank of the node the path came from.
+	while (last != nullptr) {
+
+		Node<T>* parent = last->getParent();
+
+		Subtree side = {nullptr, rank};
+
+		// read before the join recolors last
+		rank += this->rankStep(last);
+
+		if (this->comp.less(last->getItem(), key)) {
+
+			side.root = last->getLeft();
+
+			lower = this->joinNodes(side, last, lower);
+
+		} else {
+
+			side.root = last->getRight();
+
+			upper = this->joinNodes(upper, last, side);
+		}
+
+		last = parent;
+	}
+}
+
+/*
+* Links two subtrees, every item under lower before every item under
+* upper: the smallest node of upper is cut out and joinNodes links
+* it between the two
+* @param lower The lower subtree, its root possibly nullptr
+* @param upper The upper subtree, its root possibly nullptr
+* @return the joined subtree
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Subtree BinarySearchTree<T, Compare>::concatNodes(Subtree lower,
+                                                                                         Subtree upper) {
+
+	if (lower.root == nullptr || upper.root == nullptr) {
+
+		return (lower.root != nullptr) ? lower : upper;
+	}
+
+	upper.root->setParent(nullptr);
+
+	Node<T>* middle = upper.root;
+
+	// the rank of middle on the way down, then of the node below
+	// curr on the way up
+	int rank = upper.rank;
+
+	while (middle->getLeft() != nullptr) {
+
+		rank -= this->rankStep(middle);
+
+		middle = middle->getLeft();
+	}
+
+	// the ancestors of the smallest node are joined back above its
+	// right subtree, bottom up, which leaves the smallest node free
+	Subtree rest = {middle->getRight(), rank - this->rankStep(middle)};
+
+	Node<T>* curr = middle->getParent();
+
+	while (curr != nullptr) {
+
+		Node<T>* parent = curr->getParent();
+
+		Subtree side = {curr->getRight(), rank};
+
+		rank += this->rankStep(curr);
+
+		rest = this->joinNodes(rest, curr, side);
+
+		curr = parent;
+	}
+
+	return this->joinNodes(lower, middle, rest);
+}
+
+/*
+* Recomputes the subtree sizes from curr up to the root
+* @param curr The lowest node whose subtree changed
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::fixSizes(Node<T>* curr) {
+
+	for (; curr != nullptr; curr = curr->getParent()) {
+
+		curr->setSize(1 + BinarySearchTree<T, Compare>::sizeOf(curr->getLeft()) +
+		                  BinarySearchTree<T, Compare>::sizeOf(curr->getRight()));
+	}
+}
+
+/*
+* Gets the subtree size of a possibly null node
+* @param node The node
+* @return its subtree size, 0 for nullptr
+*/
+template<class T, class Compare>
+std::size_t BinarySearchTree<T, Compare>::sizeOf(const Node<T>* node) {
+
+	return (node != nullptr) ? node->getSize() : 0;
+}
+
+/*
+* Static helper function, gets the node with the smallest item under curr
+* @param curr The root of the subtree, not nullptr
+* @return the leftmost node
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::leftMost(Node<T>* curr) {
+
+	while (curr->getLeft() != nullptr) {
+
+		curr = curr->getLeft();
+	}
+
+	return curr;
+}
+
+/*
+* Static helper function, gets the node with the largest item under curr
+* @param curr The root of the subtree, not nullptr
+* @return the rightmost node
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::rightMost(Node<T>* curr) {
+
+	while (curr->getRight() != nullptr) {
+
+		curr = curr->getRight();
+	}
+
+	return curr;
+}
+
+/*
+* Static helper function, gets the root above curr by following
+* parent pointers, for subtrees that are not the tree's root
+* @param curr A node, not nullptr
+* @return the node above curr without a parent
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::topOf(Node<T>* curr) {
+
+	while (curr->getParent() != nullptr) {
+
+		curr = curr->getParent();
+	}
+
+	return curr;
+}
+
+/*
+* Static helper function, gets the inorder successor of curr
+* @param curr The current node, not nullptr
+* @return the next node in sorted order or nullptr
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::successor(const Node<T>* curr) {
+
+	if (curr->getRight() != nullptr) {
+
+		return BinarySearchTree<T, Compare>::leftMost(curr->getRight());
+	}
+
+	Node<T>* parent = curr->getParent();
+
+	while (parent != nullptr && parent->getRight() == curr) {
+
+		curr = parent;
+		parent = parent->getParent();
+	}
+
+	return parent;
+}
+
+/*
+* Static helper function, gets the inorder predecessor of curr
+* @param curr The current node, not nullptr
+* @return the previous node in sorted order or nullptr
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::predecessor(const Node<T>* curr) {
+
+	if (curr->getLeft() != nullptr) {
+
+		return BinarySearchTree<T, Compare>::rightMost(curr->getLeft());
+	}
+
+	Node<T>* parent = curr->getParent();
+
+	while (parent != nullptr && parent->getLeft() == curr) {
+
+		curr = parent;
+		parent = parent->getParent();
+	}
+
+	return parent;
+}
+
+/*
+* Gets the root of the tree
+* @return the root, possibly nullptr
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::getRoot() const {
+
+	return this->rootPtr;
+}
+
+/*
+* Gets the wrapped comparator that orders the items
+* @return the comparator
+*/
+template<class T, class Compare>
+const KeyCompare<Compare>& BinarySearchTree<T, Compare>::getComparator() const {
+
+	return this->comp;
+}
+
+/*
+* Creates a node for item, derived trees create their own node types
+* @param item The item for the node
+* @return the new node
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::createNode(const T& item) {
+
+	return this->plainNodes().create(item);
+}
+
+/*
+* Creates a node moving item into it
+* @param item The item for the node
+* @return the new node
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::createNode(T&& item) {
+
+	return this->plainNodes().create(std::move(item));
+}
+
+/*
+* Creates a copy of other for copyNode, with its item and what it
+* keeps about its subtree (its size, and its height in an AVLTree)
+* @param other The node to copy, not linked to anything
+* @return the new node
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::cloneNode(const Node<T>* other) {
+
+	Node<T>* node = this->createNode(other->getItem());
+
+	node->setSize(other->getSize());
+
+	return node;
+}
+
+/*
+* Recomputes what a node keeps about its subtree (its size, and its
+* height in an AVLTree) from its children
+* @param node The node to update
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::fixNode(Node<T>* node) {
+
+	node->setSize(1 + BinarySearchTree<T, Compare>::sizeOf(node->getLeft()) +
+	                  BinarySearchTree<T, Compare>::sizeOf(node->getRight()));
+}
+
+/*
+* Called after readTree or rebalance relinked every node into a tree
+* of minimum height, for what depends on the shape of the whole tree
+* (the colors of a RedBlackTree). Nothing to do for a plain tree.
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::fixTree() {
+
+}
+
+/*
+* Links left, middle and right into one subtree, every item under
+* left before middle and every item under right after it. Only the
+* nodes of the three are touched. A plain tree puts middle on top.
+* @param left The lower subtree, its root possibly nullptr
+* @param middle The node in between, its links are overwritten
+* @param right The upper subtree, its root possibly nullptr
+* @return the joined subtree, with middle as its root
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Subtree BinarySearchTree<T, Compare>::joinNodes(Subtree left,
+                                                                                       Node<T>* middle,
+                                                                                       Subtree right) {
+
+	middle->setLeft(left.root);
+	middle->setRight(right.root);
+	middle->setParent(nullptr);
+
+	if (left.root != nullptr) {
+
+		left.root->setParent(middle);
+	}
+	if (right.root != nullptr) {
+
+		right.root->setParent(middle);
+	}
+
+	this->fixNode(middle);
+
+	return {middle, std::max(left.rank, right.rank) + this->rankStep(middle)};
+}
+
+/*
+* Gets the rank of a subtree (see Subtree) by walking down it,
+* only done once per split, join or set operation
+* @param root The root of the subtree, possibly nullptr
+* @return its rank, 0 for a plain tree
+*/
+template<class T, class Compare>
+int BinarySearchTree<T, Compare>::rankOf(const Node<T>*) const {
+
+	return 0;
+}
+
+/*
+* Gets how much a node adds to the rank of its children: the rank
+* of each child is the rank of node less this
+* @param node The node
+* @return its part of the rank, 0 for a plain tree
+*/
+template<class T, class Compare>
+int BinarySearchTree<T, Compare>::rankStep(const Node<T>*) const {
+
+	return 0;
+}
+
+/*
+* Makes this tree and other allocate from the same slabs so their
+* nodes can be linked together (see NodeArena::absorb)
+* @param other A tree of the same type as this one
+* @return false if both arenas are already shared with other trees
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::shareNodes(BinarySearchTree<T, Compare>& other) {
+
+	return this->plainNodes().absorb(other.plainNodes());
+}
+
+/*
+* Destroys a node created by createNode
+* @param node The node to destroy
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::destroyNode(Node<T>* node) {
+
+	this->nodes->destroy(node);
+}
+
+/*
+* Releases the memory of every node at once, their items
+* must already be destroyed
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::releaseNodes() {
+
+	if (this->nodes != nullptr) {
+
+		this->nodes->reset();
+	}
+}
+
+/*
+* Checks if another tree allocates from the same slabs (after a
+* split or join), then clear destroys the nodes one by one so the
+* other tree can reuse their slots
+* @return true if the node arena is shared
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::nodesShared() const {
+
+	return this->nodes != nullptr && this->nodes->shared();
+}
+
+/*
+* Takes uninitialized storage for n nodes in a row from the arena
+* @param n The number of nodes
+* @return the storage, filled with createNodeAt
+*/
+template<class T, class Compare>
+void* BinarySearchTree<T, Compare>::takeRun(std::size_t n) {
+
+	return this->plainNodes().takeRun(n);
+}
+
+/*
+* Constructs node i of a run taken with takeRun, different nodes of
+* the same run may be constructed from different threads
+* @param run The storage returned by takeRun
+* @param i The index of the node in the run
+* @param item The item for the node
+* @return the new node
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::createNodeAt(void* run, std::size_t i, const T& item) {
+
+	return NodeArena<Node<T>>::createAt(static_cast<Node<T>*>(run), i, item);
+}
+
+/*
+* Constructs node i of a run taken with takeRun moving item into it
+* @param run The storage returned by takeRun
+* @param i The index of the node in the run
+* @param item The item for the node
+* @return the new node
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::createNodeAt(void* run, std::size_t i, T&& item) {
+
+	return NodeArena<Node<T>>::createAt(static_cast<Node<T>*>(run), i, std::move(item));
+}
+
+/*
+* Gives back slot i of a run taken with takeRun that was never
+* constructed, so it is reused like the slot of a destroyed node
+* @param run The storage returned by takeRun
+* @param i The index of the slot in the run
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::recycleAt(void* run, std::size_t i) {
+
+	this->nodes->recycle(static_cast<Node<T>*>(run) + i);
+}
+
+/*
+* Gets the node arena of a plain tree, creating it on first use
+* @return the arena
+*/
+template<class T, class Compare>
+NodeArena<Node<T>>& BinarySearchTree<T, Compare>::plainNodes() {
+
+	if (this->nodes == nullptr) {
+
+		this->nodes = std::make_unique<NodeArena<Node<T>>>();
+	}
+
+	return *this->nodes;
+}
+
+/*
+* Helper function
+* Finds the node in the tree with the target item walking down from curr,
+* one comparison per level
+* @param curr The current node in the tree
+* @param target The target item or key
+* @return pointer to node with target item or nullptr if item not in tree
+*/
+template<class T, class Compare>
+template<class K>
+Node<T>* BinarySearchTree<T, Compare>::getNode(Node<T>* curr,
+											const K& target) const {
+
+	if constexpr (KeyCompare<Compare>::template isThreeWay<K, T>()) {
+
+		int order(1);
+
+		while (curr != nullptr && (order = this->comp.order(target, curr->getItem())) != 0) {
+
+			curr = (order > 0) ? curr->getRight() : curr->getLeft();
+		}
+
+		return curr;
+
+	} else {
+
+		// the last node not less than target is the only one
+		// that can be equivalent to it
+		Node<T>* candidate = nullptr;
+
+		while (curr != nullptr) {
+
+			if (this->comp.less(curr->getItem(), target)) {
+
+				curr = curr->getRight();
+
+			} else {
+
+				candidate = curr;
+				curr = curr->getLeft();
+			}
+		}
+
+		if (candidate != nullptr && this->comp.less(target, candidate->getItem())) {
+
+			candidate = nullptr;
+		}
+
+		return candidate;
+	}
+}
+
+/*
+* Helper function for the bounds, finds the first node not ordered
+* before item, or with after set the first node ordered after item
+* @param item The item to look for
+* @param after true for the upper bound, false for the lower bound
+* @return the node, nullptr if there is none
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::boundNode(const T& item, bool after) const {
+
+	Node<T>* candidate = nullptr,
+		   * curr = this->rootPtr;
+
+	while (curr != nullptr) {
+
+		bool before = after ? !this->comp.less(item, curr->getItem())
+		                    : this->comp.less(curr->getItem(), item);
+
+		if (before) {
+
+			curr = curr->getRight();
+
+		} else {
+
+			candidate = curr;
+			curr = curr->getLeft();
+		}
+	}
+
+	return candidate;
+}
+
+/*
+* Helper function for containsBatch and findBatch, searches for
+* BATCH_LOOKUPS keys side by side (asynchronous memory access
+* chaining): each search in turn compares at its node, steps to a
+* child and prefetches it, and by the time it comes round again the
+* child has usually arrived. A finished search hands its slot to the
+* next key, so the searches stay in flight for any tree shape.
+* @param keys The keys to search for
+* @param count The number of keys
+* @param out Called as out(i, node) with the node equivalent to
+*        keys[i], nullptr if there is none
+*/
+template<class T, class Compare>
+template<class Out>
+void BinarySearchTree<T, Compare>::searchBatch(const T* keys, std::size_t count, Out out) const {
+
+	// each search walks down like getNode with a bool comparator: the
+	// last node not less than the key is the only one that can match
+	Node<T>* curr[BATCH_LOOKUPS];
+	Node<T>* candidate[BATCH_LOOKUPS];
+	std::size_t key[BATCH_LOOKUPS];
+
+	std::size_t active(0), next(0);
+
+	for (; active < BATCH_LOOKUPS && next < count; ++active, ++next) {
+
+		curr[active] = this->rootPtr;
+		candidate[active] = nullptr;
+		key[active] = next;
+	}
+
+	while (active > 0) {
+
+		for (std::size_t j(0); j < active; ) {
+
+			if (curr[j] != nullptr) {
+
+				const T& target = keys[key[j]];
+
+				if (this->comp.less(curr[j]->getItem(), target)) {
+
+					curr[j] = curr[j]->getRight();
+
+				} else {
+
+					candidate[j] = curr[j];
+					curr[j] = curr[j]->getLeft();
+				}
+
+#if defined(__GNUC__)
+				__builtin_prefetch(curr[j]);
+#endif
+
+				++j;
+
+				continue;
+			}
+
+			Node<T>* found = candidate[j];
+
+			if (found != nullptr && this->comp.less(keys[key[j]], found->getItem())) {
+
+				found = nullptr;
+			}
+
+			out(key[j], found);
+
+			if (next < count) {
+
+				// the root is in cache, the new search starts there
+				curr[j] = this->rootPtr;
+				candidate[j] = nullptr;
+				key[j] = next++;
+
+				++j;
+
+			} else {
+
+				// the last search takes the free slot, j is looked at again
+				--active;
+
+				curr[j] = curr[active];
+				candidate[j] = candidate[active];
+				key[j] = key[active];
+			}
+		}
+	}
+}
+
+/*
+* Static helper function for displaySideways
+* @param curr The current node in the tree
+* @param level The current level in the tree
 */
-template<class T>
-bool BinarySearchTree<T>::equalNode(Node<T>* curr, Node<T>* other) {
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::sideways(Node<T>* curr, int level) {
+
+	if (curr == nullptr) {
+
+		return;
+	}
+
+	// reverse inorder: right subtree, node, left subtree
+	Node<T>* node = curr;
+
+	++level;
+
+	while (node->getRight() != nullptr) {
+
+		node = node->getRight();
+		++level;
+	}
+
+	while (true) {
+
+		for (int i(level); i >= 0; --i) {
+
+			std::cout << "    ";
+		}
+
+		std::cout << node->getItem() << std::endl;
+
+		if (node->getLeft() != nullptr) {
+
+			node = node->getLeft();
+			++level;
+
+			while (node->getRight() != nullptr) {
+
+				node = node->getRight();
+				++level;
+			}
+
+		} else {
+
+			while (node != curr && node == node->getParent()->getLeft()) {
 
-	bool equal(false);
+				node = node->getParent();
+				--level;
+			}
 
-	if (curr == nullptr && other == nullptr) {
+			if (node == curr) {
 
-		equal = true;
+				break;
+			}
+
+			node = node->getParent();
+			--level;
+		}
+	}
+}
 
-	} else if (curr != nullptr && other != nullptr &&
-			   curr->getItem() == other->getItem()) {
+/*
+* Helper function for clear
+* Destroys every node under curr through destroyNode, as the type
+* the tree created it as, rotating left children up so the walk
+* needs neither recursion nor a stack (see destroyNodes). The memory
+* is left to the arena which releases it in bulk.
+* Nothing is visited when T has a trivial destructor.
+* @param curr The current node in the tree
+* @return nullptr after all nodes destroyed
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::deleteNodes(Node<T>* curr) {
 
-		Node<T>* currLeft   = curr->getLeft(),
-					 * currRight  = curr->getRight(),
-					 * otherLeft  = other->getLeft(),
-					 * otherRight = other->getRight();
+	if (!std::is_trivially_destructible<T>::value) {
 
-		equal = BinarySearchTree<T>::equalNode(currLeft, otherLeft) &&
-				BinarySearchTree<T>::equalNode(currRight, otherRight);
+		this->destroyNodes(curr);
 	}
 
-	return equal;
+	return nullptr;
 }
 
 /*
-* Static helper function for getHeight,
-* counts the height recursively by adding 1 at each lower level
+* Static helper function for eraseNode to check
+* if curr has both children
 * @param curr The current node in the tree
-* @return the height of the tree as an int
+* @return true if has both children, false otherwise
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::hasTwoChild(Node<T>* curr) {
+	
+	return curr->getLeft()  != nullptr &&
+		   curr->getRight() != nullptr;
+}
+
+/*
+* Static helper function for eraseNode to get only child of curr
+* @param curr The current node in the tree
+* @return the only child of curr
 */
-template<class T>
-int BinarySearchTree<T>::getHeight(Node<T>* curr) {
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::only(Node<T>* curr) {
 
-	int height(0);
+	Node<T>* left  = curr->getLeft(),
+				 * right = curr->getRight();
 
-	if (curr != nullptr) {
+	return (left != nullptr) ? left : right;
+}
+
+/*
+* Helper function for assingment operator overload,
+* copies a given node and all its children (preorder traversal)
+* walking parent pointers instead of recursing. Both children of a
+* copy are linked when it is visited, so the copy and the original
+* have the same shape along the walk and step through it together.
+* @param curr The current node in the first tree
+* @param other the current node in the other tree to copy
+* @return curr after all nodes have been copied
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::copyNode(Node<T>* curr, Node<T>* currParent, Node<T>* other) {
+
+	if (other != nullptr) {
+
+		curr = this->cloneNode(other);
+		curr->setParent(currParent);
+
+		Node<T>* from = other;
+		Node<T>* to = curr;
+
+		int depth(0), toDepth(0);
+
+		while (from != nullptr) {
 
-		Node<T>* left  = curr->getLeft(),
-			   * right = curr->getRight();
+			if (from->getLeft() != nullptr) {
 
-		int  leftHeight(BinarySearchTree<T>::getHeight(left));
-		int rightHeight(BinarySearchTree<T>::getHeight(right));
+				Node<T>* left = this->cloneNode(from->getLeft());
 
-		height = 1 + std::max(leftHeight, rightHeight);
+				to->setLeft(left);
+				left->setParent(to);
+			}
+			if (from->getRight() != nullptr) {
+
+				Node<T>* right = this->cloneNode(from->getRight());
+
+				to->setRight(right);
+				right->setParent(to);
+			}
+
+			from = BinarySearchTree<T, Compare>::preorderNext(from, other, depth);
+			to = BinarySearchTree<T, Compare>::preorderNext(to, curr, toDepth);
+		}
 	}
 
-	return height;
+	return curr;
+}
+
+/*
+* Helper function for equality operator overload, compares nodes for
+* equivalent items
+* @param curr The current node in the first tree
+* @param other The current node in the second tree
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::equalNode(Node<T>* curr, Node<T>* other) const {
+
+	if (curr == nullptr || other == nullptr) {
+
+		return curr == other;
+	}
+
+	Node<T>* a = curr;
+	Node<T>* b = other;
+
+	int depth(0), otherDepth(0);
+
+	// while the shapes match so far both walks take the same steps
+	while (a != nullptr) {
+
+		if (!this->comp.equivalent(a->getItem(), b->getItem()) ||
+			(a->getLeft() == nullptr) != (b->getLeft() == nullptr) ||
+			(a->getRight() == nullptr) != (b->getRight() == nullptr)) {
+
+			return false;
+		}
+
+		a = BinarySearchTree<T, Compare>::preorderNext(a, curr, depth);
+		b = BinarySearchTree<T, Compare>::preorderNext(b, other, otherDepth);
+	}
+
+	return true;
 }
 
 /*
-* Static helper function for getNumberOfNodes,
-* counts the nodes by adding one at each node in postorder traversal
+* Static helper function for getHeight, finds the deepest
+* node in a preorder walk that keeps track of the depth
 * @param curr The current node in the tree
-* @return the number of nodes in the tree as an int
+* @return the height of the tree as an int
 */
-template<class T>
-int BinarySearchTree<T>::getNodes(Node<T>* curr) {
+template<class T, class Compare>
+int BinarySearchTree<T, Compare>::getHeight(Node<T>* curr) {
 
-	int nodes(0);
+	int height(0), depth(1);
 
-	if (curr != nullptr) {
+	for (Node<T>* node = curr; node != nullptr;
+		 node = BinarySearchTree<T, Compare>::preorderNext(node, curr, depth)) {
+
+		height = std::max(height, depth);
+	}
+
+	return height;
+}
+
+/*
+* Static helper function for the traversals, gets the node after
+* curr in preorder without leaving the subtree under root, walking
+* parent pointers so no stack is needed
+* @param curr The current node
+* @param root The root of the subtree being walked
+* @param depth The depth of curr, updated to the depth of the result
+* @return the next node in preorder, nullptr after the last one
+*/
+template<class T, class Compare>
+Node<T>* BinarySearchTree<T, Compare>::preorderNext(Node<T>* curr, const Node<T>* root, int& depth) {
+
+	if (curr->getLeft() != nullptr) {
+
+		++depth;
+
+		return curr->getLeft();
+	}
+	if (curr->getRight() != nullptr) {
+
+		++depth;
+
+		return curr->getRight();
+	}
+
+	// climb until coming up from a left child whose parent has a right child
+	while (curr != root) {
+
+		Node<T>* parent = curr->getParent();
+
+		--depth;
 
-		Node<T>* left  = curr->getLeft(),
-					 * right = curr->getRight();
+		if (curr == parent->getLeft() && parent->getRight() != nullptr) {
 
-		int  leftNodes(BinarySearchTree<T>::getNodes(left));
-		int rightNodes(BinarySearchTree<T>::getNodes(right));
+			++depth;
 
-		nodes = 1 + leftNodes + rightNodes;
+			return parent->getRight();
+		}
+
+		curr = parent;
 	}
 
-	return nodes;
+	return nullptr;
 }
 
 /*
-* Static helper function for inorder traverse
+* Static helper function for inorder traverse, visits the items in place
+* stepping from each node to its successor
 * @param curr The current node in the tree
 * @param visit The visiting function on each item in tree
 */
-template<class T>
-void BinarySearchTree<T>::inorder(Node<T>* curr, void visit(T& item)) {
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::inorder(Node<T>* curr, void visit(T& item)) {
 
 	if (curr != nullptr) {
 
-		Node<T>* left  = curr->getLeft(),
-					 * right = curr->getRight();
+		Node<T>* last = BinarySearchTree<T, Compare>::rightMost(curr);
 
-		BinarySearchTree<T>::inorder(left, visit);
+		for (Node<T>* node = BinarySearchTree<T, Compare>::leftMost(curr); ;
+			 node = BinarySearchTree<T, Compare>::successor(node)) {
 
-		T currItem(curr->getItem());
-		visit(currItem);
+			visit(node->getItem());
 
-		BinarySearchTree<T>::inorder(right, visit);
+			if (node == last) {
+
+				break;
+			}
+		}
 	}
 }
 
 /*
-* Static helper function for rebalance, fills array with all items
-* in sorted order with inorder traversal
-* @param arr The array to fill
-* @param curr The current node in the tree
-* @param index The current index to insert in the array
+* Helper function for rebalance, rotates right until every node
+* has no left child, leaving a sorted "vine" down the right side
 */
-template<class T>
-void BinarySearchTree<T>::toArray(T arr[], Node<T>* curr, int* index) {
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::treeToVine() {
 
-	if (curr != nullptr) {
+	Node<T>* curr = this->rootPtr;
+
+	while (curr != nullptr) {
+
+		if (curr->getLeft() != nullptr) {
+
+			curr = this->rotateRight(curr);
+
+		} else {
+
+			curr = curr->getRight();
+		}
+	}
+}
 
-		Node<T>* left  = curr->getLeft(),
-					 * right = curr->getRight();
+/*
+* Helper function for rebalance, does count left rotations at every
+* other node down the right spine starting at the root
+* @param count The number of rotations
+*/
+template<class T, class Compare>
+void BinarySearchTree<T, Compare>::compress(std::size_t count) {
 
-		BinarySearchTree<T>::toArray(arr, left, index);
+	Node<T>* curr = this->rootPtr;
 
-		arr[(*index)++] = curr->getItem();
+	for (std::size_t i(0); i < count; ++i) {
 
-		BinarySearchTree<T>::toArray(arr, right, index);
+		curr = this->rotateLeft(curr)->getRight();
 	}
 }
 
@@ -728,8 +2930,8 @@ void BinarySearchTree<T>::toArray(T arr[], Node<T>* curr, int* index) {
 * @param n A mystery number
 * @return mystery number
 */
-template<class T>
-int BinarySearchTree<T>::helper(Node<T>* curr, int& n) {
+template<class T, class Compare>
+int BinarySearchTree<T, Compare>::helper(Node<T>* curr, int& n) {
 
 	std::cout << "M: " << n << " ";
 
@@ -755,3 +2957,237 @@ int BinarySearchTree<T>::helper(Node<T>* curr, int& n) {
 	
 	return helper(curr->getLeft(), n) + helper(curr->getRight(), n);
 }
+
+///////////////////////////////////////////////////////////////////////////////
+/////////////// ITERATOR ITERATOR ITERATOR ITERATOR ///////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+* Constructs an iterator that belongs to no tree
+*/
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::Iterator::Iterator() :curr(nullptr), tree(nullptr) {}
+
+/*
+* Constructs an iterator at node, nullptr is end()
+* @param node The node at the iterator
+* @param tree The tree the node belongs to
+*/
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::Iterator::Iterator(const Node<T>* node, const BinarySearchTree<T, Compare>* tree)
+
+	:curr(node), tree(tree) {}
+
+/*
+* Gets the item at the iterator
+* @return the item by reference
+*/
+template<class T, class Compare>
+const T& BinarySearchTree<T, Compare>::Iterator::operator*() const {
+
+	return this->curr->getItem();
+}
+
+/*
+* Gets the address of the item at the iterator
+* @return pointer to the item
+*/
+template<class T, class Compare>
+const T* BinarySearchTree<T, Compare>::Iterator::operator->() const {
+
+	return &this->curr->getItem();
+}
+
+/*
+* Moves to the next item in sorted order
+* @return this by reference
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator& BinarySearchTree<T, Compare>::Iterator::operator++() {
+
+	this->curr = BinarySearchTree<T, Compare>::successor(this->curr);
+
+	return *this;
+}
+
+/*
+* Moves to the next item in sorted order
+* @return the iterator before moving
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator BinarySearchTree<T, Compare>::Iterator::operator++(int) {
+
+	Iterator before(*this);
+
+	++(*this);
+
+	return before;
+}
+
+/*
+* Moves to the previous item in sorted order, end() moves to the last item
+* @return this by reference
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator& BinarySearchTree<T, Compare>::Iterator::operator--() {
+
+	if (this->curr == nullptr) {
+
+		this->curr = BinarySearchTree<T, Compare>::rightMost(this->tree->rootPtr);
+
+	} else {
+
+		this->curr = BinarySearchTree<T, Compare>::predecessor(this->curr);
+	}
+
+	return *this;
+}
+
+/*
+* Moves to the previous item in sorted order, end() moves to the last item
+* @return the iterator before moving
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator BinarySearchTree<T, Compare>::Iterator::operator--(int) {
+
+	Iterator before(*this);
+
+	--(*this);
+
+	return before;
+}
+
+/*
+* Equality operator overload
+* @param other The other iterator
+* @return true if both are at the same node
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::Iterator::operator==(const Iterator& other) const {
+
+	return this->curr == other.curr;
+}
+
+/*
+* Inequality operator overload
+* @param other The other iterator
+* @return true if the iterators are at different nodes
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::Iterator::operator!=(const Iterator& other) const {
+
+	return !(*this == other);
+}
+
+/*
+* Constructs the range between two iterators of the same tree
+* @param first The iterator at the first item
+* @param last The iterator past the last item
+*/
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::Range::Range(Iterator first, Iterator last)
+
+	:first(first), last(last) {}
+
+/*
+* Gets an iterator at the first item in the range
+* @return iterator at the first item, equal to end() if empty
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator BinarySearchTree<T, Compare>::Range::begin() const {
+
+	return this->first;
+}
+
+/*
+* Gets the iterator past the last item in the range
+* @return iterator at the first item not before high
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::Iterator BinarySearchTree<T, Compare>::Range::end() const {
+
+	return this->last;
+}
+
+/*
+* Checks if the range holds no item
+* @return true if empty, false otherwise
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::Range::empty() const {
+
+	return this->first == this->last;
+}
+
+/*
+* Constructs an empty handle
+*/
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::NodeHandle::NodeHandle() {}
+
+/*
+* Constructs a handle moving an item into it
+* @param item The item
+*/
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::NodeHandle::NodeHandle(T&& item) :item(std::move(item)) {}
+
+/*
+* Move constructor, other is left empty
+* @param other The handle to move from
+*/
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::NodeHandle::NodeHandle(NodeHandle&& other) noexcept :item(std::move(other.item)) {
+
+	other.item.reset();
+}
+
+/*
+* Move assignment, other is left empty
+* @param other The handle to move from
+* @return this by reference
+*/
+template<class T, class Compare>
+typename BinarySearchTree<T, Compare>::NodeHandle&
+BinarySearchTree<T, Compare>::NodeHandle::operator=(NodeHandle&& other) noexcept {
+
+	if (this != &other) {
+
+		this->item = std::move(other.item);
+
+		other.item.reset();
+	}
+
+	return *this;
+}
+
+/*
+* Checks if the handle holds no item
+* @return true if empty, false otherwise
+*/
+template<class T, class Compare>
+bool BinarySearchTree<T, Compare>::NodeHandle::empty() const {
+
+	return !this->item.has_value();
+}
+
+/*
+* Checks if the handle holds an item
+* @return true if not empty
+*/
+template<class T, class Compare>
+BinarySearchTree<T, Compare>::NodeHandle::operator bool() const {
+
+	return this->item.has_value();
+}
+
+/*
+* Gets the item, the handle must not be empty. The item may be
+* changed, it is not in any tree.
+* @return the item by reference
+*/
+template<class T, class Compare>
+T& BinarySearchTree<T, Compare>::NodeHandle::value() {
+
+	return *this->item;
+}
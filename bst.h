@@ -7,60 +7,322 @@
 * 
 * A BinarySearchTree is a binary tree where all values to the right of a node
 * are greater and all values left a node are lesser. It is able to locate a
-* a node in O(logn) time. Operations include:
+* a node in O(logn) time. Items are ordered by Compare, which may be a bool
+* "less" comparator or a three-way comparator (see compare.h). Operations
+* include:
 *
 *	- checking if empty
 *	- getting height
-*	- getting number of nodes
-*	- checking for an item
-*	- adding an item
+*	- getting number of nodes in O(1)
+*	- selecting the k-th smallest item and ranking an item in O(height)
+*	- lower and upper bound, floor and ceiling
+*	- iterating over the items of a range [low, high), visiting only
+*	  those items and the path to the first, and counting them in
+*	  O(height) from the subtree sizes
+*	- checking for an item, or for a key of another type with a
+*	  transparent comparator
+*	- checking for or finding many items at once, several searches in
+*	  flight with the next node of each prefetched
+*	- adding an item, copying it, moving it or constructing it from
+*	  arguments (emplace)
+*	- extracting an item into a NodeHandle and inserting it into
+*	  another tree, moving it both ways
+*	- moving a whole tree in O(1) (move constructor and assignment)
+*	- union, intersection and difference with another tree by
+*	  splitting and joining, on several threads
+*	- erasing a range of items by splitting it off, with no search
+*	  per item
 *	- displaying the tree sideways
 *	- visiting each item inorder with a function parameter
+*	- bidirectional iterators (begin/end, rbegin/rend)
 *	- rebalancing
 *	- clearing
-*	- creating itself from an array
+*	- creating itself in O(n) from a sorted array, iterator range or
+*	  vector (moving the items), optionally sorting first
+*	- building, sorting and rebalancing on several threads
+*	- freezing into a read only FrozenTree for faster lookups
 *	- equality and non equality operator overloads
+*
+* Nodes are allocated from a NodeArena owned by the tree, so clearing
+* or destroying a tree releases its memory in bulk. Balanced trees that
+* split and join (AVLTree, RedBlackTree) share their arena with the
+* trees split off them, so nodes can be relinked between them. Clearing
+* a tree whose arena is shared destroys its nodes one by one, so the
+* trees still using the arena reuse their slots.
 */
 
 #ifndef BINARYSEARCHTREE_H
 #define BINARYSEARCHTREE_H
 
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
 #include <vector>
+#include "arena.h"
+#include "compare.h"
+#include "frozentree.h"
 #include "node.h"
 
-template<class T>
+template<class T, class Compare = std::less<T>>
 class BinarySearchTree {
 
 public:
 
+	/*
+	* Bidirectional iterator over the items in sorted order, stepping
+	* through parent pointers in amortized O(1) without recursion.
+	* Items are read only since changing them could break the ordering.
+	*/
+	class Iterator {
+
+	public:
+
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T* pointer;
+		typedef const T& reference;
+
+		/*
+		* Constructs an iterator that belongs to no tree
+		*/
+		Iterator();
+
+		/*
+		* Gets the item at the iterator
+		* @return the item by reference
+		*/
+		reference operator*() const;
+
+		/*
+		* Gets the address of the item at the iterator
+		* @return pointer to the item
+		*/
+		pointer operator->() const;
+
+		/*
+		* Moves to the next item in sorted order
+		* @return this by reference
+		*/
+		Iterator& operator++();
+
+		/*
+		* Moves to the next item in sorted order
+		* @return the iterator before moving
+		*/
+		Iterator operator++(int);
+
+		/*
+		* Moves to the previous item in sorted order, end() moves to the last item
+		* @return this by reference
+		*/
+		Iterator& operator--();
+
+		/*
+		* Moves to the previous item in sorted order, end() moves to the last item
+		* @return the iterator before moving
+		*/
+		Iterator operator--(int);
+
+		/*
+		* Equality operator overload
+		* @param other The other iterator
+		* @return true if both are at the same node
+		*/
+		bool operator==(const Iterator& other) const;
+
+		/*
+		* Inequality operator overload
+		* @param other The other iterator
+		* @return true if the iterators are at different nodes
+		*/
+		bool operator!=(const Iterator& other) const;
+
+	private:
+
+		friend class BinarySearchTree<T, Compare>;
+
+		/*
+		* Constructs an iterator at node, nullptr is end()
+		* @param node The node at the iterator
+		* @param tree The tree the node belongs to
+		*/
+		Iterator(const Node<T>* node, const BinarySearchTree<T, Compare>* tree);
+
+		// Node at the iterator, nullptr at end()
+		const Node<T>* curr;
+
+		// Tree iterated, needed to step back from end()
+		const BinarySearchTree<T, Compare>* tree;
+	};
+
+	typedef Iterator iterator;
+	typedef Iterator const_iterator;
+	typedef std::reverse_iterator<Iterator> reverse_iterator;
+	typedef std::reverse_iterator<Iterator> const_reverse_iterator;
+
+	/*
+	* The items of a tree in [low, high), made by range, for range-for
+	* loops and <algorithm>. Iterating visits the items in the range
+	* and the path down to the first one, O(height + k) for k items.
+	* It is invalidated like the iterators it holds.
+	*/
+	class Range {
+
+	public:
+
+		/*
+		* Gets an iterator at the first item in the range
+		* @return iterator at the first item, equal to end() if empty
+		*/
+		Iterator begin() const;
+
+		/*
+		* Gets the iterator past the last item in the range
+		* @return iterator at the first item not before high
+		*/
+		Iterator end() const;
+
+		/*
+		* Checks if the range holds no item
+		* @return true if empty, false otherwise
+		*/
+		bool empty() const;
+
+	private:
+
+		friend class BinarySearchTree<T, Compare>;
+
+		/*
+		* Constructs the range between two iterators of the same tree
+		* @param first The iterator at the first item
+		* @param last The iterator past the last item
+		*/
+		Range(Iterator first, Iterator last);
+
+		// Iterator at the first item
+		Iterator first;
+
+		// Iterator past the last item
+		Iterator last;
+	};
+
+	/*
+	* An item taken out of a tree by extract, to insert into another
+	* tree with the same item type and comparator. The item is moved in
+	* and out, never copied. The node it came from goes back to its
+	* tree's arena, since a node can only live in the arena that made it.
+	*/
+	class NodeHandle {
+
+	public:
+
+		/*
+		* Constructs an empty handle
+		*/
+		NodeHandle();
+
+		NodeHandle(const NodeHandle& other) = delete;
+
+		NodeHandle& operator=(const NodeHandle& other) = delete;
+
+		/*
+		* Move constructor, other is left empty
+		* @param other The handle to move from
+		*/
+		NodeHandle(NodeHandle&& other) noexcept;
+
+		/*
+		* Move assignment, other is left empty
+		* @param other The handle to move from
+		* @return this by reference
+		*/
+		NodeHandle& operator=(NodeHandle&& other) noexcept;
+
+		/*
+		* Checks if the handle holds no item
+		* @return true if empty, false otherwise
+		*/
+		bool empty() const;
+
+		/*
+		* Checks if the handle holds an item
+		* @return true if not empty
+		*/
+		explicit operator bool() const;
+
+		/*
+		* Gets the item, the handle must not be empty. The item may be
+		* changed, it is not in any tree.
+		* @return the item by reference
+		*/
+		T& value();
+
+	private:
+
+		friend class BinarySearchTree<T, Compare>;
+
+		/*
+		* Constructs a handle moving an item into it
+		* @param item The item
+		*/
+		explicit NodeHandle(T&& item);
+
+		// The item, nothing when empty
+		std::optional<T> item;
+	};
+
 	/*
 	* Constructs empty tree
 	*/
-	BinarySearchTree<T>();
+	BinarySearchTree();
 
 	/*
 	* Constructs tree with given item for root node
 	* @param item The item for the root node
 	*/
-	explicit BinarySearchTree<T>(const T& item);
+	explicit BinarySearchTree(const T& item);
+
+	/*
+	* Constructs empty tree ordered by a given comparator, which may
+	* hold state. Copies and moves of the tree take the comparator along.
+	* @param comp The comparator
+	*/
+	explicit BinarySearchTree(const Compare& comp);
 
 	/*
 	* Copy constructor
 	* @param bst The other tree to copy
 	*/
-	BinarySearchTree<T>(const BinarySearchTree<T>& other);
+	BinarySearchTree(const BinarySearchTree<T, Compare>& other);
+
+	/*
+	* Move constructor, takes the nodes of other in O(1), other is left empty
+	* @param other The other tree to move from
+	*/
+	BinarySearchTree(BinarySearchTree<T, Compare>&& other) noexcept;
 
 	/*
 	* Destroys tree and deallocates all dynamic memory
 	*/
-	virtual ~BinarySearchTree<T>();
+	virtual ~BinarySearchTree();
 
 	/*
 	* Assignment operator overload, makes this a deep copy of other
 	* @param other The other tree to copy
 	* @return this by reference
 	*/
-	BinarySearchTree<T>& operator=(const BinarySearchTree<T>& other);
+	BinarySearchTree<T, Compare>& operator=(const BinarySearchTree<T, Compare>& other);
+
+	/*
+	* Move assignment, clears this and takes the nodes of other in O(1),
+	* other is left empty
+	* @param other The other tree to move from
+	* @return this by reference
+	*/
+	BinarySearchTree<T, Compare>& operator=(BinarySearchTree<T, Compare>&& other) noexcept;
 
 	/*
 	* Checks if tree is empty
@@ -80,6 +342,74 @@ public:
 	*/
 	virtual int getNumberOfNodes() const;
 
+	/*
+	* Gets the amount of items in the tree in O(1)
+	* @return the amount of items in the tree
+	*/
+	std::size_t size() const;
+
+	/*
+	* Gets the k-th smallest item, counting from 0
+	* @param k The position of the item in sorted order
+	* @return the item at position k by reference
+	* @throws std::out_of_range if k >= size()
+	*/
+	const T& select(std::size_t k) const;
+
+	/*
+	* Counts the items less than a given item, which is the position
+	* item has or would have in sorted order
+	* @param item The item to rank
+	* @return the number of items less than item
+	*/
+	std::size_t rank(const T& item) const;
+
+	/*
+	* Finds the first item not ordered before item in O(height)
+	* @param item The item to look for
+	* @return iterator at that item, end() if every item is before item
+	*/
+	Iterator lowerBound(const T& item) const;
+
+	/*
+	* Finds the first item ordered after item in O(height)
+	* @param item The item to look for
+	* @return iterator at that item, end() if no item is after item
+	*/
+	Iterator upperBound(const T& item) const;
+
+	/*
+	* Finds the last item not ordered after item in O(height)
+	* @param item The item to look for
+	* @return iterator at that item, end() if every item is after item
+	*/
+	Iterator floor(const T& item) const;
+
+	/*
+	* Finds the first item not ordered before item, the same item as
+	* lowerBound, named to go with floor
+	* @param item The item to look for
+	* @return iterator at that item, end() if every item is before item
+	*/
+	Iterator ceiling(const T& item) const;
+
+	/*
+	* Gets the items in [low, high) to iterate over, O(height) to make
+	* @param low The first item of the range, included
+	* @param high The end of the range, not included
+	* @return the range, empty if high is not after low
+	*/
+	Range range(const T& low, const T& high) const;
+
+	/*
+	* Counts the items in [low, high) in O(height) by ranking both ends,
+	* without visiting the items
+	* @param low The first item of the range, included
+	* @param high The end of the range, not included
+	* @return the number of items in the range, 0 if high is not after low
+	*/
+	std::size_t countRange(const T& low, const T& high) const;
+
 	/*
 	* Adds a given item to the tree, if not duplicate
 	* @param item The item to add
@@ -87,18 +417,116 @@ public:
 	*/
 	virtual bool add(const T& item);
 
+	/*
+	* Adds a given item to the tree, if not duplicate, moving it into
+	* its node. A duplicate is left as it was.
+	* @param item The item to add
+	* @return true if item added, false otherwise
+	*/
+	virtual bool add(T&& item);
+
+	/*
+	* Constructs an item from the arguments and adds it, if not duplicate,
+	* moving it into its node
+	* @param args The arguments for the item's constructor
+	* @return true if item added, false otherwise
+	*/
+	template<class... Args>
+	bool emplace(Args&&... args);
+
 	/*
 	* Removes a given item from the tree if there
 	* @param item The item to remove
 	* @return true if item removed, false otherwise
 	*/
-	bool remove(const T& item);
+	virtual bool remove(const T& item);
+
+	/*
+	* Removes a given item from the tree if there, moving it into a handle
+	* @param item The item to extract
+	* @return the handle with the item, empty if item was not in the tree
+	*/
+	NodeHandle extract(const T& item);
+
+	/*
+	* Adds the item of a handle, if not duplicate, moving it into its
+	* node and leaving the handle empty. A duplicate stays in the handle.
+	* @param handle The handle, possibly empty
+	* @return true if item added, false if duplicate or handle empty
+	*/
+	bool insert(NodeHandle&& handle);
+
+	/*
+	* Adds every item of other not already in the tree. This tree is split
+	* by the item at the root of other, each half is merged with one of
+	* its subtrees (on two threads when large, see useThreads) and the
+	* halves are joined back, O(m log(n/m + 1)) for an AVLTree or a
+	* RedBlackTree of n items and m items in other. When other has at
+	* most three quarters as many items (UNION_BY_ADD_PERCENT) they are
+	* added in order instead, which keeps the paths walked in cache and
+	* beats the splits and joins. If copying T can throw, every item of
+	* other is copied before the tree is touched and an add that throws
+	* takes back the items added before it, so the tree is left as it
+	* was. Otherwise only the items missing here are copied.
+	* @param other The tree whose items are added, of any kind
+	*/
+	void unionWith(const BinarySearchTree<T, Compare>& other);
+
+	/*
+	* Removes every item not in other, splitting and joining like unionWith
+	* @param other The tree whose items are kept, of any kind
+	*/
+	void intersect(const BinarySearchTree<T, Compare>& other);
+
+	/*
+	* Removes every item in other, splitting and joining like unionWith
+	* @param other The tree whose items are removed, of any kind
+	*/
+	void difference(const BinarySearchTree<T, Compare>& other);
+
+	/*
+	* Removes the items in [low, high): the tree is split at both ends,
+	* the middle is destroyed node by node without searching for its
+	* items and the two sides are joined, O(log n + k) for k items
+	* when joinNodes balances (AVLTree, RedBlackTree)
+	* @param low The first item to remove
+	* @param high The end of the range, not removed
+	* @return the number of items removed, 0 if high is not after low
+	*/
+	std::size_t eraseRange(const T& low, const T& high);
 
 	/*
 	* Deletes all nodes in the tree
 	*/
 	virtual void clear();
 
+	/*
+	* Makes room for n more nodes so adding them does not allocate
+	* @param n The number of nodes to make room for
+	*/
+	virtual void reserve(std::size_t n);
+
+	/*
+	* Turns huge page backing of the node arena on or off,
+	* affects memory allocated from now on
+	* @param enable true to use huge pages
+	*/
+	virtual void useHugePages(bool enable);
+
+	/*
+	* Gets the number of bytes held by the node arena, including
+	* what trees sharing it (after a split) hold
+	* @return bytes held by the arena
+	*/
+	virtual std::size_t bytesReserved() const;
+
+	/*
+	* Sets how many threads readTree, rebalance and the set operations
+	* may use for large trees, 1 (the default) keeps them serial
+	* @param threads The number of threads, 0 for one per hardware thread
+	*/
+	void useThreads(unsigned threads);
+
 	/*
 	* Checks for membership of given item
 	* @param item The item to check for
@@ -106,6 +534,33 @@ public:
 	*/
 	virtual bool contains(const T& item) const;
 
+	/*
+	* Checks for membership of a key of another type, only available when
+	* Compare is transparent (has is_transparent), no item is constructed
+	* @param key The key to check for
+	* @return true if tree contains an item equivalent to key
+	*/
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	bool contains(const K& key) const;
+
+	/*
+	* Checks for membership of many items, BATCH_LOOKUPS searches at a
+	* time taking one step each in turn (see searchBatch), so the cache
+	* misses of different searches overlap.
+	* @param keys The items to check for
+	* @param count The number of items
+	* @param found Set to whether the tree contains each item
+	*/
+	void containsBatch(const T* keys, std::size_t count, bool* found) const;
+
+	/*
+	* Finds many items, searching like containsBatch
+	* @param keys The items to find
+	* @param count The number of items
+	* @param found Set to an iterator at each item, end() if not in the tree
+	*/
+	void findBatch(const T* keys, std::size_t count, Iterator* found) const;
+
 	/*
 	* Prints the tree sideways
 	*/
@@ -115,13 +570,47 @@ public:
 	* Inorder traversal: left-root-right
 	* The function can modify the data in tree, but the
     * tree structure is not changed
+	* Items are passed by reference, never copied
 	* @param visit The function to visit on each node
 	*/
 	void inorderTraverse(void visit(T& item)) const;
 
+	/*
+	* Gets an iterator at the smallest item
+	* @return iterator at the first item, end() if empty
+	*/
+	Iterator begin() const;
+
+	/*
+	* Gets the iterator past the largest item
+	* @return the end iterator
+	*/
+	Iterator end() const;
+
+	/*
+	* Gets a reverse iterator at the largest item
+	* @return reverse iterator at the last item
+	*/
+	reverse_iterator rbegin() const;
+
+	/*
+	* Gets the reverse iterator past the smallest item
+	* @return the reverse end iterator
+	*/
+	reverse_iterator rend() const;
+
+	/*
+	* Makes an immutable snapshot of the items in O(n), stored without
+	* nodes for branch free searches (see frozentree.h). Later changes
+	* to the tree do not show in the snapshot.
+	* @return the snapshot
+	*/
+	FrozenTree<T, Compare> freeze() const;
+
 	/* 
-	* Creates a dynamic array, copies all items to the array
-	* and then reads the array to re-balance this tree
+	* Relinks the existing nodes into a tree of minimum height in O(n)
+	* time and O(1) extra memory (Day-Stout-Warren), no item is copied
+	* and no node is allocated or freed
 	*/
 	virtual void rebalance();
 
@@ -134,19 +623,42 @@ public:
 	*/
 	bool readTree(const T arr[], int n);
 
+	/*
+	* Clears the tree and builds it at minimum height from the items in
+	* [first, last) in O(n), each item is read once and linked bottom up.
+	* Use std::make_move_iterator to move the items instead of copying.
+	* @param first Forward iterator to the first item
+	* @param last Iterator past the last item
+	* @param sorted true if the items are sorted without duplicates,
+	*        false to sort them and drop duplicates first
+	* @return true if the range was not empty
+	*/
+	template<class It>
+	bool readTree(It first, It last, bool sorted = true);
+
+	/*
+	* Clears the tree and builds it at minimum height in O(n),
+	* moving the items out of a vector
+	* @param items The items, left in a valid but unspecified state
+	* @param sorted true if the items are sorted without duplicates,
+	*        false to sort them and drop duplicates first
+	* @return true if items was not empty
+	*/
+	bool readTree(std::vector<T>&& items, bool sorted = true);
+
 	/*
 	* Equality operator overload
 	* @param other The other tree to compare to
 	* @return true if all nodes have same value and structure, false otherwise
 	*/
-	bool operator==(const BinarySearchTree<T>& other) const;
+	bool operator==(const BinarySearchTree<T, Compare>& other) const;
 
 	/*
 	* Inequality operator overload
 	* @param other The other tree to compare to
 	* @return true if nodes have different value or structure, false otherwise
 	*/
-	bool operator!=(const BinarySearchTree<T>& other) const;
+	bool operator!=(const BinarySearchTree<T, Compare>& other) const;
 
 	/*
 	* Get cousins of Node with item
@@ -170,20 +682,358 @@ public:
 protected:
 
 	/*
-	* Static helper function for add, adds new node in the tree
-	* @param curr The current node in the tree
-	* @param item The item to add in a new node
-	* @return the current node after the new node is added
+	* Finds the node with item or links a new node for it, descending
+	* the tree only once
+	* @param item The item to find or add, moved into the new node
+	*        when an rvalue
+	* @return the node holding item, and true if it was added or
+	*         false if it was already in the tree
 	*/
-	static Node<T>* addNode(Node<T>* curr, Node<T>* parent, const T& item);
+	template<class Item>
+	std::pair<Node<T>*, bool> insertUnique(Item&& item);
 
 	/*
-	* Static helper function, finds the node in the tree with the target item
+	* Called by add after insertUnique, for what a derived tree does
+	* about a new or found node (rebalancing, recoloring). Nothing to do
+	* for a plain tree.
+	* @param node The node holding the item
+	* @param added true if node was just linked, false if it was there
+	*/
+	virtual void afterInsert(Node<T>* node, bool added);
+
+	/*
+	* Takes a node found by remove or extract out of the tree and
+	* destroys it, derived trees rebalance afterwards. Its item may
+	* already be moved out, so it is not compared.
+	* @param node The node to remove
+	*/
+	virtual void removeNode(Node<T>* node);
+
+	/*
+	* Unlinks a node from the tree and destroys it. A node with two
+	* children is replaced by its inorder successor node, items are
+	* never copied.
+	* @param node The node to erase
+	* @return the lowest node whose subtree changed, nullptr if none
+	*/
+	Node<T>* eraseNode(Node<T>* node);
+
+	/*
+	* Rotates curr's right child into curr's place, both nodes
+	* are updated with fixNode
+	* @param curr The root of the subtree to rotate
+	* @return the new root of the subtree
+	*/
+	Node<T>* rotateLeft(Node<T>* curr);
+
+	/*
+	* Rotates curr's left child into curr's place, both nodes
+	* are updated with fixNode
+	* @param curr The root of the subtree to rotate
+	* @return the new root of the subtree
+	*/
+	Node<T>* rotateRight(Node<T>* curr);
+
+	/*
+	* Makes child take the place of old under parent, or the root
+	* when parent is nullptr
+	* @param parent The parent of old
+	* @param old The child being replaced
+	* @param child The new child, possibly nullptr
+	*/
+	void replaceChild(Node<T>* parent, Node<T>* old, Node<T>* child);
+
+	/*
+	* Makes root the root of the tree, possibly nullptr, without
+	* touching the nodes the tree held before. Derived trees fix what
+	* their rules ask of a root (RedBlackTree blackens it).
+	* @param root The new root
+	*/
+	virtual void setRoot(Node<T>* root);
+
+	/*
+	* The root of a subtree along with its rank, what joinNodes balances
+	* a RedBlackTree by (its black height). Splitting and joining keep
+	* the ranks of the pieces as they go, so no join measures a spine.
+	* Other trees keep what they balance by in their nodes and leave
+	* the rank at 0.
+	*/
+	struct Subtree {
+
+		Node<T>* root;
+
+		int rank;
+	};
+
+	/*
+	* Gets the rank of a subtree (see Subtree) by walking down it,
+	* only done once per split, join or set operation
+	* @param root The root of the subtree, possibly nullptr
+	* @return its rank, 0 for a plain tree
+	*/
+	virtual int rankOf(const Node<T>* root) const;
+
+	/*
+	* Gets how much a node adds to the rank of its children: the rank
+	* of each child is the rank of node less this
+	* @param node The node
+	* @return its part of the rank, 0 for a plain tree
+	*/
+	virtual int rankStep(const Node<T>* node) const;
+
+	/*
+	* Moves every item not less than key into right, cutting the path
+	* down to key and linking the pieces on each side back together
+	* with joinNodes, O(log n) when joinNodes balances. Nodes are
+	* relinked, never copied, and right uses this tree's arena.
+	* @param key The first item to move
+	* @param right An empty tree of the same type as this one
+	*/
+	void splitTree(const T& key, BinarySearchTree<T, Compare>& right);
+
+	/*
+	* Moves every item of right to the end of this tree: the smallest
+	* node of right is cut out and joinNodes links it between the two,
+	* O(log n) when joinNodes balances. When both arenas are already
+	* shared with other trees the items are moved one by one instead.
+	* @param right A tree of the same type as this one, left empty
+	* @throws std::invalid_argument if an item of right is not greater
+	*         than every item of this tree
+	*/
+	void joinTree(BinarySearchTree<T, Compare>& right);
+
+	/*
+	* Splits the subtree under root into the nodes before key, the node
+	* equivalent to key if any and the nodes after it: the path down to
+	* key is cut and the pieces on each side are linked back together
+	* with joinNodes, bottom up, O(log n) when joinNodes balances. The
+	* rank of each piece follows from the rank of root. Only nodes under
+	* root are touched, so different subtrees can be split on different
+	* threads.
+	* @param root The subtree, its root possibly nullptr
+	* @param key The item to split by
+	* @param lower Set to the nodes before key
+	* @param equal Set to the node equivalent to key, unlinked, or nullptr
+	* @param upper Set to the nodes after key
+	*/
+	void splitNodes(Subtree root, const T& key, Subtree& lower, Node<T>*& equal, Subtree& upper);
+
+	/*
+	* Links two subtrees, every item under lower before every item under
+	* upper: the smallest node of upper is cut out and joinNodes links
+	* it between the two
+	* @param lower The lower subtree, its root possibly nullptr
+	* @param upper The upper subtree, its root possibly nullptr
+	* @return the joined subtree
+	*/
+	Subtree concatNodes(Subtree lower, Subtree upper);
+
+	/*
+	* Recomputes the subtree sizes from curr up to the root
+	* @param curr The lowest node whose subtree changed
+	*/
+	static void fixSizes(Node<T>* curr);
+
+	/*
+	* Gets the subtree size of a possibly null node
+	* @param node The node
+	* @return its subtree size, 0 for nullptr
+	*/
+	static std::size_t sizeOf(const Node<T>* node);
+
+	/*
+	* Static helper function, gets the node with the smallest item under curr
+	* @param curr The root of the subtree, not nullptr
+	* @return the leftmost node
+	*/
+	static Node<T>* leftMost(Node<T>* curr);
+
+	/*
+	* Static helper function, gets the node with the largest item under curr
+	* @param curr The root of the subtree, not nullptr
+	* @return the rightmost node
+	*/
+	static Node<T>* rightMost(Node<T>* curr);
+
+	/*
+	* Static helper function, gets the root above curr by following
+	* parent pointers, for subtrees that are not the tree's root
+	* @param curr A node, not nullptr
+	* @return the node above curr without a parent
+	*/
+	static Node<T>* topOf(Node<T>* curr);
+
+	/*
+	* Static helper function, gets the inorder successor of curr
+	* @param curr The current node, not nullptr
+	* @return the next node in sorted order or nullptr
+	*/
+	static Node<T>* successor(const Node<T>* curr);
+
+	/*
+	* Static helper function, gets the inorder predecessor of curr
+	* @param curr The current node, not nullptr
+	* @return the previous node in sorted order or nullptr
+	*/
+	static Node<T>* predecessor(const Node<T>* curr);
+
+	/*
+	* Gets the root of the tree
+	* @return the root, possibly nullptr
+	*/
+	Node<T>* getRoot() const;
+
+	/*
+	* Gets the wrapped comparator that orders the items
+	* @return the comparator
+	*/
+	const KeyCompare<Compare>& getComparator() const;
+
+	/*
+	* Creates a node for item, derived trees create their own node types
+	* @param item The item for the node
+	* @return the new node
+	*/
+	virtual Node<T>* createNode(const T& item);
+
+	/*
+	* Creates a node moving item into it
+	* @param item The item for the node
+	* @return the new node
+	*/
+	virtual Node<T>* createNode(T&& item);
+
+	/*
+	* Creates a copy of other for copyNode, with its item and what it
+	* keeps about its subtree (its size, and its height in an AVLTree)
+	* @param other The node to copy, not linked to anything
+	* @return the new node
+	*/
+	virtual Node<T>* cloneNode(const Node<T>* other);
+
+	/*
+	* Recomputes what a node keeps about its subtree (its size, and its
+	* height in an AVLTree) from its children
+	* @param node The node to update
+	*/
+	virtual void fixNode(Node<T>* node);
+
+	/*
+	* Called after readTree or rebalance relinked every node into a tree
+	* of minimum height, for what depends on the shape of the whole tree
+	* (the colors of a RedBlackTree). Nothing to do for a plain tree.
+	*/
+	virtual void fixTree();
+
+	/*
+	* Links left, middle and right into one subtree, every item under
+	* left before middle and every item under right after it. Only the
+	* nodes of the three are touched, not the root of the tree, so
+	* different subtrees can be joined on different threads. A plain
+	* tree puts middle on top, balanced trees descend the taller side
+	* to where the other one fits and rebalance from there.
+	* @param left The lower subtree, its root possibly nullptr
+	* @param middle The node in between, its links are overwritten
+	* @param right The upper subtree, its root possibly nullptr
+	* @return the joined subtree
+	*/
+	virtual Subtree joinNodes(Subtree left, Node<T>* middle, Subtree right);
+
+	/*
+	* Makes this tree and other allocate from the same slabs so their
+	* nodes can be linked together (see NodeArena::absorb)
+	* @param other A tree of the same type as this one
+	* @return false if both arenas are already shared with other trees
+	*/
+	virtual bool shareNodes(BinarySearchTree<T, Compare>& other);
+
+	/*
+	* Destroys a node created by createNode
+	* @param node The node to destroy
+	*/
+	virtual void destroyNode(Node<T>* node);
+
+	/*
+	* Releases the memory of every node at once, their items
+	* must already be destroyed
+	*/
+	virtual void releaseNodes();
+
+	/*
+	* Checks if another tree allocates from the same slabs (after a
+	* split or join), then clear destroys the nodes one by one so the
+	* other tree can reuse their slots
+	* @return true if the node arena is shared
+	*/
+	virtual bool nodesShared() const;
+
+	/*
+	* Takes uninitialized storage for n nodes in a row from the arena
+	* @param n The number of nodes
+	* @return the storage, filled with createNodeAt
+	*/
+	virtual void* takeRun(std::size_t n);
+
+	/*
+	* Constructs node i of a run taken with takeRun, different nodes of
+	* the same run may be constructed from different threads
+	* @param run The storage returned by takeRun
+	* @param i The index of the node in the run
+	* @param item The item for the node
+	* @return the new node
+	*/
+	virtual Node<T>* createNodeAt(void* run, std::size_t i, const T& item);
+
+	/*
+	* Constructs node i of a run taken with takeRun moving item into it
+	* @param run The storage returned by takeRun
+	* @param i The index of the node in the run
+	* @param item The item for the node
+	* @return the new node
+	*/
+	virtual Node<T>* createNodeAt(void* run, std::size_t i, T&& item);
+
+	/*
+	* Gives back slot i of a run taken with takeRun that was never
+	* constructed, so it is reused like the slot of a destroyed node
+	* @param run The storage returned by takeRun
+	* @param i The index of the slot in the run
+	*/
+	virtual void recycleAt(void* run, std::size_t i);
+
+	/*
+	* Helper function, finds the node in the tree with the target item
+	* walking down from curr, one comparison per level
 	* @param curr The current node in the tree
-	* @param target The target item
+	* @param target The target item or key
 	* @return pointer to node with target item or nullptr if item not in tree
 	*/
-	static Node<T>* getNode(Node<T>* curr, const T& target);
+	template<class K>
+	Node<T>* getNode(Node<T>* curr, const K& target) const;
+
+	/*
+	* Helper function for the bounds, finds the first node not ordered
+	* before item, or with after set the first node ordered after item
+	* @param item The item to look for
+	* @param after true for the upper bound, false for the lower bound
+	* @return the node, nullptr if there is none
+	*/
+	Node<T>* boundNode(const T& item, bool after) const;
+
+	/*
+	* Helper function for containsBatch and findBatch, searches for
+	* BATCH_LOOKUPS keys side by side (asynchronous memory access
+	* chaining): each search in turn compares at its node, steps to a
+	* child and prefetches it, and by the time it comes round again the
+	* child has usually arrived. A finished search hands its slot to the
+	* next key, so the searches stay in flight for any tree shape.
+	* @param keys The keys to search for
+	* @param count The number of keys
+	* @param out Called as out(i, node) with the node equivalent to
+	*        keys[i], nullptr if there is none
+	*/
+	template<class Out>
+	void searchBatch(const T* keys, std::size_t count, Out out) const;
 
 	/*
 	* Static helper function for displaySideways
@@ -193,54 +1043,169 @@ protected:
 	static void sideways(Node<T>* curr, int level);
 
 	/*
-	* Static helper function for clear
-	* Deletes a nodes children and then deletes node (postorder traversal)
+	* Helper function for clear
+	* Destroys every node under curr through destroyNode, as the type
+	* the tree created it as, rotating left children up so the walk
+	* needs neither recursion nor a stack (see destroyNodes). The memory
+	* is left to the arena which releases it in bulk.
+	* Nothing is visited when T has a trivial destructor.
 	* @param curr The current node in the tree
-	* @return nullptr after all nodes deleted
+	* @return nullptr after all nodes destroyed
+	*/
+	Node<T>* deleteNodes(Node<T>* curr);
+
+	/*
+	* Static helper function for the traversals, gets the node after
+	* curr in preorder without leaving the subtree under root, walking
+	* parent pointers so no stack is needed
+	* @param curr The current node
+	* @param root The root of the subtree being walked
+	* @param depth The depth of curr, updated to the depth of the result
+	* @return the next node in preorder, nullptr after the last one
 	*/
-	static Node<T>* deleteNodes(Node<T>* curr);
+	static Node<T>* preorderNext(Node<T>* curr, const Node<T>* root, int& depth);
 
 private:
 
 	// Root of the tree
 	Node<T>* rootPtr;
 
+	// Storage for the nodes of a plain tree, created on first use so
+	// trees with their own node type (AVLTree) carry only a nullptr
+	std::unique_ptr<NodeArena<Node<T>>> nodes;
+
+	// Orders the items
+	KeyCompare<Compare> comp;
+
+	// Threads readTree and rebalance may use
+	unsigned threads;
+
+	// Fewest nodes worth handing to another thread
+	static const std::size_t PARALLEL_GRAIN = 1 << 14;
+
+	// Largest size of another tree, in percent of this one, unionWith adds item by item
+	static const std::size_t UNION_BY_ADD_PERCENT = 75;
+
+	// Searches containsBatch and findBatch keep in flight
+	static const std::size_t BATCH_LOOKUPS = 16;
+
 	/*
-	* Helper function for readTree, recursively adds each item
-	* in the array by finding the middle item for the next node
-	* @param arr The array of items
-	* @param first The first index to use in the array/subarray
-	* @param last  The  last index to use in the array/subarray
+	* Gets the node arena of a plain tree, creating it on first use
+	* @return the arena
 	*/
-	void readHelper(const T arr[], int first, int last);
+	NodeArena<Node<T>>& plainNodes();
 
 	/*
-	* Static helper function for remove, finds the node to remove and returns
-	* nullptr, nodes child or inorder successor to take its place
-	* @param curr The current node in the tree
-	* @param target The target item to remove
-	* @return curr after node has been deleted
+	* Helper function for readTree, builds a subtree of n nodes taking
+	* the items in order from next: the left subtree, then the node,
+	* then the right subtree. Nodes end up in memory in sorted order.
+	* @param next Iterator to the next unused item, advanced by n
+	* @param n The number of nodes in the subtree
+	* @return the root of the subtree
 	*/
-	static Node<T>* removeItem(Node<T>* curr, Node<T>* parent, const T& target);
+	template<class It>
+	Node<T>* readHelper(It& next, std::size_t n);
 
 	/*
-	* Static helper function for removeItem, deletes curr and returns nullptr,
-	* curr's child or curr's inorder successor to take its place
-	* @param curr The current node in the tree
-	* @return curr after node has been deleted and replaced
+	* Helper function for readTree, builds the subtree for items
+	* [first, first + n) of a random access range into a run of nodes,
+	* splitting the left and right halves across tasks threads
+	* @param items The whole sorted range
+	* @param run The storage for all nodes, node i holds items[i]
+	* @param first The index of the first item of the subtree
+	* @param n The number of nodes in the subtree
+	* @param tasks The number of threads this subtree may use
+	* @return the root of the subtree
 	*/
-	static Node<T>* removeNode(Node<T>* curr, Node<T>* parent);
+	template<class It>
+	Node<T>* readParallel(It items, void* run, std::size_t first, std::size_t n, unsigned tasks);
 
 	/*
-	* Static helper function for removeNode, gets the inorderSuccesor item
-	* to replace in node and deletes inorderSuccesor node
-	* @param curr The current node in the tree
-	* @param newItem The new item for the node
+	* Helper function for rebalance, relinks the nodes order[first, first + n)
+	* into a subtree of minimum height, splitting across tasks threads
+	* @param order All nodes in sorted order
+	* @param first The index of the first node of the subtree
+	* @param n The number of nodes in the subtree
+	* @param tasks The number of threads this subtree may use
+	* @return the root of the subtree
+	*/
+	Node<T>* linkParallel(Node<T>** order, std::size_t first, std::size_t n, unsigned tasks);
+
+	/*
+	* Static helper function for rebalance, writes the nodes under curr
+	* in sorted order to order[first, first + size), walking subtrees on
+	* up to tasks threads
+	* @param curr The root of the subtree
+	* @param order The array of all nodes
+	* @param first The index of curr's leftmost node
+	* @param tasks The number of threads this subtree may use
+	*/
+	static void gatherParallel(Node<T>* curr, Node<T>** order, std::size_t first, unsigned tasks);
+
+	/*
+	* Helper function for readTree, sorts items with the tree's
+	* comparator splitting the work across tasks threads
+	* @param first The first item
+	* @param last Past the last item
+	* @param tasks The number of threads to use
+	*/
+	void sortParallel(typename std::vector<T>::iterator first,
+	                  typename std::vector<T>::iterator last, unsigned tasks) const;
+
+	/*
+	* Helper function for unionWith, merges the items under other into
+	* the nodes under curr, splitting across tasks threads. The node for
+	* an item missing under curr is slot first + rank of the item under
+	* other of run, built already if built is not nullptr, the slots of
+	* items found are flagged in found. If a thread cannot be started
+	* the work stays on this one, so nothing here throws when copying T
+	* cannot.
+	* @param curr The subtree of this tree, its root possibly nullptr
+	* @param other The root of the subtree of the other tree, possibly nullptr
+	* @param run Storage for a node per item of the other tree
+	* @param built The nodes of the run in order, or nullptr to build them here
+	* @param found A flag per slot of the run, set for the items found
+	* @param first The slot for the smallest item under other
+	* @param tasks The number of threads this subtree may use
+	* @return the merged subtree
+	*/
+	Subtree unionParallel(Subtree curr, const Node<T>* other, void* run, Node<T>* const* built,
+	                      unsigned char* found, std::size_t first, unsigned tasks);
+
+	/*
+	* Helper function for intersect, keeps the nodes under curr whose
+	* items are under other, splitting across tasks threads
+	* @param curr The subtree of this tree, its root possibly nullptr
+	* @param other The root of the subtree of the other tree, possibly nullptr
+	* @param dropped The roots of the subtrees left out, appended to
+	* @param tasks The number of threads this subtree may use
+	* @return the nodes kept
+	*/
+	Subtree intersectParallel(Subtree curr, const Node<T>* other,
+	                          std::vector<Node<T>*>& dropped, unsigned tasks);
+
+	/*
+	* Helper function for difference, keeps the nodes under curr whose
+	* items are not under other, splitting across tasks threads
+	* @param curr The subtree of this tree, its root possibly nullptr
+	* @param other The root of the subtree of the other tree, possibly nullptr
+	* @param dropped The nodes left out, appended to
+	* @param tasks The number of threads this subtree may use
+	* @return the nodes kept
 	*/
-	static Node<T>* removeLeftMost(Node<T>* curr, Node<T>* parent, T* newItem);
+	Subtree differenceParallel(Subtree curr, const Node<T>* other,
+	                           std::vector<Node<T>*>& dropped, unsigned tasks);
 
 	/*
-	* Static helper function for removeNode to check
+	* Helper function for intersect, difference and eraseRange, destroys
+	* every node under curr one by one, rotating left children up so the
+	* walk needs neither recursion nor a stack
+	* @param curr The root of a subtree no longer linked to the tree
+	*/
+	void destroyNodes(Node<T>* curr);
+
+	/*
+	* Static helper function for eraseNode to check
 	* if curr has both children
 	* @param curr The current node in the tree
 	* @return true if has both children, false otherwise
@@ -248,60 +1213,58 @@ private:
 	static bool hasTwoChild(Node<T>* curr);
 
 	/*
-	* Static helper function for removeNode to get only child of curr
+	* Static helper function for eraseNode to get only child of curr
 	* @param curr The current node in the tree
 	* @return the only child of curr
 	*/
 	static Node<T>* only(Node<T>* curr);
 
 	/*
-	* Static helper function for copy constructor,
+	* Helper function for copy constructor,
 	* copies a given node and all its children (preorder traversal)
+	* walking parent pointers instead of recursing
 	* @param curr The current node in the first tree
 	* @param other the current node in the second tree to copy
 	* @return curr after all nodes have been copied
 	*/
-	static Node<T>* copyNode(Node<T>* curr, Node<T>* currParent, Node<T>* other);
+	Node<T>* copyNode(Node<T>* curr, Node<T>* currParent, Node<T>* other);
 
 	/*
-	* Static helper function for equality operator overload,
-	* compares nodes for equal items
+	* Helper function for equality operator overload, compares nodes
+	* for equivalent items and the same shape in one preorder walk
 	* @param curr The current node in the first tree
 	* @param other The current node in the second tree
 	*/
-	static bool equalNode(Node<T>* curr, Node<T>* other);
+	bool equalNode(Node<T>* curr, Node<T>* other) const;
 
 	/*
-	* Static helper function for getHeight,
-	* counts the height recursively by adding 1 at each lower level
+	* Static helper function for getHeight, finds the deepest
+	* node in a preorder walk that keeps track of the depth
 	* @param curr The current node in the tree
 	* @return the height of the tree as an int
 	*/
 	static int getHeight(Node<T>* curr);
 
 	/*
-	* Static helper function for getNumberOfNodes,
-	* counts the nodes by adding one at each node in postorder traversal
+	* Static helper function for inorder traverse, visits the items in place
+	* stepping from each node to its successor
 	* @param curr The current node in the tree
-	* @return the number of nodes in the tree as an int
+	* @param visit The visiting function on each item in tree
 	*/
-	static int getNodes(Node<T>* curr);
+	static void inorder(Node<T>* curr, void visit(T& item));
 
 	/*
-	* Static helper function for inorder traverse
-	* @param curr The current node in the tree
-	* @param visit The visiting function on each item in tree
+	* Helper function for rebalance, rotates right until every node
+	* has no left child, leaving a sorted "vine" down the right side
 	*/
-	static void inorder(Node<T>* curr, void visit(T& item));
+	void treeToVine();
 
 	/*
-	* Static helper function for rebalance, fills array with all items
-	* in sorted order with inorder traversal
-	* @param arr The array to fill
-	* @param curr The current node in the tree
-	* @param index The current index to insert in the array
+	* Helper function for rebalance, does count left rotations at every
+	* other node down the right spine starting at the root
+	* @param count The number of rotations
 	*/
-	static void toArray(T arr[], Node<T>* curr, int* index);
+	void compress(std::size_t count);
 
 	/*
 	* Helper for mystery function
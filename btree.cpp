@@ -0,0 +1,1351 @@
+/*
+* btree.cpp
+*
+* BTree implementations
+*
+* Nodes hold between MIN_ITEMS and MAX_ITEMS items, only the root may
+* hold fewer. Items live in raw storage inside the nodes and are
+* constructed, moved and destroyed by hand, so T needs no default
+* constructor and unused slots cost nothing.
+*
+* DO NOT compile this file, it is included at the bottom of btree.h
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+/*
+* Constructs empty tree
+*/
+template<class T, std::size_t Fanout, class Compare>
+BTree<T, Fanout, Compare>::BTree() :rootPtr(nullptr), count(0) {}
+
+/*
+* Constructs tree with a given item
+* @param item The first item
+*/
+template<class T, std::size_t Fanout, class Compare>
+BTree<T, Fanout, Compare>::BTree(const T& item) :rootPtr(nullptr), count(0) {
+
+	this->add(item);
+}
+
+/*
+* Copy constructor
+* @param other The other tree to copy
+*/
+template<class T, std::size_t Fanout, class Compare>
+BTree<T, Fanout, Compare>::BTree(const BTree<T, Fanout, Compare>& other)
+
+	:rootPtr(nullptr), count(0), comp(other.comp) {
+
+	*this = other;
+}
+
+/*
+* Destroys tree and deallocates all dynamic memory
+*/
+template<class T, std::size_t Fanout, class Compare>
+BTree<T, Fanout, Compare>::~BTree() {
+
+	this->clear();
+}
+
+/*
+* Assignment operator overload, makes this a deep copy of other
+* @param other The other tree to copy
+* @return this by reference
+*/
+template<class T, std::size_t Fanout, class Compare>
+BTree<T, Fanout, Compare>& BTree<T, Fanout, Compare>::operator=(const BTree<T, Fanout, Compare>& other) {
+
+	if (this != &other) {
+
+		this->clear();
+
+		if (other.rootPtr != nullptr) {
+
+			this->rootPtr = this->copyNode(other.rootPtr, nullptr);
+		}
+
+		this->count = other.count;
+	}
+
+	return *this;
+}
+
+/*
+* Checks if tree is empty
+* @return true if there are no items, false otherwise
+*/
+template<class T, std::size_t Fanout, class Compare>
+bool BTree<T, Fanout, Compare>::isEmpty() const {
+
+	return this->rootPtr == nullptr;
+}
+
+/*
+* Gets the height of the tree, the number of levels of nodes
+* @return the height of the tree
+*/
+template<class T, std::size_t Fanout, class Compare>
+int BTree<T, Fanout, Compare>::getHeight() const {
+
+	int height(0);
+
+	for (const LeafNode* node = this->rootPtr; node != nullptr;
+		 node = node->leaf ? nullptr : BTree::child(node, 0)) {
+
+		++height;
+	}
+
+	return height;
+}
+
+/*
+* Gets the amount of items in the tree in O(1), like
+* BinarySearchTree::getNumberOfNodes
+* @return the amount of items in the tree
+*/
+template<class T, std::size_t Fanout, class Compare>
+int BTree<T, Fanout, Compare>::getNumberOfNodes() const {
+
+	return static_cast<int>(this->count);
+}
+
+/*
+* Gets the amount of items in the tree in O(1)
+* @return the amount of items in the tree
+*/
+template<class T, std::size_t Fanout, class Compare>
+std::size_t BTree<T, Fanout, Compare>::size() const {
+
+	return this->count;
+}
+
+/*
+* Adds a given item to the tree, if not duplicate. Full nodes on the
+* way down are split first, so the item always fits in its leaf.
+* @param item The item to add
+* @return true if item added, false otherwise
+*/
+template<class T, std::size_t Fanout, class Compare>
+bool BTree<T, Fanout, Compare>::add(const T& item) {
+
+	if (this->rootPtr == nullptr) {
+
+		this->rootPtr = this->createNode(true, nullptr);
+
+	} else if (this->rootPtr->count == MAX_ITEMS) {
+
+		// the only way the tree grows taller
+		InnerNode* root = static_cast<InnerNode*>(this->createNode(false, nullptr));
+
+		root->children[0] = this->rootPtr;
+		this->rootPtr->parent = root;
+		this->rootPtr = root;
+
+		this->splitChild(root, 0);
+	}
+
+	LeafNode* node = this->rootPtr;
+
+	while (true) {
+
+		unsigned i = this->search(node, item);
+
+		if (i < node->count && !this->comp.less(item, node->items()[i])) {
+
+			return false;
+		}
+
+		if (node->leaf) {
+
+			BTree::insertItem(node, i, item);
+
+			++this->count;
+
+			return true;
+		}
+
+		InnerNode* inner = static_cast<InnerNode*>(node);
+
+		if (inner->children[i]->count == MAX_ITEMS) {
+
+			this->splitChild(inner, i);
+
+			// the middle item of the child moved up to index i
+			int order = this->comp.order(item, inner->items()[i]);
+
+			if (order == 0) {
+
+				return false;
+			}
+
+			if (order > 0) {
+
+				++i;
+			}
+		}
+
+		node = inner->children[i];
+	}
+}
+
+/*
+* Removes a given item from the tree if there. Nodes on the way down
+* that hold the fewest items allowed borrow from a sibling or merge
+* with it first, so taking an item out never leaves one too small.
+* @param item The item to remove
+* @return true if item removed, false otherwise
+*/
+template<class T, std::size_t Fanout, class Compare>
+bool BTree<T, Fanout, Compare>::remove(const T& item) {
+
+	LeafNode* node = this->rootPtr;
+
+	while (node != nullptr) {
+
+		unsigned i = this->search(node, item);
+
+		bool found = i < node->count && !this->comp.less(item, node->items()[i]);
+
+		if (node->leaf) {
+
+			if (!found) {
+
+				return false;
+			}
+
+			BTree::eraseItem(node, i);
+
+			--this->count;
+
+			// only the root can run out of items
+			if (node->count == 0) {
+
+				this->destroyNode(node);
+				this->rootPtr = nullptr;
+			}
+
+			return true;
+		}
+
+		InnerNode* inner = static_cast<InnerNode*>(node);
+
+		if (found) {
+
+			// replace the item with its predecessor or successor
+			// from a child that can spare one, or merge around it
+			if (inner->children[i]->count > MIN_ITEMS) {
+
+				this->takeLast(inner->children[i], inner->items()[i]);
+
+				--this->count;
+
+				return true;
+			}
+
+			if (inner->children[i + 1]->count > MIN_ITEMS) {
+
+				this->takeFirst(inner->children[i + 1], inner->items()[i]);
+
+				--this->count;
+
+				return true;
+			}
+
+			node = this->mergeChildren(inner, i);
+
+		} else {
+
+			node = this->fillChild(inner, i);
+		}
+	}
+
+	return false;
+}
+
+/*
+* Deletes all items in the tree
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::clear() {
+
+	if constexpr (!std::is_trivially_destructible<T>::value) {
+
+		if (this->rootPtr != nullptr) {
+
+			BTree::destroyItems(this->rootPtr);
+		}
+	}
+
+	this->rootPtr = nullptr;
+	this->count = 0;
+
+	this->leaves.reset();
+	this->inners.reset();
+}
+
+/*
+* Turns huge page backing of the node arenas on or off,
+* affects memory allocated from now on
+* @param enable true to use huge pages
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::useHugePages(bool enable) {
+
+	this->leaves.setHugePages(enable);
+	this->inners.setHugePages(enable);
+}
+
+/*
+* Checks for membership of given item
+* @param item The item to check for
+* @return true if tree contains item, false otherwise
+*/
+template<class T, std::size_t Fanout, class Compare>
+bool BTree<T, Fanout, Compare>::contains(const T& item) const {
+
+	return this->find(item);
+}
+
+/*
+* Checks for membership of a key of another type, only available when
+* Compare is transparent (has is_transparent), no item is constructed
+* @param key The key to check for
+* @return true if tree contains an item equivalent to key
+*/
+template<class T, std::size_t Fanout, class Compare>
+template<class K, class C, class>
+bool BTree<T, Fanout, Compare>::contains(const K& key) const {
+
+	return this->find(key);
+}
+
+/*
+* Prints the tree sideways, one line per node
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::displaySideways() const {
+
+	if (this->rootPtr != nullptr) {
+
+		BTree::sideways(this->rootPtr, 0);
+	}
+}
+
+/*
+* Inorder traversal, visits every item in sorted order
+* The function can modify the data in tree, but the
+* tree structure is not changed
+* Items are passed by reference, never copied
+* @param visit The function to visit on each item
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::inorderTraverse(void visit(T& item)) const {
+
+	if (this->rootPtr != nullptr) {
+
+		BTree::inorder(this->rootPtr, visit);
+	}
+}
+
+/*
+* Gets an iterator at the smallest item
+* @return iterator at the first item, end() if empty
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::Iterator BTree<T, Fanout, Compare>::begin() const {
+
+	const LeafNode* node = this->rootPtr;
+
+	while (node != nullptr && !node->leaf) {
+
+		node = BTree::child(node, 0);
+	}
+
+	return Iterator(node, 0, this);
+}
+
+/*
+* Gets the iterator past the largest item
+* @return the end iterator
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::Iterator BTree<T, Fanout, Compare>::end() const {
+
+	return Iterator(nullptr, 0, this);
+}
+
+/*
+* Gets a reverse iterator at the largest item
+* @return reverse iterator at the last item
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::reverse_iterator BTree<T, Fanout, Compare>::rbegin() const {
+
+	return reverse_iterator(this->end());
+}
+
+/*
+* Gets the reverse iterator past the smallest item
+* @return the reverse end iterator
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::reverse_iterator BTree<T, Fanout, Compare>::rend() const {
+
+	return reverse_iterator(this->begin());
+}
+
+/*
+* Clears the tree and then uses the given sorted array of length n
+* to create this tree
+* @param arr The given array of elements
+* @param n The size of the array
+* @return true if the array was not empty
+*/
+template<class T, std::size_t Fanout, class Compare>
+bool BTree<T, Fanout, Compare>::readTree(const T arr[], int n) {
+
+	return n > 0 && this->readTree(arr, arr + n);
+}
+
+/*
+* Clears the tree and builds it from the items in [first, last) in
+* O(n), each item is read once and the nodes are filled left to right.
+* Use std::make_move_iterator to move the items instead of copying.
+* @param first Forward iterator to the first item
+* @param last Iterator past the last item
+* @param sorted true if the items are sorted without duplicates,
+*        false to sort them and drop duplicates first
+* @return true if the range was not empty
+*/
+template<class T, std::size_t Fanout, class Compare>
+template<class It>
+bool BTree<T, Fanout, Compare>::readTree(It first, It last, bool sorted) {
+
+	if (!sorted) {
+
+		return this->readTree(std::vector<T>(first, last), false);
+	}
+
+	std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+
+	bool read(false);
+
+	if (n > 0) {
+
+		this->clear();
+
+		int height(1);
+
+		while (BTree::capacity(height) < n) {
+
+			++height;
+		}
+
+		this->rootPtr = this->readHelper(first, n, height, nullptr);
+		this->count = n;
+
+		read = true;
+	}
+
+	return read;
+}
+
+/*
+* Clears the tree and builds it in O(n), moving the items out of a vector
+* @param items The items, left in a valid but unspecified state
+* @param sorted true if the items are sorted without duplicates,
+*        false to sort them and drop duplicates first
+* @return true if items was not empty
+*/
+template<class T, std::size_t Fanout, class Compare>
+bool BTree<T, Fanout, Compare>::readTree(std::vector<T>&& items, bool sorted) {
+
+	if (!sorted) {
+
+		const KeyCompare<Compare>& comp = this->comp;
+
+		std::sort(items.begin(), items.end(), [&comp](const T& a, const T& b) {
+
+			return comp.less(a, b);
+		});
+
+		items.erase(std::unique(items.begin(), items.end(), [&comp](const T& a, const T& b) {
+
+			return comp.equivalent(a, b);
+
+		}), items.end());
+	}
+
+	return this->readTree(std::make_move_iterator(items.begin()),
+	                      std::make_move_iterator(items.end()));
+}
+
+/*
+* Equality operator overload
+* @param other The other tree to compare to
+* @return true if both trees hold equivalent items, false otherwise
+*/
+template<class T, std::size_t Fanout, class Compare>
+bool BTree<T, Fanout, Compare>::operator==(const BTree<T, Fanout, Compare>& other) const {
+
+	const KeyCompare<Compare>& comp = this->comp;
+
+	return this->count == other.count &&
+	       std::equal(this->begin(), this->end(), other.begin(), [&comp](const T& a, const T& b) {
+
+		return comp.equivalent(a, b);
+	});
+}
+
+/*
+* Inequality operator overload
+* @param other The other tree to compare to
+* @return true if the trees hold different items, false otherwise
+*/
+template<class T, std::size_t Fanout, class Compare>
+bool BTree<T, Fanout, Compare>::operator!=(const BTree<T, Fanout, Compare>& other) const {
+
+	return !(*this == other);
+}
+
+/*
+* Gets the root of the tree
+* @return the root, nullptr if empty
+*/
+template<class T, std::size_t Fanout, class Compare>
+const typename BTree<T, Fanout, Compare>::LeafNode* BTree<T, Fanout, Compare>::getRoot() const {
+
+	return this->rootPtr;
+}
+
+/*
+* Finds the position of a key in a node: the index of the
+* first item that is not ordered before key
+* @param node The node to search
+* @param key The key to look for
+* @return the index, node->count if every item is before key
+*/
+template<class T, std::size_t Fanout, class Compare>
+template<class K>
+unsigned BTree<T, Fanout, Compare>::search(const LeafNode* node, const K& key) const {
+
+	const T* items = node->items();
+
+	if constexpr (SimdSearch::applies<T, Compare>() && std::is_same<K, T>::value) {
+
+		// no branch to mispredict, a few vector compares for a whole node
+		return SimdSearch::countLess(items, node->count, key);
+
+	} else {
+
+		unsigned low(0), high(node->count);
+
+		while (low < high) {
+
+			unsigned mid = (low + high) / 2;
+
+			if (this->comp.less(items[mid], key)) {
+
+				low = mid + 1;
+
+			} else {
+
+				high = mid;
+			}
+		}
+
+		return low;
+	}
+}
+
+/*
+* Helper function for contains, finds a key from the root down
+* @param key The key to look for
+* @return true if an equivalent item is in the tree
+*/
+template<class T, std::size_t Fanout, class Compare>
+template<class K>
+bool BTree<T, Fanout, Compare>::find(const K& key) const {
+
+	const LeafNode* node = this->rootPtr;
+
+	while (node != nullptr) {
+
+		unsigned i = this->search(node, key);
+
+		if (i < node->count && !this->comp.less(key, node->items()[i])) {
+
+			return true;
+		}
+
+		node = node->leaf ? nullptr : BTree::child(node, i);
+	}
+
+	return false;
+}
+
+/*
+* Creates an empty node
+* @param leaf true for a leaf, false for an inner node
+* @param parent The parent of the node
+* @return the new node
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::LeafNode* BTree<T, Fanout, Compare>::createNode(bool leaf, InnerNode* parent) {
+
+	if (leaf) {
+
+		return this->leaves.create(true, parent);
+	}
+
+	return this->inners.create(parent);
+}
+
+/*
+* Destroys a node whose items were already destroyed or moved out
+* @param node The node to destroy
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::destroyNode(LeafNode* node) {
+
+	if (node->leaf) {
+
+		this->leaves.destroy(node);
+
+	} else {
+
+		this->inners.destroy(static_cast<InnerNode*>(node));
+	}
+}
+
+/*
+* Splits the full child i of parent in two around its middle
+* item, which moves up into parent at index i
+* @param parent The parent, not full
+* @param i The index of the child to split
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::splitChild(InnerNode* parent, unsigned i) {
+
+	LeafNode* left = parent->children[i];
+	LeafNode* right = this->createNode(left->leaf, parent);
+
+	// MIN_ITEMS items stay, MIN_ITEMS move right and the middle one moves up
+	BTree::relocate(left->items() + MIN_ITEMS + 1, right->items(), MIN_ITEMS);
+
+	right->count = MIN_ITEMS;
+
+	if (!left->leaf) {
+
+		InnerNode* from = static_cast<InnerNode*>(left);
+		InnerNode* to = static_cast<InnerNode*>(right);
+
+		std::copy(from->children + MIN_ITEMS + 1, from->children + Fanout, to->children);
+
+		BTree::adoptChildren(to, 0, MIN_ITEMS + 1);
+	}
+
+	for (unsigned j(parent->count); j > i; --j) {
+
+		parent->children[j + 1] = parent->children[j];
+	}
+
+	parent->children[i + 1] = right;
+
+	T& middle = left->items()[MIN_ITEMS];
+
+	BTree::insertItem(parent, i, std::move(middle));
+
+	middle.~T();
+
+	left->count = MIN_ITEMS;
+}
+
+/*
+* Merges child i of parent, the item i of parent and child i + 1
+* into child i. When parent is the root and loses its last item
+* the merged child becomes the root.
+* @param parent The parent
+* @param i The index of the left child
+* @return the merged child
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::LeafNode* BTree<T, Fanout, Compare>::mergeChildren(InnerNode* parent, unsigned i) {
+
+	LeafNode* left = parent->children[i];
+	LeafNode* right = parent->children[i + 1];
+
+	T* items = left->items();
+
+	::new (static_cast<void*>(items + left->count)) T(std::move(parent->items()[i]));
+
+	BTree::relocate(right->items(), items + left->count + 1, right->count);
+
+	if (!left->leaf) {
+
+		InnerNode* to = static_cast<InnerNode*>(left);
+		InnerNode* from = static_cast<InnerNode*>(right);
+
+		std::copy(from->children, from->children + right->count + 1, to->children + left->count + 1);
+
+		BTree::adoptChildren(to, left->count + 1, left->count + right->count + 2);
+	}
+
+	left->count += right->count + 1;
+
+	BTree::eraseItem(parent, i);
+
+	for (unsigned j(i + 1); j <= parent->count; ++j) {
+
+		parent->children[j] = parent->children[j + 1];
+	}
+
+	this->destroyNode(right);
+
+	// the tree gets shorter
+	if (parent->count == 0) {
+
+		this->destroyNode(parent);
+
+		left->parent = nullptr;
+		this->rootPtr = left;
+	}
+
+	return left;
+}
+
+/*
+* Makes sure child i of parent has more than MIN_ITEMS items, by
+* borrowing an item through parent from a sibling or merging with one
+* @param parent The parent
+* @param i The index of the child, updated if the child merged left
+* @return the child to descend into
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::LeafNode* BTree<T, Fanout, Compare>::fillChild(InnerNode* parent, unsigned& i) {
+
+	LeafNode* node = parent->children[i];
+
+	if (node->count > MIN_ITEMS) {
+
+		return node;
+	}
+
+	if (i > 0 && parent->children[i - 1]->count > MIN_ITEMS) {
+
+		// the separator comes down in front, the left sibling's last item goes up
+		LeafNode* left = parent->children[i - 1];
+
+		T& last = left->items()[left->count - 1];
+
+		BTree::insertItem(node, 0, std::move(parent->items()[i - 1]));
+
+		parent->items()[i - 1] = std::move(last);
+
+		last.~T();
+
+		if (!node->leaf) {
+
+			InnerNode* to = static_cast<InnerNode*>(node);
+
+			for (unsigned j(to->count); j > 0; --j) {
+
+				to->children[j] = to->children[j - 1];
+			}
+
+			to->children[0] = static_cast<InnerNode*>(left)->children[left->count];
+			to->children[0]->parent = to;
+		}
+
+		--left->count;
+
+	} else if (i < parent->count && parent->children[i + 1]->count > MIN_ITEMS) {
+
+		// the separator comes down at the end, the right sibling's first item goes up
+		LeafNode* right = parent->children[i + 1];
+
+		BTree::insertItem(node, node->count, std::move(parent->items()[i]));
+
+		parent->items()[i] = std::move(right->items()[0]);
+
+		if (!node->leaf) {
+
+			InnerNode* to = static_cast<InnerNode*>(node);
+			InnerNode* from = static_cast<InnerNode*>(right);
+
+			to->children[to->count] = from->children[0];
+			to->children[to->count]->parent = to;
+
+			for (unsigned j(0); j < from->count; ++j) {
+
+				from->children[j] = from->children[j + 1];
+			}
+		}
+
+		BTree::eraseItem(right, 0);
+
+	} else {
+
+		if (i == parent->count) {
+
+			--i;
+		}
+
+		node = this->mergeChildren(parent, i);
+	}
+
+	return node;
+}
+
+/*
+* Moves the largest item of a subtree out of its leaf, refilling
+* nodes on the way down like remove
+* @param node The root of the subtree, more than MIN_ITEMS items
+* @param dest The item to move the largest item into
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::takeLast(LeafNode* node, T& dest) {
+
+	while (!node->leaf) {
+
+		unsigned i = node->count;
+
+		node = this->fillChild(static_cast<InnerNode*>(node), i);
+	}
+
+	dest = std::move(node->items()[node->count - 1]);
+
+	BTree::eraseItem(node, node->count - 1);
+}
+
+/*
+* Moves the smallest item of a subtree out of its leaf, refilling
+* nodes on the way down like remove
+* @param node The root of the subtree, more than MIN_ITEMS items
+* @param dest The item to move the smallest item into
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::takeFirst(LeafNode* node, T& dest) {
+
+	while (!node->leaf) {
+
+		unsigned i(0);
+
+		node = this->fillChild(static_cast<InnerNode*>(node), i);
+	}
+
+	dest = std::move(node->items()[0]);
+
+	BTree::eraseItem(node, 0);
+}
+
+/*
+* Helper function for readTree, builds a subtree of a given height
+* holding the next n items, taking them in order from next. Each inner
+* node gets as few children as can hold its items, but at least half
+* of Fanout below the root, and the items are spread evenly over them.
+* @param next Iterator to the next unused item, advanced by n
+* @param n The number of items in the subtree
+* @param height The height of the subtree
+* @param parent The parent of the subtree
+* @return the root of the subtree
+*/
+template<class T, std::size_t Fanout, class Compare>
+template<class It>
+typename BTree<T, Fanout, Compare>::LeafNode* BTree<T, Fanout, Compare>::readHelper(It& next, std::size_t n, int height, InnerNode* parent) {
+
+	LeafNode* node = this->createNode(height == 1, parent);
+
+	T* items = node->items();
+
+	if (height == 1) {
+
+		for (; node->count < n; ++node->count, ++next) {
+
+			::new (static_cast<void*>(items + node->count)) T(*next);
+		}
+
+		return node;
+	}
+
+	InnerNode* inner = static_cast<InnerNode*>(node);
+
+	std::size_t below = BTree::capacity(height - 1);
+	std::size_t children = (n + below + 1) / (below + 1);
+
+	if (parent != nullptr && children < Fanout / 2) {
+
+		children = Fanout / 2;
+	}
+
+	std::size_t share = (n + 1 - children) / children;
+	std::size_t extra = (n + 1 - children) % children;
+
+	for (std::size_t c(0); c < children; ++c) {
+
+		inner->children[c] = this->readHelper(next, share + (c < extra), height - 1, inner);
+
+		if (c + 1 < children) {
+
+			::new (static_cast<void*>(items + c)) T(*next);
+
+			++node->count;
+			++next;
+		}
+	}
+
+	return node;
+}
+
+/*
+* Helper function for operator=, copies a subtree
+* @param other The root of the subtree to copy
+* @param parent The parent of the copy
+* @return the root of the copy
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::LeafNode* BTree<T, Fanout, Compare>::copyNode(const LeafNode* other, InnerNode* parent) {
+
+	LeafNode* node = this->createNode(other->leaf, parent);
+
+	for (; node->count < other->count; ++node->count) {
+
+		::new (static_cast<void*>(node->items() + node->count)) T(other->items()[node->count]);
+	}
+
+	if (!node->leaf) {
+
+		InnerNode* inner = static_cast<InnerNode*>(node);
+
+		for (unsigned c(0); c <= node->count; ++c) {
+
+			inner->children[c] = this->copyNode(BTree::child(other, c), inner);
+		}
+	}
+
+	return node;
+}
+
+/*
+* Helper function for clear, destroys the items of a subtree
+* @param node The root of the subtree
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::destroyItems(LeafNode* node) {
+
+	for (unsigned i(0); i < node->count; ++i) {
+
+		node->items()[i].~T();
+	}
+
+	if (!node->leaf) {
+
+		for (unsigned c(0); c <= node->count; ++c) {
+
+			BTree::destroyItems(static_cast<InnerNode*>(node)->children[c]);
+		}
+	}
+}
+
+/*
+* Gets the most items a subtree of a given height can hold
+* @param height The height of the subtree
+* @return the number of items
+*/
+template<class T, std::size_t Fanout, class Compare>
+std::size_t BTree<T, Fanout, Compare>::capacity(int height) {
+
+	std::size_t items(MAX_ITEMS);
+
+	for (int level(1); level < height; ++level) {
+
+		items = items * Fanout + MAX_ITEMS;
+	}
+
+	return items;
+}
+
+/*
+* Gets the child of an inner node
+* @param node The inner node
+* @param i The index of the child
+* @return the child
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::LeafNode* BTree<T, Fanout, Compare>::child(const LeafNode* node, unsigned i) {
+
+	return static_cast<const InnerNode*>(node)->children[i];
+}
+
+/*
+* Gets the index of a node among its parent's children
+* @param node The node, not the root
+* @return the index
+*/
+template<class T, std::size_t Fanout, class Compare>
+unsigned BTree<T, Fanout, Compare>::childIndex(const LeafNode* node) {
+
+	unsigned i(0);
+
+	while (node->parent->children[i] != node) {
+
+		++i;
+	}
+
+	return i;
+}
+
+/*
+* Sets the parent of children [first, last) of an inner node
+* @param node The inner node
+* @param first The first child
+* @param last Past the last child
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::adoptChildren(InnerNode* node, unsigned first, unsigned last) {
+
+	for (unsigned c(first); c < last; ++c) {
+
+		node->children[c]->parent = node;
+	}
+}
+
+/*
+* Constructs an item at index i of node, moving the items
+* from i on one place right
+* @param node The node, not full
+* @param i The index of the new item
+* @param item The item
+*/
+template<class T, std::size_t Fanout, class Compare>
+template<class U>
+void BTree<T, Fanout, Compare>::insertItem(LeafNode* node, unsigned i, U&& item) {
+
+	T* items = node->items();
+
+	if constexpr (std::is_nothrow_constructible<T, U&&>::value) {
+
+		BTree::relocate(items + i, items + i + 1, node->count - i);
+
+		::new (static_cast<void*>(items + i)) T(std::forward<U>(item));
+
+	} else {
+
+		// a copy that throws must leave the node as it was
+		T made(std::forward<U>(item));
+
+		BTree::relocate(items + i, items + i + 1, node->count - i);
+
+		::new (static_cast<void*>(items + i)) T(std::move(made));
+	}
+
+	++node->count;
+}
+
+/*
+* Destroys the item at index i of node, moving the
+* items after it one place left
+* @param node The node
+* @param i The index of the item
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::eraseItem(LeafNode* node, unsigned i) {
+
+	T* items = node->items();
+
+	items[i].~T();
+
+	BTree::relocate(items + i + 1, items + i, node->count - i - 1);
+
+	--node->count;
+}
+
+/*
+* Moves n items to uninitialized storage, the sources are destroyed.
+* The ranges may overlap.
+* @param from The first item to move
+* @param to The first slot to move to
+* @param n The number of items
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::relocate(T* from, T* to, unsigned n) {
+
+	if constexpr (std::is_trivially_copyable<T>::value) {
+
+		std::memmove(static_cast<void*>(to), static_cast<const void*>(from), n * sizeof(T));
+
+	} else if (to < from) {
+
+		for (unsigned i(0); i < n; ++i) {
+
+			::new (static_cast<void*>(to + i)) T(std::move(from[i]));
+
+			from[i].~T();
+		}
+
+	} else {
+
+		for (unsigned i(n); i > 0; --i) {
+
+			::new (static_cast<void*>(to + i - 1)) T(std::move(from[i - 1]));
+
+			from[i - 1].~T();
+		}
+	}
+}
+
+/*
+* Static helper function for displaySideways, the larger half of the
+* children is printed above the node and the smaller half below it
+* @param node The current node in the tree
+* @param level The current level in the tree
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::sideways(const LeafNode* node, int level) {
+
+	unsigned half = node->count / 2;
+
+	if (!node->leaf) {
+
+		for (unsigned c(node->count); c > half; --c) {
+
+			BTree::sideways(BTree::child(node, c), level + 1);
+		}
+	}
+
+	for (int i(level); i >= 0; --i) {
+
+		std::cout << "    ";
+	}
+
+	for (unsigned i(0); i < node->count; ++i) {
+
+		std::cout << ((i > 0) ? " " : "") << node->items()[i];
+	}
+
+	std::cout << std::endl;
+
+	if (!node->leaf) {
+
+		for (unsigned c(half + 1); c > 0; --c) {
+
+			BTree::sideways(BTree::child(node, c - 1), level + 1);
+		}
+	}
+}
+
+/*
+* Helper function for inorderTraverse
+* @param node The current node in the tree
+* @param visit The function to visit on each item
+*/
+template<class T, std::size_t Fanout, class Compare>
+void BTree<T, Fanout, Compare>::inorder(const LeafNode* node, void visit(T& item)) {
+
+	T* items = const_cast<LeafNode*>(node)->items();
+
+	for (unsigned i(0); i <= node->count; ++i) {
+
+		if (!node->leaf) {
+
+			BTree::inorder(BTree::child(node, i), visit);
+		}
+
+		if (i < node->count) {
+
+			visit(items[i]);
+		}
+	}
+}
+
+/*
+* Constructs an iterator that belongs to no tree
+*/
+template<class T, std::size_t Fanout, class Compare>
+BTree<T, Fanout, Compare>::Iterator::Iterator() :curr(nullptr), index(0), tree(nullptr) {}
+
+/*
+* Constructs an iterator at an item of node, nullptr is end()
+* @param node The node at the iterator
+* @param index The index of the item in node
+* @param tree The tree the node belongs to
+*/
+template<class T, std::size_t Fanout, class Compare>
+BTree<T, Fanout, Compare>::Iterator::Iterator(const LeafNode* node, unsigned index, const BTree<T, Fanout, Compare>* tree)
+
+	:curr(node), index(index), tree(tree) {}
+
+/*
+* Gets the item at the iterator
+* @return the item by reference
+*/
+template<class T, std::size_t Fanout, class Compare>
+const T& BTree<T, Fanout, Compare>::Iterator::operator*() const {
+
+	return this->curr->items()[this->index];
+}
+
+/*
+* Gets the address of the item at the iterator
+* @return pointer to the item
+*/
+template<class T, std::size_t Fanout, class Compare>
+const T* BTree<T, Fanout, Compare>::Iterator::operator->() const {
+
+	return this->curr->items() + this->index;
+}
+
+/*
+* Moves to the next item in sorted order
+* @return this by reference
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::Iterator& BTree<T, Fanout, Compare>::Iterator::operator++() {
+
+	const LeafNode* node = this->curr;
+
+	if (!node->leaf) {
+
+		// leftmost item right of the current one
+		node = BTree::child(node, this->index + 1);
+
+		while (!node->leaf) {
+
+			node = BTree::child(node, 0);
+		}
+
+		this->curr = node;
+		this->index = 0;
+
+	} else if (this->index + 1 < node->count) {
+
+		++this->index;
+
+	} else {
+
+		// first ancestor with an item right of the subtree left behind
+		this->curr = nullptr;
+		this->index = 0;
+
+		while (node->parent != nullptr) {
+
+			unsigned i = BTree::childIndex(node);
+
+			node = node->parent;
+
+			if (i < node->count) {
+
+				this->curr = node;
+				this->index = i;
+
+				break;
+			}
+		}
+	}
+
+	return *this;
+}
+
+/*
+* Moves to the next item in sorted order
+* @return the iterator before moving
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::Iterator BTree<T, Fanout, Compare>::Iterator::operator++(int) {
+
+	Iterator before(*this);
+
+	++(*this);
+
+	return before;
+}
+
+/*
+* Moves to the previous item in sorted order, end() moves to the last item
+* @return this by reference
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::Iterator& BTree<T, Fanout, Compare>::Iterator::operator--() {
+
+	const LeafNode* node = this->curr;
+
+	if (node == nullptr || !node->leaf) {
+
+		// rightmost item of the tree, or left of the current one
+		node = (node == nullptr) ? this->tree->rootPtr : BTree::child(node, this->index);
+
+		while (!node->leaf) {
+
+			node = BTree::child(node, node->count);
+		}
+
+		this->curr = node;
+		this->index = node->count - 1;
+
+	} else if (this->index > 0) {
+
+		--this->index;
+
+	} else {
+
+		// first ancestor with an item left of the subtree left behind
+		while (node->parent != nullptr) {
+
+			unsigned i = BTree::childIndex(node);
+
+			node = node->parent;
+
+			if (i > 0) {
+
+				this->curr = node;
+				this->index = i - 1;
+
+				break;
+			}
+		}
+	}
+
+	return *this;
+}
+
+/*
+* Moves to the previous item in sorted order, end() moves to the last item
+* @return the iterator before moving
+*/
+template<class T, std::size_t Fanout, class Compare>
+typename BTree<T, Fanout, Compare>::Iterator BTree<T, Fanout, Compare>::Iterator::operator--(int) {
+
+	Iterator before(*this);
+
+	--(*this);
+
+	return before;
+}
+
+/*
+* Equality operator overload
+* @param other The other iterator
+* @return true if both are at the same item
+*/
+template<class T, std::size_t Fanout, class Compare>
+bool BTree<T, Fanout, Compare>::Iterator::operator==(const Iterator& other) const {
+
+	return this->curr == other.curr && this->index == other.index;
+}
+
+/*
+* Inequality operator overload
+* @param other The other iterator
+* @return true if the iterators are at different items
+*/
+template<class T, std::size_t Fanout, class Compare>
+bool BTree<T, Fanout, Compare>::Iterator::operator!=(const Iterator& other) const {
+
+	return !(*this == other);
+}
@@ -0,0 +1,610 @@
+/*
+* btree.h
+*
+* BTree specs
+*
+* A BTree keeps up to Fanout - 1 sorted items in each node and up to
+* Fanout children in each inner node, and every leaf is at the same depth.
+* Nodes are aligned to cache lines and their items are stored side by
+* side, so a lookup in a tree of n items touches about log(n) / log(Fanout)
+* nodes instead of the log(n) scattered nodes of a binary tree, and the
+* search inside a node reads a few consecutive cache lines. For large
+* in-memory indexes it is the container to use.
+*
+* It has the same interface as BinarySearchTree (add, remove, contains,
+* iterators, inorderTraverse, readTree, equality) except for what only
+* makes sense for binary nodes. It never needs rebalancing: adding splits
+* full nodes on the way down and removing refills nodes that would get
+* too small, so every operation is O(log n).
+*
+* The default Fanout fills about four cache lines with items, 64 for int
+* and 8 for std::string. Inside a node, arithmetic items ordered by
+* std::less are found by counting the items before the key in one linear
+* pass with SimdSearch::countLess (AVX2 or SSE4.2 when the processor has
+* it, see simd.h), others by binary search.
+*/
+
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <vector>
+#include "arena.h"
+#include "compare.h"
+#include "simd.h"
+
+/*
+* Gets the default fanout of a BTree of T, an even number of children
+* whose items fill about four cache lines, between 8 and 64
+* @return the default fanout
+*/
+template<class T>
+constexpr std::size_t btreeFanout() {
+
+	std::size_t fanout = 256 / sizeof(T);
+
+	fanout = (fanout < 8) ? 8 : ((fanout > 64) ? 64 : fanout);
+
+	return fanout - fanout % 2;
+}
+
+/*
+* Cache friendly B-tree
+*
+* @author Juan Arias
+*
+*/
+template<class T, std::size_t Fanout = btreeFanout<T>(), class Compare = std::less<T>>
+class BTree {
+
+	static_assert(Fanout >= 4 && Fanout % 2 == 0, "Fanout must be even and at least 4");
+
+protected:
+
+	struct InnerNode;
+
+	/*
+	* A leaf, and the first part of every inner node: the items,
+	* which are constructed only in the first count slots
+	*/
+	struct alignas(64) LeafNode {
+
+		/*
+		* Constructs a node with no items
+		* @param leaf true for a leaf, false for the base of an inner node
+		* @param parent The parent of the node
+		*/
+		LeafNode(bool leaf, InnerNode* parent) :parent(parent), count(0), leaf(leaf) {}
+
+		InnerNode* parent;
+
+		unsigned count;
+
+		bool leaf;
+
+		alignas(T) unsigned char storage[sizeof(T) * (Fanout - 1)];
+
+		/*
+		* Gets the items of the node
+		* @return pointer to the first item
+		*/
+		T* items() {
+
+			return std::launder(reinterpret_cast<T*>(this->storage));
+		}
+
+		/*
+		* Gets the items of the node
+		* @return pointer to the first item
+		*/
+		const T* items() const {
+
+			return std::launder(reinterpret_cast<const T*>(this->storage));
+		}
+	};
+
+	/*
+	* An inner node, children[i] holds the items between items()[i - 1]
+	* and items()[i], count + 1 children are in use
+	*/
+	struct InnerNode : LeafNode {
+
+		/*
+		* Constructs an inner node with no items and no children
+		* @param parent The parent of the node
+		*/
+		explicit InnerNode(InnerNode* parent) :LeafNode(false, parent) {}
+
+		LeafNode* children[Fanout];
+	};
+
+public:
+
+	/*
+	* Bidirectional iterator over the items in sorted order. It steps
+	* through a node's items in place and climbs parent pointers between
+	* nodes, amortized O(1) without recursion. Items are read only.
+	*/
+	class Iterator {
+
+	public:
+
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T* pointer;
+		typedef const T& reference;
+
+		/*
+		* Constructs an iterator that belongs to no tree
+		*/
+		Iterator();
+
+		/*
+		* Gets the item at the iterator
+		* @return the item by reference
+		*/
+		reference operator*() const;
+
+		/*
+		* Gets the address of the item at the iterator
+		* @return pointer to the item
+		*/
+		pointer operator->() const;
+
+		/*
+		* Moves to the next item in sorted order
+		* @return this by reference
+		*/
+		Iterator& operator++();
+
+		/*
+		* Moves to the next item in sorted order
+		* @return the iterator before moving
+		*/
+		Iterator operator++(int);
+
+		/*
+		* Moves to the previous item in sorted order, end() moves to the last item
+		* @return this by reference
+		*/
+		Iterator& operator--();
+
+		/*
+		* Moves to the previous item in sorted order, end() moves to the last item
+		* @return the iterator before moving
+		*/
+		Iterator operator--(int);
+
+		/*
+		* Equality operator overload
+		* @param other The other iterator
+		* @return true if both are at the same item
+		*/
+		bool operator==(const Iterator& other) const;
+
+		/*
+		* Inequality operator overload
+		* @param other The other iterator
+		* @return true if the iterators are at different items
+		*/
+		bool operator!=(const Iterator& other) const;
+
+	private:
+
+		friend class BTree<T, Fanout, Compare>;
+
+		/*
+		* Constructs an iterator at an item of node, nullptr is end()
+		* @param node The node at the iterator
+		* @param index The index of the item in node
+		* @param tree The tree the node belongs to
+		*/
+		Iterator(const LeafNode* node, unsigned index, const BTree<T, Fanout, Compare>* tree);
+
+		// Node at the iterator, nullptr at end()
+		const LeafNode* curr;
+
+		// Index of the item in curr
+		unsigned index;
+
+		// Tree iterated, needed to step back from end()
+		const BTree<T, Fanout, Compare>* tree;
+	};
+
+	typedef Iterator iterator;
+	typedef Iterator const_iterator;
+	typedef std::reverse_iterator<Iterator> reverse_iterator;
+	typedef std::reverse_iterator<Iterator> const_reverse_iterator;
+
+	/*
+	* Constructs empty tree
+	*/
+	BTree();
+
+	/*
+	* Constructs tree with a given item
+	* @param item The first item
+	*/
+	explicit BTree(const T& item);
+
+	/*
+	* Copy constructor
+	* @param other The other tree to copy
+	*/
+	BTree(const BTree<T, Fanout, Compare>& other);
+
+	/*
+	* Destroys tree and deallocates all dynamic memory
+	*/
+	virtual ~BTree();
+
+	/*
+	* Assignment operator overload, makes this a deep copy of other
+	* @param other The other tree to copy
+	* @return this by reference
+	*/
+	BTree<T, Fanout, Compare>& operator=(const BTree<T, Fanout, Compare>& other);
+
+	/*
+	* Checks if tree is empty
+	* @return true if there are no items, false otherwise
+	*/
+	bool isEmpty() const;
+
+	/*
+	* Gets the height of the tree, the number of levels of nodes
+	* @return the height of the tree
+	*/
+	int getHeight() const;
+
+	/*
+	* Gets the amount of items in the tree in O(1), like
+	* BinarySearchTree::getNumberOfNodes
+	* @return the amount of items in the tree
+	*/
+	int getNumberOfNodes() const;
+
+	/*
+	* Gets the amount of items in the tree in O(1)
+	* @return the amount of items in the tree
+	*/
+	std::size_t size() const;
+
+	/*
+	* Adds a given item to the tree, if not duplicate. Full nodes on the
+	* way down are split first, so the item always fits in its leaf.
+	* @param item The item to add
+	* @return true if item added, false otherwise
+	*/
+	bool add(const T& item);
+
+	/*
+	* Removes a given item from the tree if there. Nodes on the way down
+	* that hold the fewest items allowed borrow from a sibling or merge
+	* with it first, so taking an item out never leaves one too small.
+	* @param item The item to remove
+	* @return true if item removed, false otherwise
+	*/
+	bool remove(const T& item);
+
+	/*
+	* Deletes all items in the tree
+	*/
+	void clear();
+
+	/*
+	* Turns huge page backing of the node arenas on or off,
+	* affects memory allocated from now on
+	* @param enable true to use huge pages
+	*/
+	void useHugePages(bool enable);
+
+	/*
+	* Checks for membership of given item
+	* @param item The item to check for
+	* @return true if tree contains item, false otherwise
+	*/
+	bool contains(const T& item) const;
+
+	/*
+	* Checks for membership of a key of another type, only available when
+	* Compare is transparent (has is_transparent), no item is constructed
+	* @param key The key to check for
+	* @return true if tree contains an item equivalent to key
+	*/
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	bool contains(const K& key) const;
+
+	/*
+	* Prints the tree sideways, one line per node
+	*/
+	void displaySideways() const;
+
+	/*
+	* Inorder traversal, visits every item in sorted order
+	* The function can modify the data in tree, but the
+	* tree structure is not changed
+	* Items are passed by reference, never copied
+	* @param visit The function to visit on each item
+	*/
+	void inorderTraverse(void visit(T& item)) const;
+
+	/*
+	* Gets an iterator at the smallest item
+	* @return iterator at the first item, end() if empty
+	*/
+	Iterator begin() const;
+
+	/*
+	* Gets the iterator past the largest item
+	* @return the end iterator
+	*/
+	Iterator end() const;
+
+	/*
+	* Gets a reverse iterator at the largest item
+	* @return reverse iterator at the last item
+	*/
+	reverse_iterator rbegin() const;
+
+	/*
+	* Gets the reverse iterator past the smallest item
+	* @return the reverse end iterator
+	*/
+	reverse_iterator rend() const;
+
+	/*
+	* Clears the tree and then uses the given sorted array of length n
+	* to create this tree
+	* @param arr The given array of elements
+	* @param n The size of the array
+	* @return true if the array was not empty
+	*/
+	bool readTree(const T arr[], int n);
+
+	/*
+	* Clears the tree and builds it from the items in [first, last) in
+	* O(n), each item is read once and the nodes are filled left to right.
+	* Use std::make_move_iterator to move the items instead of copying.
+	* @param first Forward iterator to the first item
+	* @param last Iterator past the last item
+	* @param sorted true if the items are sorted without duplicates,
+	*        false to sort them and drop duplicates first
+	* @return true if the range was not empty
+	*/
+	template<class It>
+	bool readTree(It first, It last, bool sorted = true);
+
+	/*
+	* Clears the tree and builds it in O(n), moving the items out of a vector
+	* @param items The items, left in a valid but unspecified state
+	* @param sorted true if the items are sorted without duplicates,
+	*        false to sort them and drop duplicates first
+	* @return true if items was not empty
+	*/
+	bool readTree(std::vector<T>&& items, bool sorted = true);
+
+	/*
+	* Equality operator overload
+	* @param other The other tree to compare to
+	* @return true if both trees hold equivalent items, false otherwise
+	*/
+	bool operator==(const BTree<T, Fanout, Compare>& other) const;
+
+	/*
+	* Inequality operator overload
+	* @param other The other tree to compare to
+	* @return true if the trees hold different items, false otherwise
+	*/
+	bool operator!=(const BTree<T, Fanout, Compare>& other) const;
+
+protected:
+
+	// Most items in a node
+	static const unsigned MAX_ITEMS = Fanout - 1;
+
+	// Fewest items in a node other than the root
+	static const unsigned MIN_ITEMS = Fanout / 2 - 1;
+
+	/*
+	* Gets the root of the tree
+	* @return the root, nullptr if empty
+	*/
+	const LeafNode* getRoot() const;
+
+	/*
+	* Finds the position of a key in a node: the index of the
+	* first item that is not ordered before key
+	* @param node The node to search
+	* @param key The key to look for
+	* @return the index, node->count if every item is before key
+	*/
+	template<class K>
+	unsigned search(const LeafNode* node, const K& key) const;
+
+private:
+
+	// Root of the tree
+	LeafNode* rootPtr;
+
+	// Number of items
+	std::size_t count;
+
+	// Storage for the leaves
+	NodeArena<LeafNode> leaves;
+
+	// Storage for the inner nodes
+	NodeArena<InnerNode> inners;
+
+	// Orders the items
+	KeyCompare<Compare> comp;
+
+	/*
+	* Helper function for contains, finds a key from the root down
+	* @param key The key to look for
+	* @return true if an equivalent item is in the tree
+	*/
+	template<class K>
+	bool find(const K& key) const;
+
+	/*
+	* Creates an empty node
+	* @param leaf true for a leaf, false for an inner node
+	* @param parent The parent of the node
+	* @return the new node
+	*/
+	LeafNode* createNode(bool leaf, InnerNode* parent);
+
+	/*
+	* Destroys a node whose items were already destroyed or moved out
+	* @param node The node to destroy
+	*/
+	void destroyNode(LeafNode* node);
+
+	/*
+	* Splits the full child i of parent in two around its middle
+	* item, which moves up into parent at index i
+	* @param parent The parent, not full
+	* @param i The index of the child to split
+	*/
+	void splitChild(InnerNode* parent, unsigned i);
+
+	/*
+	* Merges child i of parent, the item i of parent and child i + 1
+	* into child i. When parent is the root and loses its last item
+	* the merged child becomes the root.
+	* @param parent The parent
+	* @param i The index of the left child
+	* @return the merged child
+	*/
+	LeafNode* mergeChildren(InnerNode* parent, unsigned i);
+
+	/*
+	* Makes sure child i of parent has more than MIN_ITEMS items, by
+	* borrowing an item through parent from a sibling or merging with one
+	* @param parent The parent
+	* @param i The index of the child, updated if the child merged left
+	* @return the child to descend into
+	*/
+	LeafNode* fillChild(InnerNode* parent, unsigned& i);
+
+	/*
+	* Moves the largest item of a subtree out of its leaf, refilling
+	* nodes on the way down like remove
+	* @param node The root of the subtree, more than MIN_ITEMS items
+	* @param dest The item to move the largest item into
+	*/
+	void takeLast(LeafNode* node, T& dest);
+
+	/*
+	* Moves the smallest item of a subtree out of its leaf, refilling
+	* nodes on the way down like remove
+	* @param node The root of the subtree, more than MIN_ITEMS items
+	* @param dest The item to move the smallest item into
+	*/
+	void takeFirst(LeafNode* node, T& dest);
+
+	/*
+	* Helper function for readTree, builds a subtree of a given height
+	* holding the next n items, taking them in order from next
+	* @param next Iterator to the next unused item, advanced by n
+	* @param n The number of items in the subtree
+	* @param height The height of the subtree
+	* @param parent The parent of the subtree
+	* @return the root of the subtree
+	*/
+	template<class It>
+	LeafNode* readHelper(It& next, std::size_t n, int height, InnerNode* parent);
+
+	/*
+	* Helper function for operator=, copies a subtree
+	* @param other The root of the subtree to copy
+	* @param parent The parent of the copy
+	* @return the root of the copy
+	*/
+	LeafNode* copyNode(const LeafNode* other, InnerNode* parent);
+
+	/*
+	* Helper function for clear, destroys the items of a subtree
+	* @param node The root of the subtree
+	*/
+	static void destroyItems(LeafNode* node);
+
+	/*
+	* Gets the most items a subtree of a given height can hold
+	* @param height The height of the subtree
+	* @return the number of items
+	*/
+	static std::size_t capacity(int height);
+
+	/*
+	* Gets the child of an inner node
+	* @param node The inner node
+	* @param i The index of the child
+	* @return the child
+	*/
+	static LeafNode* child(const LeafNode* node, unsigned i);
+
+	/*
+	* Gets the index of a node among its parent's children
+	* @param node The node, not the root
+	* @return the index
+	*/
+	static unsigned childIndex(const LeafNode* node);
+
+	/*
+	* Sets the parent of children [first, last) of an inner node
+	* @param node The inner node
+	* @param first The first child
+	* @param last Past the last child
+	*/
+	static void adoptChildren(InnerNode* node, unsigned first, unsigned last);
+
+	/*
+	* Constructs an item at index i of node, moving the items
+	* from i on one place right
+	* @param node The node, not full
+	* @param i The index of the new item
+	* @param item The item
+	*/
+	template<class U>
+	static void insertItem(LeafNode* node, unsigned i, U&& item);
+
+	/*
+	* Destroys the item at index i of node, moving the
+	* items after it one place left
+	* @param node The node
+	* @param i The index of the item
+	*/
+	static void eraseItem(LeafNode* node, unsigned i);
+
+	/*
+	* Moves n items to uninitialized storage, the sources are destroyed.
+	* The ranges may overlap.
+	* @param from The first item to move
+	* @param to The first slot to move to
+	* @param n The number of items
+	*/
+	static void relocate(T* from, T* to, unsigned n);
+
+	/*
+	* Static helper function for displaySideways
+	* @param node The current node in the tree
+	* @param level The current level in the tree
+	*/
+	static void sideways(const LeafNode* node, int level);
+
+	/*
+	* Helper function for inorderTraverse
+	* @param node The current node in the tree
+	* @param visit The function to visit on each item
+	*/
+	static void inorder(const LeafNode* node, void visit(T& item));
+};
+
+#include "btree.cpp"
+#endif // BTREE_H
@@ -0,0 +1,1647 @@
+/*
+* compacttree.cpp
+*
+* CompactAVLTree implementations
+*
+* Slot i of the pool is node i. Links are indices into the pool, NIL
+* for none, so the pool can move to a larger allocation without fixing
+* a single link. The balance of node i, -1 (left subtree taller), 0 or
+* 1 (right subtree taller), is kept as balance + 1 in the top 2 bits of
+* its parent field, or of its left field when there is no parent field;
+* the value 3 there marks a free slot.
+*
+* Every use of an optional field is behind if constexpr, so a tree
+* without a field has no code for it.
+*
+* DO NOT compile this file, it is included at the bottom of compacttree.h
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+/*
+* Constructs empty tree
+*/
+template<class T, class Compare, class Fields>
+CompactAVLTree<T, Compare, Fields>::CompactAVLTree()
+
+	:pool(nullptr), capacity(0), used(0), freeList(NIL), rootIndex(NIL), count(0) {}
+
+/*
+* Constructs tree with a given item
+* @param item The first item
+*/
+template<class T, class Compare, class Fields>
+CompactAVLTree<T, Compare, Fields>::CompactAVLTree(const T& item)
+
+	:pool(nullptr), capacity(0), used(0), freeList(NIL), rootIndex(NIL), count(0) {
+
+	this->add(item);
+}
+
+/*
+* Copy constructor
+* @param other The other tree to copy
+*/
+template<class T, class Compare, class Fields>
+CompactAVLTree<T, Compare, Fields>::CompactAVLTree(const CompactAVLTree<T, Compare, Fields>& other)
+
+	:pool(nullptr), capacity(0), used(0), freeList(NIL), rootIndex(NIL), count(0), comp(other.comp) {
+
+	*this = other;
+}
+
+/*
+* Destroys tree and deallocates all dynamic memory
+*/
+template<class T, class Compare, class Fields>
+CompactAVLTree<T, Compare, Fields>::~CompactAVLTree() {
+
+	this->clear();
+
+	if (this->pool != nullptr) {
+
+		std::allocator<CompactNode>().deallocate(this->pool, this->capacity);
+	}
+}
+
+/*
+* Assignment operator overload, makes this a deep copy of other. The
+* pool is copied slot by slot, so the copy has the same shape.
+* @param other The other tree to copy
+* @return this by reference
+*/
+template<class T, class Compare, class Fields>
+CompactAVLTree<T, Compare, Fields>& CompactAVLTree<T, Compare, Fields>::operator=(const CompactAVLTree<T, Compare, Fields>& other) {
+
+	if (this != &other) {
+
+		this->clear();
+		this->reserve(other.used);
+
+		for (std::uint32_t i(0); i < other.used; ++i) {
+
+			// the links and optional fields, then the item if there is one
+			std::memcpy(static_cast<void*>(this->pool + i), static_cast<const void*>(other.pool + i),
+			            sizeof(CompactNode));
+
+			if (!other.isFree(i)) {
+
+				::new (static_cast<void*>(this->pool[i].storage)) T(other.pool[i].item());
+			}
+
+			this->used = i + 1;
+		}
+
+		this->freeList = other.freeList;
+		this->rootIndex = other.rootIndex;
+		this->count = other.count;
+	}
+
+	return *this;
+}
+
+/*
+* Checks if tree is empty
+* @return true if there are no items, false otherwise
+*/
+template<class T, class Compare, class Fields>
+bool CompactAVLTree<T, Compare, Fields>::isEmpty() const {
+
+	return this->rootIndex == NIL;
+}
+
+/*
+* Gets the height of the tree in O(log n), following the balance
+* bits down the taller side
+* @return the height of the tree
+*/
+template<class T, class Compare, class Fields>
+int CompactAVLTree<T, Compare, Fields>::getHeight() const {
+
+	int height(0);
+
+	for (std::uint32_t i = this->rootIndex; i != NIL;
+		 i = (this->balanceOf(i) > 0) ? this->rightOf(i) : this->leftOf(i)) {
+
+		++height;
+	}
+
+	return height;
+}
+
+/*
+* Gets the amount of items in the tree in O(1), like
+* BinarySearchTree::getNumberOfNodes
+* @return the amount of items in the tree
+*/
+template<class T, class Compare, class Fields>
+int CompactAVLTree<T, Compare, Fields>::getNumberOfNodes() const {
+
+	return static_cast<int>(this->count);
+}
+
+/*
+* Gets the amount of items in the tree in O(1)
+* @return the amount of items in the tree
+*/
+template<class T, class Compare, class Fields>
+std::size_t CompactAVLTree<T, Compare, Fields>::size() const {
+
+	return this->count;
+}
+
+/*
+* Gets the k-th smallest item, counting from 0, in O(log n).
+* Needs the size field.
+* @param k The position of the item in sorted order
+* @return the item at position k by reference
+* @throws std::out_of_range if k >= size()
+*/
+template<class T, class Compare, class Fields>
+const T& CompactAVLTree<T, Compare, Fields>::select(std::size_t k) const {
+
+	static_assert(Fields::size, "select needs the size field, see CompactFields");
+
+	if (k >= this->count) {
+
+		throw std::out_of_range("CompactAVLTree::select: k >= size()");
+	}
+
+	std::uint32_t curr = this->rootIndex;
+
+	while (true) {
+
+		std::size_t leftSize = this->sizeOf(this->leftOf(curr));
+
+		if (k < leftSize) {
+
+			curr = this->leftOf(curr);
+
+		} else if (k > leftSize) {
+
+			k -= leftSize + 1;
+			curr = this->rightOf(curr);
+
+		} else {
+
+			return this->pool[curr].item();
+		}
+	}
+}
+
+/*
+* Counts the items less than a given item, which is the position
+* item has or would have in sorted order, in O(log n).
+* Needs the size field.
+* @param item The item to rank
+* @return the number of items less than item
+*/
+template<class T, class Compare, class Fields>
+std::size_t CompactAVLTree<T, Compare, Fields>::rank(const T& item) const {
+
+	static_assert(Fields::size, "rank needs the size field, see CompactFields");
+
+	std::size_t less(0);
+
+	std::uint32_t curr = this->rootIndex;
+
+	while (curr != NIL) {
+
+		if (this->comp.less(this->pool[curr].item(), item)) {
+
+			less += this->sizeOf(this->leftOf(curr)) + 1;
+			curr = this->rightOf(curr);
+
+		} else {
+
+			curr = this->leftOf(curr);
+		}
+	}
+
+	return less;
+}
+
+/*
+* Gets the augmentation of the whole tree in O(1), the combination
+* of the values of all items. Needs an augmentation field.
+* @return the augmentation of the root
+* @throws std::out_of_range if the tree is empty
+*/
+template<class T, class Compare, class Fields>
+const typename CompactAVLTree<T, Compare, Fields>::augment_type& CompactAVLTree<T, Compare, Fields>::summary() const {
+
+	static_assert(Fields::augmented, "summary needs an augmentation field, see CompactFields");
+
+	if (this->rootIndex == NIL) {
+
+		throw std::out_of_range("CompactAVLTree::summary: the tree is empty");
+	}
+
+	return this->pool[this->rootIndex].augment;
+}
+
+/*
+* Adds a given item to the tree, if not duplicate, then retraces
+* from the new leaf and rotates at most once
+* @param item The item to add
+* @return true if item added, false otherwise
+*/
+template<class T, class Compare, class Fields>
+bool CompactAVLTree<T, Compare, Fields>::add(const T& item) {
+
+	std::uint32_t path[MAX_HEIGHT];
+
+	int depth(0);
+
+	bool left(false);
+
+	for (std::uint32_t curr = this->rootIndex; curr != NIL;) {
+
+		int order = this->comp.order(item, this->pool[curr].item());
+
+		if (order == 0) {
+
+			return false;
+		}
+
+		path[depth++] = curr;
+		left = order < 0;
+
+		curr = left ? this->leftOf(curr) : this->rightOf(curr);
+	}
+
+	std::uint32_t parent = (depth > 0) ? path[depth - 1] : NIL;
+
+	// indices stay valid when the pool grows
+	std::uint32_t leaf = this->createNode(item, parent);
+
+	if (parent == NIL) {
+
+		this->rootIndex = leaf;
+
+	} else if (left) {
+
+		this->setLeft(parent, leaf);
+
+	} else {
+
+		this->setRight(parent, leaf);
+	}
+
+	++this->count;
+
+	this->retraceAdd(path, depth, leaf);
+
+	return true;
+}
+
+/*
+* Removes a given item from the tree if there. A node with two
+* children is replaced by its inorder successor node, items are
+* never copied. Then retraces from where the tree got shorter.
+* @param item The item to remove
+* @return true if item removed, false otherwise
+*/
+template<class T, class Compare, class Fields>
+bool CompactAVLTree<T, Compare, Fields>::remove(const T& item) {
+
+	std::uint32_t path[MAX_HEIGHT];
+
+	int depth(0);
+
+	std::uint32_t node = this->rootIndex;
+
+	while (node != NIL) {
+
+		int order = this->comp.order(item, this->pool[node].item());
+
+		if (order == 0) {
+
+			break;
+		}
+
+		path[depth++] = node;
+
+		node = (order < 0) ? this->leftOf(node) : this->rightOf(node);
+	}
+
+	if (node == NIL) {
+
+		return false;
+	}
+
+	std::uint32_t up = (depth > 0) ? path[depth - 1] : NIL;
+	std::uint32_t left = this->leftOf(node);
+	std::uint32_t right = this->rightOf(node);
+
+	// side of path[depth - 1] that got shorter
+	bool shorterLeft;
+
+	if (left != NIL && right != NIL) {
+
+		// the successor takes the node's place on the path
+		int place = depth++;
+
+		std::uint32_t next = right;
+
+		while (this->leftOf(next) != NIL) {
+
+			path[depth++] = next;
+			next = this->leftOf(next);
+		}
+
+		shorterLeft = next != right;
+
+		if (shorterLeft) {
+
+			this->setLeft(path[depth - 1], this->rightOf(next));
+			this->setRight(next, right);
+		}
+
+		this->setLeft(next, left);
+		this->setBalance(next, this->balanceOf(node));
+		this->replaceChild(up, node, next);
+
+		path[place] = next;
+
+	} else {
+
+		shorterLeft = up != NIL && this->leftOf(up) == node;
+
+		this->replaceChild(up, node, (left != NIL) ? left : right);
+	}
+
+	this->destroyNode(node);
+
+	--this->count;
+
+	this->retraceRemove(path, depth, shorterLeft);
+
+	return true;
+}
+
+/*
+* Deletes all items in the tree, the pool keeps its memory
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::clear() {
+
+	if constexpr (!std::is_trivially_destructible<T>::value) {
+
+		for (std::uint32_t i(0); i < this->used; ++i) {
+
+			if (!this->isFree(i)) {
+
+				this->pool[i].item().~T();
+			}
+		}
+	}
+
+	this->used = 0;
+	this->freeList = NIL;
+	this->rootIndex = NIL;
+	this->count = 0;
+}
+
+/*
+* Makes room for n items in all so adding them does not allocate
+* @param n The number of items to make room for
+* @throws std::length_error if n is more than 2^30 - 1
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::reserve(std::size_t n) {
+
+	if (n > NIL) {
+
+		throw std::length_error("CompactAVLTree holds at most 2^30 - 1 items");
+	}
+
+	if (n > this->capacity) {
+
+		this->grow(n);
+	}
+}
+
+/*
+* Gets the number of bytes held by the node pool
+* @return bytes held by the pool
+*/
+template<class T, class Compare, class Fields>
+std::size_t CompactAVLTree<T, Compare, Fields>::bytesReserved() const {
+
+	return this->capacity * sizeof(CompactNode);
+}
+
+/*
+* Checks for membership of given item
+* @param item The item to check for
+* @return true if tree contains item, false otherwise
+*/
+template<class T, class Compare, class Fields>
+bool CompactAVLTree<T, Compare, Fields>::contains(const T& item) const {
+
+	return this->find(item) != NIL;
+}
+
+/*
+* Checks for membership of a key of another type, only available when
+* Compare is transparent (has is_transparent), no item is constructed
+* @param key The key to check for
+* @return true if tree contains an item equivalent to key
+*/
+template<class T, class Compare, class Fields>
+template<class K, class C, class>
+bool CompactAVLTree<T, Compare, Fields>::contains(const K& key) const {
+
+	return this->find(key) != NIL;
+}
+
+/*
+* Prints the tree sideways
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::displaySideways() const {
+
+	if (this->rootIndex != NIL) {
+
+		this->sideways(this->rootIndex, 0);
+	}
+}
+
+/*
+* Inorder traversal: left-root-right
+* The function can modify the data in tree, but the
+* tree structure is not changed
+* Items are passed by reference, never copied
+* @param visit The function to visit on each item
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::inorderTraverse(void visit(T& item)) const {
+
+	if constexpr (Fields::parent) {
+
+		if (this->rootIndex != NIL) {
+
+			for (std::uint32_t i = this->leftMost(this->rootIndex); i != NIL; i = this->successor(i)) {
+
+				visit(this->pool[i].item());
+			}
+		}
+
+	} else {
+
+		// the nodes whose left subtree is being visited
+		std::uint32_t stack[MAX_HEIGHT];
+
+		int depth(0);
+
+		std::uint32_t curr = this->rootIndex;
+
+		while (curr != NIL || depth > 0) {
+
+			for (; curr != NIL; curr = this->leftOf(curr)) {
+
+				stack[depth++] = curr;
+			}
+
+			curr = stack[--depth];
+
+			visit(this->pool[curr].item());
+
+			curr = this->rightOf(curr);
+		}
+	}
+}
+
+/*
+* Gets an iterator at the smallest item
+* @return iterator at the first item, end() if empty
+*/
+template<class T, class Compare, class Fields>
+typename CompactAVLTree<T, Compare, Fields>::Iterator CompactAVLTree<T, Compare, Fields>::begin() const {
+
+	return Iterator((this->rootIndex != NIL) ? this->leftMost(this->rootIndex) : NIL, this);
+}
+
+/*
+* Gets the iterator past the largest item
+* @return the end iterator
+*/
+template<class T, class Compare, class Fields>
+typename CompactAVLTree<T, Compare, Fields>::Iterator CompactAVLTree<T, Compare, Fields>::end() const {
+
+	return Iterator(NIL, this);
+}
+
+/*
+* Gets a reverse iterator at the largest item
+* @return reverse iterator at the last item
+*/
+template<class T, class Compare, class Fields>
+typename CompactAVLTree<T, Compare, Fields>::reverse_iterator CompactAVLTree<T, Compare, Fields>::rbegin() const {
+
+	return reverse_iterator(this->end());
+}
+
+/*
+* Gets the reverse iterator past the smallest item
+* @return the reverse end iterator
+*/
+template<class T, class Compare, class Fields>
+typename CompactAVLTree<T, Compare, Fields>::reverse_iterator CompactAVLTree<T, Compare, Fields>::rend() const {
+
+	return reverse_iterator(this->begin());
+}
+
+/*
+* Clears the tree and then uses the given sorted array of length n
+* to create this tree at minimum height
+* @param arr The given array of elements
+* @param n The size of the array
+* @return true if the array was not empty
+*/
+template<class T, class Compare, class Fields>
+bool CompactAVLTree<T, Compare, Fields>::readTree(const T arr[], int n) {
+
+	return n > 0 && this->readTree(arr, arr + n);
+}
+
+/*
+* Clears the tree and builds it at minimum height from the items in
+* [first, last) in O(n), each item is read once. The nodes end up in
+* the pool in sorted order.
+* Use std::make_move_iterator to move the items instead of copying.
+* @param first Forward iterator to the first item
+* @param last Iterator past the last item
+* @param sorted true if the items are sorted without duplicates,
+*        false to sort them and drop duplicates first
+* @return true if the range was not empty
+* @throws std::length_error if there are more than 2^30 - 1 items
+*/
+template<class T, class Compare, class Fields>
+template<class It>
+bool CompactAVLTree<T, Compare, Fields>::readTree(It first, It last, bool sorted) {
+
+	if (!sorted) {
+
+		return this->readTree(std::vector<T>(first, last), false);
+	}
+
+	std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+
+	bool read(false);
+
+	if (n > 0) {
+
+		this->clear();
+		this->reserve(n);
+
+		this->rootIndex = this->readHelper(first, 0, static_cast<std::uint32_t>(n), NIL);
+		this->used = static_cast<std::uint32_t>(n);
+		this->count = n;
+
+		read = true;
+	}
+
+	return read;
+}
+
+/*
+* Clears the tree and builds it at minimum height in O(n),
+* moving the items out of a vector
+* @param items The items, left in a valid but unspecified state
+* @param sorted true if the items are sorted without duplicates,
+*        false to sort them and drop duplicates first
+* @return true if items was not empty
+*/
+template<class T, class Compare, class Fields>
+bool CompactAVLTree<T, Compare, Fields>::readTree(std::vector<T>&& items, bool sorted) {
+
+	if (!sorted) {
+
+		const KeyCompare<Compare>& comp = this->comp;
+
+		std::sort(items.begin(), items.end(), [&comp](const T& a, const T& b) {
+
+			return comp.less(a, b);
+		});
+
+		items.erase(std::unique(items.begin(), items.end(), [&comp](const T& a, const T& b) {
+
+			return comp.equivalent(a, b);
+
+		}), items.end());
+	}
+
+	return this->readTree(std::make_move_iterator(items.begin()),
+	                      std::make_move_iterator(items.end()));
+}
+
+/*
+* Equality operator overload
+* @param other The other tree to compare to
+* @return true if both trees hold equivalent items, false otherwise
+*/
+template<class T, class Compare, class Fields>
+bool CompactAVLTree<T, Compare, Fields>::operator==(const CompactAVLTree<T, Compare, Fields>& other) const {
+
+	const KeyCompare<Compare>& comp = this->comp;
+
+	return this->count == other.count &&
+	       std::equal(this->begin(), this->end(), other.begin(), [&comp](const T& a, const T& b) {
+
+		return comp.equivalent(a, b);
+	});
+}
+
+/*
+* Inequality operator overload
+* @param other The other tree to compare to
+* @return true if the trees hold different items, false otherwise
+*/
+template<class T, class Compare, class Fields>
+bool CompactAVLTree<T, Compare, Fields>::operator!=(const CompactAVLTree<T, Compare, Fields>& other) const {
+
+	return !(*this == other);
+}
+
+/*
+* Gets the root of the tree
+* @return the index of the root, NIL if empty
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::getRoot() const {
+
+	return this->rootIndex;
+}
+
+/*
+* Gets a node of the tree
+* @param i The index of the node, not NIL
+* @return the node
+*/
+template<class T, class Compare, class Fields>
+const typename CompactAVLTree<T, Compare, Fields>::CompactNode& CompactAVLTree<T, Compare, Fields>::node(std::uint32_t i) const {
+
+	return this->pool[i];
+}
+
+/*
+* Gets the left child of a node
+* @param i The index of the node
+* @return the index of its left child, NIL if none
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::leftOf(std::uint32_t i) const {
+
+	if constexpr (Fields::parent) {
+
+		return this->pool[i].left;
+
+	} else {
+
+		return this->pool[i].left & NIL;
+	}
+}
+
+/*
+* Gets the right child of a node
+* @param i The index of the node
+* @return the index of its right child, NIL if none
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::rightOf(std::uint32_t i) const {
+
+	return this->pool[i].right;
+}
+
+/*
+* Gets the parent of a node, needs the parent field
+* @param i The index of the node
+* @return the index of its parent, NIL for the root
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::parentOf(std::uint32_t i) const {
+
+	static_assert(Fields::parent, "parentOf needs the parent field, see CompactFields");
+
+	return this->pool[i].parent & NIL;
+}
+
+/*
+* Gets the balance of a node, the height of its right subtree
+* minus the height of its left subtree
+* @param i The index of the node
+* @return -1, 0 or 1
+*/
+template<class T, class Compare, class Fields>
+int CompactAVLTree<T, Compare, Fields>::balanceOf(std::uint32_t i) const {
+
+	if constexpr (Fields::parent) {
+
+		return static_cast<int>(this->pool[i].parent >> 30) - 1;
+
+	} else {
+
+		return static_cast<int>(this->pool[i].left >> 30) - 1;
+	}
+}
+
+/*
+* Helper function for contains, finds a key from the root down with
+* one comparison per level, checking for equivalence only at the end
+* @param key The key to look for
+* @return the index of the node with an equivalent item, NIL if none
+*/
+template<class T, class Compare, class Fields>
+template<class K>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::find(const K& key) const {
+
+	std::uint32_t candidate(NIL), curr(this->rootIndex);
+
+	while (curr != NIL) {
+
+		if (this->comp.less(this->pool[curr].item(), key)) {
+
+			curr = this->rightOf(curr);
+
+		} else {
+
+			candidate = curr;
+			curr = this->leftOf(curr);
+		}
+	}
+
+	return (candidate != NIL && !this->comp.less(key, this->pool[candidate].item())) ? candidate : NIL;
+}
+
+/*
+* Takes a free slot and constructs a leaf for item in it,
+* growing the pool if needed
+* @param item The item for the node
+* @param parent The parent of the node
+* @return the index of the new node
+* @throws std::length_error if the tree already holds 2^30 - 1 items
+*/
+template<class T, class Compare, class Fields>
+template<class U>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::createNode(U&& item, std::uint32_t parent) {
+
+	std::uint32_t i = (this->freeList != NIL) ? this->freeList : this->used;
+
+	if (i == this->capacity) {
+
+		std::size_t grown = std::max<std::size_t>(MIN_CAPACITY, 2 * std::size_t(this->capacity));
+
+		this->reserve((i < NIL) ? std::min<std::size_t>(grown, NIL) : grown);
+	}
+
+	::new (static_cast<void*>(this->pool[i].storage)) T(std::forward<U>(item));
+
+	// the slot is taken only once the item is constructed
+	if (i == this->used) {
+
+		++this->used;
+
+	} else {
+
+		this->freeList = this->pool[i].right;
+	}
+
+	this->setLinks(i, NIL, NIL, parent, 0);
+	this->update(i);
+
+	return i;
+}
+
+/*
+* Destroys the item of a node and puts its slot on the free list
+* @param i The index of the node
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::destroyNode(std::uint32_t i) {
+
+	this->pool[i].item().~T();
+
+	this->pool[i].right = this->freeList;
+
+	if constexpr (Fields::parent) {
+
+		this->pool[i].parent = FREE;
+
+	} else {
+
+		this->pool[i].left = FREE;
+	}
+
+	this->freeList = i;
+}
+
+/*
+* Moves the pool to a larger allocation, moving every item. Trivially
+* copyable items are copied with the links in one memcpy.
+* @param n The new number of slots, more than capacity
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::grow(std::size_t n) {
+
+	CompactNode* larger = std::allocator<CompactNode>().allocate(n);
+
+	if (this->used > 0) {
+
+		std::memcpy(static_cast<void*>(larger), static_cast<const void*>(this->pool),
+		            this->used * sizeof(CompactNode));
+	}
+
+	if constexpr (!std::is_trivially_copyable<T>::value) {
+
+		for (std::uint32_t i(0); i < this->used; ++i) {
+
+			if (!this->isFree(i)) {
+
+				::new (static_cast<void*>(larger[i].storage)) T(std::move(this->pool[i].item()));
+
+				this->pool[i].item().~T();
+			}
+		}
+	}
+
+	if (this->pool != nullptr) {
+
+		std::allocator<CompactNode>().deallocate(this->pool, this->capacity);
+	}
+
+	this->pool = larger;
+	this->capacity = static_cast<std::uint32_t>(n);
+}
+
+/*
+* Checks if a slot below used is free
+* @param i The index of the slot
+* @return true if the slot holds no node
+*/
+template<class T, class Compare, class Fields>
+bool CompactAVLTree<T, Compare, Fields>::isFree(std::uint32_t i) const {
+
+	return this->balanceOf(i) == 2;
+}
+
+/*
+* Sets the links and balance of a node
+* @param i The index of the node
+* @param left The left child
+* @param right The right child
+* @param parent The parent, ignored without the parent field
+* @param balance -1, 0 or 1
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::setLinks(std::uint32_t i, std::uint32_t left, std::uint32_t right,
+                                                  std::uint32_t parent, int balance) {
+
+	std::uint32_t bits = static_cast<std::uint32_t>(balance + 1) << 30;
+
+	if constexpr (Fields::parent) {
+
+		this->pool[i].left = left;
+		this->pool[i].parent = parent | bits;
+
+	} else {
+
+		this->pool[i].left = left | bits;
+	}
+
+	this->pool[i].right = right;
+}
+
+/*
+* Sets the left child of a node, keeping its balance, and the
+* parent of the child
+* @param i The index of the node
+* @param child The index of the child, possibly NIL
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::setLeft(std::uint32_t i, std::uint32_t child) {
+
+	if constexpr (Fields::parent) {
+
+		this->pool[i].left = child;
+
+		if (child != NIL) {
+
+			this->setParent(child, i);
+		}
+
+	} else {
+
+		this->pool[i].left = (this->pool[i].left & ~NIL) | child;
+	}
+}
+
+/*
+* Sets the right child of a node and the parent of the child
+* @param i The index of the node
+* @param child The index of the child, possibly NIL
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::setRight(std::uint32_t i, std::uint32_t child) {
+
+	this->pool[i].right = child;
+
+	if (child != NIL) {
+
+		this->setParent(child, i);
+	}
+}
+
+/*
+* Sets the parent of a node, keeping its balance, does nothing
+* without the parent field
+* @param i The index of the node
+* @param parent The index of the parent
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::setParent(std::uint32_t i, std::uint32_t parent) {
+
+	if constexpr (Fields::parent) {
+
+		this->pool[i].parent = (this->pool[i].parent & ~NIL) | parent;
+	}
+}
+
+/*
+* Sets the balance of a node, keeping the link it shares bits with
+* @param i The index of the node
+* @param balance -1, 0 or 1
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::setBalance(std::uint32_t i, int balance) {
+
+	std::uint32_t bits = static_cast<std::uint32_t>(balance + 1) << 30;
+
+	if constexpr (Fields::parent) {
+
+		this->pool[i].parent = (this->pool[i].parent & NIL) | bits;
+
+	} else {
+
+		this->pool[i].left = (this->pool[i].left & NIL) | bits;
+	}
+}
+
+/*
+* Recomputes the size and augmentation of a node from its children,
+* does nothing when the tree has neither
+* @param i The index of the node
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::update(std::uint32_t i) {
+
+	std::uint32_t left = this->leftOf(i);
+	std::uint32_t right = this->rightOf(i);
+
+	if constexpr (Fields::size) {
+
+		this->pool[i].size = static_cast<std::uint32_t>(1 + this->sizeOf(left) + this->sizeOf(right));
+	}
+
+	if constexpr (Fields::augmented) {
+
+		typedef typename Fields::augment Augment;
+
+		augment_type value = Augment::value(this->pool[i].item());
+
+		if (left != NIL) {
+
+			value = Augment::combine(this->pool[left].augment, value);
+		}
+
+		if (right != NIL) {
+
+			value = Augment::combine(value, this->pool[right].augment);
+		}
+
+		this->pool[i].augment = value;
+	}
+
+	(void)left;
+	(void)right;
+}
+
+/*
+* Makes child take the place of old under parent, or the root
+* when parent is NIL
+* @param parent The parent of old
+* @param old The child being replaced
+* @param child The new child, possibly NIL
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::replaceChild(std::uint32_t parent, std::uint32_t old, std::uint32_t child) {
+
+	if (parent == NIL) {
+
+		this->rootIndex = child;
+
+		if (child != NIL) {
+
+			this->setParent(child, NIL);
+		}
+
+	} else if (this->leftOf(parent) == old) {
+
+		this->setLeft(parent, child);
+
+	} else {
+
+		this->setRight(parent, child);
+	}
+}
+
+/*
+* Rotates the right child z of x into x's place, for a right heavy x
+* whose child z is not left heavy, and sets both balances. z is
+* balanced only when removing, then the subtree keeps its height.
+* @param x The node out of balance
+* @param up The parent of x
+* @return z, the new root of the subtree
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::rotateLeft(std::uint32_t x, std::uint32_t up) {
+
+	std::uint32_t z = this->rightOf(x);
+
+	this->setRight(x, this->leftOf(z));
+	this->replaceChild(up, x, z);
+	this->setLeft(z, x);
+
+	bool even = this->balanceOf(z) == 0;
+
+	this->setBalance(x, even ? 1 : 0);
+	this->setBalance(z, even ? -1 : 0);
+
+	this->update(x);
+	this->update(z);
+
+	return z;
+}
+
+/*
+* Rotates the left child z of x into x's place, for a left heavy x
+* whose child z is not right heavy, and sets both balances. z is
+* balanced only when removing, then the subtree keeps its height.
+* @param x The node out of balance
+* @param up The parent of x
+* @return z, the new root of the subtree
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::rotateRight(std::uint32_t x, std::uint32_t up) {
+
+	std::uint32_t z = this->leftOf(x);
+
+	this->setLeft(x, this->rightOf(z));
+	this->replaceChild(up, x, z);
+	this->setRight(z, x);
+
+	bool even = this->balanceOf(z) == 0;
+
+	this->setBalance(x, even ? -1 : 0);
+	this->setBalance(z, even ? 1 : 0);
+
+	this->update(x);
+	this->update(z);
+
+	return z;
+}
+
+/*
+* Rotates the left child y of x's right child z into x's place,
+* for a right heavy x whose child z is left heavy
+* @param x The node out of balance
+* @param up The parent of x
+* @return y, the new root of the subtree
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::rotateRightLeft(std::uint32_t x, std::uint32_t up) {
+
+	std::uint32_t z = this->rightOf(x);
+	std::uint32_t y = this->leftOf(z);
+
+	this->setRight(x, this->leftOf(y));
+	this->setLeft(z, this->rightOf(y));
+	this->replaceChild(up, x, y);
+	this->setLeft(y, x);
+	this->setRight(y, z);
+
+	int balance = this->balanceOf(y);
+
+	this->setBalance(x, (balance > 0) ? -1 : 0);
+	this->setBalance(z, (balance < 0) ? 1 : 0);
+	this->setBalance(y, 0);
+
+	this->update(x);
+	this->update(z);
+	this->update(y);
+
+	return y;
+}
+
+/*
+* Rotates the right child y of x's left child z into x's place,
+* for a left heavy x whose child z is right heavy
+* @param x The node out of balance
+* @param up The parent of x
+* @return y, the new root of the subtree
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::rotateLeftRight(std::uint32_t x, std::uint32_t up) {
+
+	std::uint32_t z = this->leftOf(x);
+	std::uint32_t y = this->rightOf(z);
+
+	this->setLeft(x, this->rightOf(y));
+	this->setRight(z, this->leftOf(y));
+	this->replaceChild(up, x, y);
+	this->setRight(y, x);
+	this->setLeft(y, z);
+
+	int balance = this->balanceOf(y);
+
+	this->setBalance(x, (balance < 0) ? 1 : 0);
+	this->setBalance(z, (balance > 0) ? -1 : 0);
+	this->setBalance(y, 0);
+
+	this->update(x);
+	this->update(z);
+	this->update(y);
+
+	return y;
+}
+
+/*
+* Rotates a node that is two levels out of balance. Its balance bits
+* still say which side was taller before that side grew or the
+* other side shrank.
+* @param x The node out of balance
+* @param up The parent of x
+* @return the new root of the subtree
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::fixBalance(std::uint32_t x, std::uint32_t up) {
+
+	if (this->balanceOf(x) > 0) {
+
+		return (this->balanceOf(this->rightOf(x)) < 0) ? this->rotateRightLeft(x, up) : this->rotateLeft(x, up);
+	}
+
+	return (this->balanceOf(this->leftOf(x)) > 0) ? this->rotateLeftRight(x, up) : this->rotateRight(x, up);
+}
+
+/*
+* Retraces from a new leaf up to the root, updating balances
+* until a subtree keeps its height or one rotation restores it,
+* and sizes and augmentations all the way up
+* @param path The nodes from the root down to the parent of the leaf
+* @param depth The number of nodes in path
+* @param leaf The new leaf
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::retraceAdd(const std::uint32_t* path, int depth, std::uint32_t leaf) {
+
+	std::uint32_t child(leaf);
+
+	int d = depth - 1;
+
+	for (; d >= 0; --d) {
+
+		std::uint32_t parent = path[d];
+
+		int balance = this->balanceOf(parent) + ((this->leftOf(parent) == child) ? -1 : 1);
+
+		if (balance == 2 || balance == -2) {
+
+			// a rotation after adding restores the height from before
+			this->fixBalance(parent, (d > 0) ? path[d - 1] : NIL);
+
+			--d;
+
+			break;
+		}
+
+		this->setBalance(parent, balance);
+		this->update(parent);
+
+		if (balance == 0) {
+
+			--d;
+
+			break;
+		}
+
+		child = parent;
+	}
+
+	if constexpr (Fields::size || Fields::augmented) {
+
+		for (; d >= 0; --d) {
+
+			this->update(path[d]);
+		}
+	}
+}
+
+/*
+* Retraces from where a subtree got shorter up to the root,
+* updating balances and rotating where out of balance, and sizes
+* and augmentations all the way up
+* @param path The nodes from the root down to the parent of the
+*        shorter subtree
+* @param depth The number of nodes in path
+* @param left true if the shorter subtree is the left one
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::retraceRemove(const std::uint32_t* path, int depth, bool left) {
+
+	int d = depth - 1;
+
+	for (; d >= 0; --d) {
+
+		std::uint32_t parent = path[d];
+		std::uint32_t up = (d > 0) ? path[d - 1] : NIL;
+
+		int balance = this->balanceOf(parent) + (left ? 1 : -1);
+
+		std::uint32_t top = parent;
+
+		if (balance == 1 || balance == -1) {
+
+			// was even, now one side is taller but the height is the same
+			this->setBalance(parent, balance);
+			this->update(parent);
+
+			--d;
+
+			break;
+		}
+
+		if (balance == 0) {
+
+			this->setBalance(parent, 0);
+			this->update(parent);
+
+		} else {
+
+			std::uint32_t taller = left ? this->rightOf(parent) : this->leftOf(parent);
+
+			bool even = this->balanceOf(taller) == 0;
+
+			top = this->fixBalance(parent, up);
+
+			if (even) {
+
+				--d;
+
+				break;
+			}
+		}
+
+		left = up != NIL && this->leftOf(up) == top;
+	}
+
+	if constexpr (Fields::size || Fields::augmented) {
+
+		for (; d >= 0; --d) {
+
+			this->update(path[d]);
+		}
+	}
+}
+
+/*
+* Helper function for readTree, builds a subtree of n nodes taking
+* the items in order from next, in the slots [first, first + n). The
+* right subtree gets the extra node when n - 1 is odd, so balances
+* are 0 or 1.
+* @param next Iterator to the next unused item, advanced by n
+* @param first The slot of the leftmost node
+* @param n The number of nodes in the subtree
+* @param parent The parent of the subtree
+* @return the root of the subtree
+*/
+template<class T, class Compare, class Fields>
+template<class It>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::readHelper(It& next, std::uint32_t first, std::uint32_t n,
+                                                             std::uint32_t parent) {
+
+	std::uint32_t leftCount = (n - 1) / 2;
+	std::uint32_t rightCount = n - 1 - leftCount;
+	std::uint32_t i = first + leftCount;
+
+	std::uint32_t left = (leftCount > 0) ? this->readHelper(next, first, leftCount, i) : NIL;
+
+	::new (static_cast<void*>(this->pool[i].storage)) T(*next);
+	++next;
+
+	std::uint32_t right = (rightCount > 0) ? this->readHelper(next, i + 1, rightCount, i) : NIL;
+
+	this->setLinks(i, left, right, parent,
+	               CompactAVLTree::minHeight(rightCount) - CompactAVLTree::minHeight(leftCount));
+	this->update(i);
+
+	return i;
+}
+
+/*
+* Gets the subtree size of a possibly NIL node, needs the size field
+* @param i The index of the node
+* @return its subtree size, 0 for NIL
+*/
+template<class T, class Compare, class Fields>
+std::size_t CompactAVLTree<T, Compare, Fields>::sizeOf(std::uint32_t i) const {
+
+	static_assert(Fields::size, "sizeOf needs the size field, see CompactFields");
+
+	return (i != NIL) ? this->pool[i].size : 0;
+}
+
+/*
+* Gets the leftmost node under i
+* @param i The root of the subtree, not NIL
+* @return the node with the smallest item
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::leftMost(std::uint32_t i) const {
+
+	while (this->leftOf(i) != NIL) {
+
+		i = this->leftOf(i);
+	}
+
+	return i;
+}
+
+/*
+* Gets the rightmost node under i
+* @param i The root of the subtree, not NIL
+* @return the node with the largest item
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::rightMost(std::uint32_t i) const {
+
+	while (this->rightOf(i) != NIL) {
+
+		i = this->rightOf(i);
+	}
+
+	return i;
+}
+
+/*
+* Gets the inorder successor of a node. Without parent links, the
+* lowest ancestor with i on its left is found searching from the root.
+* @param i The node, not NIL
+* @return the next node in sorted order, NIL after the last
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::successor(std::uint32_t i) const {
+
+	if (this->rightOf(i) != NIL) {
+
+		return this->leftMost(this->rightOf(i));
+	}
+
+	std::uint32_t next(NIL);
+
+	if constexpr (Fields::parent) {
+
+		next = this->parentOf(i);
+
+		while (next != NIL && this->rightOf(next) == i) {
+
+			i = next;
+			next = this->parentOf(next);
+		}
+
+	} else {
+
+		for (std::uint32_t curr = this->rootIndex; curr != i;) {
+
+			if (this->comp.less(this->pool[i].item(), this->pool[curr].item())) {
+
+				next = curr;
+				curr = this->leftOf(curr);
+
+			} else {
+
+				curr = this->rightOf(curr);
+			}
+		}
+	}
+
+	return next;
+}
+
+/*
+* Gets the inorder predecessor of a node. Without parent links, the
+* lowest ancestor with i on its right is found searching from the root.
+* @param i The node, not NIL
+* @return the previous node in sorted order, NIL before the first
+*/
+template<class T, class Compare, class Fields>
+std::uint32_t CompactAVLTree<T, Compare, Fields>::predecessor(std::uint32_t i) const {
+
+	if (this->leftOf(i) != NIL) {
+
+		return this->rightMost(this->leftOf(i));
+	}
+
+	std::uint32_t previous(NIL);
+
+	if constexpr (Fields::parent) {
+
+		previous = this->parentOf(i);
+
+		while (previous != NIL && this->leftOf(previous) == i) {
+
+			i = previous;
+			previous = this->parentOf(previous);
+		}
+
+	} else {
+
+		for (std::uint32_t curr = this->rootIndex; curr != i;) {
+
+			if (this->comp.less(this->pool[curr].item(), this->pool[i].item())) {
+
+				previous = curr;
+				curr = this->rightOf(curr);
+
+			} else {
+
+				curr = this->leftOf(curr);
+			}
+		}
+	}
+
+	return previous;
+}
+
+/*
+* Helper function for displaySideways, recursion depth is the
+* height, about 1.44 log n at worst
+* @param i The current node in the tree
+* @param level The current level in the tree
+*/
+template<class T, class Compare, class Fields>
+void CompactAVLTree<T, Compare, Fields>::sideways(std::uint32_t i, int level) const {
+
+	if (this->rightOf(i) != NIL) {
+
+		this->sideways(this->rightOf(i), level + 1);
+	}
+
+	for (int j(level); j >= 0; --j) {
+
+		std::cout << "    ";
+	}
+
+	std::cout << this->pool[i].item() << std::endl;
+
+	if (this->leftOf(i) != NIL) {
+
+		this->sideways(this->leftOf(i), level + 1);
+	}
+}
+
+/*
+* Gets the number of balanced tree levels needed for n nodes
+* @param n The number of nodes
+* @return the height of a tree of minimum height
+*/
+template<class T, class Compare, class Fields>
+int CompactAVLTree<T, Compare, Fields>::minHeight(std::uint32_t n) {
+
+	int height(0);
+
+	for (; n > 0; n >>= 1) {
+
+		++height;
+	}
+
+	return height;
+}
+
+/*
+* Constructs an iterator that belongs to no tree
+*/
+template<class T, class Compare, class Fields>
+CompactAVLTree<T, Compare, Fields>::Iterator::Iterator() :curr(NIL), tree(nullptr) {}
+
+/*
+* Constructs an iterator at node i, NIL is end()
+* @param i The index of the node
+* @param tree The tree the node belongs to
+*/
+template<class T, class Compare, class Fields>
+CompactAVLTree<T, Compare, Fields>::Iterator::Iterator(std::uint32_t i, const CompactAVLTree<T, Compare, Fields>* tree)
+
+	:curr(i), tree(tree) {}
+
+/*
+* Gets the item at the iterator
+* @return the item by reference
+*/
+template<class T, class Compare, class Fields>
+const T& CompactAVLTree<T, Compare, Fields>::Iterator::operator*() const {
+
+	return this->tree->pool[this->curr].item();
+}
+
+/*
+* Gets the address of the item at the iterator
+* @return pointer to the item
+*/
+template<class T, class Compare, class Fields>
+const T* CompactAVLTree<T, Compare, Fields>::Iterator::operator->() const {
+
+	return &this->tree->pool[this->curr].item();
+}
+
+/*
+* Moves to the next item in sorted order
+* @return this by reference
+*/
+template<class T, class Compare, class Fields>
+typename CompactAVLTree<T, Compare, Fields>::Iterator& CompactAVLTree<T, Compare, Fields>::Iterator::operator++() {
+
+	this->curr = this->tree->successor(this->curr);
+
+	return *this;
+}
+
+/*
+* Moves to the next item in sorted order
+* @return the iterator before moving
+*/
+template<class T, class Compare, class Fields>
+typename CompactAVLTree<T, Compare, Fields>::Iterator CompactAVLTree<T, Compare, Fields>::Iterator::operator++(int) {
+
+	Iterator before(*this);
+
+	++(*this);
+
+	return before;
+}
+
+/*
+* Moves to the previous item in sorted order, end() moves to the last item
+* @return this by reference
+*/
+template<class T, class Compare, class Fields>
+typename CompactAVLTree<T, Compare, Fields>::Iterator& CompactAVLTree<T, Compare, Fields>::Iterator::operator--() {
+
+	this->curr = (this->curr == NIL) ? this->tree->rightMost(this->tree->rootIndex)
+	                                 : this->tree->predecessor(this->curr);
+
+	return *this;
+}
+
+/*
+* Moves to the previous item in sorted order, end() moves to the last item
+* @return the iterator before moving
+*/
+template<class T, class Compare, class Fields>
+typename CompactAVLTree<T, Compare, Fields>::Iterator CompactAVLTree<T, Compare, Fields>::Iterator::operator--(int) {
+
+	Iterator before(*this);
+
+	--(*this);
+
+	return before;
+}
+
+/*
+* Equality operator overload
+* @param other The other iterator
+* @return true if both are at the same node
+*/
+template<class T, class Compare, class Fields>
+bool CompactAVLTree<T, Compare, Fields>::Iterator::operator==(const Iterator& other) const {
+
+	return this->curr == other.curr;
+}
+
+/*
+* Inequality operator overload
+* @param other The other iterator
+* @return true if the iterators are at different nodes
+*/
+template<class T, class Compare, class Fields>
+bool CompactAVLTree<T, Compare, Fields>::Iterator::operator!=(const Iterator& other) const {
+
+	return !(*this == other);
+}
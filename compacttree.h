@@ -0,0 +1,783 @@
+/*
+* compacttree.h
+*
+* CompactAVLTree specs
+*
+* A CompactAVLTree is an AVLTree for trees of many small items, where the
+* links of a node cost more memory than its item. Nodes live side by side
+* in one pool and refer to each other by 32-bit indices instead of
+* pointers, and the balance of each node (which subtree is taller, if
+* any) takes the top 2 bits of one of its links instead of a field of
+* its own. Nodes have no vtable. Operations include:
+*
+*	- checking if empty
+*	- getting height and number of items
+*	- checking for an item, or for a key of another type with a
+*	  transparent comparator
+*	- adding and removing an item in O(log n)
+*	- selecting the k-th smallest item and ranking an item in O(log n),
+*	  with the size field
+*	- summarizing every item, with an augmentation field
+*	- displaying the tree sideways
+*	- visiting each item inorder with a function parameter
+*	- bidirectional iterators (begin/end, rbegin/rend)
+*	- clearing and reserving room for items
+*	- creating itself in O(n) from a sorted array, iterator range or
+*	  vector (moving the items), optionally sorting first
+*	- equality and non equality operator overloads
+*
+* Fields (see CompactFields) picks at compile time which fields a node
+* has besides its item and child links, and the algorithms are compiled
+* for exactly those:
+*
+*	- parent link (default on): iterators step through parents in
+*	  amortized O(1). Without it, a step searches from the root in
+*	  O(log n), and a node of 4-byte items is 12 bytes instead of 16.
+*	- subtree size (default off): select and rank, 4 more bytes
+*	- augmentation (default none): a value every node keeps about its
+*	  subtree, computed by Augment (see CompactFields), for order
+*	  statistics of your own such as the sum or the largest of a field
+*
+* Adding and removing keep the path from the root on the stack, so they
+* need no parent links, and update sizes and augmentations on that path
+* only when the tree has them.
+*
+* The pool doubles when full and moves the items to the new memory, so
+* pointers and references to items are invalidated by add and reserve,
+* like those of a std::vector. A tree holds at most 2^30 - 1 items.
+*/
+
+#ifndef COMPACTTREE_H
+#define COMPACTTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+#include "compare.h"
+
+/*
+* The augmentation of a CompactAVLTree without one
+*/
+struct NoAugment {
+
+	typedef bool value_type;
+};
+
+/*
+* Chooses the fields of the nodes of a CompactAVLTree
+*
+* Augment, unless NoAugment, has a trivially copyable value_type and
+*
+*	static value_type value(const T& item);
+*	static value_type combine(const value_type& left, const value_type& right);
+*
+* The augmentation of a subtree is the combination of value() of its
+* items in sorted order, so combine must be associative.
+*
+* @param Parent true to link every node to its parent
+* @param Size true to keep the size of every subtree
+* @param Augment What every node keeps about its subtree
+*/
+template<bool Parent = true, bool Size = false, class Augment = NoAugment>
+struct CompactFields {
+
+	static const bool parent = Parent;
+
+	static const bool size = Size;
+
+	static const bool augmented = !std::is_same<Augment, NoAugment>::value;
+
+	typedef Augment augment;
+};
+
+/*
+* Optional fields of a CompactNode, empty when turned off so they take
+* no room (the empty base optimization)
+*/
+template<bool On>
+struct CompactParentField {};
+
+template<>
+struct CompactParentField<true> {
+
+	// Parent in the low 30 bits, balance + 1 in the top 2 bits
+	std::uint32_t parent;
+};
+
+template<bool On>
+struct CompactSizeField {};
+
+template<>
+struct CompactSizeField<true> {
+
+	// Nodes in this subtree
+	std::uint32_t size;
+};
+
+template<class Augment, bool On = !std::is_same<Augment, NoAugment>::value>
+struct CompactAugmentField {};
+
+template<class Augment>
+struct CompactAugmentField<Augment, true> {
+
+	static_assert(std::is_trivially_copyable<typename Augment::value_type>::value,
+	              "the augmentation value must be trivially copyable");
+
+	// Augment's value for this subtree
+	typename Augment::value_type augment;
+};
+
+/*
+* AVL tree with 32-bit links
+*
+* @author Juan Arias
+*
+*/
+template<class T, class Compare = std::less<T>, class Fields = CompactFields<>>
+class CompactAVLTree {
+
+public:
+
+	typedef typename Fields::augment::value_type augment_type;
+
+	/*
+	* Bidirectional iterator over the items in sorted order, stepping
+	* through parent indices in amortized O(1), or searching from the
+	* root in O(log n) without them
+	*/
+	class Iterator {
+
+	public:
+
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T* pointer;
+		typedef const T& reference;
+
+		/*
+		* Constructs an iterator that belongs to no tree
+		*/
+		Iterator();
+
+		/*
+		* Gets the item at the iterator
+		* @return the item by reference
+		*/
+		reference operator*() const;
+
+		/*
+		* Gets the address of the item at the iterator
+		* @return pointer to the item
+		*/
+		pointer operator->() const;
+
+		/*
+		* Moves to the next item in sorted order
+		* @return this by reference
+		*/
+		Iterator& operator++();
+
+		/*
+		* Moves to the next item in sorted order
+		* @return the iterator before moving
+		*/
+		Iterator operator++(int);
+
+		/*
+		* Moves to the previous item in sorted order, end() moves to the last item
+		* @return this by reference
+		*/
+		Iterator& operator--();
+
+		/*
+		* Moves to the previous item in sorted order, end() moves to the last item
+		* @return the iterator before moving
+		*/
+		Iterator operator--(int);
+
+		/*
+		* Equality operator overload
+		* @param other The other iterator
+		* @return true if both are at the same node
+		*/
+		bool operator==(const Iterator& other) const;
+
+		/*
+		* Inequality operator overload
+		* @param other The other iterator
+		* @return true if the iterators are at different nodes
+		*/
+		bool operator!=(const Iterator& other) const;
+
+	private:
+
+		friend class CompactAVLTree<T, Compare, Fields>;
+
+		/*
+		* Constructs an iterator at node i, NIL is end()
+		* @param i The index of the node
+		* @param tree The tree the node belongs to
+		*/
+		Iterator(std::uint32_t i, const CompactAVLTree<T, Compare, Fields>* tree);
+
+		// Index of the node at the iterator, NIL at end()
+		std::uint32_t curr;
+
+		// Tree iterated
+		const CompactAVLTree<T, Compare, Fields>* tree;
+	};
+
+	typedef Iterator iterator;
+	typedef Iterator const_iterator;
+	typedef std::reverse_iterator<Iterator> reverse_iterator;
+	typedef std::reverse_iterator<Iterator> const_reverse_iterator;
+
+	/*
+	* Constructs empty tree
+	*/
+	CompactAVLTree();
+
+	/*
+	* Constructs tree with a given item
+	* @param item The first item
+	*/
+	explicit CompactAVLTree(const T& item);
+
+	/*
+	* Copy constructor
+	* @param other The other tree to copy
+	*/
+	CompactAVLTree(const CompactAVLTree<T, Compare, Fields>& other);
+
+	/*
+	* Destroys tree and deallocates all dynamic memory
+	*/
+	virtual ~CompactAVLTree();
+
+	/*
+	* Assignment operator overload, makes this a deep copy of other
+	* @param other The other tree to copy
+	* @return this by reference
+	*/
+	CompactAVLTree<T, Compare, Fields>& operator=(const CompactAVLTree<T, Compare, Fields>& other);
+
+	/*
+	* Checks if tree is empty
+	* @return true if there are no items, false otherwise
+	*/
+	bool isEmpty() const;
+
+	/*
+	* Gets the height of the tree in O(log n), following the balance
+	* bits down the taller side
+	* @return the height of the tree
+	*/
+	int getHeight() const;
+
+	/*
+	* Gets the amount of items in the tree in O(1)
+	* @return the amount of items in the tree
+	*/
+	int getNumberOfNodes() const;
+
+	/*
+	* Gets the amount of items in the tree in O(1)
+	* @return the amount of items in the tree
+	*/
+	std::size_t size() const;
+
+	/*
+	* Gets the k-th smallest item, counting from 0, in O(log n).
+	* Needs the size field.
+	* @param k The position of the item in sorted order
+	* @return the item at position k by reference
+	* @throws std::out_of_range if k >= size()
+	*/
+	const T& select(std::size_t k) const;
+
+	/*
+	* Counts the items less than a given item, which is the position
+	* item has or would have in sorted order, in O(log n).
+	* Needs the size field.
+	* @param item The item to rank
+	* @return the number of items less than item
+	*/
+	std::size_t rank(const T& item) const;
+
+	/*
+	* Gets the augmentation of the whole tree in O(1), the combination
+	* of the values of all items. Needs an augmentation field.
+	* @return the augmentation of the root
+	* @throws std::out_of_range if the tree is empty
+	*/
+	const augment_type& summary() const;
+
+	/*
+	* Adds a given item to the tree, if not duplicate
+	* @param item The item to add
+	* @return true if item added, false otherwise
+	*/
+	bool add(const T& item);
+
+	/*
+	* Removes a given item from the tree if there
+	* @param item The item to remove
+	* @return true if item removed, false otherwise
+	*/
+	bool remove(const T& item);
+
+	/*
+	* Deletes all items in the tree, the pool keeps its memory
+	*/
+	void clear();
+
+	/*
+	* Makes room for n items in all so adding them does not allocate
+	* @param n The number of items to make room for
+	*/
+	void reserve(std::size_t n);
+
+	/*
+	* Gets the number of bytes held by the node pool
+	* @return bytes held by the pool
+	*/
+	std::size_t bytesReserved() const;
+
+	/*
+	* Checks for membership of given item
+	* @param item The item to check for
+	* @return true if tree contains item, false otherwise
+	*/
+	bool contains(const T& item) const;
+
+	/*
+	* Checks for membership of a key of another type, only available when
+	* Compare is transparent (has is_transparent), no item is constructed
+	* @param key The key to check for
+	* @return true if tree contains an item equivalent to key
+	*/
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	bool contains(const K& key) const;
+
+	/*
+	* Prints the tree sideways
+	*/
+	void displaySideways() const;
+
+	/*
+	* Inorder traversal: left-root-right
+	* The function can modify the data in tree, but the
+	* tree structure is not changed
+	* Items are passed by reference, never copied
+	* @param visit The function to visit on each item
+	*/
+	void inorderTraverse(void visit(T& item)) const;
+
+	/*
+	* Gets an iterator at the smallest item
+	* @return iterator at the first item, end() if empty
+	*/
+	Iterator begin() const;
+
+	/*
+	* Gets the iterator past the largest item
+	* @return the end iterator
+	*/
+	Iterator end() const;
+
+	/*
+	* Gets a reverse iterator at the largest item
+	* @return reverse iterator at the last item
+	*/
+	reverse_iterator rbegin() const;
+
+	/*
+	* Gets the reverse iterator past the smallest item
+	* @return the reverse end iterator
+	*/
+	reverse_iterator rend() const;
+
+	/*
+	* Clears the tree and then uses the given sorted array of length n
+	* to create this tree at minimum height
+	* @param arr The given array of elements
+	* @param n The size of the array
+	* @return true if the array was not empty
+	*/
+	bool readTree(const T arr[], int n);
+
+	/*
+	* Clears the tree and builds it at minimum height from the items in
+	* [first, last) in O(n), each item is read once. The nodes end up in
+	* the pool in sorted order.
+	* Use std::make_move_iterator to move the items instead of copying.
+	* @param first Forward iterator to the first item
+	* @param last Iterator past the last item
+	* @param sorted true if the items are sorted without duplicates,
+	*        false to sort them and drop duplicates first
+	* @return true if the range was not empty
+	*/
+	template<class It>
+	bool readTree(It first, It last, bool sorted = true);
+
+	/*
+	* Clears the tree and builds it at minimum height in O(n),
+	* moving the items out of a vector
+	* @param items The items, left in a valid but unspecified state
+	* @param sorted true if the items are sorted without duplicates,
+	*        false to sort them and drop duplicates first
+	* @return true if items was not empty
+	*/
+	bool readTree(std::vector<T>&& items, bool sorted = true);
+
+	/*
+	* Equality operator overload
+	* @param other The other tree to compare to
+	* @return true if both trees hold equivalent items, false otherwise
+	*/
+	bool operator==(const CompactAVLTree<T, Compare, Fields>& other) const;
+
+	/*
+	* Inequality operator overload
+	* @param other The other tree to compare to
+	* @return true if the trees hold different items, false otherwise
+	*/
+	bool operator!=(const CompactAVLTree<T, Compare, Fields>& other) const;
+
+protected:
+
+	// Index of no node, the largest index 30 bits can hold
+	static const std::uint32_t NIL = (std::uint32_t(1) << 30) - 1;
+
+	/*
+	* A slot of the pool: the fields Fields asks for, the item,
+	* constructed only while the slot is in use, and the child links.
+	* The balance takes the top 2 bits of parent, or of left when there
+	* is no parent field. A free slot keeps the next free slot in right
+	* and has all bits of that field set. The augmentation comes first
+	* so a wide one does not leave padding after a 4 byte field.
+	*/
+	struct CompactNode : CompactAugmentField<typename Fields::augment>,
+	                     CompactParentField<Fields::parent>,
+	                     CompactSizeField<Fields::size> {
+
+		alignas(T) unsigned char storage[sizeof(T)];
+
+		// Left child, with the balance in the top 2 bits without a parent field
+		std::uint32_t left;
+
+		// Right child
+		std::uint32_t right;
+
+		/*
+		* Gets the item of a slot in use
+		* @return the item
+		*/
+		T& item() { return *reinterpret_cast<T*>(this->storage); }
+
+		/*
+		* Gets the item of a slot in use
+		* @return the item
+		*/
+		const T& item() const { return *reinterpret_cast<const T*>(this->storage); }
+	};
+
+	/*
+	* Gets the root of the tree
+	* @return the index of the root, NIL if empty
+	*/
+	std::uint32_t getRoot() const;
+
+	/*
+	* Gets a node of the tree
+	* @param i The index of the node, not NIL
+	* @return the node
+	*/
+	const CompactNode& node(std::uint32_t i) const;
+
+	/*
+	* Gets the left child of a node
+	* @param i The index of the node
+	* @return the index of its left child, NIL if none
+	*/
+	std::uint32_t leftOf(std::uint32_t i) const;
+
+	/*
+	* Gets the right child of a node
+	* @param i The index of the node
+	* @return the index of its right child, NIL if none
+	*/
+	std::uint32_t rightOf(std::uint32_t i) const;
+
+	/*
+	* Gets the parent of a node, needs the parent field
+	* @param i The index of the node
+	* @return the index of its parent, NIL for the root
+	*/
+	std::uint32_t parentOf(std::uint32_t i) const;
+
+	/*
+	* Gets the balance of a node, the height of its right subtree
+	* minus the height of its left subtree
+	* @param i The index of the node
+	* @return -1, 0 or 1
+	*/
+	int balanceOf(std::uint32_t i) const;
+
+private:
+
+	// Marks a free slot in the field with the balance, no node has a balance of 2
+	static const std::uint32_t FREE = ~std::uint32_t(0);
+
+	// Slots in the first pool
+	static const std::uint32_t MIN_CAPACITY = 64;
+
+	// Most levels of an AVL tree of fewer than 2^30 nodes, 1.44 * 30 rounded up
+	static const int MAX_HEIGHT = 48;
+
+	// The slots
+	CompactNode* pool;
+
+	// Number of slots
+	std::uint32_t capacity;
+
+	// Slots ever used, every slot from here on was never used
+	std::uint32_t used;
+
+	// First free slot below used, NIL if none
+	std::uint32_t freeList;
+
+	// Root of the tree
+	std::uint32_t rootIndex;
+
+	// Number of items
+	std::size_t count;
+
+	// Orders the items
+	KeyCompare<Compare> comp;
+
+	/*
+	* Helper function for contains, finds a key from the root down
+	* @param key The key to look for
+	* @return the index of the node with an equivalent item, NIL if none
+	*/
+	template<class K>
+	std::uint32_t find(const K& key) const;
+
+	/*
+	* Takes a free slot and constructs a leaf for item in it,
+	* growing the pool if needed
+	* @param item The item for the node
+	* @param parent The parent of the node
+	* @return the index of the new node
+	*/
+	template<class U>
+	std::uint32_t createNode(U&& item, std::uint32_t parent);
+
+	/*
+	* Destroys the item of a node and puts its slot on the free list
+	* @param i The index of the node
+	*/
+	void destroyNode(std::uint32_t i);
+
+	/*
+	* Moves the pool to a larger allocation, moving every item
+	* @param n The new number of slots, more than capacity
+	*/
+	void grow(std::size_t n);
+
+	/*
+	* Checks if a slot below used is free
+	* @param i The index of the slot
+	* @return true if the slot holds no node
+	*/
+	bool isFree(std::uint32_t i) const;
+
+	/*
+	* Sets the links and balance of a node
+	* @param i The index of the node
+	* @param left The left child
+	* @param right The right child
+	* @param parent The parent, ignored without the parent field
+	* @param balance -1, 0 or 1
+	*/
+	void setLinks(std::uint32_t i, std::uint32_t left, std::uint32_t right, std::uint32_t parent, int balance);
+
+	/*
+	* Sets the left child of a node, keeping its balance, and the
+	* parent of the child
+	* @param i The index of the node
+	* @param child The index of the child, possibly NIL
+	*/
+	void setLeft(std::uint32_t i, std::uint32_t child);
+
+	/*
+	* Sets the right child of a node and the parent of the child
+	* @param i The index of the node
+	* @param child The index of the child, possibly NIL
+	*/
+	void setRight(std::uint32_t i, std::uint32_t child);
+
+	/*
+	* Sets the parent of a node, keeping its balance, does nothing
+	* without the parent field
+	* @param i The index of the node
+	* @param parent The index of the parent
+	*/
+	void setParent(std::uint32_t i, std::uint32_t parent);
+
+	/*
+	* Sets the balance of a node, keeping the link it shares bits with
+	* @param i The index of the node
+	* @param balance -1, 0 or 1
+	*/
+	void setBalance(std::uint32_t i, int balance);
+
+	/*
+	* Recomputes the size and augmentation of a node from its children,
+	* does nothing when the tree has neither
+	* @param i The index of the node
+	*/
+	void update(std::uint32_t i);
+
+	/*
+	* Makes child take the place of old under parent, or the root
+	* when parent is NIL
+	* @param parent The parent of old
+	* @param old The child being replaced
+	* @param child The new child, possibly NIL
+	*/
+	void replaceChild(std::uint32_t parent, std::uint32_t old, std::uint32_t child);
+
+	/*
+	* Rotates the right child z of x into x's place, for a right heavy x
+	* whose child z is not left heavy, and sets both balances
+	* @param x The node out of balance
+	* @param up The parent of x
+	* @return z, the new root of the subtree
+	*/
+	std::uint32_t rotateLeft(std::uint32_t x, std::uint32_t up);
+
+	/*
+	* Rotates the left child z of x into x's place, for a left heavy x
+	* whose child z is not right heavy, and sets both balances
+	* @param x The node out of balance
+	* @param up The parent of x
+	* @return z, the new root of the subtree
+	*/
+	std::uint32_t rotateRight(std::uint32_t x, std::uint32_t up);
+
+	/*
+	* Rotates the left child y of x's right child z into x's place,
+	* for a right heavy x whose child z is left heavy
+	* @param x The node out of balance
+	* @param up The parent of x
+	* @return y, the new root of the subtree
+	*/
+	std::uint32_t rotateRightLeft(std::uint32_t x, std::uint32_t up);
+
+	/*
+	* Rotates the right child y of x's left child z into x's place,
+	* for a left heavy x whose child z is right heavy
+	* @param x The node out of balance
+	* @param up The parent of x
+	* @return y, the new root of the subtree
+	*/
+	std::uint32_t rotateLeftRight(std::uint32_t x, std::uint32_t up);
+
+	/*
+	* Rotates a node that is two levels out of balance
+	* @param x The node out of balance
+	* @param up The parent of x
+	* @return the new root of the subtree
+	*/
+	std::uint32_t fixBalance(std::uint32_t x, std::uint32_t up);
+
+	/*
+	* Retraces from a new leaf up to the root, updating balances
+	* until a subtree keeps its height or one rotation restores it,
+	* and sizes and augmentations all the way up
+	* @param path The nodes from the root down to the parent of the leaf
+	* @param depth The number of nodes in path
+	* @param leaf The new leaf
+	*/
+	void retraceAdd(const std::uint32_t* path, int depth, std::uint32_t leaf);
+
+	/*
+	* Retraces from where a subtree got shorter up to the root,
+	* updating balances and rotating where out of balance, and sizes
+	* and augmentations all the way up
+	* @param path The nodes from the root down to the parent of the
+	*        shorter subtree
+	* @param depth The number of nodes in path
+	* @param left true if the shorter subtree is the left one
+	*/
+	void retraceRemove(const std::uint32_t* path, int depth, bool left);
+
+	/*
+	* Helper function for readTree, builds a subtree of n nodes taking
+	* the items in order from next, in the slots [first, first + n)
+	* @param next Iterator to the next unused item, advanced by n
+	* @param first The slot of the leftmost node
+	* @param n The number of nodes in the subtree
+	* @param parent The parent of the subtree
+	* @return the root of the subtree
+	*/
+	template<class It>
+	std::uint32_t readHelper(It& next, std::uint32_t first, std::uint32_t n, std::uint32_t parent);
+
+	/*
+	* Gets the subtree size of a possibly NIL node, needs the size field
+	* @param i The index of the node
+	* @return its subtree size, 0 for NIL
+	*/
+	std::size_t sizeOf(std::uint32_t i) const;
+
+	/*
+	* Gets the leftmost node under i
+	* @param i The root of the subtree, not NIL
+	* @return the node with the smallest item
+	*/
+	std::uint32_t leftMost(std::uint32_t i) const;
+
+	/*
+	* Gets the rightmost node under i
+	* @param i The root of the subtree, not NIL
+	* @return the node with the largest item
+	*/
+	std::uint32_t rightMost(std::uint32_t i) const;
+
+	/*
+	* Gets the inorder successor of a node
+	* @param i The node, not NIL
+	* @return the next node in sorted order, NIL after the last
+	*/
+	std::uint32_t successor(std::uint32_t i) const;
+
+	/*
+	* Gets the inorder predecessor of a node
+	* @param i The node, not NIL
+	* @return the previous node in sorted order, NIL before the first
+	*/
+	std::uint32_t predecessor(std::uint32_t i) const;
+
+	/*
+	* Helper function for displaySideways
+	* @param i The current node in the tree
+	* @param level The current level in the tree
+	*/
+	void sideways(std::uint32_t i, int level) const;
+
+	/*
+	* Gets the number of balanced tree levels needed for n nodes
+	* @param n The number of nodes
+	* @return the height of a tree of minimum height
+	*/
+	static int minHeight(std::uint32_t n);
+};
+
+#include "compacttree.cpp"
+#endif // COMPACTTREE_H
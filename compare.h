@@ -0,0 +1,136 @@
+/*
+* compare.h
+*
+* KeyCompare specs and implementations
+*
+* The trees order their items with a comparator. A comparator either
+* returns bool, like std::less, or the result of a three-way comparison
+* (anything that can be compared against 0, like the result of <=>).
+* KeyCompare wraps either kind and gives the trees both questions they
+* ask: "is a before b" and "is a before, equal to or after b".
+*
+* With a three-way comparator every level of a search costs a single
+* comparison. A comparator with an is_transparent member type (std::less<>,
+* std::compare_three_way, ThreeWayCompare) also allows looking up keys of
+* other types, e.g. a const char* in a tree of std::string, without
+* building a temporary item.
+*/
+
+#ifndef KEYCOMPARE_H
+#define KEYCOMPARE_H
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#if defined(__cpp_impl_three_way_comparison) && __has_include(<compare>)
+#include <compare>
+
+/*
+* Transparent three-way comparator using operator<=>
+*/
+struct ThreeWayCompare {
+
+	typedef void is_transparent;
+
+	template<class A, class B>
+	auto operator()(const A& a, const B& b) const -> decltype(a <=> b) {
+
+		return a <=> b;
+	}
+};
+#endif
+
+template<class Compare>
+class KeyCompare {
+
+public:
+
+	/*
+	* Constructs the wrapper around a comparator
+	* @param comp The comparator
+	*/
+	explicit KeyCompare(const Compare& comp = Compare()) :comp(comp) {}
+
+	/*
+	* Checks if a comes before b, one comparison
+	* @param a The first key
+	* @param b The second key
+	* @return true if a is ordered before b
+	*/
+	template<class A, class B>
+	bool less(const A& a, const B& b) const {
+
+		if constexpr (KeyCompare::isThreeWay<A, B>()) {
+
+			return this->comp(a, b) < 0;
+
+		} else {
+
+			return this->comp(a, b);
+		}
+	}
+
+	/*
+	* Orders a against b, one comparison for a three-way comparator
+	* and two for a bool comparator
+	* @param a The first key
+	* @param b The second key
+	* @return negative if a is before b, 0 if equivalent, positive if after
+	*/
+	template<class A, class B>
+	int order(const A& a, const B& b) const {
+
+		if constexpr (KeyCompare::isThreeWay<A, B>()) {
+
+			auto result = this->comp(a, b);
+
+			return (result < 0) ? -1 : ((result == 0) ? 0 : 1);
+
+		} else {
+
+			return this->comp(a, b) ? -1 : (this->comp(b, a) ? 1 : 0);
+		}
+	}
+
+	/*
+	* Checks if a and b are equivalent
+	* @param a The first key
+	* @param b The second key
+	* @return true if neither comes before the other
+	*/
+	template<class A, class B>
+	bool equivalent(const A& a, const B& b) const {
+
+		return this->order(a, b) == 0;
+	}
+
+	/*
+	* Checks if the comparator is three-way for keys of type A and B
+	* @return true if the comparator does not return bool
+	*/
+	template<class A, class B>
+	static constexpr bool isThreeWay() {
+
+		typedef decltype(std::declval<const Compare&>()(std::declval<const A&>(),
+		                                                std::declval<const B&>())) Result;
+
+		return !std::is_same<typename std::decay<Result>::type, bool>::value;
+	}
+
+	/*
+	* Gets the wrapped comparator
+	* @return the comparator
+	*/
+	const Compare& get() const {
+
+		return this->comp;
+	}
+
+private:
+
+	// The wrapped comparator
+	Compare comp;
+};
+
+#endif // KEYCOMPARE_H
@@ -0,0 +1,1021 @@
+/*
+* concurrenttree.cpp
+*
+* ConcurrentAVLTree implementations
+*
+* Links, heights, versions and presence are atomics read and written
+* with sequentially consistent operations, which is what lets a search
+* that reads a link and then the unchanged version of its node trust
+* the link. Fixing heights and rotating follow Bronson et al. closely,
+* with the mirror image cases folded together by the side dir.
+*
+* DO NOT compile this file, it is included at the bottom of concurrenttree.h
+*/
+
+#include <algorithm>
+
+/*
+* Constructs a node with no children
+* @param parent The parent
+* @param present true for a node with an item, false for the root holder
+*/
+template<class T, class Compare>
+ConcurrentAVLTree<T, Compare>::Node::Node(Node* parent, bool present)
+
+	:child{nullptr, nullptr}, parent(parent), version(0), height(1), present(present) {}
+
+/*
+* Constructs a leaf
+* @param item The item
+* @param parent The parent
+*/
+template<class T, class Compare>
+ConcurrentAVLTree<T, Compare>::ItemNode::ItemNode(const T& item, Node* parent) :Node(parent, true), item(item) {}
+
+/*
+* Constructs empty tree
+*/
+template<class T, class Compare>
+ConcurrentAVLTree<T, Compare>::ConcurrentAVLTree() :holder(nullptr, false), count(0) {}
+
+/*
+* Destroys tree and deallocates the nodes in it, no other thread may
+* use the tree. Retired nodes are freed by EpochReclaimer.
+*/
+template<class T, class Compare>
+ConcurrentAVLTree<T, Compare>::~ConcurrentAVLTree() {
+
+	this->clear();
+}
+
+/*
+* Gets the amount of items in O(1), exact when no add or remove
+* is running
+* @return the amount of items in the tree
+*/
+template<class T, class Compare>
+std::size_t ConcurrentAVLTree<T, Compare>::size() const {
+
+	return this->count.load();
+}
+
+/*
+* Checks if tree is empty, only while no other thread uses the tree
+* @return true if there are no items, false otherwise
+*/
+template<class T, class Compare>
+bool ConcurrentAVLTree<T, Compare>::isEmpty() const {
+
+	return this->count.load() == 0;
+}
+
+/*
+* Gets the height of the tree, only while no other thread uses the tree
+* @return the height of the tree
+*/
+template<class T, class Compare>
+int ConcurrentAVLTree<T, Compare>::getHeight() const {
+
+	return ConcurrentAVLTree::heightOf(this->getRoot());
+}
+
+/*
+* Checks for membership of given item without locking
+* @param item The item to check for
+* @return true if tree contains item, false otherwise
+*/
+template<class T, class Compare>
+bool ConcurrentAVLTree<T, Compare>::contains(const T& item) const {
+
+	EpochReclaimer::Guard guard;
+
+	Attempt found;
+
+	// the root holder is never moved down, so its version stays 0
+	do {
+
+		found = this->attemptGet(item, &this->holder, 1, 0);
+
+	} while (found == RETRY);
+
+	return found == DONE;
+}
+
+/*
+* Checks for membership of a key of another type, only available when
+* Compare is transparent (has is_transparent), no item is constructed
+* @param key The key to check for
+* @return true if tree contains an item equivalent to key
+*/
+template<class T, class Compare>
+template<class K, class C, class>
+bool ConcurrentAVLTree<T, Compare>::contains(const K& key) const {
+
+	EpochReclaimer::Guard guard;
+
+	Attempt found;
+
+	do {
+
+		found = this->attemptGet(key, &this->holder, 1, 0);
+
+	} while (found == RETRY);
+
+	return found == DONE;
+}
+
+/*
+* Adds a given item to the tree, if not duplicate
+* @param item The item to add
+* @return true if item added, false otherwise
+*/
+template<class T, class Compare>
+bool ConcurrentAVLTree<T, Compare>::add(const T& item) {
+
+	EpochReclaimer::Guard guard;
+
+	Attempt added;
+
+	do {
+
+		added = this->attemptAdd(item, &this->holder, 1, 0);
+
+	} while (added == RETRY);
+
+	return added == DONE;
+}
+
+/*
+* Removes a given item from the tree if there
+* @param item The item to remove
+* @return true if item removed, false otherwise
+*/
+template<class T, class Compare>
+bool ConcurrentAVLTree<T, Compare>::remove(const T& item) {
+
+	EpochReclaimer::Guard guard;
+
+	Attempt removed;
+
+	do {
+
+		removed = this->attemptRemove(item, &this->holder, 1, 0);
+
+	} while (removed == RETRY);
+
+	return removed == DONE;
+}
+
+/*
+* Deletes all items in the tree, only while no other thread uses the tree
+*/
+template<class T, class Compare>
+void ConcurrentAVLTree<T, Compare>::clear() {
+
+	ConcurrentAVLTree::clearHelper(this->holder.child[1].load());
+
+	this->holder.child[1].store(nullptr);
+	this->count.store(0);
+}
+
+/*
+* Inorder traversal: left-root-right, only while no other thread
+* uses the tree
+* @param visit The function to visit on each item
+*/
+template<class T, class Compare>
+void ConcurrentAVLTree<T, Compare>::inorderTraverse(void visit(const T& item)) const {
+
+	ConcurrentAVLTree::inorderHelper(this->getRoot(), visit);
+}
+
+/*
+* Gets the root of the tree
+* @return the root, nullptr if empty
+*/
+template<class T, class Compare>
+const typename ConcurrentAVLTree<T, Compare>::Node* ConcurrentAVLTree<T, Compare>::getRoot() const {
+
+	return this->holder.child[1].load();
+}
+
+/*
+* Gets the item of a node
+* @param node The node, not the root holder
+* @return the item
+*/
+template<class T, class Compare>
+const T& ConcurrentAVLTree<T, Compare>::itemOf(const Node* node) {
+
+	return static_cast<const ItemNode*>(node)->item;
+}
+
+/*
+* Searches for a key below a node, backing up when the node changes
+* @param key The key to look for
+* @param node The node the search is at
+* @param dir The side of node to search
+* @param nodeVersion The version of node when the search got there
+* @return DONE if found, FAILED if not, RETRY if node changed
+*/
+template<class T, class Compare>
+template<class K>
+typename ConcurrentAVLTree<T, Compare>::Attempt ConcurrentAVLTree<T, Compare>::attemptGet(const K& key, Node* node, int dir,
+                                                                                          std::uint64_t nodeVersion) const {
+
+	while (true) {
+
+		Node* child = node->child[dir].load();
+
+		if (child == nullptr) {
+
+			// the empty link was right only if node did not move since
+			return (node->version.load() != nodeVersion) ? RETRY : FAILED;
+		}
+
+		int order = this->comp.order(key, ConcurrentAVLTree::itemOf(child));
+
+		if (order == 0) {
+
+			return child->present.load() ? DONE : FAILED;
+		}
+
+		std::uint64_t childVersion = child->version.load();
+
+		if ((childVersion & (SHRINKING | UNLINKED)) != 0) {
+
+			ConcurrentAVLTree::waitUntilShrunk(child);
+
+			if (node->version.load() != nodeVersion) {
+
+				return RETRY;
+			}
+
+		} else if (child != node->child[dir].load()) {
+
+			if (node->version.load() != nodeVersion) {
+
+				return RETRY;
+			}
+
+		} else {
+
+			if (node->version.load() != nodeVersion) {
+
+				return RETRY;
+			}
+
+			// child was reached while node still covered key
+			Attempt found = this->attemptGet(key, child, order > 0, childVersion);
+
+			if (found != RETRY) {
+
+				return found;
+			}
+		}
+	}
+}
+
+/*
+* Adds an item below a node, backing up when the node changes
+* @param item The item to add
+* @param node The node the search is at
+* @param dir The side of node to search
+* @param nodeVersion The version of node when the search got there
+* @return DONE if added, FAILED if there, RETRY if node changed
+*/
+template<class T, class Compare>
+typename ConcurrentAVLTree<T, Compare>::Attempt ConcurrentAVLTree<T, Compare>::attemptAdd(const T& item, Node* node, int dir,
+                                                                                          std::uint64_t nodeVersion) {
+
+	while (true) {
+
+		Node* child = node->child[dir].load();
+
+		if (node->version.load() != nodeVersion) {
+
+			return RETRY;
+		}
+
+		if (child == nullptr) {
+
+			Node* damaged;
+
+			{
+				std::lock_guard<std::mutex> nodeLock(node->lock);
+
+				if (node->version.load() != nodeVersion) {
+
+					return RETRY;
+				}
+
+				if (node->child[dir].load() != nullptr) {
+
+					// another writer linked a node there first
+					continue;
+				}
+
+				node->child[dir].store(new ItemNode(item, node));
+
+				damaged = this->fixHeight(node);
+			}
+
+			++this->count;
+
+			this->fixHeightAndRebalance(damaged);
+
+			return DONE;
+		}
+
+		int order = this->comp.order(item, ConcurrentAVLTree::itemOf(child));
+
+		if (order == 0) {
+
+			Attempt revived = this->attemptRevive(child);
+
+			if (revived != RETRY) {
+
+				return revived;
+			}
+
+			continue;
+		}
+
+		std::uint64_t childVersion = child->version.load();
+
+		if ((childVersion & (SHRINKING | UNLINKED)) != 0) {
+
+			ConcurrentAVLTree::waitUntilShrunk(child);
+
+		} else if (child == node->child[dir].load()) {
+
+			if (node->version.load() != nodeVersion) {
+
+				return RETRY;
+			}
+
+			Attempt added = this->attemptAdd(item, child, order > 0, childVersion);
+
+			if (added != RETRY) {
+
+				return added;
+			}
+		}
+	}
+}
+
+/*
+* Marks a routing node with item present again
+* @param node The node
+* @return DONE if revived, FAILED if present, RETRY if unlinked
+*/
+template<class T, class Compare>
+typename ConcurrentAVLTree<T, Compare>::Attempt ConcurrentAVLTree<T, Compare>::attemptRevive(Node* node) {
+
+	if (node->present.load()) {
+
+		return FAILED;
+	}
+
+	std::lock_guard<std::mutex> nodeLock(node->lock);
+
+	if (node->version.load() == UNLINKED) {
+
+		return RETRY;
+	}
+
+	if (node->present.load()) {
+
+		return FAILED;
+	}
+
+	node->present.store(true);
+
+	++this->count;
+
+	return DONE;
+}
+
+/*
+* Removes an item below a node, backing up when the node changes
+* @param item The item to remove
+* @param node The node the search is at
+* @param dir The side of node to search
+* @param nodeVersion The version of node when the search got there
+* @return DONE if removed, FAILED if not there, RETRY if node changed
+*/
+template<class T, class Compare>
+typename ConcurrentAVLTree<T, Compare>::Attempt ConcurrentAVLTree<T, Compare>::attemptRemove(const T& item, Node* node, int dir,
+                                                                                             std::uint64_t nodeVersion) {
+
+	while (true) {
+
+		Node* child = node->child[dir].load();
+
+		if (node->version.load() != nodeVersion) {
+
+			return RETRY;
+		}
+
+		if (child == nullptr) {
+
+			return FAILED;
+		}
+
+		int order = this->comp.order(item, ConcurrentAVLTree::itemOf(child));
+
+		if (order == 0) {
+
+			Attempt removed = this->attemptRemoveNode(node, child);
+
+			if (removed != RETRY) {
+
+				return removed;
+			}
+
+			continue;
+		}
+
+		std::uint64_t childVersion = child->version.load();
+
+		if ((childVersion & (SHRINKING | UNLINKED)) != 0) {
+
+			ConcurrentAVLTree::waitUntilShrunk(child);
+
+		} else if (child == node->child[dir].load()) {
+
+			if (node->version.load() != nodeVersion) {
+
+				return RETRY;
+			}
+
+			Attempt removed = this->attemptRemove(item, child, order > 0, childVersion);
+
+			if (removed != RETRY) {
+
+				return removed;
+			}
+		}
+	}
+}
+
+/*
+* Removes the item of a node, unlinking the node if it has at
+* most one child, or else making it a routing node
+* @param parent The parent the search came from
+* @param node The node
+* @return DONE if removed, FAILED if not present, RETRY if either changed
+*/
+template<class T, class Compare>
+typename ConcurrentAVLTree<T, Compare>::Attempt ConcurrentAVLTree<T, Compare>::attemptRemoveNode(Node* parent, Node* node) {
+
+	if (!node->present.load()) {
+
+		return FAILED;
+	}
+
+	if (node->child[0].load() == nullptr || node->child[1].load() == nullptr) {
+
+		Node* damaged;
+
+		{
+			// parent before child, and node is locked only once parent is
+			// known to still be its parent, so no thread can hold node while
+			// waiting for parent (see tsan.supp for the false report)
+			std::lock_guard<std::mutex> parentLock(parent->lock);
+
+			if (parent->version.load() == UNLINKED || node->parent.load() != parent) {
+
+				return RETRY;
+			}
+
+			std::lock_guard<std::mutex> nodeLock(node->lock);
+
+			if (!node->present.load()) {
+
+				return FAILED;
+			}
+
+			if (!this->attemptUnlink(parent, node)) {
+
+				return RETRY;
+			}
+
+			damaged = this->fixHeight(parent);
+		}
+
+		--this->count;
+
+		this->fixHeightAndRebalance(damaged);
+
+		return DONE;
+	}
+
+	std::lock_guard<std::mutex> nodeLock(node->lock);
+
+	if (node->version.load() == UNLINKED) {
+
+		return RETRY;
+	}
+
+	if (!node->present.load()) {
+
+		return FAILED;
+	}
+
+	if (node->child[0].load() == nullptr || node->child[1].load() == nullptr) {
+
+		// lost a child since, so it can be unlinked after all
+		return RETRY;
+	}
+
+	node->present.store(false);
+
+	--this->count;
+
+	return DONE;
+}
+
+/*
+* Unlinks a node with at most one child and retires it, with the
+* node and its parent locked
+* @param parent The parent
+* @param node The node
+* @return true if unlinked, false if either changed
+*/
+template<class T, class Compare>
+bool ConcurrentAVLTree<T, Compare>::attemptUnlink(Node* parent, Node* node) {
+
+	Node* parentLeft = parent->child[0].load();
+
+	if (parentLeft != node && parent->child[1].load() != node) {
+
+		return false;
+	}
+
+	Node* left = node->child[0].load();
+	Node* right = node->child[1].load();
+
+	if (left != nullptr && right != nullptr) {
+
+		return false;
+	}
+
+	Node* splice = (left != nullptr) ? left : right;
+
+	parent->child[(parentLeft == node) ? 0 : 1].store(splice);
+
+	if (splice != nullptr) {
+
+		splice->parent.store(parent);
+	}
+
+	node->version.store(UNLINKED);
+	node->present.store(false);
+
+	// freed once every search that may be on it is done
+	EpochReclaimer::retire(static_cast<ItemNode*>(node), ConcurrentAVLTree::destroy);
+
+	return true;
+}
+
+/*
+* Waits until a rotation moving node down is done. The rotation
+* holds the node's lock, so taking it waits for the end.
+* @param node The node
+*/
+template<class T, class Compare>
+void ConcurrentAVLTree<T, Compare>::waitUntilShrunk(Node* node) {
+
+	if ((node->version.load() & SHRINKING) != 0) {
+
+		std::lock_guard<std::mutex> wait(node->lock);
+	}
+}
+
+/*
+* Checks what a node needs, from a read of its links and heights
+* that may be stale. Whoever changes a node later fixes it again, so
+* a stale answer is never the last word.
+* @param node The node
+* @return NOTHING_REQUIRED, REBALANCE_REQUIRED, UNLINK_REQUIRED or
+*         the height the node should have
+*/
+template<class T, class Compare>
+int ConcurrentAVLTree<T, Compare>::nodeCondition(Node* node) const {
+
+	Node* left = node->child[0].load();
+	Node* right = node->child[1].load();
+
+	if ((left == nullptr || right == nullptr) && !node->present.load()) {
+
+		return UNLINK_REQUIRED;
+	}
+
+	int height = node->height.load();
+	int hLeft = ConcurrentAVLTree::heightOf(left);
+	int hRight = ConcurrentAVLTree::heightOf(right);
+
+	if (hLeft - hRight < -1 || hLeft - hRight > 1) {
+
+		return REBALANCE_REQUIRED;
+	}
+
+	int repaired = 1 + std::max(hLeft, hRight);
+
+	return (height != repaired) ? repaired : NOTHING_REQUIRED;
+}
+
+/*
+* Fixes the height of a node, with the node locked
+* @param node The node
+* @return the node to check next, the parent if nothing needed fixing
+*/
+template<class T, class Compare>
+typename ConcurrentAVLTree<T, Compare>::Node* ConcurrentAVLTree<T, Compare>::fixHeight(Node* node) {
+
+	int condition = this->nodeCondition(node);
+
+	if (condition == REBALANCE_REQUIRED || condition == UNLINK_REQUIRED) {
+
+		return node;
+	}
+
+	if (condition != NOTHING_REQUIRED) {
+
+		node->height.store(condition);
+	}
+
+	// the parent's height may be off now
+	return node->parent.load();
+}
+
+/*
+* Fixes heights, balance and routing nodes from a node up until
+* nothing needs fixing, locking what it changes. After a rotation
+* it goes on to the root, since a rotation hands back its deepest
+* damaged node and fixing that one may not reach the others.
+* @param node The first node to fix
+*/
+template<class T, class Compare>
+void ConcurrentAVLTree<T, Compare>::fixHeightAndRebalance(Node* node) {
+
+	bool rotated(false);
+
+	// the root holder has no parent and needs no fixing
+	while (node != nullptr && node->parent.load() != nullptr) {
+
+		int condition = this->nodeCondition(node);
+
+		if (node->version.load() == UNLINKED || (condition == NOTHING_REQUIRED && !rotated)) {
+
+			return;
+		}
+
+		if (condition == NOTHING_REQUIRED) {
+
+			node = node->parent.load();
+
+		} else if (condition != REBALANCE_REQUIRED && condition != UNLINK_REQUIRED) {
+
+			std::lock_guard<std::mutex> nodeLock(node->lock);
+
+			node = this->fixHeight(node);
+
+		} else {
+
+			Node* parent = node->parent.load();
+
+			// parent before child, node only once the link is checked
+			// with parent locked, as in attemptRemoveNode
+			std::lock_guard<std::mutex> parentLock(parent->lock);
+
+			// else try node again
+			if (parent->version.load() != UNLINKED && node->parent.load() == parent) {
+
+				std::lock_guard<std::mutex> nodeLock(node->lock);
+
+				rotated = true;
+
+				node = this->rebalance(parent, node);
+			}
+		}
+	}
+}
+
+/*
+* Unlinks, rotates or fixes the height of a node, with the node
+* and its parent locked
+* @param parent The parent
+* @param node The node
+* @return the node to check next, the parent if nothing needed fixing
+*/
+template<class T, class Compare>
+typename ConcurrentAVLTree<T, Compare>::Node* ConcurrentAVLTree<T, Compare>::rebalance(Node* parent, Node* node) {
+
+	Node* left = node->child[0].load();
+	Node* right = node->child[1].load();
+
+	if ((left == nullptr || right == nullptr) && !node->present.load()) {
+
+		return this->attemptUnlink(parent, node) ? this->fixHeight(parent) : node;
+	}
+
+	int height = node->height.load();
+	int hLeft = ConcurrentAVLTree::heightOf(left);
+	int hRight = ConcurrentAVLTree::heightOf(right);
+
+	if (hLeft - hRight > 1) {
+
+		return this->rebalanceToward(parent, node, left, hRight, 0);
+	}
+
+	if (hLeft - hRight < -1) {
+
+		return this->rebalanceToward(parent, node, right, hLeft, 1);
+	}
+
+	int repaired = 1 + std::max(hLeft, hRight);
+
+	if (height != repaired) {
+
+		node->height.store(repaired);
+
+		return this->fixHeight(parent);
+	}
+
+	return parent;
+}
+
+/*
+* Rotates for a node whose child on side dir is too tall, once or
+* twice, locking that child and maybe its child on the other side
+* @param parent The parent, locked
+* @param node The node, locked
+* @param tall The child on side dir
+* @param hShort The height of the other child
+* @param dir 0 if the left child is too tall, 1 for the right one
+* @return the node to check next, the parent if nothing needed fixing
+*/
+template<class T, class Compare>
+typename ConcurrentAVLTree<T, Compare>::Node* ConcurrentAVLTree<T, Compare>::rebalanceToward(Node* parent, Node* node, Node* tall,
+                                                                                             int hShort, int dir) {
+
+	// tall and inner were read as children with their parents locked,
+	// so these locks go down the tree like every other nested lock
+	std::lock_guard<std::mutex> tallLock(tall->lock);
+
+	if (tall->height.load() - hShort <= 1) {
+
+		// changed since node was checked, check it again
+		return node;
+	}
+
+	Node* inner = tall->child[1 - dir].load();
+
+	int hOuter = ConcurrentAVLTree::heightOf(tall->child[dir].load());
+	int hInner0 = ConcurrentAVLTree::heightOf(inner);
+
+	if (hOuter >= hInner0) {
+
+		return this->rotate(parent, node, tall, hShort, hOuter, inner, hInner0, dir);
+	}
+
+	{
+		std::lock_guard<std::mutex> innerLock(inner->lock);
+
+		int hInner = inner->height.load();
+
+		if (hOuter >= hInner) {
+
+			return this->rotate(parent, node, tall, hShort, hOuter, inner, hInner, dir);
+		}
+
+		int hInnerOuter = ConcurrentAVLTree::heightOf(inner->child[dir].load());
+
+		// a double rotation only if it leaves tall balanced
+		if (hOuter - hInnerOuter >= -1 && hOuter - hInnerOuter <= 1) {
+
+			return this->rotateDouble(parent, node, tall, hShort, hOuter, inner, hInnerOuter, dir);
+		}
+	}
+
+	// rotate inner up over tall first, node is balanced later
+	return this->rebalanceToward(node, tall, inner, hOuter, 1 - dir);
+}
+
+/*
+* Rotates tall, the child of node on side dir, into node's place
+* @param parent The parent, locked
+* @param node The node, locked
+* @param tall The child on side dir, locked
+* @param hShort The height of node's other child
+* @param hOuter The height of tall's child on side dir
+* @param inner tall's child on the other side
+* @param hInner The height of inner
+* @param dir The side of tall
+* @return the node to check next, the parent if nothing needed fixing
+*/
+template<class T, class Compare>
+typename ConcurrentAVLTree<T, Compare>::Node* ConcurrentAVLTree<T, Compare>::rotate(Node* parent, Node* node, Node* tall, int hShort,
+                                                                                    int hOuter, Node* inner, int hInner, int dir) {
+
+	std::uint64_t nodeVersion = node->version.load();
+
+	node->version.store(nodeVersion | SHRINKING);
+
+	Node* parentLeft = parent->child[0].load();
+
+	// every link but node's stays right for searches going through
+	node->child[dir].store(inner);
+
+	if (inner != nullptr) {
+
+		inner->parent.store(node);
+	}
+
+	tall->child[1 - dir].store(node);
+	node->parent.store(tall);
+
+	parent->child[(parentLeft == node) ? 0 : 1].store(tall);
+	tall->parent.store(parent);
+
+	int hNode = 1 + std::max(hInner, hShort);
+
+	node->height.store(hNode);
+	tall->height.store(1 + std::max(hOuter, hNode));
+
+	node->version.store(nodeVersion + SHRINK_COUNT);
+
+	// fix what the locks held allow, deepest first
+	if (hInner - hShort < -1 || hInner - hShort > 1) {
+
+		return node;
+	}
+
+	if ((inner == nullptr || hShort == 0) && !node->present.load()) {
+
+		return node;
+	}
+
+	if (hOuter - hNode < -1 || hOuter - hNode > 1) {
+
+		return tall;
+	}
+
+	if (hOuter == 0 && !tall->present.load()) {
+
+		return tall;
+	}
+
+	return this->fixHeight(parent);
+}
+
+/*
+* Rotates inner, the child of tall on the side away from dir, into
+* node's place, tall being node's child on side dir
+* @param parent The parent, locked
+* @param node The node, locked
+* @param tall The child on side dir, locked
+* @param hShort The height of node's other child
+* @param hOuter The height of tall's child on side dir
+* @param inner tall's child on the other side, locked
+* @param hInnerOuter The height of inner's child on side dir
+* @param dir The side of tall
+* @return the node to check next, the parent if nothing needed fixing
+*/
+template<class T, class Compare>
+typename ConcurrentAVLTree<T, Compare>::Node* ConcurrentAVLTree<T, Compare>::rotateDouble(Node* parent, Node* node, Node* tall,
+                                                                                          int hShort, int hOuter, Node* inner,
+                                                                                          int hInnerOuter, int dir) {
+
+	std::uint64_t nodeVersion = node->version.load();
+	std::uint64_t tallVersion = tall->version.load();
+
+	Node* parentLeft = parent->child[0].load();
+	Node* innerOuter = inner->child[dir].load();
+	Node* innerInner = inner->child[1 - dir].load();
+
+	int hInnerInner = ConcurrentAVLTree::heightOf(innerInner);
+
+	node->version.store(nodeVersion | SHRINKING);
+	tall->version.store(tallVersion | SHRINKING);
+
+	node->child[dir].store(innerInner);
+
+	if (innerInner != nullptr) {
+
+		innerInner->parent.store(node);
+	}
+
+	tall->child[1 - dir].store(innerOuter);
+
+	if (innerOuter != nullptr) {
+
+		innerOuter->parent.store(tall);
+	}
+
+	inner->child[dir].store(tall);
+	tall->parent.store(inner);
+	inner->child[1 - dir].store(node);
+	node->parent.store(inner);
+
+	parent->child[(parentLeft == node) ? 0 : 1].store(inner);
+	inner->parent.store(parent);
+
+	int hNode = 1 + std::max(hInnerInner, hShort);
+	int hTall = 1 + std::max(hOuter, hInnerOuter);
+
+	node->height.store(hNode);
+	tall->height.store(hTall);
+	inner->height.store(1 + std::max(hTall, hNode));
+
+	node->version.store(nodeVersion + SHRINK_COUNT);
+	tall->version.store(tallVersion + SHRINK_COUNT);
+
+	// a routing node left with one child or none is unlinked while
+	// inner, now its parent, is still locked
+	if ((hOuter == 0 || hInnerOuter == 0) && !tall->present.load()) {
+
+		this->attemptUnlink(inner, tall);
+
+		hTall = std::max(hOuter, hInnerOuter);
+
+		inner->height.store(1 + std::max(hTall, hNode));
+	}
+
+	if (hInnerInner - hShort < -1 || hInnerInner - hShort > 1) {
+
+		return node;
+	}
+
+	if ((innerInner == nullptr || hShort == 0) && !node->present.load()) {
+
+		return node;
+	}
+
+	if (hTall - hNode < -1 || hTall - hNode > 1 || (hTall == 0 && !inner->present.load())) {
+
+		return inner;
+	}
+
+	return this->fixHeight(parent);
+}
+
+/*
+* Gets the height of a possibly null node
+* @param node The node
+* @return its height, 0 for nullptr
+*/
+template<class T, class Compare>
+int ConcurrentAVLTree<T, Compare>::heightOf(const Node* node) {
+
+	return (node != nullptr) ? node->height.load() : 0;
+}
+
+/*
+* Deletes a retired node, for EpochReclaimer
+* @param node The node
+*/
+template<class T, class Compare>
+void ConcurrentAVLTree<T, Compare>::destroy(void* node) {
+
+	delete static_cast<ItemNode*>(node);
+}
+
+/*
+* Helper function for clear, deletes a subtree
+* @param node The root of the subtree
+*/
+template<class T, class Compare>
+void ConcurrentAVLTree<T, Compare>::clearHelper(Node* node) {
+
+	if (node != nullptr) {
+
+		ConcurrentAVLTree::clearHelper(node->child[0].load());
+		ConcurrentAVLTree::clearHelper(node->child[1].load());
+
+		delete static_cast<ItemNode*>(node);
+	}
+}
+
+/*
+* Helper function for inorderTraverse, skipping routing nodes
+* @param node The root of the subtree
+* @param visit The function to visit on each item
+*/
+template<class T, class Compare>
+void ConcurrentAVLTree<T, Compare>::inorderHelper(const Node* node, void visit(const T& item)) {
+
+	if (node != nullptr) {
+
+		ConcurrentAVLTree::inorderHelper(node->child[0].load(), visit);
+
+		if (node->present.load()) {
+
+			visit(ConcurrentAVLTree::itemOf(node));
+		}
+
+		ConcurrentAVLTree::inorderHelper(node->child[1].load(), visit);
+	}
+}
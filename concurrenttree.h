@@ -0,0 +1,410 @@
+/*
+* concurrenttree.h
+*
+* ConcurrentAVLTree specs
+*
+* A ConcurrentAVLTree is an AVL tree that many threads can search and
+* change at once. Searches take no locks at all, and writers lock only
+* the nodes they change, so readers never wait behind a global mutex.
+* Operations include:
+*
+*	- checking for an item, or for a key of another type with a
+*	  transparent comparator, without locking
+*	- adding and removing an item in O(log n)
+*	- getting the number of items
+*
+* and, only while no other thread uses the tree:
+*
+*	- checking if empty, getting the height
+*	- visiting each item inorder with a function parameter
+*	- clearing
+*
+* The algorithm is the optimistic one of Bronson, Casper, Chafi and
+* Olukotun (A Practical Concurrent Binary Search Tree, PPoPP 2010).
+* Every node has a version that a rotation changes when it moves the
+* node down, which shrinks the range of keys under it. A search reads
+* the version of a node, reads the link to the child, then checks that
+* the version is the same, so a rotation that happened in between is
+* noticed and the search backs up one level instead of starting over.
+*
+* Writers lock the node they link a new leaf to, or the node and its
+* parent to unlink it, and rebalancing locks the parent, the node and
+* the one or two children it rotates, always top down, locking a child
+* only after checking with its parent locked that the link is still
+* there. Removing an item with two children only marks its node as a
+* routing node with no item, which rebalancing unlinks once it has one
+* child or none; adding the item back revives it. Heights are fixed
+* after the change, by the writer, so the tree may be briefly out of
+* balance while writers are active, and is a strict AVL tree whenever
+* they are not.
+*
+* ThreadSanitizer reports the nested locks as lock-order inversions,
+* since a rotation makes a parent the child of its old child and the
+* same two nodes are later locked the other way round. Run it with
+* TSAN_OPTIONS="suppressions=tsan.supp" to leave those out.
+*
+* Unlinked nodes are retired to EpochReclaimer (see epoch.h) and freed
+* once no search can still be reading them.
+*/
+
+#ifndef CONCURRENTTREE_H
+#define CONCURRENTTREE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include "compare.h"
+#include "epoch.h"
+
+/*
+* AVL tree safe to use from many threads at once
+*
+* @author Juan Arias
+*
+*/
+template<class T, class Compare = std::less<T>>
+class ConcurrentAVLTree {
+
+public:
+
+	/*
+	* Constructs empty tree
+	*/
+	ConcurrentAVLTree();
+
+	/*
+	* Destroys tree and deallocates the nodes in it, no other thread may
+	* use the tree. Retired nodes are freed by EpochReclaimer.
+	*/
+	virtual ~ConcurrentAVLTree();
+
+	ConcurrentAVLTree(const ConcurrentAVLTree<T, Compare>& other) = delete;
+
+	ConcurrentAVLTree<T, Compare>& operator=(const ConcurrentAVLTree<T, Compare>& other) = delete;
+
+	/*
+	* Gets the amount of items in O(1), exact when no add or remove
+	* is running
+	* @return the amount of items in the tree
+	*/
+	std::size_t size() const;
+
+	/*
+	* Checks if tree is empty, only while no other thread uses the tree
+	* @return true if there are no items, false otherwise
+	*/
+	bool isEmpty() const;
+
+	/*
+	* Gets the height of the tree, only while no other thread uses the tree
+	* @return the height of the tree
+	*/
+	int getHeight() const;
+
+	/*
+	* Checks for membership of given item without locking
+	* @param item The item to check for
+	* @return true if tree contains item, false otherwise
+	*/
+	bool contains(const T& item) const;
+
+	/*
+	* Checks for membership of a key of another type, only available when
+	* Compare is transparent (has is_transparent), no item is constructed
+	* @param key The key to check for
+	* @return true if tree contains an item equivalent to key
+	*/
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	bool contains(const K& key) const;
+
+	/*
+	* Adds a given item to the tree, if not duplicate
+	* @param item The item to add
+	* @return true if item added, false otherwise
+	*/
+	bool add(const T& item);
+
+	/*
+	* Removes a given item from the tree if there
+	* @param item The item to remove
+	* @return true if item removed, false otherwise
+	*/
+	bool remove(const T& item);
+
+	/*
+	* Deletes all items in the tree, only while no other thread uses the tree
+	*/
+	void clear();
+
+	/*
+	* Inorder traversal: left-root-right, only while no other thread
+	* uses the tree
+	* @param visit The function to visit on each item
+	*/
+	void inorderTraverse(void visit(const T& item)) const;
+
+protected:
+
+	/*
+	* A node: the links, height and version readers go through without
+	* locking, and the lock writers take to change them
+	*/
+	struct Node {
+
+		/*
+		* Constructs a node with no children
+		* @param parent The parent
+		* @param present true for a node with an item, false for the root holder
+		*/
+		Node(Node* parent, bool present);
+
+		// Children, the left one at 0 and the right one at 1
+		std::atomic<Node*> child[2];
+
+		// Parent, nullptr only for the root holder
+		std::atomic<Node*> parent;
+
+		// Changes each time a rotation moves the node down, UNLINKED once unlinked
+		std::atomic<std::uint64_t> version;
+
+		// Height of the subtree, may be stale while writers are fixing it
+		std::atomic<int> height;
+
+		// false for a routing node, whose item was removed
+		std::atomic<bool> present;
+
+		// Held to change the node's links, height or presence
+		std::mutex lock;
+	};
+
+	/*
+	* A node with an item, every node but the root holder
+	*/
+	struct ItemNode : Node {
+
+		/*
+		* Constructs a leaf
+		* @param item The item
+		* @param parent The parent
+		*/
+		ItemNode(const T& item, Node* parent);
+
+		// The item, never changes
+		const T item;
+	};
+
+	/*
+	* Gets the root of the tree
+	* @return the root, nullptr if empty
+	*/
+	const Node* getRoot() const;
+
+	/*
+	* Gets the item of a node
+	* @param node The node, not the root holder
+	* @return the item
+	*/
+	static const T& itemOf(const Node* node);
+
+private:
+
+	// Set in a version while a rotation moves the node down
+	static const std::uint64_t SHRINKING = 2;
+
+	// Added to a version when a rotation that moves the node down ends
+	static const std::uint64_t SHRINK_COUNT = 4;
+
+	// The version of an unlinked node
+	static const std::uint64_t UNLINKED = 1;
+
+	// Answers of nodeCondition that are not a height
+	static const int NOTHING_REQUIRED = -1;
+
+	static const int REBALANCE_REQUIRED = -2;
+
+	static const int UNLINK_REQUIRED = -3;
+
+	/*
+	* What an attempt at one level of the tree ended with: the answer,
+	* or RETRY when the node it started from changed
+	*/
+	enum Attempt { FAILED, DONE, RETRY };
+
+	// Never removed node whose right child is the root
+	mutable Node holder;
+
+	// Number of items
+	std::atomic<std::size_t> count;
+
+	// Orders the items
+	KeyCompare<Compare> comp;
+
+	/*
+	* Searches for a key below a node, backing up when the node changes
+	* @param key The key to look for
+	* @param node The node the search is at
+	* @param dir The side of node to search
+	* @param nodeVersion The version of node when the search got there
+	* @return DONE if found, FAILED if not, RETRY if node changed
+	*/
+	template<class K>
+	Attempt attemptGet(const K& key, Node* node, int dir, std::uint64_t nodeVersion) const;
+
+	/*
+	* Adds an item below a node, backing up when the node changes
+	* @param item The item to add
+	* @param node The node the search is at
+	* @param dir The side of node to search
+	* @param nodeVersion The version of node when the search got there
+	* @return DONE if added, FAILED if there, RETRY if node changed
+	*/
+	Attempt attemptAdd(const T& item, Node* node, int dir, std::uint64_t nodeVersion);
+
+	/*
+	* Marks a routing node with item present again
+	* @param node The node
+	* @return DONE if revived, FAILED if present, RETRY if unlinked
+	*/
+	Attempt attemptRevive(Node* node);
+
+	/*
+	* Removes an item below a node, backing up when the node changes
+	* @param item The item to remove
+	* @param node The node the search is at
+	* @param dir The side of node to search
+	* @param nodeVersion The version of node when the search got there
+	* @return DONE if removed, FAILED if not there, RETRY if node changed
+	*/
+	Attempt attemptRemove(const T& item, Node* node, int dir, std::uint64_t nodeVersion);
+
+	/*
+	* Removes the item of a node, unlinking the node if it has at
+	* most one child, or else making it a routing node
+	* @param parent The parent the search came from
+	* @param node The node
+	* @return DONE if removed, FAILED if not present, RETRY if either changed
+	*/
+	Attempt attemptRemoveNode(Node* parent, Node* node);
+
+	/*
+	* Unlinks a node with at most one child and retires it, with the
+	* node and its parent locked
+	* @param parent The parent
+	* @param node The node
+	* @return true if unlinked, false if either changed
+	*/
+	bool attemptUnlink(Node* parent, Node* node);
+
+	/*
+	* Waits until a rotation moving node down is done
+	* @param node The node
+	*/
+	static void waitUntilShrunk(Node* node);
+
+	/*
+	* Checks what a node needs, from a read of its links and heights
+	* that may be stale
+	* @param node The node
+	* @return NOTHING_REQUIRED, REBALANCE_REQUIRED, UNLINK_REQUIRED or
+	*         the height the node should have
+	*/
+	int nodeCondition(Node* node) const;
+
+	/*
+	* Fixes the height of a node, with the node locked
+	* @param node The node
+	* @return the node to check next, the parent if nothing needed fixing
+	*/
+	Node* fixHeight(Node* node);
+
+	/*
+	* Fixes heights, balance and routing nodes from a node up until
+	* nothing needs fixing, locking what it changes. After a rotation
+	* it goes on to the root, since a rotation hands back its deepest
+	* damaged node and fixing that one may not reach the others.
+	* @param node The first node to fix
+	*/
+	void fixHeightAndRebalance(Node* node);
+
+	/*
+	* Unlinks, rotates or fixes the height of a node, with the node
+	* and its parent locked
+	* @param parent The parent
+	* @param node The node
+	* @return the node to check next, the parent if nothing needed fixing
+	*/
+	Node* rebalance(Node* parent, Node* node);
+
+	/*
+	* Rotates for a node whose child on side dir is too tall, once or
+	* twice, locking that child and maybe its child on the other side
+	* @param parent The parent, locked
+	* @param node The node, locked
+	* @param tall The child on side dir
+	* @param hShort The height of the other child
+	* @param dir 0 if the left child is too tall, 1 for the right one
+	* @return the node to check next, the parent if nothing needed fixing
+	*/
+	Node* rebalanceToward(Node* parent, Node* node, Node* tall, int hShort, int dir);
+
+	/*
+	* Rotates tall, the child of node on side dir, into node's place
+	* @param parent The parent, locked
+	* @param node The node, locked
+	* @param tall The child on side dir, locked
+	* @param hShort The height of node's other child
+	* @param hOuter The height of tall's child on side dir
+	* @param inner tall's child on the other side
+	* @param hInner The height of inner
+	* @param dir The side of tall
+	* @return the node to check next, the parent if nothing needed fixing
+	*/
+	Node* rotate(Node* parent, Node* node, Node* tall, int hShort, int hOuter, Node* inner, int hInner, int dir);
+
+	/*
+	* Rotates inner, the child of tall on the side away from dir, into
+	* node's place, tall being node's child on side dir
+	* @param parent The parent, locked
+	* @param node The node, locked
+	* @param tall The child on side dir, locked
+	* @param hShort The height of node's other child
+	* @param hOuter The height of tall's child on side dir
+	* @param inner tall's child on the other side, locked
+	* @param hInnerOuter The height of inner's child on side dir
+	* @param dir The side of tall
+	* @return the node to check next, the parent if nothing needed fixing
+	*/
+	Node* rotateDouble(Node* parent, Node* node, Node* tall, int hShort, int hOuter, Node* inner,
+	                   int hInnerOuter, int dir);
+
+	/*
+	* Gets the height of a possibly null node
+	* @param node The node
+	* @return its height, 0 for nullptr
+	*/
+	static int heightOf(const Node* node);
+
+	/*
+	* Deletes a retired node, for EpochReclaimer
+	* @param node The node
+	*/
+	static void destroy(void* node);
+
+	/*
+	* Helper function for clear, deletes a subtree
+	* @param node The root of the subtree
+	*/
+	static void clearHelper(Node* node);
+
+	/*
+	* Helper function for inorderTraverse
+	* @param node The root of the subtree
+	* @param visit The function to visit on each item
+	*/
+	static void inorderHelper(const Node* node, void visit(const T& item));
+};
+
+#include "concurrenttree.cpp"
+#endif // CONCURRENTTREE_H
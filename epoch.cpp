@@ -0,0 +1,191 @@
+/*
+* epoch.cpp
+*
+* EpochReclaimer implementations
+*
+* Every access to the epoch and to the announced epochs is sequentially
+* consistent, so a thread announcing an epoch is ordered against the
+* reads of the structure it makes afterwards, and against the scans of
+* tryAdvance.
+*
+* DO NOT compile this file, it is included at the bottom of epoch.h
+*/
+
+/*
+* Enters a read section
+*/
+inline EpochReclaimer::Guard::Guard() :record(&EpochReclaimer::mine()) {
+
+	if (this->record->depth++ == 0) {
+
+		this->record->announced.store((EpochReclaimer::epoch.load() << 1) | ACTIVE);
+	}
+}
+
+/*
+* Leaves the read section
+*/
+inline EpochReclaimer::Guard::~Guard() {
+
+	if (--this->record->depth == 0) {
+
+		this->record->announced.store(0);
+	}
+}
+
+/*
+* Retires an object no longer reachable by new readers. It is
+* destroyed later by the calling thread, or another if this one exits.
+* @param object The object
+* @param destroy The function that destroys it
+*/
+inline void EpochReclaimer::retire(void* object, void destroy(void* object)) {
+
+	Record& record = EpochReclaimer::mine();
+
+	record.limbo.push_back(Retired{object, destroy, EpochReclaimer::epoch.load()});
+
+	if (++record.pending >= COLLECT_EVERY) {
+
+		EpochReclaimer::collect();
+	}
+}
+
+/*
+* Tries to move the epoch on and frees what the calling thread
+* retired and no reader can reach any more
+* @return the number of objects the thread still holds
+*/
+inline std::size_t EpochReclaimer::collect() {
+
+	Record& record = EpochReclaimer::mine();
+
+	record.pending = 0;
+
+	EpochReclaimer::tryAdvance();
+	EpochReclaimer::release(record);
+
+	return record.limbo.size();
+}
+
+/*
+* Takes a record for a thread on its first use, reusing one
+* given back by a thread that exited
+*/
+inline EpochReclaimer::Owner::Owner() :record(nullptr) {
+
+	// made before the first record so it is destroyed after the last Owner
+	static Cleanup cleanup;
+
+	for (Record* curr = EpochReclaimer::records.load(); curr != nullptr && this->record == nullptr; curr = curr->next) {
+
+		bool owned(false);
+
+		if (!curr->owned.load() && curr->owned.compare_exchange_strong(owned, true)) {
+
+			this->record = curr;
+		}
+	}
+
+	if (this->record == nullptr) {
+
+		this->record = new Record();
+		this->record->next = EpochReclaimer::records.load();
+
+		while (!EpochReclaimer::records.compare_exchange_weak(this->record->next, this->record)) {}
+	}
+}
+
+/*
+* Frees what it can and gives the record back, the rest is freed by
+* the next thread to take it
+*/
+inline EpochReclaimer::Owner::~Owner() {
+
+	EpochReclaimer::tryAdvance();
+	EpochReclaimer::release(*this->record);
+
+	this->record->owned.store(false);
+}
+
+/*
+* Frees everything left when the program exits, no thread is inside a
+* Guard any more
+*/
+inline EpochReclaimer::Cleanup::~Cleanup() {
+
+	Record* curr = EpochReclaimer::records.exchange(nullptr);
+
+	while (curr != nullptr) {
+
+		for (const Retired& retired : curr->limbo) {
+
+			retired.destroy(retired.object);
+		}
+
+		Record* next = curr->next;
+
+		delete curr;
+
+		curr = next;
+	}
+}
+
+/*
+* Gets the calling thread's record
+* @return the record
+*/
+inline EpochReclaimer::Record& EpochReclaimer::mine() {
+
+	thread_local Owner owner;
+
+	return *owner.record;
+}
+
+/*
+* Moves the epoch on if every thread inside a Guard has
+* announced the current one
+*/
+inline void EpochReclaimer::tryAdvance() {
+
+	std::uint64_t current = EpochReclaimer::epoch.load();
+
+	for (Record* curr = EpochReclaimer::records.load(); curr != nullptr; curr = curr->next) {
+
+		std::uint64_t announced = curr->announced.load();
+
+		if ((announced & ACTIVE) != 0 && (announced >> 1) != current) {
+
+			return;
+		}
+	}
+
+	EpochReclaimer::epoch.compare_exchange_strong(current, current + 1);
+}
+
+/*
+* Frees the objects of a record retired at least two epochs ago
+* @param record The record
+*/
+inline void EpochReclaimer::release(Record& record) {
+
+	std::uint64_t current = EpochReclaimer::epoch.load();
+
+	std::size_t kept(0);
+
+	for (std::size_t i(0); i < record.limbo.size(); ++i) {
+
+		Retired retired = record.limbo[i];
+
+		if (retired.epoch + 2 <= current) {
+
+			retired.destroy(retired.object);
+
+		} else {
+
+			record.limbo[kept++] = retired;
+		}
+	}
+
+	record.limbo.resize(kept);
+}
@@ -0,0 +1,178 @@
+/*
+* epoch.h
+*
+* EpochReclaimer specs
+*
+* EpochReclaimer frees memory that other threads may still be reading,
+* for structures whose readers take no locks (see concurrenttree.h).
+* A thread reads shared nodes only inside a Guard. A node taken out of
+* the structure is retired instead of deleted, and freed once every
+* thread that was inside a Guard when it was retired has left it.
+* Operations include:
+*
+*	- entering and leaving a read section (Guard), which may nest
+*	- retiring an object with the function that destroys it
+*	- freeing what the calling thread retired and is safe to free
+*
+* There is one global epoch. A thread entering a Guard announces the
+* epoch it saw, and the epoch moves on only when every thread inside a
+* Guard has announced the current one, so an object retired in epoch e
+* cannot be reached by anyone once the epoch is e + 2. Each thread keeps
+* its own list of retired objects and frees from it every COLLECT_EVERY
+* retirements; a thread that is stuck inside a Guard holds back freeing
+* for everyone, so Guards should be short. What is left when a thread
+* exits is freed by the next thread to take its place, or at exit.
+*/
+
+#ifndef EPOCHRECLAIMER_H
+#define EPOCHRECLAIMER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class EpochReclaimer {
+
+	struct Record;
+
+public:
+
+	/*
+	* A read section: shared objects read inside it are not freed
+	* until it ends. Guards of one thread may nest.
+	*/
+	class Guard {
+
+	public:
+
+		/*
+		* Enters a read section
+		*/
+		Guard();
+
+		/*
+		* Leaves the read section
+		*/
+		~Guard();
+
+		Guard(const Guard&) = delete;
+
+		Guard& operator=(const Guard&) = delete;
+
+	private:
+
+		// The calling thread's record
+		Record* record;
+	};
+
+	/*
+	* Retires an object no longer reachable by new readers. It is
+	* destroyed later by the calling thread, or another if this one exits.
+	* @param object The object
+	* @param destroy The function that destroys it
+	*/
+	static void retire(void* object, void destroy(void* object));
+
+	/*
+	* Tries to move the epoch on and frees what the calling thread
+	* retired and no reader can reach any more
+	* @return the number of objects the thread still holds
+	*/
+	static std::size_t collect();
+
+private:
+
+	// Retirements between collections
+	static const std::size_t COLLECT_EVERY = 64;
+
+	// Set in the announced epoch of a thread inside a Guard
+	static const std::uint64_t ACTIVE = 1;
+
+	/*
+	* An object waiting to be freed
+	*/
+	struct Retired {
+
+		void* object;
+
+		void (*destroy)(void* object);
+
+		// Epoch when it was retired
+		std::uint64_t epoch;
+	};
+
+	/*
+	* What one thread shares with the others, reused by a later
+	* thread once it exits
+	*/
+	struct Record {
+
+		// Epoch seen on entering the outermost Guard, shifted left once
+		// and ACTIVE, 0 outside a Guard
+		std::atomic<std::uint64_t> announced{0};
+
+		// true while a thread uses this record
+		std::atomic<bool> owned{true};
+
+		// Next record, records are never removed
+		Record* next = nullptr;
+
+		// Guards the thread is inside
+		unsigned depth = 0;
+
+		// Retirements since the last collection
+		std::size_t pending = 0;
+
+		// Objects retired and not yet freed
+		std::vector<Retired> limbo;
+	};
+
+	/*
+	* Takes a record for a thread on its first use and gives it
+	* back when the thread exits
+	*/
+	struct Owner {
+
+		Owner();
+
+		~Owner();
+
+		Record* record;
+	};
+
+	/*
+	* Frees everything left when the program exits
+	*/
+	struct Cleanup {
+
+		~Cleanup();
+	};
+
+	// The global epoch
+	static inline std::atomic<std::uint64_t> epoch{0};
+
+	// Every record ever made, newest first
+	static inline std::atomic<Record*> records{nullptr};
+
+	/*
+	* Gets the calling thread's record
+	* @return the record
+	*/
+	static Record& mine();
+
+	/*
+	* Moves the epoch on if every thread inside a Guard has
+	* announced the current one
+	*/
+	static void tryAdvance();
+
+	/*
+	* Frees the objects of a record retired at least two epochs ago
+	* @param record The record
+	*/
+	static void release(Record& record);
+};
+
+#include "epoch.cpp"
+#endif // EPOCHRECLAIMER_H
@@ -0,0 +1,527 @@
+/*
+* frozentree.cpp
+*
+* FrozenTree implementations
+*
+* Indexes count from 1 like in a heap: the children of k are 2k and
+* 2k + 1, and the bits of k below its leading 1 spell the path from the
+* root, 0 for left and 1 for right.
+*
+* DO NOT compile this file, it is included at the bottom of frozentree.h
+*/
+
+#include <utility>
+
+/*
+* Constructs an empty snapshot
+*/
+template<class T, class Compare>
+FrozenTree<T, Compare>::FrozenTree() {}
+
+/*
+* Constructs a snapshot of n sorted items without duplicates, in O(n)
+* @param first Iterator to the first item, read n times in order
+* @param n The number of items
+* @param comp The comparator the items are sorted by
+*/
+template<class T, class Compare>
+template<class It>
+FrozenTree<T, Compare>::FrozenTree(It first, std::size_t n, const Compare& comp) :comp(comp) {
+
+	std::vector<T> sorted;
+	std::vector<std::size_t> rank(n);
+
+	sorted.reserve(n);
+
+	for (std::size_t i(0); i < n; ++i, ++first) {
+
+		sorted.push_back(*first);
+	}
+
+	// the i-th item in order goes to the i-th index of an inorder walk
+	std::size_t k = FrozenTree::first(1, n);
+
+	for (std::size_t i(0); i < n; ++i) {
+
+		rank[k - 1] = i;
+
+		k = FrozenTree::next(k, n);
+	}
+
+	this->items.reserve(n);
+
+	for (std::size_t j(0); j < n; ++j) {
+
+		this->items.push_back(std::move(sorted[rank[j]]));
+	}
+}
+
+/*
+* Checks if the snapshot is empty
+* @return true if there are no items
+*/
+template<class T, class Compare>
+bool FrozenTree<T, Compare>::isEmpty() const {
+
+	return this->items.empty();
+}
+
+/*
+* Gets the amount of items in O(1)
+* @return the amount of items
+*/
+template<class T, class Compare>
+std::size_t FrozenTree<T, Compare>::size() const {
+
+	return this->items.size();
+}
+
+/*
+* Gets the height of the implicit tree, which is as short as possible
+* @return the height
+*/
+template<class T, class Compare>
+int FrozenTree<T, Compare>::getHeight() const {
+
+	int height(0);
+
+	for (std::size_t k(1); k <= this->items.size(); k *= 2) {
+
+		++height;
+	}
+
+	return height;
+}
+
+/*
+* Checks for membership of given item
+* @param item The item to check for
+* @return true if the snapshot contains item, false otherwise
+*/
+template<class T, class Compare>
+bool FrozenTree<T, Compare>::contains(const T& item) const {
+
+	std::size_t k = this->search(item, false);
+
+	return k != 0 && !this->comp.less(item, this->items[k - 1]);
+}
+
+/*
+* Checks for membership of a key of another type, only available when
+* Compare is transparent (has is_transparent), no item is constructed
+* @param key The key to check for
+* @return true if the snapshot contains an item equivalent to key
+*/
+template<class T, class Compare>
+template<class K, class C, class>
+bool FrozenTree<T, Compare>::contains(const K& key) const {
+
+	std::size_t k = this->search(key, false);
+
+	return k != 0 && !this->comp.less(key, this->items[k - 1]);
+}
+
+/*
+* Checks for membership of many items, searching for
+* SimdSearch::BATCH of them side by side
+* @param keys The items to check for
+* @param count The number of items
+* @param found Set to whether the snapshot contains each item
+*/
+template<class T, class Compare>
+void FrozenTree<T, Compare>::containsBatch(const T* keys, std::size_t count, bool* found) const {
+
+	this->lookupBatch(keys, count, [found](std::size_t i, std::size_t k) {
+
+		found[i] = k != 0;
+	});
+}
+
+/*
+* Finds many items, searching like containsBatch
+* @param keys The items to find
+* @param count The number of items
+* @param found Set to an iterator at each item, end() if not in the snapshot
+*/
+template<class T, class Compare>
+void FrozenTree<T, Compare>::findBatch(const T* keys, std::size_t count, Iterator* found) const {
+
+	this->lookupBatch(keys, count, [this, found](std::size_t i, std::size_t k) {
+
+		found[i] = Iterator(k, this);
+	});
+}
+
+/*
+* Finds the first item not ordered before item
+* @param item The item to look for
+* @return iterator at that item, end() if every item is before item
+*/
+template<class T, class Compare>
+typename FrozenTree<T, Compare>::Iterator FrozenTree<T, Compare>::lowerBound(const T& item) const {
+
+	return Iterator(this->search(item, false), this);
+}
+
+/*
+* Finds the first item ordered after item
+* @param item The item to look for
+* @return iterator at that item, end() if no item is after item
+*/
+template<class T, class Compare>
+typename FrozenTree<T, Compare>::Iterator FrozenTree<T, Compare>::upperBound(const T& item) const {
+
+	return Iterator(this->search(item, true), this);
+}
+
+/*
+* Gets an iterator at the smallest item
+* @return iterator at the first item, end() if empty
+*/
+template<class T, class Compare>
+typename FrozenTree<T, Compare>::Iterator FrozenTree<T, Compare>::begin() const {
+
+	return Iterator(this->items.empty() ? 0 : FrozenTree::first(1, this->items.size()), this);
+}
+
+/*
+* Gets the iterator past the largest item
+* @return the end iterator
+*/
+template<class T, class Compare>
+typename FrozenTree<T, Compare>::Iterator FrozenTree<T, Compare>::end() const {
+
+	return Iterator(0, this);
+}
+
+/*
+* Gets a reverse iterator at the largest item
+* @return reverse iterator at the last item
+*/
+template<class T, class Compare>
+typename FrozenTree<T, Compare>::reverse_iterator FrozenTree<T, Compare>::rbegin() const {
+
+	return reverse_iterator(this->end());
+}
+
+/*
+* Gets the reverse iterator past the smallest item
+* @return the reverse end iterator
+*/
+template<class T, class Compare>
+typename FrozenTree<T, Compare>::reverse_iterator FrozenTree<T, Compare>::rend() const {
+
+	return reverse_iterator(this->begin());
+}
+
+/*
+* Finds the first item not ordered before key, or with after set
+* the first item ordered after key, without branching on comparisons.
+* Every step goes down one level to 2k or 2k + 1, and the answer is
+* the last item where the walk went left: dropping the trailing 1 bits
+* (right turns) and one more bit (that left turn) from the final index.
+* @param key The key to look for
+* @param after true for the upper bound, false for the lower bound
+* @return the index of the item, 0 if there is none
+*/
+template<class T, class Compare>
+template<class K>
+std::size_t FrozenTree<T, Compare>::search(const K& key, bool after) const {
+
+	const T* base = this->items.data();
+
+	std::size_t n(this->items.size()), k(1);
+
+	while (k <= n) {
+
+#if defined(__GNUC__)
+		// the 16 descendants four levels down are items 16k to 16k + 15
+		__builtin_prefetch(reinterpret_cast<const char*>(base) + (16 * k - 1) * sizeof(T));
+#endif
+
+		const T& item = base[k - 1];
+
+		bool right = after ? !this->comp.less(key, item) : this->comp.less(item, key);
+
+		k = 2 * k + right;
+	}
+
+	return k >> (FrozenTree::trailingOnes(k) + 1);
+}
+
+/*
+* Finds the lower bounds of up to SimdSearch::BATCH keys, descending
+* one level of every search per round
+* @param keys The keys
+* @param count The number of keys
+* @param bounds The index of the lower bound of each key, 0 if none
+*/
+template<class T, class Compare>
+void FrozenTree<T, Compare>::searchBatch(const T* keys, std::size_t count, std::size_t* bounds) const {
+
+	const T* base = this->items.data();
+
+	std::size_t n(this->items.size()), k[SimdSearch::BATCH];
+
+	for (std::size_t j(0); j < count; ++j) {
+
+		k[j] = 1;
+	}
+
+	for (std::size_t levels(n); levels > 0; levels >>= 1) {
+
+		for (std::size_t j(0); j < count; ++j) {
+
+			std::size_t curr = k[j];
+
+			k[j] = (curr <= n) ? 2 * curr + this->comp.less(base[curr - 1], keys[j]) : curr;
+		}
+	}
+
+	for (std::size_t j(0); j < count; ++j) {
+
+		bounds[j] = k[j] >> (FrozenTree::trailingOnes(k[j]) + 1);
+	}
+}
+
+/*
+* Helper function for containsBatch and findBatch, looks for the
+* keys SimdSearch::BATCH at a time
+* @param keys The keys to look for
+* @param count The number of keys
+* @param out Called as out(i, k) with the index of the item
+*        equivalent to keys[i], 0 if there is none
+*/
+template<class T, class Compare>
+template<class Out>
+void FrozenTree<T, Compare>::lookupBatch(const T* keys, std::size_t count, Out out) const {
+
+	std::size_t bounds[SimdSearch::BATCH];
+
+	for (std::size_t i(0); i < count; i += SimdSearch::BATCH) {
+
+		std::size_t size = (count - i < SimdSearch::BATCH) ? count - i : SimdSearch::BATCH;
+
+		if constexpr (SimdSearch::applies<T, Compare>()) {
+
+			SimdSearch::lowerBounds(this->items.data(), this->items.size(), keys + i, size, bounds);
+
+		} else {
+
+			this->searchBatch(keys + i, size, bounds);
+		}
+
+		for (std::size_t j(0); j < size; ++j) {
+
+			bool hit = bounds[j] != 0 && !this->comp.less(keys[i + j], this->items[bounds[j] - 1]);
+
+			out(i + j, hit ? bounds[j] : 0);
+		}
+	}
+}
+
+/*
+* Gets the index of the first item in order of the subtree at k
+* @param k The index of the root of the subtree
+* @param n The number of items
+* @return the index of the leftmost item
+*/
+template<class T, class Compare>
+std::size_t FrozenTree<T, Compare>::first(std::size_t k, std::size_t n) {
+
+	while (2 * k <= n) {
+
+		k = 2 * k;
+	}
+
+	return k;
+}
+
+/*
+* Gets the index of the last item in order of the subtree at k
+* @param k The index of the root of the subtree
+* @param n The number of items
+* @return the index of the rightmost item
+*/
+template<class T, class Compare>
+std::size_t FrozenTree<T, Compare>::last(std::size_t k, std::size_t n) {
+
+	while (2 * k + 1 <= n) {
+
+		k = 2 * k + 1;
+	}
+
+	return k;
+}
+
+/*
+* Gets the index of the item after the one at k in sorted order:
+* the first item of the right subtree, or else the parent of the
+* closest ancestor that is a left child
+* @param k The index of the item
+* @param n The number of items
+* @return the index of the next item, 0 if k is the last one
+*/
+template<class T, class Compare>
+std::size_t FrozenTree<T, Compare>::next(std::size_t k, std::size_t n) {
+
+	if (2 * k + 1 <= n) {
+
+		return FrozenTree::first(2 * k + 1, n);
+	}
+
+	return k >> (FrozenTree::trailingOnes(k) + 1);
+}
+
+/*
+* Gets the index of the item before the one at k in sorted order:
+* the last item of the left subtree, or else the parent of the
+* closest ancestor that is a right child
+* @param k The index of the item
+* @param n The number of items
+* @return the index of the previous item, 0 if k is the first one
+*/
+template<class T, class Compare>
+std::size_t FrozenTree<T, Compare>::previous(std::size_t k, std::size_t n) {
+
+	if (2 * k <= n) {
+
+		return FrozenTree::last(2 * k, n);
+	}
+
+	return k >> (FrozenTree::trailingOnes(~k) + 1);
+}
+
+/*
+* Counts the 1 bits at the bottom of k
+* @param k The number, not all 1 bits
+* @return the number of trailing 1 bits
+*/
+template<class T, class Compare>
+int FrozenTree<T, Compare>::trailingOnes(std::size_t k) {
+
+#if defined(__GNUC__)
+	return __builtin_ctzll(~static_cast<unsigned long long>(k));
+#else
+	int ones(0);
+
+	for (; k & 1; k >>= 1) {
+
+		++ones;
+	}
+
+	return ones;
+#endif
+}
+
+/*
+* Constructs an iterator that belongs to no tree
+*/
+template<class T, class Compare>
+FrozenTree<T, Compare>::Iterator::Iterator() :k(0), tree(nullptr) {}
+
+/*
+* Constructs an iterator at index k, 0 is end()
+* @param k The index of the item in Eytzinger order
+* @param tree The tree the item belongs to
+*/
+template<class T, class Compare>
+FrozenTree<T, Compare>::Iterator::Iterator(std::size_t k, const FrozenTree<T, Compare>* tree)
+
+	:k(k), tree(tree) {}
+
+/*
+* Gets the item at the iterator
+* @return the item by reference
+*/
+template<class T, class Compare>
+const T& FrozenTree<T, Compare>::Iterator::operator*() const {
+
+	return this->tree->items[this->k - 1];
+}
+
+/*
+* Gets the address of the item at the iterator
+* @return pointer to the item
+*/
+template<class T, class Compare>
+const T* FrozenTree<T, Compare>::Iterator::operator->() const {
+
+	return &this->tree->items[this->k - 1];
+}
+
+/*
+* Moves to the next item in sorted order
+* @return this by reference
+*/
+template<class T, class Compare>
+typename FrozenTree<T, Compare>::Iterator& FrozenTree<T, Compare>::Iterator::operator++() {
+
+	this->k = FrozenTree::next(this->k, this->tree->items.size());
+
+	return *this;
+}
+
+/*
+* Moves to the next item in sorted order
+* @return the iterator before moving
+*/
+template<class T, class Compare>
+typename FrozenTree<T, Compare>::Iterator FrozenTree<T, Compare>::Iterator::operator++(int) {
+
+	Iterator before(*this);
+
+	++(*this);
+
+	return before;
+}
+
+/*
+* Moves to the previous item in sorted order, end() moves to the last item
+* @return this by reference
+*/
+template<class T, class Compare>
+typename FrozenTree<T, Compare>::Iterator& FrozenTree<T, Compare>::Iterator::operator--() {
+
+	std::size_t n = this->tree->items.size();
+
+	this->k = (this->k == 0) ? FrozenTree::last(1, n) : FrozenTree::previous(this->k, n);
+
+	return *this;
+}
+
+/*
+* Moves to the previous item in sorted order, end() moves to the last item
+* @return the iterator before moving
+*/
+template<class T, class Compare>
+typename FrozenTree<T, Compare>::Iterator FrozenTree<T, Compare>::Iterator::operator--(int) {
+
+	Iterator before(*this);
+
+	--(*this);
+
+	return before;
+}
+
+/*
+* Equality operator overload
+* @param other The other iterator
+* @return true if both are at the same item
+*/
+template<class T, class Compare>
+bool FrozenTree<T, Compare>::Iterator::operator==(const Iterator& other) const {
+
+	return this->k == other.k;
+}
+
+/*
+* Inequality operator overload
+* @param other The other iterator
+* @return true if the iterators are at different items
+*/
+template<class T, class Compare>
+bool FrozenTree<T, Compare>::Iterator::operator!=(const Iterator& other) const {
+
+	return !(*this == other);
+}
@@ -0,0 +1,318 @@
+/*
+* frozentree.h
+*
+* FrozenTree specs
+*
+* A FrozenTree is an immutable snapshot of a sorted set of items, made
+* by BinarySearchTree::freeze for trees that are read far more often than
+* they change. There are no nodes: the items sit in one array in
+* Eytzinger (breadth first) order, the root at index 1 and the children
+* of the item at k at 2k and 2k + 1. Operations include:
+*
+*	- checking for an item, or for a key of another type with a
+*	  transparent comparator
+*	- checking for or finding many items at once, several searches
+*	  in flight
+*	- lower and upper bound
+*	- bidirectional iterators (begin/end, rbegin/rend)
+*	- size, emptiness and height
+*
+* A search walks down the array computing the next index from the result
+* of the comparison instead of branching on it, so there is nothing to
+* mispredict, and it prefetches the items four levels below, which share
+* a cache line for small items. The first levels of the tree are at the
+* start of the array and stay in cache across lookups. containsBatch and
+* findBatch run 8 searches side by side so their cache misses overlap,
+* with AVX2 gathers for small snapshots of arithmetic items (see simd.h).
+*/
+
+#ifndef FROZENTREE_H
+#define FROZENTREE_H
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include "compare.h"
+#include "simd.h"
+
+template<class T, class Compare = std::less<T>>
+class FrozenTree {
+
+public:
+
+	/*
+	* Bidirectional iterator over the items in sorted order, stepping
+	* through the implicit tree by index arithmetic in amortized O(1)
+	*/
+	class Iterator {
+
+	public:
+
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T* pointer;
+		typedef const T& reference;
+
+		/*
+		* Constructs an iterator that belongs to no tree
+		*/
+		Iterator();
+
+		/*
+		* Gets the item at the iterator
+		* @return the item by reference
+		*/
+		reference operator*() const;
+
+		/*
+		* Gets the address of the item at the iterator
+		* @return pointer to the item
+		*/
+		pointer operator->() const;
+
+		/*
+		* Moves to the next item in sorted order
+		* @return this by reference
+		*/
+		Iterator& operator++();
+
+		/*
+		* Moves to the next item in sorted order
+		* @return the iterator before moving
+		*/
+		Iterator operator++(int);
+
+		/*
+		* Moves to the previous item in sorted order, end() moves to the last item
+		* @return this by reference
+		*/
+		Iterator& operator--();
+
+		/*
+		* Moves to the previous item in sorted order, end() moves to the last item
+		* @return the iterator before moving
+		*/
+		Iterator operator--(int);
+
+		/*
+		* Equality operator overload
+		* @param other The other iterator
+		* @return true if both are at the same item
+		*/
+		bool operator==(const Iterator& other) const;
+
+		/*
+		* Inequality operator overload
+		* @param other The other iterator
+		* @return true if the iterators are at different items
+		*/
+		bool operator!=(const Iterator& other) const;
+
+	private:
+
+		friend class FrozenTree<T, Compare>;
+
+		/*
+		* Constructs an iterator at index k, 0 is end()
+		* @param k The index of the item in Eytzinger order
+		* @param tree The tree the item belongs to
+		*/
+		Iterator(std::size_t k, const FrozenTree<T, Compare>* tree);
+
+		// Index of the item, counting from 1, 0 at end()
+		std::size_t k;
+
+		// Tree iterated
+		const FrozenTree<T, Compare>* tree;
+	};
+
+	typedef Iterator iterator;
+	typedef Iterator const_iterator;
+	typedef std::reverse_iterator<Iterator> reverse_iterator;
+	typedef std::reverse_iterator<Iterator> const_reverse_iterator;
+
+	/*
+	* Constructs an empty snapshot
+	*/
+	FrozenTree();
+
+	/*
+	* Constructs a snapshot of n sorted items without duplicates, in O(n)
+	* @param first Iterator to the first item, read n times in order
+	* @param n The number of items
+	* @param comp The comparator the items are sorted by
+	*/
+	template<class It>
+	FrozenTree(It first, std::size_t n, const Compare& comp = Compare());
+
+	/*
+	* Checks if the snapshot is empty
+	* @return true if there are no items
+	*/
+	bool isEmpty() const;
+
+	/*
+	* Gets the amount of items in O(1)
+	* @return the amount of items
+	*/
+	std::size_t size() const;
+
+	/*
+	* Gets the height of the implicit tree, which is as short as possible
+	* @return the height
+	*/
+	int getHeight() const;
+
+	/*
+	* Checks for membership of given item
+	* @param item The item to check for
+	* @return true if the snapshot contains item, false otherwise
+	*/
+	bool contains(const T& item) const;
+
+	/*
+	* Checks for membership of a key of another type, only available when
+	* Compare is transparent (has is_transparent), no item is constructed
+	* @param key The key to check for
+	* @return true if the snapshot contains an item equivalent to key
+	*/
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	bool contains(const K& key) const;
+
+	/*
+	* Checks for membership of many items, searching for
+	* SimdSearch::BATCH of them side by side
+	* @param keys The items to check for
+	* @param count The number of items
+	* @param found Set to whether the snapshot contains each item
+	*/
+	void containsBatch(const T* keys, std::size_t count, bool* found) const;
+
+	/*
+	* Finds many items, searching like containsBatch
+	* @param keys The items to find
+	* @param count The number of items
+	* @param found Set to an iterator at each item, end() if not in the snapshot
+	*/
+	void findBatch(const T* keys, std::size_t count, Iterator* found) const;
+
+	/*
+	* Finds the first item not ordered before item
+	* @param item The item to look for
+	* @return iterator at that item, end() if every item is before item
+	*/
+	Iterator lowerBound(const T& item) const;
+
+	/*
+	* Finds the first item ordered after item
+	* @param item The item to look for
+	* @return iterator at that item, end() if no item is after item
+	*/
+	Iterator upperBound(const T& item) const;
+
+	/*
+	* Gets an iterator at the smallest item
+	* @return iterator at the first item, end() if empty
+	*/
+	Iterator begin() const;
+
+	/*
+	* Gets the iterator past the largest item
+	* @return the end iterator
+	*/
+	Iterator end() const;
+
+	/*
+	* Gets a reverse iterator at the largest item
+	* @return reverse iterator at the last item
+	*/
+	reverse_iterator rbegin() const;
+
+	/*
+	* Gets the reverse iterator past the smallest item
+	* @return the reverse end iterator
+	*/
+	reverse_iterator rend() const;
+
+private:
+
+	// The items in Eytzinger order, the item at index k is items[k - 1]
+	std::vector<T> items;
+
+	// Orders the items
+	KeyCompare<Compare> comp;
+
+	/*
+	* Finds the first item not ordered before key, or with after set
+	* the first item ordered after key, without branching on comparisons
+	* @param key The key to look for
+	* @param after true for the upper bound, false for the lower bound
+	* @return the index of the item, 0 if there is none
+	*/
+	template<class K>
+	std::size_t search(const K& key, bool after) const;
+
+	/*
+	* Finds the lower bounds of up to SimdSearch::BATCH keys, descending
+	* one level of every search per round
+	* @param keys The keys
+	* @param count The number of keys
+	* @param bounds The index of the lower bound of each key, 0 if none
+	*/
+	void searchBatch(const T* keys, std::size_t count, std::size_t* bounds) const;
+
+	/*
+	* Helper function for containsBatch and findBatch, looks for the
+	* keys SimdSearch::BATCH at a time
+	* @param keys The keys to look for
+	* @param count The number of keys
+	* @param out Called as out(i, k) with the index of the item
+	*        equivalent to keys[i], 0 if there is none
+	*/
+	template<class Out>
+	void lookupBatch(const T* keys, std::size_t count, Out out) const;
+
+	/*
+	* Gets the index of the first item in order of the subtree at k
+	* @param k The index of the root of the subtree
+	* @param n The number of items
+	* @return the index of the leftmost item
+	*/
+	static std::size_t first(std::size_t k, std::size_t n);
+
+	/*
+	* Gets the index of the last item in order of the subtree at k
+	* @param k The index of the root of the subtree
+	* @param n The number of items
+	* @return the index of the rightmost item
+	*/
+	static std::size_t last(std::size_t k, std::size_t n);
+
+	/*
+	* Gets the index of the item after the one at k in sorted order
+	* @param k The index of the item
+	* @param n The number of items
+	* @return the index of the next item, 0 if k is the last one
+	*/
+	static std::size_t next(std::size_t k, std::size_t n);
+
+	/*
+	* Gets the index of the item before the one at k in sorted order
+	* @param k The index of the item
+	* @param n The number of items
+	* @return the index of the previous item, 0 if k is the first one
+	*/
+	static std::size_t previous(std::size_t k, std::size_t n);
+
+	/*
+	* Counts the 1 bits at the bottom of k
+	* @param k The number
+	* @return the number of trailing 1 bits
+	*/
+	static int trailingOnes(std::size_t k);
+};
+
+#include "frozentree.cpp"
+#endif // FROZENTREE_H
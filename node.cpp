@@ -10,16 +10,25 @@
 // Uses template so that ItemType can be any type
 // getLeftChildPtr and setLeftChildPtr used to get/set child nodes
 // getItem/setItem used to set the data stored in this node
+// getSize/setSize used to track the number of nodes in this subtree
+// isRed/setRed used by RedBlackTree, the color is kept in the low bit
+// of the parent ptr so it does not make the node any bigger
+// The destructor is not virtual so nodes carry no vtable ptr, trees
+// destroy the nodes they create as the type they created them as
+// The item comes last so a small item shares its 8 bytes with the
+// extra field of a derived node (the height of an AVLNode)
 // BinarySearchTree requires <, > relationships to be defined for ItemType
 // << for  BinaryNode is defined to print the ItemType as [BN: item ]
 // binarynode.cpp file is included at the bottom of the .h file
 // binarynode.cpp is part of the template, cannot be compiled separately
 
+#include <utility>
+
 
 // default constructor, children set to nullptr as default
 // item contained is undefined
 template<class T>
-Node<T>::Node() :left{nullptr}, right{nullptr}, parent{nullptr} {}
+Node<T>::Node() :left{nullptr}, right{nullptr}, parent{0}, size{1} {}
 
 // destructor
 template<class T>
@@ -31,7 +40,12 @@ Node<T>::~Node() {
 // constructor setting item
 // left and right childPtr set to nullptr as default
 template<class T>
-Node<T>::Node(const T &item) :item{item}, left{nullptr}, right{nullptr}, parent{nullptr}{}
+Node<T>::Node(const T &item) :left{nullptr}, right{nullptr}, parent{0}, size{1}, item{item} {}
+
+// constructor moving item
+// left and right childPtr set to nullptr as default
+template<class T>
+Node<T>::Node(T &&item) :left{nullptr}, right{nullptr}, parent{0}, size{1}, item{std::move(item)} {}
 
 // true if no children, both leftPtr and rightPtr are nullptrs
 template<class T>
@@ -70,7 +84,14 @@ void Node<T>::setRight(Node<T> *childPtr) {
 
 // getter for item stored at node
 template<class T>
-T Node<T>::getItem() const {
+const T& Node<T>::getItem() const {
+
+  return this->item;
+}
+
+// getter for item stored at node, modifiable in place
+template<class T>
+T& Node<T>::getItem() {
 
   return this->item;
 }
@@ -81,16 +102,44 @@ void Node<T>::setItem(const T &item) {
   this->item = item;
 }
 
-// get parent ptr
+// get parent ptr, without the color bit
 template<class T>
 Node<T>* Node<T>::getParent() const {
 
-	return this->parent;
+	return reinterpret_cast<Node<T>*>(this->parent & ~static_cast<std::uintptr_t>(1));
 }
 
-// set parent ptr
+// set parent ptr, keeping the color bit
 template<class T>
 void Node<T>::setParent(Node<T>* parent) {
 
-	this->parent = parent;
+	this->parent = reinterpret_cast<std::uintptr_t>(parent) | (this->parent & 1);
+}
+
+// number of nodes in the subtree rooted here, including this one
+template<class T>
+std::size_t Node<T>::getSize() const {
+
+	return this->size;
+}
+
+// set the number of nodes in the subtree rooted here
+template<class T>
+void Node<T>::setSize(std::size_t size) {
+
+	this->size = size;
+}
+
+// true if colored red, nodes start black
+template<class T>
+bool Node<T>::isRed() const {
+
+	return (this->parent & 1) != 0;
+}
+
+// set the color, setParent keeps it
+template<class T>
+void Node<T>::setRed(bool red) {
+
+	this->parent = (this->parent & ~static_cast<std::uintptr_t>(1)) | (red ? 1 : 0);
 }
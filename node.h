@@ -8,6 +8,13 @@
 // Uses template so that ItemType can be any type
 // getLeftChildPtr and setLeftChildPtr used to get/set child nodes
 // getItem/setItem used to set the data stored in this node
+// getSize/setSize used to track the number of nodes in this subtree
+// isRed/setRed used by RedBlackTree, the color is kept in the low bit
+// of the parent ptr so it does not make the node any bigger
+// The destructor is not virtual so nodes carry no vtable ptr, trees
+// destroy the nodes they create as the type they created them as
+// The item comes last so a small item shares its 8 bytes with the
+// extra field of a derived node (the height of an AVLNode)
 // BinarySearchTree requires <, > relationships to be defined for ItemType
 // << for  BinaryNode is defined to print the ItemType as [BN: item ]
 // binarynode.cpp file is included at the bottom of the .h file
@@ -16,6 +23,8 @@
 #ifndef BINARYNODE_H
 #define BINARYNODE_H
 
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 
 template<class T>
@@ -32,10 +41,13 @@ class Node {
 public:
 
   // constructor setting the data to be stored
-  explicit Node<T>(const T &item);
+  explicit Node(const T &item);
 
-  // destructor to cleanup
-  virtual ~Node<T>();
+  // constructor moving the data to be stored
+  explicit Node(T &&item);
+
+  // destructor to cleanup, not virtual
+  ~Node();
 
   // true if no children, both left and right child ptrs are nullptr
   bool isLeaf() const;
@@ -53,7 +65,11 @@ public:
   void setRight(Node<T>* child);
 
   // return the item stored
-  T getItem() const;
+  const T& getItem() const;
+
+  // return the item stored for modification in place,
+  // changing it must not change its order relative to other items
+  T& getItem();
 
   // set the item stored to a new value
   void setItem(const T &item);
@@ -64,13 +80,22 @@ public:
   // set parent ptr
   void setParent(Node<T>* parent);
 
+  // number of nodes in the subtree rooted here, including this one
+  std::size_t getSize() const;
+
+  // set the number of nodes in the subtree rooted here
+  void setSize(std::size_t size);
+
+  // true if colored red, nodes start black
+  bool isRed() const;
+
+  // set the color, setParent keeps it
+  void setRed(bool red);
+
 private:
 
 	// default constructor not allowed
-	Node<T>();
-
-  // the data that will be stored
-  T item;
+	Node();
 
   // left child
   Node<T>* left;
@@ -78,8 +103,14 @@ private:
   // right child
   Node<T>* right;
 
-  // right child
-  Node<T>* parent;
+  // parent ptr, its low bit is the color (1 for red)
+  std::uintptr_t parent;
+
+  // nodes in this subtree
+  std::size_t size;
+
+  // the data that will be stored
+  T item;
 };
 
 #include "node.cpp"
@@ -0,0 +1,930 @@
+/*
+* persistenttree.cpp
+*
+* PersistentAVLTree implementations
+*
+* A node's reference count is the number of links to it, from trees
+* and from parent nodes. Updates go top down and make each node they
+* change their own first (own): a node held once, through a parent this
+* tree already owns, is reachable from this tree alone and is changed
+* in place; any other node is copied, and the copy takes a reference to
+* each child, which makes those shared in turn. Rotations only move
+* links between nodes they own, so they never change a count.
+*
+* Counts go up with relaxed operations, since whoever adds a reference
+* already holds one, and go down with acquire release ones, so the
+* thread that drops the last reference, and the one that sees a count
+* of one and changes the node, see every write made through the others.
+*
+* DO NOT compile this file, it is included at the bottom of persistenttree.h
+*/
+
+#include <algorithm>
+#include <iostream>
+
+/*
+* Constructs a leaf
+* @param item The item
+*/
+template<class T, class Compare>
+PersistentAVLTree<T, Compare>::PersistentNode::PersistentNode(const T& item)
+
+	:left(nullptr), right(nullptr), refs(1), height(1), item(item) {}
+
+/*
+* Constructs a copy of a shared node, sharing its children
+* @param other The node to copy
+*/
+template<class T, class Compare>
+PersistentAVLTree<T, Compare>::PersistentNode::PersistentNode(const PersistentNode& other)
+
+	:left(PersistentAVLTree::retain(other.left)), right(PersistentAVLTree::retain(other.right)),
+	 refs(1), height(other.height), item(other.item) {}
+
+/*
+* Constructs empty tree
+*/
+template<class T, class Compare>
+PersistentAVLTree<T, Compare>::PersistentAVLTree() :rootPtr(nullptr), count(0) {}
+
+/*
+* Constructs tree with a given item
+* @param item The first item
+*/
+template<class T, class Compare>
+PersistentAVLTree<T, Compare>::PersistentAVLTree(const T& item) :rootPtr(new PersistentNode(item)), count(1) {}
+
+/*
+* Copy constructor, takes a snapshot of other in O(1)
+* @param other The other tree to copy
+*/
+template<class T, class Compare>
+PersistentAVLTree<T, Compare>::PersistentAVLTree(const PersistentAVLTree<T, Compare>& other)
+
+	:rootPtr(PersistentAVLTree::retain(other.rootPtr)), count(other.count), comp(other.comp) {}
+
+/*
+* Destroys tree, deallocating the nodes no other tree shares
+*/
+template<class T, class Compare>
+PersistentAVLTree<T, Compare>::~PersistentAVLTree() {
+
+	PersistentAVLTree::release(this->rootPtr);
+}
+
+/*
+* Assignment operator overload, makes this a snapshot of other in O(1)
+* @param other The other tree to copy
+* @return this by reference
+*/
+template<class T, class Compare>
+PersistentAVLTree<T, Compare>& PersistentAVLTree<T, Compare>::operator=(const PersistentAVLTree<T, Compare>& other) {
+
+	// retained first, so assigning a tree to itself keeps its nodes
+	PersistentNode* root = PersistentAVLTree::retain(other.rootPtr);
+
+	PersistentAVLTree::release(this->rootPtr);
+
+	this->rootPtr = root;
+	this->count = other.count;
+	this->comp = other.comp;
+
+	return *this;
+}
+
+/*
+* Takes a snapshot of the tree in O(1), the same as copying it
+* @return a tree with the items this one has now
+*/
+template<class T, class Compare>
+PersistentAVLTree<T, Compare> PersistentAVLTree<T, Compare>::snapshot() const {
+
+	return PersistentAVLTree<T, Compare>(*this);
+}
+
+/*
+* Checks if tree is empty
+* @return true if there are no items, false otherwise
+*/
+template<class T, class Compare>
+bool PersistentAVLTree<T, Compare>::isEmpty() const {
+
+	return this->rootPtr == nullptr;
+}
+
+/*
+* Gets the height of the tree in O(1)
+* @return the height of the tree
+*/
+template<class T, class Compare>
+int PersistentAVLTree<T, Compare>::getHeight() const {
+
+	return PersistentAVLTree::heightOf(this->rootPtr);
+}
+
+/*
+* Gets the amount of items in the tree in O(1)
+* @return the amount of items in the tree
+*/
+template<class T, class Compare>
+int PersistentAVLTree<T, Compare>::getNumberOfNodes() const {
+
+	return static_cast<int>(this->count);
+}
+
+/*
+* Gets the amount of items in the tree in O(1)
+* @return the amount of items in the tree
+*/
+template<class T, class Compare>
+std::size_t PersistentAVLTree<T, Compare>::size() const {
+
+	return this->count;
+}
+
+/*
+* Adds a given item to the tree, if not duplicate, copying the
+* shared nodes on its path. The tree is searched first, so adding a
+* duplicate copies nothing.
+* @param item The item to add
+* @return true if item added, false otherwise
+*/
+template<class T, class Compare>
+bool PersistentAVLTree<T, Compare>::add(const T& item) {
+
+	if (this->find(item)) {
+
+		return false;
+	}
+
+	this->addHelper(this->rootPtr, item);
+
+	++this->count;
+
+	return true;
+}
+
+/*
+* Removes a given item from the tree if there, copying the
+* shared nodes on its path. The tree is searched first, so removing
+* a missing item copies nothing.
+* @param item The item to remove
+* @return true if item removed, false otherwise
+*/
+template<class T, class Compare>
+bool PersistentAVLTree<T, Compare>::remove(const T& item) {
+
+	if (!this->find(item)) {
+
+		return false;
+	}
+
+	this->removeHelper(this->rootPtr, item);
+
+	--this->count;
+
+	return true;
+}
+
+/*
+* Deletes all items in the tree, nodes other trees share stay
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::clear() {
+
+	PersistentAVLTree::release(this->rootPtr);
+
+	this->rootPtr = nullptr;
+	this->count = 0;
+}
+
+/*
+* Checks for membership of given item
+* @param item The item to check for
+* @return true if tree contains item, false otherwise
+*/
+template<class T, class Compare>
+bool PersistentAVLTree<T, Compare>::contains(const T& item) const {
+
+	return this->find(item);
+}
+
+/*
+* Checks for membership of a key of another type, only available when
+* Compare is transparent (has is_transparent), no item is constructed
+* @param key The key to check for
+* @return true if tree contains an item equivalent to key
+*/
+template<class T, class Compare>
+template<class K, class C, class>
+bool PersistentAVLTree<T, Compare>::contains(const K& key) const {
+
+	return this->find(key);
+}
+
+/*
+* Prints the tree sideways
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::displaySideways() const {
+
+	PersistentAVLTree::sideways(this->rootPtr, 0);
+}
+
+/*
+* Inorder traversal: left-root-right
+* Items may be shared with other trees, so they can't be changed
+* @param visit The function to visit on each item
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::inorderTraverse(void visit(const T& item)) const {
+
+	PersistentAVLTree::inorderHelper(this->rootPtr, visit);
+}
+
+/*
+* Gets an iterator at the smallest item
+* @return iterator at the first item, end() if empty
+*/
+template<class T, class Compare>
+typename PersistentAVLTree<T, Compare>::Iterator PersistentAVLTree<T, Compare>::begin() const {
+
+	return Iterator(this->rootPtr, false);
+}
+
+/*
+* Gets the iterator past the largest item
+* @return the end iterator
+*/
+template<class T, class Compare>
+typename PersistentAVLTree<T, Compare>::Iterator PersistentAVLTree<T, Compare>::end() const {
+
+	return Iterator(this->rootPtr, true);
+}
+
+/*
+* Gets a reverse iterator at the largest item
+* @return reverse iterator at the last item
+*/
+template<class T, class Compare>
+typename PersistentAVLTree<T, Compare>::reverse_iterator PersistentAVLTree<T, Compare>::rbegin() const {
+
+	return reverse_iterator(this->end());
+}
+
+/*
+* Gets the reverse iterator past the smallest item
+* @return the reverse end iterator
+*/
+template<class T, class Compare>
+typename PersistentAVLTree<T, Compare>::reverse_iterator PersistentAVLTree<T, Compare>::rend() const {
+
+	return reverse_iterator(this->begin());
+}
+
+/*
+* Clears the tree and then uses the given sorted array of length n
+* to create this tree at minimum height
+* @param arr The given array of elements
+* @param n The size of the array
+* @return true if the array was not empty
+*/
+template<class T, class Compare>
+bool PersistentAVLTree<T, Compare>::readTree(const T arr[], int n) {
+
+	return n > 0 && this->readTree(arr, arr + n);
+}
+
+/*
+* Clears the tree and builds it at minimum height from the items in
+* [first, last) in O(n)
+* @param first Forward iterator to the first item
+* @param last Iterator past the last item
+* @param sorted true if the items are sorted without duplicates,
+*        false to sort them and drop duplicates first
+* @return true if the range was not empty
+*/
+template<class T, class Compare>
+template<class It>
+bool PersistentAVLTree<T, Compare>::readTree(It first, It last, bool sorted) {
+
+	if (!sorted) {
+
+		const KeyCompare<Compare>& comp = this->comp;
+
+		std::vector<T> items(first, last);
+
+		std::sort(items.begin(), items.end(), [&comp](const T& a, const T& b) {
+
+			return comp.less(a, b);
+		});
+
+		items.erase(std::unique(items.begin(), items.end(), [&comp](const T& a, const T& b) {
+
+			return comp.equivalent(a, b);
+
+		}), items.end());
+
+		return this->readTree(items.begin(), items.end());
+	}
+
+	std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+
+	if (n == 0) {
+
+		return false;
+	}
+
+	this->clear();
+
+	this->rootPtr = PersistentAVLTree::readHelper(first, n);
+	this->count = n;
+
+	return true;
+}
+
+/*
+* Equality operator overload
+* @param other The other tree to compare to
+* @return true if both trees hold equivalent items, false otherwise
+*/
+template<class T, class Compare>
+bool PersistentAVLTree<T, Compare>::operator==(const PersistentAVLTree<T, Compare>& other) const {
+
+	if (this->rootPtr == other.rootPtr) {
+
+		return true;
+	}
+
+	const KeyCompare<Compare>& comp = this->comp;
+
+	return this->count == other.count && std::equal(this->begin(), this->end(), other.begin(),
+	                                                [&comp](const T& a, const T& b) {
+
+		return comp.equivalent(a, b);
+	});
+}
+
+/*
+* Inequality operator overload
+* @param other The other tree to compare to
+* @return true if the trees hold different items, false otherwise
+*/
+template<class T, class Compare>
+bool PersistentAVLTree<T, Compare>::operator!=(const PersistentAVLTree<T, Compare>& other) const {
+
+	return !(*this == other);
+}
+
+/*
+* Gets the root of the tree
+* @return the root, nullptr if empty
+*/
+template<class T, class Compare>
+const typename PersistentAVLTree<T, Compare>::PersistentNode* PersistentAVLTree<T, Compare>::getRoot() const {
+
+	return this->rootPtr;
+}
+
+/*
+* Helper function for contains
+* @param key The key to look for
+* @return true if an equivalent item is in the tree
+*/
+template<class T, class Compare>
+template<class K>
+bool PersistentAVLTree<T, Compare>::find(const K& key) const {
+
+	const PersistentNode* curr = this->rootPtr;
+
+	while (curr != nullptr) {
+
+		int order = this->comp.order(key, curr->item);
+
+		if (order == 0) {
+
+			return true;
+		}
+
+		curr = (order < 0) ? curr->left : curr->right;
+	}
+
+	return false;
+}
+
+/*
+* Makes the node a link points to one this tree alone holds, copying
+* it if it is shared. The copy shares the children, so they become
+* shared in turn.
+* @param link The link, not nullptr, updated to the copy
+* @return the node, now held by this tree alone
+*/
+template<class T, class Compare>
+typename PersistentAVLTree<T, Compare>::PersistentNode* PersistentAVLTree<T, Compare>::own(PersistentNode*& link) {
+
+	if (link->refs.load(std::memory_order_acquire) == 1) {
+
+		return link;
+	}
+
+	PersistentNode* copy = new PersistentNode(*link);
+
+	PersistentAVLTree::release(link);
+
+	link = copy;
+
+	return copy;
+}
+
+/*
+* Adds a reference to a node
+* @param node The node, possibly nullptr
+* @return node
+*/
+template<class T, class Compare>
+typename PersistentAVLTree<T, Compare>::PersistentNode* PersistentAVLTree<T, Compare>::retain(PersistentNode* node) {
+
+	if (node != nullptr) {
+
+		node->refs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return node;
+}
+
+/*
+* Drops a reference to a node, deleting it and dropping its
+* references to its children when it was the last one. Recursion
+* depth is the height of the tree.
+* @param node The node, possibly nullptr
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::release(PersistentNode* node) {
+
+	if (node != nullptr && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+
+		PersistentAVLTree::release(node->left);
+		PersistentAVLTree::release(node->right);
+
+		delete node;
+	}
+}
+
+/*
+* Helper function for add, the item is not in the subtree
+* @param link The link to the subtree
+* @param item The item to add
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::addHelper(PersistentNode*& link, const T& item) {
+
+	if (link == nullptr) {
+
+		link = new PersistentNode(item);
+
+		return;
+	}
+
+	PersistentNode* node = PersistentAVLTree::own(link);
+
+	if (this->comp.less(item, node->item)) {
+
+		this->addHelper(node->left, item);
+
+	} else {
+
+		this->addHelper(node->right, item);
+	}
+
+	PersistentAVLTree::rebalance(link);
+}
+
+/*
+* Helper function for remove, an equivalent item is in the subtree.
+* The node with the item is never copied: its children are linked
+* into its place and this tree's reference to it is dropped.
+* @param link The link to the subtree
+* @param item The item to remove
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::removeHelper(PersistentNode*& link, const T& item) {
+
+	int order = this->comp.order(item, link->item);
+
+	if (order != 0) {
+
+		PersistentNode* node = PersistentAVLTree::own(link);
+
+		this->removeHelper((order < 0) ? node->left : node->right, item);
+
+		PersistentAVLTree::rebalance(link);
+
+		return;
+	}
+
+	PersistentNode* node = link;
+
+	PersistentNode* left = node->left;
+	PersistentNode* right = node->right;
+
+	if (node->refs.load(std::memory_order_acquire) == 1) {
+
+		// the node goes away, its references move to the new links
+		node->left = nullptr;
+		node->right = nullptr;
+
+	} else {
+
+		PersistentAVLTree::retain(left);
+		PersistentAVLTree::retain(right);
+	}
+
+	if (left == nullptr) {
+
+		link = right;
+
+	} else if (right == nullptr) {
+
+		link = left;
+
+	} else {
+
+		PersistentNode* successor = PersistentAVLTree::takeMin(right);
+
+		successor->left = left;
+		successor->right = right;
+
+		link = successor;
+
+		PersistentAVLTree::rebalance(link);
+	}
+
+	// last, since item may be the removed node's own item
+	PersistentAVLTree::release(node);
+}
+
+/*
+* Takes the node with the smallest item out of a subtree
+* @param link The link to the subtree, not nullptr
+* @return the node, held by this tree alone, with no children
+*/
+template<class T, class Compare>
+typename PersistentAVLTree<T, Compare>::PersistentNode* PersistentAVLTree<T, Compare>::takeMin(PersistentNode*& link) {
+
+	PersistentNode* node = PersistentAVLTree::own(link);
+
+	if (node->left == nullptr) {
+
+		link = node->right;
+
+		node->right = nullptr;
+
+		return node;
+	}
+
+	PersistentNode* min = PersistentAVLTree::takeMin(node->left);
+
+	PersistentAVLTree::rebalance(link);
+
+	return min;
+}
+
+/*
+* Fixes the height of the node at link and rotates it if out of balance
+* @param link The link to a node this tree alone holds
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::rebalance(PersistentNode*& link) {
+
+	PersistentNode* node = link;
+
+	PersistentAVLTree::update(node);
+
+	int balance = PersistentAVLTree::heightOf(node->left) - PersistentAVLTree::heightOf(node->right);
+
+	if (balance > 1) {
+
+		if (PersistentAVLTree::heightOf(node->left->left) < PersistentAVLTree::heightOf(node->left->right)) {
+
+			PersistentAVLTree::rotateLeft(node->left);
+		}
+
+		PersistentAVLTree::rotateRight(link);
+
+	} else if (balance < -1) {
+
+		if (PersistentAVLTree::heightOf(node->right->right) < PersistentAVLTree::heightOf(node->right->left)) {
+
+			PersistentAVLTree::rotateRight(node->right);
+		}
+
+		PersistentAVLTree::rotateLeft(link);
+	}
+}
+
+/*
+* Rotates the right child of the node at link into its place
+* @param link The link to a node this tree alone holds
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::rotateLeft(PersistentNode*& link) {
+
+	PersistentNode* node = PersistentAVLTree::own(link);
+	PersistentNode* child = PersistentAVLTree::own(node->right);
+
+	node->right = child->left;
+	child->left = node;
+
+	PersistentAVLTree::update(node);
+	PersistentAVLTree::update(child);
+
+	link = child;
+}
+
+/*
+* Rotates the left child of the node at link into its place
+* @param link The link to a node this tree alone holds
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::rotateRight(PersistentNode*& link) {
+
+	PersistentNode* node = PersistentAVLTree::own(link);
+	PersistentNode* child = PersistentAVLTree::own(node->left);
+
+	node->left = child->right;
+	child->right = node;
+
+	PersistentAVLTree::update(node);
+	PersistentAVLTree::update(child);
+
+	link = child;
+}
+
+/*
+* Sets the height of a node from its children
+* @param node The node
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::update(PersistentNode* node) {
+
+	node->height = 1 + std::max(PersistentAVLTree::heightOf(node->left), PersistentAVLTree::heightOf(node->right));
+}
+
+/*
+* Gets the height of a possibly null node
+* @param node The node
+* @return its height, 0 for nullptr
+*/
+template<class T, class Compare>
+int PersistentAVLTree<T, Compare>::heightOf(const PersistentNode* node) {
+
+	return (node != nullptr) ? node->height : 0;
+}
+
+/*
+* Helper function for readTree, builds a subtree of n nodes taking
+* the items in order from next. The left subtree never has more
+* nodes than the right one, so heights differ by at most one.
+* @param next Iterator to the next unused item, advanced by n
+* @param n The number of nodes in the subtree
+* @return the root of the subtree
+*/
+template<class T, class Compare>
+template<class It>
+typename PersistentAVLTree<T, Compare>::PersistentNode* PersistentAVLTree<T, Compare>::readHelper(It& next, std::size_t n) {
+
+	if (n == 0) {
+
+		return nullptr;
+	}
+
+	PersistentNode* left = PersistentAVLTree::readHelper(next, (n - 1) / 2);
+
+	PersistentNode* node = new PersistentNode(*next);
+
+	++next;
+
+	node->left = left;
+	node->right = PersistentAVLTree::readHelper(next, n - 1 - (n - 1) / 2);
+
+	PersistentAVLTree::update(node);
+
+	return node;
+}
+
+/*
+* Helper function for inorderTraverse
+* @param node The root of the subtree
+* @param visit The function to visit on each item
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::inorderHelper(const PersistentNode* node, void visit(const T& item)) {
+
+	if (node != nullptr) {
+
+		PersistentAVLTree::inorderHelper(node->left, visit);
+
+		visit(node->item);
+
+		PersistentAVLTree::inorderHelper(node->right, visit);
+	}
+}
+
+/*
+* Helper function for displaySideways
+* @param node The current node in the tree
+* @param level The current level in the tree
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::sideways(const PersistentNode* node, int level) {
+
+	if (node == nullptr) {
+
+		return;
+	}
+
+	PersistentAVLTree::sideways(node->right, level + 1);
+
+	for (int i(level); i >= 0; --i) {
+
+		std::cout << "    ";
+	}
+
+	std::cout << node->item << std::endl;
+
+	PersistentAVLTree::sideways(node->left, level + 1);
+}
+
+/*
+* Constructs an iterator that belongs to no tree
+*/
+template<class T, class Compare>
+PersistentAVLTree<T, Compare>::Iterator::Iterator() :root(nullptr), depth(0) {}
+
+/*
+* Constructs an iterator at the smallest item of a tree, or at end()
+* @param root The root of the tree
+* @param atEnd true for end()
+*/
+template<class T, class Compare>
+PersistentAVLTree<T, Compare>::Iterator::Iterator(const PersistentNode* root, bool atEnd) :root(root), depth(0) {
+
+	if (!atEnd) {
+
+		this->pushLeft(root);
+	}
+}
+
+/*
+* Gets the item at the iterator
+* @return the item by reference
+*/
+template<class T, class Compare>
+const T& PersistentAVLTree<T, Compare>::Iterator::operator*() const {
+
+	return this->path[this->depth - 1]->item;
+}
+
+/*
+* Gets the address of the item at the iterator
+* @return pointer to the item
+*/
+template<class T, class Compare>
+const T* PersistentAVLTree<T, Compare>::Iterator::operator->() const {
+
+	return &this->path[this->depth - 1]->item;
+}
+
+/*
+* Moves to the next item in sorted order: the leftmost item of the
+* right subtree, or else the nearest ancestor reached from its left
+* @return this by reference
+*/
+template<class T, class Compare>
+typename PersistentAVLTree<T, Compare>::Iterator& PersistentAVLTree<T, Compare>::Iterator::operator++() {
+
+	const PersistentNode* curr = this->path[this->depth - 1];
+
+	if (curr->right != nullptr) {
+
+		this->pushLeft(curr->right);
+
+	} else {
+
+		do {
+
+			curr = this->path[--this->depth];
+
+		} while (this->depth > 0 && this->path[this->depth - 1]->right == curr);
+	}
+
+	return *this;
+}
+
+/*
+* Moves to the next item in sorted order
+* @return the iterator before moving
+*/
+template<class T, class Compare>
+typename PersistentAVLTree<T, Compare>::Iterator PersistentAVLTree<T, Compare>::Iterator::operator++(int) {
+
+	Iterator before(*this);
+
+	++(*this);
+
+	return before;
+}
+
+/*
+* Moves to the previous item in sorted order, end() moves to the last item
+* @return this by reference
+*/
+template<class T, class Compare>
+typename PersistentAVLTree<T, Compare>::Iterator& PersistentAVLTree<T, Compare>::Iterator::operator--() {
+
+	if (this->depth == 0) {
+
+		this->pushRight(this->root);
+
+		return *this;
+	}
+
+	const PersistentNode* curr = this->path[this->depth - 1];
+
+	if (curr->left != nullptr) {
+
+		this->pushRight(curr->left);
+
+	} else {
+
+		do {
+
+			curr = this->path[--this->depth];
+
+		} while (this->depth > 0 && this->path[this->depth - 1]->left == curr);
+	}
+
+	return *this;
+}
+
+/*
+* Moves to the previous item in sorted order, end() moves to the last item
+* @return the iterator before moving
+*/
+template<class T, class Compare>
+typename PersistentAVLTree<T, Compare>::Iterator PersistentAVLTree<T, Compare>::Iterator::operator--(int) {
+
+	Iterator before(*this);
+
+	--(*this);
+
+	return before;
+}
+
+/*
+* Equality operator overload
+* @param other The other iterator
+* @return true if both are at the same item
+*/
+template<class T, class Compare>
+bool PersistentAVLTree<T, Compare>::Iterator::operator==(const Iterator& other) const {
+
+	return this->depth == other.depth && (this->depth == 0 || this->path[this->depth - 1] == other.path[other.depth - 1]);
+}
+
+/*
+* Inequality operator overload
+* @param other The other iterator
+* @return true if the iterators are at different items
+*/
+template<class T, class Compare>
+bool PersistentAVLTree<T, Compare>::Iterator::operator!=(const Iterator& other) const {
+
+	return !(*this == other);
+}
+
+/*
+* Pushes node and the left spine below it onto the path
+* @param node The node, possibly nullptr
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::Iterator::pushLeft(const PersistentNode* node) {
+
+	for (; node != nullptr; node = node->left) {
+
+		this->path[this->depth++] = node;
+	}
+}
+
+/*
+* Pushes node and the right spine below it onto the path
+* @param node The node, possibly nullptr
+*/
+template<class T, class Compare>
+void PersistentAVLTree<T, Compare>::Iterator::pushRight(const PersistentNode* node) {
+
+	for (; node != nullptr; node = node->right) {
+
+		this->path[this->depth++] = node;
+	}
+}
@@ -0,0 +1,499 @@
+/*
+* persistenttree.h
+*
+* PersistentAVLTree specs
+*
+* A PersistentAVLTree is an AVL tree whose copies are O(1) snapshots.
+* Nodes are reference counted and shared between trees: copying a tree
+* copies one pointer, and adding or removing an item copies only the
+* nodes on its path (and the few that rotations touch), O(log n) of
+* them, so a snapshot never sees later changes to the tree it was taken
+* from. A node no tree shares is changed in place, so a tree without
+* live snapshots costs about what an AVLTree does. Operations include:
+*
+*	- taking a snapshot (copy constructor, operator=) in O(1)
+*	- checking if empty
+*	- getting height and number of items
+*	- checking for an item, or for a key of another type with a
+*	  transparent comparator
+*	- adding and removing an item in O(log n)
+*	- displaying the tree sideways
+*	- visiting each item inorder with a function parameter
+*	- bidirectional iterators (begin/end, rbegin/rend)
+*	- clearing
+*	- creating itself in O(n) from a sorted array or iterator range
+*	- equality and non equality operator overloads, O(1) for trees that
+*	  share their root
+*
+* Shared nodes never change, and reference counts are atomic, so trees
+* that share nodes can be used from different threads at once: hand a
+* snapshot to a reader thread and keep writing to the original. One tree
+* object is still not safe to use from several threads at once.
+*
+* Nodes have no parent links, since a shared node has many parents, so
+* iterators keep the path from the root, and an iterator is only valid
+* while the tree it came from is unchanged (a snapshot never changes).
+*/
+
+#ifndef PERSISTENTTREE_H
+#define PERSISTENTTREE_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include "compare.h"
+
+/*
+* AVL tree with O(1) snapshots
+*
+* @author Juan Arias
+*
+*/
+template<class T, class Compare = std::less<T>>
+class PersistentAVLTree {
+
+protected:
+
+	/*
+	* A node, shared by every tree whose path reaches it
+	*/
+	struct PersistentNode {
+
+		/*
+		* Constructs a leaf
+		* @param item The item
+		*/
+		explicit PersistentNode(const T& item);
+
+		/*
+		* Constructs a copy of a shared node, sharing its children
+		* @param other The node to copy
+		*/
+		PersistentNode(const PersistentNode& other);
+
+		// Left child
+		PersistentNode* left;
+
+		// Right child
+		PersistentNode* right;
+
+		// Number of links to the node, from trees and parent nodes
+		std::atomic<unsigned> refs;
+
+		// Height of the subtree
+		int height;
+
+		// The item
+		T item;
+	};
+
+public:
+
+	/*
+	* Bidirectional iterator over the items in sorted order, keeping
+	* the path from the root
+	*/
+	class Iterator {
+
+	public:
+
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T* pointer;
+		typedef const T& reference;
+
+		/*
+		* Constructs an iterator that belongs to no tree
+		*/
+		Iterator();
+
+		/*
+		* Gets the item at the iterator
+		* @return the item by reference
+		*/
+		reference operator*() const;
+
+		/*
+		* Gets the address of the item at the iterator
+		* @return pointer to the item
+		*/
+		pointer operator->() const;
+
+		/*
+		* Moves to the next item in sorted order
+		* @return this by reference
+		*/
+		Iterator& operator++();
+
+		/*
+		* Moves to the next item in sorted order
+		* @return the iterator before moving
+		*/
+		Iterator operator++(int);
+
+		/*
+		* Moves to the previous item in sorted order, end() moves to the last item
+		* @return this by reference
+		*/
+		Iterator& operator--();
+
+		/*
+		* Moves to the previous item in sorted order, end() moves to the last item
+		* @return the iterator before moving
+		*/
+		Iterator operator--(int);
+
+		/*
+		* Equality operator overload
+		* @param other The other iterator
+		* @return true if both are at the same item
+		*/
+		bool operator==(const Iterator& other) const;
+
+		/*
+		* Inequality operator overload
+		* @param other The other iterator
+		* @return true if the iterators are at different items
+		*/
+		bool operator!=(const Iterator& other) const;
+
+	private:
+
+		friend class PersistentAVLTree<T, Compare>;
+
+		// Longest path kept, an AVL tree that tall has over 10^10 items
+		static const int MAX_HEIGHT = 48;
+
+		/*
+		* Constructs an iterator at the smallest item of a tree, or at end()
+		* @param root The root of the tree
+		* @param atEnd true for end()
+		*/
+		Iterator(const PersistentNode* root, bool atEnd);
+
+		/*
+		* Pushes node and the left spine below it onto the path
+		* @param node The node, possibly nullptr
+		*/
+		void pushLeft(const PersistentNode* node);
+
+		/*
+		* Pushes node and the right spine below it onto the path
+		* @param node The node, possibly nullptr
+		*/
+		void pushRight(const PersistentNode* node);
+
+		// Root of the tree iterated
+		const PersistentNode* root;
+
+		// Nodes from the root down to the item at the iterator, empty at end()
+		const PersistentNode* path[MAX_HEIGHT];
+
+		// Number of nodes in path
+		int depth;
+	};
+
+	typedef Iterator iterator;
+	typedef Iterator const_iterator;
+	typedef std::reverse_iterator<Iterator> reverse_iterator;
+	typedef std::reverse_iterator<Iterator> const_reverse_iterator;
+
+	/*
+	* Constructs empty tree
+	*/
+	PersistentAVLTree();
+
+	/*
+	* Constructs tree with a given item
+	* @param item The first item
+	*/
+	explicit PersistentAVLTree(const T& item);
+
+	/*
+	* Copy constructor, takes a snapshot of other in O(1)
+	* @param other The other tree to copy
+	*/
+	PersistentAVLTree(const PersistentAVLTree<T, Compare>& other);
+
+	/*
+	* Destroys tree, deallocating the nodes no other tree shares
+	*/
+	virtual ~PersistentAVLTree();
+
+	/*
+	* Assignment operator overload, makes this a snapshot of other in O(1)
+	* @param other The other tree to copy
+	* @return this by reference
+	*/
+	PersistentAVLTree<T, Compare>& operator=(const PersistentAVLTree<T, Compare>& other);
+
+	/*
+	* Takes a snapshot of the tree in O(1), the same as copying it
+	* @return a tree with the items this one has now
+	*/
+	PersistentAVLTree<T, Compare> snapshot() const;
+
+	/*
+	* Checks if tree is empty
+	* @return true if there are no items, false otherwise
+	*/
+	bool isEmpty() const;
+
+	/*
+	* Gets the height of the tree in O(1)
+	* @return the height of the tree
+	*/
+	int getHeight() const;
+
+	/*
+	* Gets the amount of items in the tree in O(1)
+	* @return the amount of items in the tree
+	*/
+	int getNumberOfNodes() const;
+
+	/*
+	* Gets the amount of items in the tree in O(1)
+	* @return the amount of items in the tree
+	*/
+	std::size_t size() const;
+
+	/*
+	* Adds a given item to the tree, if not duplicate, copying the
+	* shared nodes on its path
+	* @param item The item to add
+	* @return true if item added, false otherwise
+	*/
+	bool add(const T& item);
+
+	/*
+	* Removes a given item from the tree if there, copying the
+	* shared nodes on its path
+	* @param item The item to remove
+	* @return true if item removed, false otherwise
+	*/
+	bool remove(const T& item);
+
+	/*
+	* Deletes all items in the tree, nodes other trees share stay
+	*/
+	void clear();
+
+	/*
+	* Checks for membership of given item
+	* @param item The item to check for
+	* @return true if tree contains item, false otherwise
+	*/
+	bool contains(const T& item) const;
+
+	/*
+	* Checks for membership of a key of another type, only available when
+	* Compare is transparent (has is_transparent), no item is constructed
+	* @param key The key to check for
+	* @return true if tree contains an item equivalent to key
+	*/
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	bool contains(const K& key) const;
+
+	/*
+	* Prints the tree sideways
+	*/
+	void displaySideways() const;
+
+	/*
+	* Inorder traversal: left-root-right
+	* Items may be shared with other trees, so they can't be changed
+	* @param visit The function to visit on each item
+	*/
+	void inorderTraverse(void visit(const T& item)) const;
+
+	/*
+	* Gets an iterator at the smallest item
+	* @return iterator at the first item, end() if empty
+	*/
+	Iterator begin() const;
+
+	/*
+	* Gets the iterator past the largest item
+	* @return the end iterator
+	*/
+	Iterator end() const;
+
+	/*
+	* Gets a reverse iterator at the largest item
+	* @return reverse iterator at the last item
+	*/
+	reverse_iterator rbegin() const;
+
+	/*
+	* Gets the reverse iterator past the smallest item
+	* @return the reverse end iterator
+	*/
+	reverse_iterator rend() const;
+
+	/*
+	* Clears the tree and then uses the given sorted array of length n
+	* to create this tree at minimum height
+	* @param arr The given array of elements
+	* @param n The size of the array
+	* @return true if the array was not empty
+	*/
+	bool readTree(const T arr[], int n);
+
+	/*
+	* Clears the tree and builds it at minimum height from the items in
+	* [first, last) in O(n)
+	* @param first Forward iterator to the first item
+	* @param last Iterator past the last item
+	* @param sorted true if the items are sorted without duplicates,
+	*        false to sort them and drop duplicates first
+	* @return true if the range was not empty
+	*/
+	template<class It>
+	bool readTree(It first, It last, bool sorted = true);
+
+	/*
+	* Equality operator overload
+	* @param other The other tree to compare to
+	* @return true if both trees hold equivalent items, false otherwise
+	*/
+	bool operator==(const PersistentAVLTree<T, Compare>& other) const;
+
+	/*
+	* Inequality operator overload
+	* @param other The other tree to compare to
+	* @return true if the trees hold different items, false otherwise
+	*/
+	bool operator!=(const PersistentAVLTree<T, Compare>& other) const;
+
+protected:
+
+	/*
+	* Gets the root of the tree
+	* @return the root, nullptr if empty
+	*/
+	const PersistentNode* getRoot() const;
+
+private:
+
+	// Root of the tree, one of its references
+	PersistentNode* rootPtr;
+
+	// Number of items
+	std::size_t count;
+
+	// Orders the items
+	KeyCompare<Compare> comp;
+
+	/*
+	* Helper function for contains
+	* @param key The key to look for
+	* @return true if an equivalent item is in the tree
+	*/
+	template<class K>
+	bool find(const K& key) const;
+
+	/*
+	* Makes the node a link points to one this tree alone holds, copying
+	* it if it is shared. The copy shares the children, so they become
+	* shared in turn.
+	* @param link The link, not nullptr, updated to the copy
+	* @return the node, now held by this tree alone
+	*/
+	static PersistentNode* own(PersistentNode*& link);
+
+	/*
+	* Adds a reference to a node
+	* @param node The node, possibly nullptr
+	* @return node
+	*/
+	static PersistentNode* retain(PersistentNode* node);
+
+	/*
+	* Drops a reference to a node, deleting it and dropping its
+	* references to its children when it was the last one
+	* @param node The node, possibly nullptr
+	*/
+	static void release(PersistentNode* node);
+
+	/*
+	* Helper function for add, the item is not in the subtree
+	* @param link The link to the subtree
+	* @param item The item to add
+	*/
+	void addHelper(PersistentNode*& link, const T& item);
+
+	/*
+	* Helper function for remove, an equivalent item is in the subtree
+	* @param link The link to the subtree
+	* @param item The item to remove
+	*/
+	void removeHelper(PersistentNode*& link, const T& item);
+
+	/*
+	* Takes the node with the smallest item out of a subtree
+	* @param link The link to the subtree, not nullptr
+	* @return the node, held by this tree alone, with no children
+	*/
+	static PersistentNode* takeMin(PersistentNode*& link);
+
+	/*
+	* Fixes the height of the node at link and rotates it if out of balance
+	* @param link The link to a node this tree alone holds
+	*/
+	static void rebalance(PersistentNode*& link);
+
+	/*
+	* Rotates the right child of the node at link into its place
+	* @param link The link to a node this tree alone holds
+	*/
+	static void rotateLeft(PersistentNode*& link);
+
+	/*
+	* Rotates the left child of the node at link into its place
+	* @param link The link to a node this tree alone holds
+	*/
+	static void rotateRight(PersistentNode*& link);
+
+	/*
+	* Sets the height of a node from its children
+	* @param node The node
+	*/
+	static void update(PersistentNode* node);
+
+	/*
+	* Gets the height of a possibly null node
+	* @param node The node
+	* @return its height, 0 for nullptr
+	*/
+	static int heightOf(const PersistentNode* node);
+
+	/*
+	* Helper function for readTree, builds a subtree of n nodes taking
+	* the items in order from next
+	* @param next Iterator to the next unused item, advanced by n
+	* @param n The number of nodes in the subtree
+	* @return the root of the subtree
+	*/
+	template<class It>
+	static PersistentNode* readHelper(It& next, std::size_t n);
+
+	/*
+	* Helper function for inorderTraverse
+	* @param node The root of the subtree
+	* @param visit The function to visit on each item
+	*/
+	static void inorderHelper(const PersistentNode* node, void visit(const T& item));
+
+	/*
+	* Helper function for displaySideways
+	* @param node The current node in the tree
+	* @param level The current level in the tree
+	*/
+	static void sideways(const PersistentNode* node, int level);
+};
+
+#include "persistenttree.cpp"
+#endif // PERSISTENTTREE_H
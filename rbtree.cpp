@@ -0,0 +1,566 @@
+/*
+* rbtree.cpp
+*
+* RedBlackTree implementations
+*
+*/
+
+/*
+* Virtual desctructor
+*/
+template<class T, class Compare>
+RedBlackTree<T, Compare>::~RedBlackTree() {
+
+	this->clear();
+}
+
+/*
+* Constructor
+*/
+template<class T, class Compare>
+RedBlackTree<T, Compare>::RedBlackTree() {
+
+}
+
+/*
+* Constructor setting the data to be stored
+*/
+template<class T, class Compare>
+RedBlackTree<T, Compare>::RedBlackTree(const T& item) {
+
+	this->add(item);
+}
+
+/*
+* Constructor setting the comparator, which may hold state
+* @param comp The comparator
+*/
+template<class T, class Compare>
+RedBlackTree<T, Compare>::RedBlackTree(const Compare& comp)
+
+	:BinarySearchTree<T, Compare>(comp) {}
+
+/*
+* Copy constructor
+* @param other The other tree to copy
+*/
+template<class T, class Compare>
+RedBlackTree<T, Compare>::RedBlackTree(const RedBlackTree<T, Compare>& other)
+
+	:BinarySearchTree<T, Compare>() {
+
+	*this = other;
+}
+
+/*
+* Move constructor, takes the nodes of other in O(1), other is left empty
+* @param other The other tree to move from
+*/
+template<class T, class Compare>
+RedBlackTree<T, Compare>::RedBlackTree(RedBlackTree<T, Compare>&& other) noexcept
+
+	:BinarySearchTree<T, Compare>(std::move(other)) {}
+
+/*
+* Assignment operator overload, makes this a deep copy of other
+* @param other The other tree to copy
+* @return this by reference
+*/
+template<class T, class Compare>
+RedBlackTree<T, Compare>& RedBlackTree<T, Compare>::operator=(const RedBlackTree<T, Compare>& other) {
+
+	if (this != &other) {
+
+		BinarySearchTree<T, Compare>::operator=(other);
+	}
+
+	return *this;
+}
+
+/*
+* Move assignment, clears this and takes the nodes of other in O(1),
+* other is left empty
+* @param other The other tree to move from
+* @return this by reference
+*/
+template<class T, class Compare>
+RedBlackTree<T, Compare>& RedBlackTree<T, Compare>::operator=(RedBlackTree<T, Compare>&& other) noexcept {
+
+	BinarySearchTree<T, Compare>::operator=(std::move(other));
+
+	return *this;
+}
+
+/*
+* Splits the tree by key in O(log n): items less than key stay in this
+* tree and the others move to the returned tree. Nodes are relinked,
+* never copied, and the returned tree allocates from this tree's
+* arena. The shared arena locks every allocation and release, so
+* the two trees may then be changed on different threads, but
+* clearing either one destroys its nodes one by one.
+* @param key The first item of the returned tree
+* @return the tree with every item not less than key
+*/
+template<class T, class Compare>
+RedBlackTree<T, Compare> RedBlackTree<T, Compare>::split(const T& key) {
+
+	RedBlackTree<T, Compare> right;
+
+	this->splitTree(key, right);
+
+	return right;
+}
+
+/*
+* Moves every item of right to the end of this tree in O(log n),
+* relinking its nodes, right is left empty. The trees allocate from
+* the same arena afterwards, and neither may be in use on another
+* thread during the join. When both arenas are already shared with
+* other trees (after splits) the items are moved one by one instead.
+* @param right The tree with the items greater than this tree's
+* @throws std::invalid_argument if an item of right is not greater
+*         than every item of this tree
+*/
+template<class T, class Compare>
+void RedBlackTree<T, Compare>::join(RedBlackTree<T, Compare>& right) {
+
+	this->joinTree(right);
+}
+
+/*
+* Colors a new node red and restores the colors above it,
+* at most two rotations
+* @param node The node holding the item
+* @param added true if node was just linked, false if it was there
+*/
+template<class T, class Compare>
+void RedBlackTree<T, Compare>::afterInsert(Node<T>* node, bool added) {
+
+	if (added) {
+
+		node->setRed(true);
+
+		this->addFixup(node);
+	}
+}
+
+/*
+* Removes a node and restores the black heights,
+* at most three rotations
+* @param node The node to remove
+*/
+template<class T, class Compare>
+void RedBlackTree<T, Compare>::removeNode(Node<T>* node) {
+
+	// the node that leaves its place, and the child that takes it
+	bool removedRed;
+	Node<T>* child;
+
+	if (node->getLeft() != nullptr && node->getRight() != nullptr) {
+
+		// the successor is spliced into node's place and takes its color,
+		// so the color missing from the tree is the successor's
+		Node<T>* successor = RedBlackTree::leftMost(node->getRight());
+
+		removedRed = successor->isRed();
+		child = successor->getRight();
+
+		successor->setRed(node->isRed());
+
+	} else {
+
+		removedRed = node->isRed();
+		child = (node->getLeft() != nullptr) ? node->getLeft() : node->getRight();
+	}
+
+	Node<T>* parent = this->eraseNode(node);
+
+	if (!removedRed) {
+
+		this->removeFixup(child, parent);
+	}
+}
+
+/*
+* Creates a copy of a node with its item, size and color
+* @param other The node to copy
+* @return the new node
+*/
+template<class T, class Compare>
+Node<T>* RedBlackTree<T, Compare>::cloneNode(const Node<T>* other) {
+
+	Node<T>* node = BinarySearchTree<T, Compare>::cloneNode(other);
+
+	node->setRed(other->isRed());
+
+	return node;
+}
+
+/*
+* Colors a tree of minimum height built by readTree or rebalance:
+* the nodes on the deepest level red and every other node black.
+* Every empty child of such a tree is on one of its last two levels,
+* so all paths then pass the same number of black nodes.
+*/
+template<class T, class Compare>
+void RedBlackTree<T, Compare>::fixTree() {
+
+	Node<T>* root = this->getRoot();
+
+	int height(this->getHeight()), depth(1);
+
+	for (Node<T>* node = root; node != nullptr;
+		 node = RedBlackTree::preorderNext(node, root, depth)) {
+
+		node->setRed(depth == height && depth > 1);
+	}
+}
+
+/*
+* Links left, middle and right by black height: when one side has
+* more black nodes on its paths middle goes red in place of the
+* first black node down its inner spine with as many as the other
+* side, then the colors above are restored like after adding,
+* O(difference in black height).
+* Red roots are made black first, which keeps both sides valid.
+* @param left The lower subtree and its black height
+* @param middle The node in between
+* @param right The upper subtree and its black height
+* @return the joined subtree, black, and its black height
+*/
+template<class T, class Compare>
+typename RedBlackTree<T, Compare>::Subtree RedBlackTree<T, Compare>::joinNodes(Subtree left, Node<T>* middle,
+                                                                               Subtree right) {
+
+	if (RedBlackTree::isRed(left.root)) {
+
+		left.root->setRed(false);
+
+		++left.rank;
+	}
+	if (RedBlackTree::isRed(right.root)) {
+
+		right.root->setRed(false);
+
+		++right.rank;
+	}
+
+	if (left.rank == right.rank) {
+
+		Node<T>* root = BinarySearchTree<T, Compare>::joinNodes(left, middle, right).root;
+
+		root->setRed(false);
+
+		return {root, left.rank + 1};
+	}
+
+	// height is the black height of curr, which counts curr if black
+	bool taller = left.rank > right.rank;
+
+	Node<T>* parent = taller ? left.root : right.root,
+		   * curr = taller ? parent->getRight() : parent->getLeft();
+
+	int top = taller ? left.rank : right.rank,
+		height = top - 1,
+		target = taller ? right.rank : left.rank;
+
+	parent->setParent(nullptr);
+
+	while (RedBlackTree::isRed(curr) || height > target) {
+
+		if (!RedBlackTree::isRed(curr)) {
+
+			--height;
+		}
+
+		parent = curr;
+		curr = taller ? curr->getRight() : curr->getLeft();
+	}
+
+	if (taller) {
+
+		BinarySearchTree<T, Compare>::joinNodes({curr, target}, middle, right);
+
+		parent->setRight(middle);
+
+	} else {
+
+		BinarySearchTree<T, Compare>::joinNodes(left, middle, {curr, target});
+
+		parent->setLeft(middle);
+	}
+
+	middle->setParent(parent);
+	middle->setRed(true);
+
+	RedBlackTree::fixSizes(parent);
+
+	if (this->addFixup(middle)) {
+
+		++top;
+	}
+
+	return {RedBlackTree::topOf(middle), top};
+}
+
+/*
+* Gets the black height of a subtree, counting down its left spine
+* @param root The root of the subtree, possibly nullptr
+* @return its black height
+*/
+template<class T, class Compare>
+int RedBlackTree<T, Compare>::rankOf(const Node<T>* root) const {
+
+	return RedBlackTree::blackHeight(root);
+}
+
+/*
+* Gets what a node adds to the black height of its children
+* @param node The node
+* @return 1 if black, 0 if red
+*/
+template<class T, class Compare>
+int RedBlackTree<T, Compare>::rankStep(const Node<T>* node) const {
+
+	return node->isRed() ? 0 : 1;
+}
+
+/*
+* Makes root the root of the tree and colors it black. A subtree
+* left over from a split or join may have a red root, and adding
+* below a red root would look for a grandparent above it.
+* @param root The new root, possibly nullptr
+*/
+template<class T, class Compare>
+void RedBlackTree<T, Compare>::setRoot(Node<T>* root) {
+
+	BinarySearchTree<T, Compare>::setRoot(root);
+
+	if (root != nullptr) {
+
+		root->setRed(false);
+	}
+}
+
+/*
+* Restores the colors after adding a red node, recoloring
+* up the tree and rotating at most twice
+* @param node The new node
+* @return true if the recoloring reached the top, which then turns
+*         black and adds one to the black height
+*/
+template<class T, class Compare>
+bool RedBlackTree<T, Compare>::addFixup(Node<T>* node) {
+
+	Node<T>* parent;
+
+	while ((parent = node->getParent()) != nullptr && parent->isRed()) {
+
+		// a red parent is never the root
+		Node<T>* grandparent = parent->getParent();
+
+		if (parent == grandparent->getLeft()) {
+
+			Node<T>* uncle = grandparent->getRight();
+
+			if (RedBlackTree::isRed(uncle)) {
+
+				parent->setRed(false);
+				uncle->setRed(false);
+				grandparent->setRed(true);
+
+				node = grandparent;
+
+			} else {
+
+				if (node == parent->getRight()) {
+
+					this->rotateLeft(parent);
+
+					parent = node;
+				}
+
+				parent->setRed(false);
+				grandparent->setRed(true);
+
+				this->rotateRight(grandparent);
+
+				break;
+			}
+
+		} else {
+
+			Node<T>* uncle = grandparent->getLeft();
+
+			if (RedBlackTree::isRed(uncle)) {
+
+				parent->setRed(false);
+				uncle->setRed(false);
+				grandparent->setRed(true);
+
+				node = grandparent;
+
+			} else {
+
+				if (node == parent->getLeft()) {
+
+					this->rotateRight(parent);
+
+					parent = node;
+				}
+
+				parent->setRed(false);
+				grandparent->setRed(true);
+
+				this->rotateLeft(grandparent);
+
+				break;
+			}
+		}
+	}
+
+	// recoloring that reaches the top leaves it red, the top may be the
+	// root of a subtree being joined rather than of the tree
+	if (node->getParent() == nullptr && node->isRed()) {
+
+		node->setRed(false);
+
+		return true;
+	}
+
+	return false;
+}
+
+/*
+* Restores the black heights after removing a black node. The place
+* below parent is one black node short, it is fixed by borrowing from
+* the sibling's side or pushed up a level by recoloring the sibling.
+* @param node The node that took the removed node's place, possibly nullptr
+* @param parent The parent of that place
+*/
+template<class T, class Compare>
+void RedBlackTree<T, Compare>::removeFixup(Node<T>* node, Node<T>* parent) {
+
+	while (parent != nullptr && !RedBlackTree::isRed(node)) {
+
+		if (node == parent->getLeft()) {
+
+			Node<T>* sibling = parent->getRight();
+
+			if (sibling->isRed()) {
+
+				sibling->setRed(false);
+				parent->setRed(true);
+
+				this->rotateLeft(parent);
+
+				sibling = parent->getRight();
+			}
+
+			if (!RedBlackTree::isRed(sibling->getLeft()) && !RedBlackTree::isRed(sibling->getRight())) {
+
+				sibling->setRed(true);
+
+				node = parent;
+				parent = node->getParent();
+
+			} else {
+
+				if (!RedBlackTree::isRed(sibling->getRight())) {
+
+					sibling->getLeft()->setRed(false);
+					sibling->setRed(true);
+
+					sibling = this->rotateRight(sibling);
+				}
+
+				sibling->setRed(parent->isRed());
+				parent->setRed(false);
+				sibling->getRight()->setRed(false);
+
+				this->rotateLeft(parent);
+
+				node = this->getRoot();
+				parent = nullptr;
+			}
+
+		} else {
+
+			Node<T>* sibling = parent->getLeft();
+
+			if (sibling->isRed()) {
+
+				sibling->setRed(false);
+				parent->setRed(true);
+
+				this->rotateRight(parent);
+
+				sibling = parent->getLeft();
+			}
+
+			if (!RedBlackTree::isRed(sibling->getRight()) && !RedBlackTree::isRed(sibling->getLeft())) {
+
+				sibling->setRed(true);
+
+				node = parent;
+				parent = node->getParent();
+
+			} else {
+
+				if (!RedBlackTree::isRed(sibling->getLeft())) {
+
+					sibling->getRight()->setRed(false);
+					sibling->setRed(true);
+
+					sibling = this->rotateLeft(sibling);
+				}
+
+				sibling->setRed(parent->isRed());
+				parent->setRed(false);
+				sibling->getLeft()->setRed(false);
+
+				this->rotateRight(parent);
+
+				node = this->getRoot();
+				parent = nullptr;
+			}
+		}
+	}
+
+	if (node != nullptr) {
+
+		node->setRed(false);
+	}
+}
+
+/*
+* Checks the color of a possibly null node
+* @param node The node
+* @return true if red, false if black or nullptr
+*/
+template<class T, class Compare>
+bool RedBlackTree<T, Compare>::isRed(const Node<T>* node) {
+
+	return node != nullptr && node->isRed();
+}
+
+/*
+* Counts the black nodes on the way down from node to an empty child
+* @param node The root of a subtree, possibly nullptr
+* @return its black height, 0 for nullptr
+*/
+template<class T, class Compare>
+int RedBlackTree<T, Compare>::blackHeight(const Node<T>* node) {
+
+	int height(0);
+
+	for (; node != nullptr; node = node->getLeft()) {
+
+		if (!node->isRed()) {
+
+			++height;
+		}
+	}
+
+	return height;
+}
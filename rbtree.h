@@ -0,0 +1,212 @@
+/*
+* rbtree.h
+*
+* RedBlackTree specs
+*
+* A RedBlackTree is a BinarySearchTree where every node is red or black,
+* no red node has a red child and every path down from a node passes
+* the same number of black nodes. Its height stays under 2log(n + 1),
+* a little taller than an AVLTree, but adding takes at most two
+* rotations and removing at most three, and the recoloring above them
+* stops early, which suits workloads with many updates per lookup.
+*
+* It uses plain Nodes from the BinarySearchTree's arena, the color is a
+* bit of the node's parent pointer so the nodes are no bigger than in
+* a plain tree. Everything but add and remove is inherited, and
+* splitting and joining trees link subtrees by black height. Black
+* heights are not stored: a split or join counts the black height of
+* the tree once and works out the height of every piece from there,
+* so each join costs the difference in height and a split O(log n).
+*/
+
+#ifndef REDBLACKTREE_H
+#define REDBLACKTREE_H
+
+#include "bst.h"
+
+/*
+* Red-black balanced BST
+*
+* @author Juan Arias
+*
+*/
+template<class T, class Compare = std::less<T>>
+class RedBlackTree : public BinarySearchTree<T, Compare> {
+
+public:
+
+	/*
+	* Virtual desctructor
+	*/
+	virtual ~RedBlackTree();
+
+	/*
+	* Constructor
+	*/
+	RedBlackTree();
+
+	/*
+	* Constructor setting the data to be stored
+	*/
+	explicit RedBlackTree(const T& item);
+
+	/*
+	* Constructor setting the comparator, which may hold state
+	* @param comp The comparator
+	*/
+	explicit RedBlackTree(const Compare& comp);
+
+	/*
+	* Copy constructor
+	* @param other The other tree to copy
+	*/
+	RedBlackTree(const RedBlackTree<T, Compare>& other);
+
+	/*
+	* Move constructor, takes the nodes of other in O(1), other is left empty
+	* @param other The other tree to move from
+	*/
+	RedBlackTree(RedBlackTree<T, Compare>&& other) noexcept;
+
+	/*
+	* Assignment operator overload, makes this a deep copy of other
+	* @param other The other tree to copy
+	* @return this by reference
+	*/
+	RedBlackTree<T, Compare>& operator=(const RedBlackTree<T, Compare>& other);
+
+	/*
+	* Move assignment, clears this and takes the nodes of other in O(1),
+	* other is left empty
+	* @param other The other tree to move from
+	* @return this by reference
+	*/
+	RedBlackTree<T, Compare>& operator=(RedBlackTree<T, Compare>&& other) noexcept;
+
+	/*
+	* Splits the tree by key in O(log n): items less than key stay in this
+	* tree and the others move to the returned tree. Nodes are relinked,
+	* never copied, and the returned tree allocates from this tree's
+	* arena. The shared arena locks every allocation and release, so
+	* the two trees may then be changed on different threads, but
+	* clearing either one destroys its nodes one by one.
+	* @param key The first item of the returned tree
+	* @return the tree with every item not less than key
+	*/
+	RedBlackTree<T, Compare> split(const T& key);
+
+	/*
+	* Moves every item of right to the end of this tree in O(log n),
+	* relinking its nodes, right is left empty. The trees allocate from
+	* the same arena afterwards, and neither may be in use on another
+	* thread during the join. When both arenas are already shared with
+	* other trees (after splits) the items are moved one by one instead.
+	* @param right The tree with the items greater than this tree's
+	* @throws std::invalid_argument if an item of right is not greater
+	*         than every item of this tree
+	*/
+	void join(RedBlackTree<T, Compare>& right);
+
+protected:
+
+	// a subtree and its black height (see BinarySearchTree::Subtree)
+	using typename BinarySearchTree<T, Compare>::Subtree;
+
+	/*
+	* Colors a new node red and restores the colors above it,
+	* at most two rotations
+	* @param node The node holding the item
+	* @param added true if node was just linked, false if it was there
+	*/
+	void afterInsert(Node<T>* node, bool added) override;
+
+	/*
+	* Removes a node and restores the black heights,
+	* at most three rotations
+	* @param node The node to remove
+	*/
+	void removeNode(Node<T>* node) override;
+
+	/*
+	* Creates a copy of a node with its item, size and color
+	* @param other The node to copy
+	* @return the new node
+	*/
+	Node<T>* cloneNode(const Node<T>* other) override;
+
+	/*
+	* Colors a tree of minimum height built by readTree or rebalance:
+	* the nodes on the deepest level red and every other node black
+	*/
+	void fixTree() override;
+
+	/*
+	* Links left, middle and right by black height: when one side has
+	* more black nodes on its paths middle goes red in place of the
+	* first black node down its inner spine with as many as the other
+	* side, then the colors above are restored like after adding,
+	* O(difference in black height)
+	* @param left The lower subtree and its black height
+	* @param middle The node in between
+	* @param right The upper subtree and its black height
+	* @return the joined subtree, black, and its black height
+	*/
+	Subtree joinNodes(Subtree left, Node<T>* middle, Subtree right) override;
+
+	/*
+	* Gets the black height of a subtree, counting down its left spine
+	* @param root The root of the subtree, possibly nullptr
+	* @return its black height
+	*/
+	int rankOf(const Node<T>* root) const override;
+
+	/*
+	* Gets what a node adds to the black height of its children
+	* @param node The node
+	* @return 1 if black, 0 if red
+	*/
+	int rankStep(const Node<T>* node) const override;
+
+	/*
+	* Makes root the root of the tree and colors it black. A subtree
+	* left over from a split or join may have a red root, and adding
+	* below a red root would look for a grandparent above it.
+	* @param root The new root, possibly nullptr
+	*/
+	void setRoot(Node<T>* root) override;
+
+private:
+
+	/*
+	* Restores the colors after adding a red node, recoloring
+	* up the tree and rotating at most twice
+	* @param node The new node
+	* @return true if the recoloring reached the top, which then turns
+	*         black and adds one to the black height
+	*/
+	bool addFixup(Node<T>* node);
+
+	/*
+	* Restores the black heights after removing a black node
+	* @param node The node that took the removed node's place, possibly nullptr
+	* @param parent The parent of that place
+	*/
+	void removeFixup(Node<T>* node, Node<T>* parent);
+
+	/*
+	* Checks the color of a possibly null node
+	* @param node The node
+	* @return true if red, false if black or nullptr
+	*/
+	static bool isRed(const Node<T>* node);
+
+	/*
+	* Counts the black nodes on the way down from node to an empty child
+	* @param node The root of a subtree, possibly nullptr
+	* @return its black height, 0 for nullptr
+	*/
+	static int blackHeight(const Node<T>* node);
+};
+
+#include "rbtree.cpp"
+#endif // REDBLACKTREE_H
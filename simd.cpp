@@ -0,0 +1,543 @@
+/*
+* simd.cpp
+*
+* SimdSearch implementations
+*
+* The vector kernels only exist on x86-64 with GCC or Clang, elsewhere
+* supported() is SCALAR and they are never called. Comparisons are
+* signed for integers and ordered (false with NaN) for floating point,
+* the same answers as <.
+*
+* DO NOT compile this file, it is included at the bottom of simd.h
+*/
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SIMDSEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+* Gets the best instruction set of this processor, detected once
+* @return the best level supported
+*/
+inline SimdSearch::Level SimdSearch::supported() {
+
+	static const Level best = SimdSearch::detect();
+
+	return best;
+}
+
+/*
+* Gets the instruction set the kernels use now
+* @return the level in use
+*/
+inline SimdSearch::Level SimdSearch::level() {
+
+	return SimdSearch::current;
+}
+
+/*
+* Sets the instruction set the kernels use, capped at what the
+* processor supports. Meant for tests and benchmarks, not thread safe.
+* @param level The level to use
+*/
+inline void SimdSearch::useLevel(Level level) {
+
+	SimdSearch::current = (level < SimdSearch::supported()) ? level : SimdSearch::supported();
+}
+
+/*
+* Counts the keys of a block that are less than a query
+* @param keys The keys
+* @param n The number of keys
+* @param query The query
+* @return the number of keys less than query
+*/
+template<class T>
+unsigned SimdSearch::countLess(const T* keys, unsigned n, T query) {
+
+	unsigned less(0), done(0);
+
+	if constexpr (!std::is_void<Lane<T>>::value) {
+
+		if (SimdSearch::current == AVX2) {
+
+			less = SimdSearch::countLessAvx2(keys, n, static_cast<Lane<T>>(query));
+			done = n - n % (32 / sizeof(T));
+
+		} else if (SimdSearch::current == SSE4) {
+
+			less = SimdSearch::countLessSse4(keys, n, static_cast<Lane<T>>(query));
+			done = n - n % (16 / sizeof(T));
+		}
+	}
+
+	// no branch to mispredict, the compiler may vectorize this too
+	for (unsigned i(done); i < n; ++i) {
+
+		less += keys[i] < query;
+	}
+
+	return less;
+}
+
+/*
+* Finds the lower bounds of several queries in an array in Eytzinger
+* order (see frozentree.h), BATCH queries at a time
+* @param keys The array, the key at index k (from 1) is keys[k - 1]
+* @param n The number of keys
+* @param queries The queries
+* @param count The number of queries
+* @param bounds The index of the first key not less than each query,
+*        0 if there is none
+*/
+template<class T>
+void SimdSearch::lowerBounds(const T* keys, std::size_t n, const T* queries,
+                             std::size_t count, std::size_t* bounds) {
+
+	std::size_t i(0);
+
+	if constexpr (!std::is_void<Lane<T>>::value) {
+
+		// gathers only pay off while the array is in cache, past that the
+		// scalar searches overlap more misses
+		if (SimdSearch::current == AVX2 && n * sizeof(T) <= GATHER_BYTES) {
+
+			Lane<T> lanes[BATCH];
+
+			for (; i + BATCH <= count; i += BATCH) {
+
+				for (std::size_t j(0); j < BATCH; ++j) {
+
+					lanes[j] = static_cast<Lane<T>>(queries[i + j]);
+				}
+
+				SimdSearch::lowerBoundsAvx2(keys, n, lanes, bounds + i);
+			}
+		}
+	}
+
+	for (; i < count; i += BATCH) {
+
+		std::size_t size = (count - i < BATCH) ? count - i : BATCH;
+
+		SimdSearch::lowerBoundsScalar(keys, n, queries + i, size, bounds + i);
+	}
+}
+
+/*
+* Finds the lower bounds of BATCH queries with scalar code,
+* descending one level of every search per round
+* @param keys The array in Eytzinger order
+* @param n The number of keys
+* @param queries The queries
+* @param count The number of queries, at most BATCH
+* @param bounds The lower bound of each query
+*/
+template<class T>
+void SimdSearch::lowerBoundsScalar(const T* keys, std::size_t n, const T* queries,
+                                   std::size_t count, std::size_t* bounds) {
+
+	std::size_t k[BATCH];
+
+	for (std::size_t j(0); j < count; ++j) {
+
+		k[j] = 1;
+	}
+
+	// every search takes one step per level, those past a leaf stay put
+	for (std::size_t levels(n); levels > 0; levels >>= 1) {
+
+		for (std::size_t j(0); j < count; ++j) {
+
+			std::size_t curr = k[j];
+
+			k[j] = (curr <= n) ? 2 * curr + (keys[curr - 1] < queries[j]) : curr;
+		}
+	}
+
+	for (std::size_t j(0); j < count; ++j) {
+
+		bounds[j] = SimdSearch::settle(k[j]);
+	}
+}
+
+/*
+* Turns the index where a search fell off the tree into its answer,
+* dropping the trailing right turns and the last left turn
+* @param k The index past a leaf
+* @return the lower bound, 0 if none
+*/
+inline std::size_t SimdSearch::settle(std::size_t k) {
+
+#if defined(__GNUC__)
+	return k >> (__builtin_ctzll(~static_cast<unsigned long long>(k)) + 1);
+#else
+	while (k & 1) {
+
+		k >>= 1;
+	}
+
+	return k >> 1;
+#endif
+}
+
+#ifdef SIMDSEARCH_X86
+
+/*
+* AVX2: 8 int keys per compare
+*/
+__attribute__((target("avx2")))
+inline unsigned SimdSearch::countLessAvx2(const void* keys, unsigned n, std::int32_t query) {
+
+	const __m256i* block = static_cast<const __m256i*>(keys);
+	__m256i q = _mm256_set1_epi32(query);
+
+	unsigned less(0);
+
+	for (unsigned i(0); i < n / 8; ++i) {
+
+		__m256i lt = _mm256_cmpgt_epi32(q, _mm256_loadu_si256(block + i));
+
+		less += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(lt)));
+	}
+
+	return less;
+}
+
+/*
+* AVX2: 4 long keys per compare
+*/
+__attribute__((target("avx2")))
+inline unsigned SimdSearch::countLessAvx2(const void* keys, unsigned n, std::int64_t query) {
+
+	const __m256i* block = static_cast<const __m256i*>(keys);
+	__m256i q = _mm256_set1_epi64x(query);
+
+	unsigned less(0);
+
+	for (unsigned i(0); i < n / 4; ++i) {
+
+		__m256i lt = _mm256_cmpgt_epi64(q, _mm256_loadu_si256(block + i));
+
+		less += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(lt)));
+	}
+
+	return less;
+}
+
+/*
+* AVX2: 8 float keys per compare
+*/
+__attribute__((target("avx2")))
+inline unsigned SimdSearch::countLessAvx2(const void* keys, unsigned n, float query) {
+
+	const float* block = static_cast<const float*>(keys);
+	__m256 q = _mm256_set1_ps(query);
+
+	unsigned less(0);
+
+	for (unsigned i(0); i + 8 <= n; i += 8) {
+
+		__m256 lt = _mm256_cmp_ps(_mm256_loadu_ps(block + i), q, _CMP_LT_OQ);
+
+		less += __builtin_popcount(_mm256_movemask_ps(lt));
+	}
+
+	return less;
+}
+
+/*
+* AVX2: 4 double keys per compare
+*/
+__attribute__((target("avx2")))
+inline unsigned SimdSearch::countLessAvx2(const void* keys, unsigned n, double query) {
+
+	const double* block = static_cast<const double*>(keys);
+	__m256d q = _mm256_set1_pd(query);
+
+	unsigned less(0);
+
+	for (unsigned i(0); i + 4 <= n; i += 4) {
+
+		__m256d lt = _mm256_cmp_pd(_mm256_loadu_pd(block + i), q, _CMP_LT_OQ);
+
+		less += __builtin_popcount(_mm256_movemask_pd(lt));
+	}
+
+	return less;
+}
+
+/*
+* SSE4.2: 4 int keys per compare
+*/
+__attribute__((target("sse4.2,popcnt")))
+inline unsigned SimdSearch::countLessSse4(const void* keys, unsigned n, std::int32_t query) {
+
+	const __m128i* block = static_cast<const __m128i*>(keys);
+	__m128i q = _mm_set1_epi32(query);
+
+	unsigned less(0);
+
+	for (unsigned i(0); i < n / 4; ++i) {
+
+		__m128i lt = _mm_cmpgt_epi32(q, _mm_loadu_si128(block + i));
+
+		less += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(lt)));
+	}
+
+	return less;
+}
+
+/*
+* SSE4.2: 2 long keys per compare
+*/
+__attribute__((target("sse4.2,popcnt")))
+inline unsigned SimdSearch::countLessSse4(const void* keys, unsigned n, std::int64_t query) {
+
+	const __m128i* block = static_cast<const __m128i*>(keys);
+	__m128i q = _mm_set1_epi64x(query);
+
+	unsigned less(0);
+
+	for (unsigned i(0); i < n / 2; ++i) {
+
+		__m128i lt = _mm_cmpgt_epi64(q, _mm_loadu_si128(block + i));
+
+		less += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(lt)));
+	}
+
+	return less;
+}
+
+/*
+* SSE4.2: 4 float keys per compare
+*/
+__attribute__((target("sse4.2,popcnt")))
+inline unsigned SimdSearch::countLessSse4(const void* keys, unsigned n, float query) {
+
+	const float* block = static_cast<const float*>(keys);
+	__m128 q = _mm_set1_ps(query);
+
+	unsigned less(0);
+
+	for (unsigned i(0); i + 4 <= n; i += 4) {
+
+		less += __builtin_popcount(_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(block + i), q)));
+	}
+
+	return less;
+}
+
+/*
+* SSE4.2: 2 double keys per compare
+*/
+__attribute__((target("sse4.2,popcnt")))
+inline unsigned SimdSearch::countLessSse4(const void* keys, unsigned n, double query) {
+
+	const double* block = static_cast<const double*>(keys);
+	__m128d q = _mm_set1_pd(query);
+
+	unsigned less(0);
+
+	for (unsigned i(0); i + 2 <= n; i += 2) {
+
+		less += __builtin_popcount(_mm_movemask_pd(_mm_cmplt_pd(_mm_loadu_pd(block + i), q)));
+	}
+
+	return less;
+}
+
+/*
+* AVX2: 8 int searches, one gather per level. A search past a leaf
+* gathers nothing and keeps its index.
+*/
+__attribute__((target("avx2")))
+inline void SimdSearch::lowerBoundsAvx2(const void* keys, std::size_t n, const std::int32_t* queries, std::size_t* bounds) {
+
+	const int* base = static_cast<const int*>(keys);
+
+	__m256i q = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(queries));
+	__m256i k = _mm256_set1_epi32(1);
+	__m256i last = _mm256_set1_epi32(static_cast<int>(n));
+	__m256i one = _mm256_set1_epi32(1);
+
+	for (std::size_t levels(n); levels > 0; levels >>= 1) {
+
+		__m256i inside = _mm256_xor_si256(_mm256_cmpgt_epi32(k, last), _mm256_set1_epi32(-1));
+		__m256i key = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), base,
+		                                          _mm256_sub_epi32(k, one), inside, 4);
+
+		// 2k + 1 where the key is less than the query: subtracting -1 adds 1
+		__m256i next = _mm256_sub_epi32(_mm256_slli_epi32(k, 1), _mm256_cmpgt_epi32(q, key));
+
+		k = _mm256_blendv_epi8(k, next, inside);
+	}
+
+	alignas(32) std::int32_t ends[BATCH];
+
+	_mm256_store_si256(reinterpret_cast<__m256i*>(ends), k);
+
+	for (std::size_t j(0); j < BATCH; ++j) {
+
+		bounds[j] = SimdSearch::settle(static_cast<std::size_t>(ends[j]));
+	}
+}
+
+/*
+* AVX2: 8 long searches as two interleaved groups of 4, one gather
+* per group and level
+*/
+__attribute__((target("avx2")))
+inline void SimdSearch::lowerBoundsAvx2(const void* keys, std::size_t n, const std::int64_t* queries, std::size_t* bounds) {
+
+	const long long* base = static_cast<const long long*>(keys);
+
+	__m256i q[2] = {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(queries)),
+	                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(queries + 4))};
+	__m256i k[2] = {_mm256_set1_epi64x(1), _mm256_set1_epi64x(1)};
+	__m256i last = _mm256_set1_epi64x(static_cast<long long>(n));
+	__m256i one = _mm256_set1_epi64x(1);
+
+	for (std::size_t levels(n); levels > 0; levels >>= 1) {
+
+		for (int g(0); g < 2; ++g) {
+
+			__m256i inside = _mm256_xor_si256(_mm256_cmpgt_epi64(k[g], last), _mm256_set1_epi64x(-1));
+			__m256i key = _mm256_mask_i64gather_epi64(_mm256_setzero_si256(), base,
+			                                          _mm256_sub_epi64(k[g], one), inside, 8);
+			__m256i next = _mm256_sub_epi64(_mm256_slli_epi64(k[g], 1), _mm256_cmpgt_epi64(q[g], key));
+
+			k[g] = _mm256_blendv_epi8(k[g], next, inside);
+		}
+	}
+
+	alignas(32) std::int64_t ends[BATCH];
+
+	_mm256_store_si256(reinterpret_cast<__m256i*>(ends), k[0]);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(ends + 4), k[1]);
+
+	for (std::size_t j(0); j < BATCH; ++j) {
+
+		bounds[j] = SimdSearch::settle(static_cast<std::size_t>(ends[j]));
+	}
+}
+
+/*
+* AVX2: 8 float searches, one gather per level
+*/
+__attribute__((target("avx2")))
+inline void SimdSearch::lowerBoundsAvx2(const void* keys, std::size_t n, const float* queries, std::size_t* bounds) {
+
+	const float* base = static_cast<const float*>(keys);
+
+	__m256 q = _mm256_loadu_ps(queries);
+	__m256i k = _mm256_set1_epi32(1);
+	__m256i last = _mm256_set1_epi32(static_cast<int>(n));
+	__m256i one = _mm256_set1_epi32(1);
+
+	for (std::size_t levels(n); levels > 0; levels >>= 1) {
+
+		__m256i inside = _mm256_xor_si256(_mm256_cmpgt_epi32(k, last), _mm256_set1_epi32(-1));
+		__m256 key = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, _mm256_sub_epi32(k, one),
+		                                      _mm256_castsi256_ps(inside), 4);
+		__m256i lt = _mm256_castps_si256(_mm256_cmp_ps(key, q, _CMP_LT_OQ));
+		__m256i next = _mm256_sub_epi32(_mm256_slli_epi32(k, 1), lt);
+
+		k = _mm256_blendv_epi8(k, next, inside);
+	}
+
+	alignas(32) std::int32_t ends[BATCH];
+
+	_mm256_store_si256(reinterpret_cast<__m256i*>(ends), k);
+
+	for (std::size_t j(0); j < BATCH; ++j) {
+
+		bounds[j] = SimdSearch::settle(static_cast<std::size_t>(ends[j]));
+	}
+}
+
+/*
+* AVX2: 8 double searches as two interleaved groups of 4
+*/
+__attribute__((target("avx2")))
+inline void SimdSearch::lowerBoundsAvx2(const void* keys, std::size_t n, const double* queries, std::size_t* bounds) {
+
+	const double* base = static_cast<const double*>(keys);
+
+	__m256d q[2] = {_mm256_loadu_pd(queries), _mm256_loadu_pd(queries + 4)};
+	__m256i k[2] = {_mm256_set1_epi64x(1), _mm256_set1_epi64x(1)};
+	__m256i last = _mm256_set1_epi64x(static_cast<long long>(n));
+	__m256i one = _mm256_set1_epi64x(1);
+
+	for (std::size_t levels(n); levels > 0; levels >>= 1) {
+
+		for (int g(0); g < 2; ++g) {
+
+			__m256i inside = _mm256_xor_si256(_mm256_cmpgt_epi64(k[g], last), _mm256_set1_epi64x(-1));
+			__m256d key = _mm256_mask_i64gather_pd(_mm256_setzero_pd(), base, _mm256_sub_epi64(k[g], one),
+			                                       _mm256_castsi256_pd(inside), 8);
+			__m256i lt = _mm256_castpd_si256(_mm256_cmp_pd(key, q[g], _CMP_LT_OQ));
+			__m256i next = _mm256_sub_epi64(_mm256_slli_epi64(k[g], 1), lt);
+
+			k[g] = _mm256_blendv_epi8(k[g], next, inside);
+		}
+	}
+
+	alignas(32) std::int64_t ends[BATCH];
+
+	_mm256_store_si256(reinterpret_cast<__m256i*>(ends), k[0]);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(ends + 4), k[1]);
+
+	for (std::size_t j(0); j < BATCH; ++j) {
+
+		bounds[j] = SimdSearch::settle(static_cast<std::size_t>(ends[j]));
+	}
+}
+
+/*
+* Detects the best instruction set of this processor
+* @return the best level supported
+*/
+inline SimdSearch::Level SimdSearch::detect() {
+
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+
+		return AVX2;
+	}
+
+	if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+
+		return SSE4;
+	}
+
+	return SCALAR;
+}
+
+#else
+
+inline unsigned SimdSearch::countLessAvx2(const void*, unsigned, std::int32_t) { return 0; }
+inline unsigned SimdSearch::countLessAvx2(const void*, unsigned, std::int64_t) { return 0; }
+inline unsigned SimdSearch::countLessAvx2(const void*, unsigned, float) { return 0; }
+inline unsigned SimdSearch::countLessAvx2(const void*, unsigned, double) { return 0; }
+inline unsigned SimdSearch::countLessSse4(const void*, unsigned, std::int32_t) { return 0; }
+inline unsigned SimdSearch::countLessSse4(const void*, unsigned, std::int64_t) { return 0; }
+inline unsigned SimdSearch::countLessSse4(const void*, unsigned, float) { return 0; }
+inline unsigned SimdSearch::countLessSse4(const void*, unsigned, double) { return 0; }
+inline void SimdSearch::lowerBoundsAvx2(const void*, std::size_t, const std::int32_t*, std::size_t*) {}
+inline void SimdSearch::lowerBoundsAvx2(const void*, std::size_t, const std::int64_t*, std::size_t*) {}
+inline void SimdSearch::lowerBoundsAvx2(const void*, std::size_t, const float*, std::size_t*) {}
+inline void SimdSearch::lowerBoundsAvx2(const void*, std::size_t, const double*, std::size_t*) {}
+
+/*
+* Detects the best instruction set of this processor
+* @return SCALAR, there are no kernels for other processors
+*/
+inline SimdSearch::Level SimdSearch::detect() {
+
+	return SCALAR;
+}
+
+#endif // SIMDSEARCH_X86
@@ -0,0 +1,181 @@
+/*
+* simd.h
+*
+* SimdSearch specs
+*
+* Search kernels for arithmetic keys that compare a query against many
+* keys at once. BTree uses them inside its nodes and FrozenTree for
+* batches of lookups. Operations include:
+*
+*	- counting the keys of a block that are less than a query, which is
+*	  the query's position in a sorted block
+*	- finding the lower bounds of 8 queries at a time in an array in
+*	  Eytzinger order, all 8 descending the implicit tree together
+*	- choosing the instruction set at runtime, and lowering it by hand
+*	  for testing and benchmarks
+*
+* int, long, long long, float and double keys ordered by std::less get
+* AVX2 or SSE4.2 code when the processor has it, one vector compare for
+* 8 (AVX2) or 4 (SSE4.2) int or float keys, half as many 64-bit keys.
+* The batch search uses AVX2 gathers to load the 8 keys it compares
+* while the array fits in the L2 cache; for larger arrays, or without
+* AVX2, it interleaves 8 scalar searches, which overlaps their cache
+* misses better than gathers do. Every other key type, and any processor
+* that is not x86-64, uses the scalar code. The kernels are compiled for
+* their instruction set with target attributes, so no compiler flag is
+* needed.
+*/
+
+#ifndef SIMDSEARCH_H
+#define SIMDSEARCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+class SimdSearch {
+
+public:
+
+	/*
+	* Instruction sets the kernels can use, each one includes the ones before
+	*/
+	enum Level { SCALAR, SSE4, AVX2 };
+
+	// Queries searched together by lowerBounds
+	static const std::size_t BATCH = 8;
+
+	/*
+	* Gets the best instruction set of this processor, detected once
+	* @return the best level supported
+	*/
+	static Level supported();
+
+	/*
+	* Gets the instruction set the kernels use now
+	* @return the level in use
+	*/
+	static Level level();
+
+	/*
+	* Sets the instruction set the kernels use, capped at what the
+	* processor supports. Meant for tests and benchmarks, not thread safe.
+	* @param level The level to use
+	*/
+	static void useLevel(Level level);
+
+	/*
+	* Checks if keys of type T ordered by Compare are compared by value
+	* with <, so countLess and lowerBounds apply
+	* @return true for arithmetic T with std::less
+	*/
+	template<class T, class Compare>
+	static constexpr bool applies() {
+
+		return std::is_arithmetic<T>::value &&
+		       (std::is_same<Compare, std::less<T>>::value || std::is_same<Compare, std::less<>>::value);
+	}
+
+	/*
+	* Counts the keys of a block that are less than a query
+	* @param keys The keys
+	* @param n The number of keys
+	* @param query The query
+	* @return the number of keys less than query
+	*/
+	template<class T>
+	static unsigned countLess(const T* keys, unsigned n, T query);
+
+	/*
+	* Finds the lower bounds of several queries in an array in Eytzinger
+	* order (see frozentree.h), BATCH queries at a time
+	* @param keys The array, the key at index k (from 1) is keys[k - 1]
+	* @param n The number of keys
+	* @param queries The queries
+	* @param count The number of queries
+	* @param bounds The index of the first key not less than each query,
+	*        0 if there is none
+	*/
+	template<class T>
+	static void lowerBounds(const T* keys, std::size_t n, const T* queries,
+	                        std::size_t count, std::size_t* bounds);
+
+private:
+
+	// Instruction set in use
+	static inline Level current = SimdSearch::supported();
+
+	// Largest array lowerBounds searches with gathers, about an L2 cache
+	static const std::size_t GATHER_BYTES = std::size_t(1) << 18;
+
+	/*
+	* Maps a key type to the fixed width type of its vector lanes,
+	* void when there are no kernels for it
+	*/
+	template<class T>
+	using Lane = typename std::conditional<std::is_floating_point<T>::value,
+	             typename std::conditional<std::is_same<T, float>::value || std::is_same<T, double>::value, T, void>::type,
+	             typename std::conditional<std::is_integral<T>::value && std::is_signed<T>::value && sizeof(T) == 4, std::int32_t,
+	             typename std::conditional<std::is_integral<T>::value && std::is_signed<T>::value && sizeof(T) == 8, std::int64_t,
+	             void>::type>::type>::type;
+
+	/*
+	* Finds the lower bounds of BATCH queries with scalar code,
+	* descending one level of every search per round
+	* @param keys The array in Eytzinger order
+	* @param n The number of keys
+	* @param queries The queries
+	* @param count The number of queries, at most BATCH
+	* @param bounds The lower bound of each query
+	*/
+	template<class T>
+	static void lowerBoundsScalar(const T* keys, std::size_t n, const T* queries,
+	                              std::size_t count, std::size_t* bounds);
+
+	/*
+	* Turns the index where a search fell off the tree into its answer,
+	* dropping the trailing right turns and the last left turn
+	* @param k The index past a leaf
+	* @return the lower bound, 0 if none
+	*/
+	static std::size_t settle(std::size_t k);
+
+	/*
+	* Vector kernels, each counts the keys less than query among the
+	* first n - n % width keys, the caller does the rest
+	* @param keys The keys
+	* @param n The number of keys
+	* @param query The query
+	* @return the number of keys less than query in the vector part
+	*/
+	static unsigned countLessAvx2(const void* keys, unsigned n, std::int32_t query);
+	static unsigned countLessAvx2(const void* keys, unsigned n, std::int64_t query);
+	static unsigned countLessAvx2(const void* keys, unsigned n, float query);
+	static unsigned countLessAvx2(const void* keys, unsigned n, double query);
+	static unsigned countLessSse4(const void* keys, unsigned n, std::int32_t query);
+	static unsigned countLessSse4(const void* keys, unsigned n, std::int64_t query);
+	static unsigned countLessSse4(const void* keys, unsigned n, float query);
+	static unsigned countLessSse4(const void* keys, unsigned n, double query);
+
+	/*
+	* Gather kernels, find the lower bounds of BATCH queries at once
+	* @param keys The array in Eytzinger order
+	* @param n The number of keys, at most GATHER_BYTES worth
+	* @param queries BATCH queries
+	* @param bounds The lower bound of each query
+	*/
+	static void lowerBoundsAvx2(const void* keys, std::size_t n, const std::int32_t* queries, std::size_t* bounds);
+	static void lowerBoundsAvx2(const void* keys, std::size_t n, const std::int64_t* queries, std::size_t* bounds);
+	static void lowerBoundsAvx2(const void* keys, std::size_t n, const float* queries, std::size_t* bounds);
+	static void lowerBoundsAvx2(const void* keys, std::size_t n, const double* queries, std::size_t* bounds);
+
+	/*
+	* Detects the best instruction set of this processor
+	* @return the best level supported
+	*/
+	static Level detect();
+};
+
+#include "simd.cpp"
+#endif // SIMDSEARCH_H